@@ -27,19 +27,58 @@ DEFINES += EIGEN_DISABLE_UNALIGNED_ARRAY_ASSERT
 SOURCES += \
     MiniPID/MiniPID.cpp \
     autopilot.cpp \
+    autopilotsettingsfile.cpp \
+    batchpid.cpp \
+    ferrymodel.cpp \
+    guiupdatescheduler.cpp \
     losolver.cpp \
     main.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    outputencoder.cpp \
+    plothistory.cpp \
+    plotwidget.cpp \
+    posehistory.cpp \
+    posesolver.cpp \
+    recording.cpp \
+    replaywindow.cpp \
+    shmtransport.cpp \
+    telemetryarchive.cpp \
+    telemetrypublisher.cpp \
+    telemetrytablemodel.cpp \
+    trackmapwidget.cpp \
+    trackstore.cpp \
+    udpreceiver.cpp
 
 HEADERS += \
     MiniPID/MiniPID.h \
     autopilot.h \
+    autopilotsettingsfile.h \
+    batchpid.h \
+    ferrymodel.h \
+    guiupdatescheduler.h \
     losolver.h \
-    mainwindow.h
+    mainwindow.h \
+    outputencoder.h \
+    plothistory.h \
+    plotwidget.h \
+    posehistory.h \
+    posesolver.h \
+    recording.h \
+    replaywindow.h \
+    shmtransport.h \
+    telemetryarchive.h \
+    telemetrypublisher.h \
+    telemetrytablemodel.h \
+    trackmapwidget.h \
+    trackstore.h \
+    udpreceiver.h
 
 FORMS += \
     mainwindow.ui
 
+# shm_open (needed by older glibc)
+linux: LIBS += -lrt
+
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
@@ -0,0 +1,492 @@
+/*
+    arrowwriter.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include "arrowwriter.h"
+
+namespace
+{
+
+// Minimal flatbuffers builder. Like the real one, builds the buffer from the
+// end towards the beginning, so objects referred to are created first and
+// offsets are counted from the end of the buffer (alignment too, the final
+// size is made a multiple of 8).
+class FlatBufferBuilder
+{
+public:
+    typedef uint32_t Offset;
+
+    std::vector<uint8_t> data;
+
+    Offset getSize(void) const { return static_cast<Offset>(data.size()); }
+
+    template <typename T>
+    void addScalar(const int field, const T value)
+    {
+        prependScalar(value);
+        fieldOffsets.push_back({ field, getSize() });
+    }
+
+    void addOffset(const int field, const Offset target)
+    {
+        prependOffset(target);
+        fieldOffsets.push_back({ field, getSize() });
+    }
+
+    void startTable(void)
+    {
+        fieldOffsets.clear();
+        tableStart = getSize();
+    }
+
+    Offset endTable(void)
+    {
+        prependScalar<int32_t>(0);     // Offset to the vtable, set below
+
+        const Offset table = getSize();
+        int fieldCount = 0;
+
+        for (const FieldOffset& fieldOffset : fieldOffsets)
+        {
+            fieldCount = (fieldOffset.field >= fieldCount) ? fieldOffset.field + 1 : fieldCount;
+        }
+
+        std::vector<uint16_t> vtable(2 + fieldCount, 0);
+
+        vtable[0] = static_cast<uint16_t>(vtable.size() * sizeof(uint16_t));
+        vtable[1] = static_cast<uint16_t>(table - tableStart);
+
+        for (const FieldOffset& fieldOffset : fieldOffsets)
+        {
+            vtable[2 + fieldOffset.field] = static_cast<uint16_t>(table - fieldOffset.offset);
+        }
+
+        for (size_t i = vtable.size(); i-- > 0;)
+        {
+            prependScalar(vtable[i]);
+        }
+
+        // vtable is before the table, so the (signed) offset is positive
+        const int32_t vtableOffset = static_cast<int32_t>(getSize() - table);
+
+        memcpy(&data[getSize() - table], &vtableOffset, sizeof(vtableOffset));
+
+        return table;
+    }
+
+    Offset createString(const std::string& string)
+    {
+        align(sizeof(uint32_t), string.size() + 1);
+        prependBytes("", 1);
+        prependBytes(string.data(), string.size());
+        prependScalar(static_cast<uint32_t>(string.size()));
+
+        return getSize();
+    }
+
+    Offset createOffsetVector(const std::vector<Offset>& targets)
+    {
+        align(sizeof(uint32_t), targets.size() * sizeof(uint32_t));
+
+        for (size_t i = targets.size(); i-- > 0;)
+        {
+            prependOffset(targets[i]);
+        }
+
+        prependScalar(static_cast<uint32_t>(targets.size()));
+
+        return getSize();
+    }
+
+    // Structs as they are in memory (layout must match the schema's)
+    Offset createStructVector(const void* elements, const size_t count, const size_t elementSize)
+    {
+        align(8, count * elementSize);
+        prependBytes(elements, count * elementSize);
+        prependScalar(static_cast<uint32_t>(count));
+
+        return getSize();
+    }
+
+    void finish(const Offset root)
+    {
+        align(8, sizeof(uint32_t));
+        prependOffset(root);
+    }
+
+private:
+    struct FieldOffset
+    {
+        int field;
+        Offset offset;
+    };
+
+    std::vector<FieldOffset> fieldOffsets;
+    Offset tableStart = 0;
+
+    void prependBytes(const void* bytes, const size_t size)
+    {
+        if (size == 0)
+        {
+            return;
+        }
+
+        data.insert(data.begin(), static_cast<const uint8_t*>(bytes), static_cast<const uint8_t*>(bytes) + size);
+    }
+
+    // Pads so that the end of the next "size" bytes will be aligned
+    void align(const size_t alignment, const size_t size = 0)
+    {
+        const size_t padding = (alignment - (data.size() + size) % alignment) % alignment;
+
+        data.insert(data.begin(), padding, 0);
+    }
+
+    template <typename T>
+    void prependScalar(const T value)
+    {
+        align(sizeof(T));
+        prependBytes(&value, sizeof(T));
+    }
+
+    void prependOffset(const Offset target)
+    {
+        align(sizeof(uint32_t));
+
+        const uint32_t value = getSize() + sizeof(uint32_t) - target;
+
+        prependBytes(&value, sizeof(value));
+    }
+};
+
+// Values from Arrow's Schema.fbs / Message.fbs / File.fbs
+const int16_t metadataVersion = 4;      // V5
+
+enum MessageHeader
+{
+    MESSAGEHEADER_SCHEMA = 1,
+    MESSAGEHEADER_RECORDBATCH = 3
+};
+
+enum TypeId
+{
+    TYPEID_INT = 2,
+    TYPEID_FLOATINGPOINT = 3,
+    TYPEID_TIMESTAMP = 10
+};
+
+// Structs of the flatbuffers
+struct FieldNode
+{
+    int64_t length;
+    int64_t nullCount;
+};
+
+struct BufferLocation
+{
+    int64_t offset;
+    int64_t length;
+};
+
+struct FooterBlock
+{
+    int64_t offset;
+    int32_t metadataLength;
+    int32_t padding;
+    int64_t bodyLength;
+};
+
+static_assert((sizeof(FieldNode) == 16) && (sizeof(BufferLocation) == 16) && (sizeof(FooterBlock) == 24),
+              "Struct layouts must match Arrow's");
+
+const char fileMagic[8] = { 'A', 'R', 'R', 'O', 'W', '1', 0, 0 };
+const uint32_t continuationMarker = 0xFFFFFFFF;
+
+size_t getPaddedSize(const size_t size)
+{
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+FlatBufferBuilder::Offset createSchema(FlatBufferBuilder& builder, const std::vector<ArrowWriter::Field>& fields)
+{
+    std::vector<FlatBufferBuilder::Offset> fieldOffsets;
+
+    for (const ArrowWriter::Field& field : fields)
+    {
+        FlatBufferBuilder::Offset type;
+        uint8_t typeId;
+
+        switch (field.type)
+        {
+        case ArrowWriter::TYPE_INT32:
+        case ArrowWriter::TYPE_INT64:
+            builder.startTable();
+            builder.addScalar<int32_t>(0, (field.type == ArrowWriter::TYPE_INT32) ? 32 : 64);  // bitWidth
+            builder.addScalar<uint8_t>(1, 1);                                                   // is_signed
+            type = builder.endTable();
+            typeId = TYPEID_INT;
+            break;
+
+        case ArrowWriter::TYPE_TIMESTAMP_NS:
+        {
+            const FlatBufferBuilder::Offset timezone = builder.createString("UTC");
+
+            builder.startTable();
+            builder.addScalar<int16_t>(0, 3);       // unit: NANOSECOND
+            builder.addOffset(1, timezone);
+            type = builder.endTable();
+            typeId = TYPEID_TIMESTAMP;
+            break;
+        }
+
+        case ArrowWriter::TYPE_FLOAT64:
+        default:
+            builder.startTable();
+            builder.addScalar<int16_t>(0, 2);       // precision: DOUBLE
+            type = builder.endTable();
+            typeId = TYPEID_FLOATINGPOINT;
+            break;
+        }
+
+        const FlatBufferBuilder::Offset name = builder.createString(field.name);
+        const FlatBufferBuilder::Offset children = builder.createOffsetVector({});
+
+        builder.startTable();
+        builder.addOffset(0, name);
+        builder.addScalar<uint8_t>(1, field.nullable ? 1 : 0);
+        builder.addScalar<uint8_t>(2, typeId);
+        builder.addOffset(3, type);
+        builder.addOffset(5, children);
+        fieldOffsets.push_back(builder.endTable());
+    }
+
+    const FlatBufferBuilder::Offset fieldVector = builder.createOffsetVector(fieldOffsets);
+
+    builder.startTable();
+    builder.addScalar<int16_t>(0, 0);       // endianness: Little
+    builder.addOffset(1, fieldVector);
+
+    return builder.endTable();
+}
+
+FlatBufferBuilder::Offset createMessage(FlatBufferBuilder& builder, const uint8_t headerType,
+                                        const FlatBufferBuilder::Offset header, const int64_t bodyLength)
+{
+    builder.startTable();
+    builder.addScalar<int64_t>(3, bodyLength);
+    builder.addOffset(2, header);
+    builder.addScalar<int16_t>(0, metadataVersion);
+    builder.addScalar<uint8_t>(1, headerType);
+
+    return builder.endTable();
+}
+
+}
+
+int ArrowWriter::getTypeSize(const Type type)
+{
+    return (type == TYPE_INT32) ? 4 : 8;
+}
+
+ArrowWriter::~ArrowWriter()
+{
+    close();
+}
+
+bool ArrowWriter::write(const void* data, const size_t size)
+{
+    if ((size > 0) && (fwrite(data, size, 1, file) != 1))
+    {
+        writeError = true;
+        return false;
+    }
+
+    bytesWritten += size;
+
+    return true;
+}
+
+bool ArrowWriter::writeMessage(const std::vector<uint8_t>& metadata, Block* block)
+{
+    // Metadata is padded so that the body starts 8-byte aligned
+    const int32_t metadataLength = static_cast<int32_t>(getPaddedSize(metadata.size()));
+    const uint8_t padding[8] = { 0 };
+
+    if (block)
+    {
+        block->offset = static_cast<int64_t>(bytesWritten);
+        block->metadataLength = metadataLength + 8;
+    }
+
+    return write(&continuationMarker, sizeof(continuationMarker)) &&
+            write(&metadataLength, sizeof(metadataLength)) &&
+            write(metadata.data(), metadata.size()) &&
+            write(padding, metadataLength - metadata.size());
+}
+
+bool ArrowWriter::open(const std::string& fileName, const std::vector<Field>& fields)
+{
+    close();
+
+    file = fopen(fileName.c_str(), "wb");
+
+    if (!file)
+    {
+        return false;
+    }
+
+    this->fields = fields;
+    batches.clear();
+    bytesWritten = 0;
+    writeError = false;
+
+    FlatBufferBuilder builder;
+    const FlatBufferBuilder::Offset schema = createSchema(builder, fields);
+
+    builder.finish(createMessage(builder, MESSAGEHEADER_SCHEMA, schema, 0));
+
+    if (!write(fileMagic, sizeof(fileMagic)) || !writeMessage(builder.data, nullptr))
+    {
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+bool ArrowWriter::writeBatch(const int64_t rows, const std::vector<Column>& columns)
+{
+    if (!file || (columns.size() != fields.size()))
+    {
+        return false;
+    }
+
+    std::vector<FieldNode> nodes;
+    std::vector<BufferLocation> buffers;
+    int64_t bodyLength = 0;
+    const int64_t validityLength = (rows + 7) / 8;
+
+    for (size_t i = 0; i < columns.size(); i++)
+    {
+        const Column& column = columns[i];
+        const int64_t valuesLength = rows * getTypeSize(fields[i].type);
+
+        if ((static_cast<int64_t>(column.values.size()) < valuesLength) ||
+                ((column.nullCount > 0) && (static_cast<int64_t>(column.validity.size()) < validityLength)))
+        {
+            return false;
+        }
+
+        nodes.push_back({ rows, column.nullCount });
+
+        // Validity bitmap can be left out when there are no nulls
+        const int64_t length = (column.nullCount > 0) ? validityLength : 0;
+
+        buffers.push_back({ bodyLength, length });
+        bodyLength += getPaddedSize(length);
+
+        buffers.push_back({ bodyLength, valuesLength });
+        bodyLength += getPaddedSize(valuesLength);
+    }
+
+    FlatBufferBuilder builder;
+    const FlatBufferBuilder::Offset bufferVector = builder.createStructVector(buffers.data(), buffers.size(), sizeof(BufferLocation));
+    const FlatBufferBuilder::Offset nodeVector = builder.createStructVector(nodes.data(), nodes.size(), sizeof(FieldNode));
+
+    builder.startTable();
+    builder.addScalar<int64_t>(0, rows);
+    builder.addOffset(1, nodeVector);
+    builder.addOffset(2, bufferVector);
+
+    const FlatBufferBuilder::Offset recordBatch = builder.endTable();
+
+    builder.finish(createMessage(builder, MESSAGEHEADER_RECORDBATCH, recordBatch, bodyLength));
+
+    Block block;
+
+    block.bodyLength = bodyLength;
+
+    if (!writeMessage(builder.data, &block))
+    {
+        return false;
+    }
+
+    const uint8_t padding[8] = { 0 };
+
+    for (size_t i = 0; i < columns.size(); i++)
+    {
+        const int64_t length = (columns[i].nullCount > 0) ? validityLength : 0;
+        const int64_t valuesLength = rows * getTypeSize(fields[i].type);
+
+        if (!write(columns[i].validity.data(), length) ||
+                !write(padding, getPaddedSize(length) - length) ||
+                !write(columns[i].values.data(), valuesLength) ||
+                !write(padding, getPaddedSize(valuesLength) - valuesLength))
+        {
+            return false;
+        }
+    }
+
+    batches.push_back(block);
+
+    return true;
+}
+
+bool ArrowWriter::close(void)
+{
+    if (!file)
+    {
+        return false;
+    }
+
+    // End-of-stream marker
+    const uint32_t endOfStream[2] = { continuationMarker, 0 };
+
+    write(endOfStream, sizeof(endOfStream));
+
+    std::vector<FooterBlock> blocks;
+
+    for (const Block& batch : batches)
+    {
+        blocks.push_back({ batch.offset, batch.metadataLength, 0, batch.bodyLength });
+    }
+
+    FlatBufferBuilder builder;
+    const FlatBufferBuilder::Offset recordBatches = builder.createStructVector(blocks.data(), blocks.size(), sizeof(FooterBlock));
+    const FlatBufferBuilder::Offset dictionaries = builder.createStructVector(nullptr, 0, sizeof(FooterBlock));
+    const FlatBufferBuilder::Offset schema = createSchema(builder, fields);
+
+    builder.startTable();
+    builder.addOffset(1, schema);
+    builder.addOffset(2, dictionaries);
+    builder.addOffset(3, recordBatches);
+    builder.addScalar<int16_t>(0, metadataVersion);
+    builder.finish(builder.endTable());
+
+    const int32_t footerLength = static_cast<int32_t>(builder.data.size());
+
+    write(builder.data.data(), builder.data.size());
+    write(&footerLength, sizeof(footerLength));
+    write(fileMagic, 6);
+
+    writeError |= (fclose(file) != 0);
+    file = nullptr;
+
+    return !writeError;
+}
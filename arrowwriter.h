@@ -0,0 +1,94 @@
+/*
+    arrowwriter.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARROWWRITER_H
+#define ARROWWRITER_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Writer of Apache Arrow IPC files (a.k.a. Feather V2, readable by pyarrow,
+// pandas, polars, DuckDB etc.) with fixed width primitive columns only.
+// Metadata (flatbuffers) is serialized by hand, so no Arrow libraries are needed.
+//
+// Data is written as record batches, so only one batch needs to be in memory.
+// Little-endian hosts only (Arrow data is little-endian and buffers are
+// written as they are in memory).
+
+class ArrowWriter
+{
+public:
+    enum Type
+    {
+        TYPE_INT32,
+        TYPE_INT64,
+        TYPE_FLOAT64,
+        TYPE_TIMESTAMP_NS       // int64, ns since epoch (UTC)
+    };
+
+    struct Field
+    {
+        std::string name;
+        Type type;
+        bool nullable;
+    };
+
+    // Buffers of one column of a record batch
+    struct Column
+    {
+        std::vector<uint8_t> values;        // rows * size of the type
+        std::vector<uint8_t> validity;      // Bit per row (LSB first, 1 = valid). Can be empty if no nulls.
+        int64_t nullCount = 0;
+    };
+
+    static int getTypeSize(const Type type);
+
+    ~ArrowWriter();
+
+    bool open(const std::string& fileName, const std::vector<Field>& fields);
+
+    // Writes the footer (file is not readable without it)
+    bool close(void);
+    bool isOpen(void) const { return file != nullptr; }
+
+    // Columns in the order of the fields
+    bool writeBatch(const int64_t rows, const std::vector<Column>& columns);
+
+    uint64_t getBytesWritten(void) const { return bytesWritten; }
+
+private:
+    struct Block
+    {
+        int64_t offset;
+        int32_t metadataLength;
+        int64_t bodyLength;
+    };
+
+    FILE* file = nullptr;
+    std::vector<Field> fields;
+    std::vector<Block> batches;
+    uint64_t bytesWritten = 0;
+    bool writeError = false;
+
+    bool write(const void* data, const size_t size);
+    bool writeMessage(const std::vector<uint8_t>& metadata, Block* block);
+};
+
+#endif // ARROWWRITER_H
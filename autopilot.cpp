@@ -19,12 +19,14 @@
 #include "autopilot.h"
 #include "losolver.h"
 
-Autopilot::Autopilot()
+Autopilot::Autopilot() :
+    pids(PID_COUNT)
 {
 
 }
 
-Autopilot::Autopilot(const Settings& settings)
+Autopilot::Autopilot(const Settings& settings) :
+    pids(PID_COUNT)
 {
     init(settings);
 }
@@ -33,22 +35,50 @@ void Autopilot::init(const Settings &settings)
 {
     this->settings = settings;
 
-    pid_Position_N.setPID(settings.pidSettings_Position.p, settings.pidSettings_Position.i, settings.pidSettings_Position.d, settings.pidSettings_Position.f);
-    pid_Position_N.setOutputLimits(settings.pidSettings_Position.maxOut);
+    pids.setPID(PID_POSITION_N, settings.pidSettings_Position.p, settings.pidSettings_Position.i, settings.pidSettings_Position.d, settings.pidSettings_Position.f);
+    pids.setOutputLimits(PID_POSITION_N, settings.pidSettings_Position.maxOut);
 
-    pid_Position_E.setPID(settings.pidSettings_Position.p, settings.pidSettings_Position.i, settings.pidSettings_Position.d, settings.pidSettings_Position.f);
-    pid_Position_E.setOutputLimits(settings.pidSettings_Position.maxOut);
+    pids.setPID(PID_POSITION_E, settings.pidSettings_Position.p, settings.pidSettings_Position.i, settings.pidSettings_Position.d, settings.pidSettings_Position.f);
+    pids.setOutputLimits(PID_POSITION_E, settings.pidSettings_Position.maxOut);
 
-    pid_Heading.setPID(settings.pidSettings_Heading.p, settings.pidSettings_Heading.i, settings.pidSettings_Heading.d, settings.pidSettings_Heading.f);
-    pid_Heading.setOutputLimits(settings.pidSettings_Heading.maxOut);
+    pids.setPID(PID_HEADING, settings.pidSettings_Heading.p, settings.pidSettings_Heading.i, settings.pidSettings_Heading.d, settings.pidSettings_Heading.f);
+    pids.setOutputLimits(PID_HEADING, settings.pidSettings_Heading.maxOut);
 
-    pid_Position_N.setMaxIOutput(settings.pidSettings_Position.maxI);
-    pid_Position_E.setMaxIOutput(settings.pidSettings_Position.maxI);
-    pid_Heading.setMaxIOutput(settings.pidSettings_Heading.maxI);
+    pids.setMaxIOutput(PID_POSITION_N, settings.pidSettings_Position.maxI);
+    pids.setMaxIOutput(PID_POSITION_E, settings.pidSettings_Position.maxI);
+    pids.setMaxIOutput(PID_HEADING, settings.pidSettings_Heading.maxI);
 
     state = STATE_UNKNOWN;
 }
 
+Autopilot::Settings Autopilot::getDefaultSettings(void)
+{
+    // These are (hand-)tuned to work with FerrySim_Godot
+    Settings settings;
+
+    settings.nearLimit = 20;            // Distance from target where to change from "travel" to "orientation"-mode
+    settings.cruisePropulsion = 50000;
+    settings.cruiseDirectionProp = 0.2;
+
+    settings.pidSettings_Position.p = 20000;
+    settings.pidSettings_Position.i = 200;
+    settings.pidSettings_Position.d = 200000;
+    settings.pidSettings_Position.f = 0;
+    settings.pidSettings_Position.maxI = 50000;
+    settings.pidSettings_Position.maxOut = 20000;
+    settings.pidSettings_Position.rememberI = true;
+
+    settings.pidSettings_Heading.p = 80000;
+    settings.pidSettings_Heading.i = 1000;
+    settings.pidSettings_Heading.d = 500000;
+    settings.pidSettings_Heading.f = 0;
+    settings.pidSettings_Heading.maxI = 50000;
+    settings.pidSettings_Heading.maxOut = 20000;
+    settings.pidSettings_Heading.rememberI = false;
+
+    return settings;
+}
+
 void Autopilot::setDestination(const Destination destination)
 {
     this->destination = destination;
@@ -72,10 +102,6 @@ void Autopilot::update(const Eigen::Transform<double, 3, Eigen::Affine> &transfo
     double relativeBearing = atan2(sin(absBearing - heading), cos(absBearing - heading));
     double headingError = -atan2(sin(destination.heading - heading), cos(destination.heading - heading));
 
-    Eigen::Vector2d velocity = (originCoords_2D_NE - lastOrigin_2D_NE) / cycleTime;
-    double speed = velocity.norm();
-    double directionOfTravel = atan2(velocity(1), velocity(0));
-
     if (distanceToTarget > settings.nearLimit)
     {
         if (relativeBearing < (-M_PI / 2.))
@@ -117,21 +143,26 @@ void Autopilot::update(const Eigen::Transform<double, 3, Eigen::Affine> &transfo
 
             if (!settings.pidSettings_Position.rememberI)
             {
-                pid_Position_N.reset();
-                pid_Position_E.reset();
+                pids.reset(PID_POSITION_N);
+                pids.reset(PID_POSITION_E);
             }
 
             if (!settings.pidSettings_Heading.rememberI)
             {
-                pid_Heading.reset();
+                pids.reset(PID_HEADING);
             }
         }
 
-        pid_Position_N.setSetpoint(targetCoords_2D_NE(0));
-        double propulsion_N = pid_Position_N.getOutput(originCoords_2D_NE(0));
+        // Position controllers try to move origin to target,
+        // heading controller uses headingError as a source value (setpoint 0)
+        const double pidActual[PID_COUNT] = { originCoords_2D_NE(0), originCoords_2D_NE(1), headingError };
+        const double pidSetpoints[PID_COUNT] = { targetCoords_2D_NE(0), targetCoords_2D_NE(1), 0 };
+        double pidOutputs[PID_COUNT];
+
+        pids.getOutputs(pidActual, pidSetpoints, pidOutputs);
 
-        pid_Position_E.setSetpoint(targetCoords_2D_NE(1));
-        double propulsion_E = pid_Position_E.getOutput(originCoords_2D_NE(1));
+        double propulsion_N = pidOutputs[PID_POSITION_N];
+        double propulsion_E = pidOutputs[PID_POSITION_E];
 
         Eigen::Vector2d positionPropulsionVec_2D_NE(-propulsion_N, propulsion_E);
 
@@ -140,10 +171,8 @@ void Autopilot::update(const Eigen::Transform<double, 3, Eigen::Affine> &transfo
         Eigen::Rotation2D<double> rotation(heading);
         Eigen::Vector2d positionPropulsionVec_Ferry = rotation.toRotationMatrix() * positionPropulsionVec_2D_NE;
 
-        // Use headingError as a source value for heading-PID-controller
-        pid_Heading.setSetpoint(0);
 // Use this to test only position:        double headingPropulsion_Ferry = 0;
-        double headingPropulsion_Ferry = pid_Heading.getOutput(headingError);
+        double headingPropulsion_Ferry = pidOutputs[PID_HEADING];
 
         // Heading correction only adds to left/right (or port/starboard) propulsion
         Eigen::Vector2d headingPropulsionVec_Ferry(0, headingPropulsion_Ferry);
@@ -161,17 +190,22 @@ void Autopilot::update(const Eigen::Transform<double, 3, Eigen::Affine> &transfo
         state = STATE_NEAR;
     }
 
-    lastOrigin_2D_NE = originCoords_2D_NE;
-
     if (debugOutputs)
     {
+        // Velocity is only needed for debugging (not calculated otherwise)
+        Eigen::Vector2d velocity = (originCoords_2D_NE - lastOrigin_2D_NE) / cycleTime;
+
         debugOutputs->absBearing = absBearing;
         debugOutputs->relativeBearing = relativeBearing;
         debugOutputs->distanceToTarget = distanceToTarget;
-        debugOutputs->speed = speed;
-        debugOutputs->directionOfTravel = directionOfTravel;
+        debugOutputs->velocityVec = velocity;
+        debugOutputs->speed = velocity.norm();
+        debugOutputs->directionOfTravel = atan2(velocity(1), velocity(0));
         debugOutputs->headingError = headingError;
         debugOutputs->state = state;
     }
+
+    lastOrigin_2D_NE = originCoords_2D_NE;
+    outputs.valid = true;
 }
 
@@ -20,7 +20,7 @@
 #define AUTOPILOT_H
 
 #include "Eigen/Geometry"
-#include "MiniPID/MiniPID.h"
+#include "batchpid.h"
 
 class Autopilot
 {
@@ -94,7 +94,9 @@ public:
     Autopilot();
     Autopilot(const Settings& settings);
     void init(const Settings& settings);
+    static Settings getDefaultSettings(void);
     void setDestination(const Destination destination);
+    // Debug outputs (and calculations needed only for them) are skipped if debugOutputs == nullptr
     void update(const Eigen::Transform<double, 3, Eigen::Affine>& transform, Outputs& outputs, double cycleTime, DebugOutputs* debugOutputs = nullptr);
 
 private:
@@ -104,9 +106,17 @@ private:
     Eigen::Vector2d lastOrigin_2D_NE;
     State state;
 
-    MiniPID pid_Position_N;
-    MiniPID pid_Position_E;
-    MiniPID pid_Heading;
+    // PID-controllers are updated together (same results as separate MiniPIDs)
+    enum PIDIndex
+    {
+        PID_POSITION_N = 0,
+        PID_POSITION_E,
+        PID_HEADING,
+
+        PID_COUNT
+    };
+
+    BatchPID pids;
 };
 
 #endif // AUTOPILOT_H
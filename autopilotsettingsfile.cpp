@@ -0,0 +1,149 @@
+/*
+    autopilotsettingsfile.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include "autopilotsettingsfile.h"
+
+static void writePIDSettings(std::ofstream& file, const char* section, const Autopilot::PIDSettings& settings)
+{
+    file << "\n[" << section << "]\n";
+    file << "p=" << settings.p << "\n";
+    file << "i=" << settings.i << "\n";
+    file << "d=" << settings.d << "\n";
+    file << "f=" << settings.f << "\n";
+    file << "maxI=" << settings.maxI << "\n";
+    file << "maxOut=" << settings.maxOut << "\n";
+    file << "rememberI=" << (settings.rememberI ? "true" : "false") << "\n";
+}
+
+bool AutopilotSettingsFile::save(const std::string& fileName, const Autopilot::Settings& settings)
+{
+    std::ofstream file(fileName);
+
+    if (!file)
+    {
+        return false;
+    }
+
+    file.precision(std::numeric_limits<double>::max_digits10);
+
+    file << "[Autopilot]\n";
+    file << "nearLimit=" << settings.nearLimit << "\n";
+    file << "cruisePropulsion=" << settings.cruisePropulsion << "\n";
+    file << "cruiseDirectionProp=" << settings.cruiseDirectionProp << "\n";
+
+    writePIDSettings(file, "PID_Position", settings.pidSettings_Position);
+    writePIDSettings(file, "PID_Heading", settings.pidSettings_Heading);
+
+    return static_cast<bool>(file);
+}
+
+static bool setPIDValue(Autopilot::PIDSettings& settings, const std::string& key, const std::string& value)
+{
+    std::istringstream stream(value);
+
+    if (key == "rememberI")
+    {
+        settings.rememberI = ((value == "true") || (value == "1"));
+        return true;
+    }
+
+    double* target = nullptr;
+
+    if (key == "p") target = &settings.p;
+    else if (key == "i") target = &settings.i;
+    else if (key == "d") target = &settings.d;
+    else if (key == "f") target = &settings.f;
+    else if (key == "maxI") target = &settings.maxI;
+    else if (key == "maxOut") target = &settings.maxOut;
+
+    return target && (stream >> *target);
+}
+
+bool AutopilotSettingsFile::load(const std::string& fileName, Autopilot::Settings& settings)
+{
+    std::ifstream file(fileName);
+
+    if (!file)
+    {
+        return false;
+    }
+
+    // Settings are only changed if the whole file is valid
+    Autopilot::Settings loaded = settings;
+
+    std::string line;
+    std::string section;
+
+    while (std::getline(file, line))
+    {
+        // Allow files edited on windows
+        if (!line.empty() && (line.back() == '\r'))
+        {
+            line.pop_back();
+        }
+
+        if (line.empty() || (line[0] == ';') || (line[0] == '#'))
+        {
+            continue;
+        }
+
+        if (line[0] == '[')
+        {
+            section = line.substr(1, line.find(']') - 1);
+            continue;
+        }
+
+        size_t separator = line.find('=');
+
+        if (separator == std::string::npos)
+        {
+            return false;
+        }
+
+        std::string key = line.substr(0, separator);
+        std::string value = line.substr(separator + 1);
+        std::istringstream stream(value);
+        bool ok = false;
+
+        if (section == "Autopilot")
+        {
+            if (key == "nearLimit") ok = static_cast<bool>(stream >> loaded.nearLimit);
+            else if (key == "cruisePropulsion") ok = static_cast<bool>(stream >> loaded.cruisePropulsion);
+            else if (key == "cruiseDirectionProp") ok = static_cast<bool>(stream >> loaded.cruiseDirectionProp);
+        }
+        else if (section == "PID_Position")
+        {
+            ok = setPIDValue(loaded.pidSettings_Position, key, value);
+        }
+        else if (section == "PID_Heading")
+        {
+            ok = setPIDValue(loaded.pidSettings_Heading, key, value);
+        }
+
+        if (!ok)
+        {
+            return false;
+        }
+    }
+
+    settings = loaded;
+    return true;
+}
@@ -0,0 +1,46 @@
+/*
+    autopilotsettingsfile.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef AUTOPILOTSETTINGSFILE_H
+#define AUTOPILOTSETTINGSFILE_H
+
+#include <string>
+#include "autopilot.h"
+
+// Saves / loads Autopilot::Settings as an ini-file:
+//
+// [Autopilot]
+// nearLimit=20
+// ...
+// [PID_Position]
+// p=20000
+// ...
+// [PID_Heading]
+// ...
+//
+// Values are written with full (round-trip) precision.
+// Missing keys keep the values already in settings when loading.
+
+class AutopilotSettingsFile
+{
+public:
+    static bool save(const std::string& fileName, const Autopilot::Settings& settings);
+    static bool load(const std::string& fileName, Autopilot::Settings& settings);
+};
+
+#endif // AUTOPILOTSETTINGSFILE_H
@@ -0,0 +1,342 @@
+/*
+    autopilottuner.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <random>
+#include <math.h>
+#include "autopilottuner.h"
+
+const AutopilotTuner::ParameterRange AutopilotTuner::parameterRanges[PARAM_COUNT] =
+{
+    { 5, 50, false },           // PARAM_NEARLIMIT
+    { 20000, 100000, false },   // PARAM_CRUISEPROPULSION
+    { 0, 2, false },            // PARAM_CRUISEDIRECTIONPROP
+    { 1000, 1000000, true },    // PARAM_POSITION_P
+    { 1, 10000, true },         // PARAM_POSITION_I
+    { 10000, 10000000, true },  // PARAM_POSITION_D
+    { 5000, 50000, false },     // PARAM_POSITION_MAXOUT
+    { 10000, 1000000, true },   // PARAM_HEADING_P
+    { 10, 100000, true },       // PARAM_HEADING_I
+    { 10000, 10000000, true },  // PARAM_HEADING_D
+    { 5000, 50000, false },     // PARAM_HEADING_MAXOUT
+};
+
+AutopilotTuner::AutopilotTuner(const Settings& settings, const std::vector<MissionSimulator::Mission>& missions,
+                               const MissionSimulator::SimulationSettings& simulationSettings) :
+    settings(settings),
+    missions(missions),
+    simulationSettings(simulationSettings),
+    workerPool(settings.threadCount)
+{
+
+}
+
+AutopilotTuner::Settings AutopilotTuner::getDefaultSettings(void)
+{
+    Settings settings;
+
+    settings.populationSize = 32;
+    settings.generations = 50;
+    settings.differentialWeight = 0.6;
+    settings.crossoverProbability = 0.9;
+    settings.seed = 1;
+    settings.threadCount = 0;
+
+    settings.notArrivedPenalty = 600;
+    settings.overshootWeight = 2;
+    settings.energyWeight = 1e-5;
+
+    return settings;
+}
+
+double* AutopilotTuner::getParameter(Autopilot::Settings& autopilotSettings, const int parameter)
+{
+    switch (parameter)
+    {
+    case PARAM_NEARLIMIT:
+        return &autopilotSettings.nearLimit;
+    case PARAM_CRUISEPROPULSION:
+        return &autopilotSettings.cruisePropulsion;
+    case PARAM_CRUISEDIRECTIONPROP:
+        return &autopilotSettings.cruiseDirectionProp;
+    case PARAM_POSITION_P:
+        return &autopilotSettings.pidSettings_Position.p;
+    case PARAM_POSITION_I:
+        return &autopilotSettings.pidSettings_Position.i;
+    case PARAM_POSITION_D:
+        return &autopilotSettings.pidSettings_Position.d;
+    case PARAM_POSITION_MAXOUT:
+        return &autopilotSettings.pidSettings_Position.maxOut;
+    case PARAM_HEADING_P:
+        return &autopilotSettings.pidSettings_Heading.p;
+    case PARAM_HEADING_I:
+        return &autopilotSettings.pidSettings_Heading.i;
+    case PARAM_HEADING_D:
+        return &autopilotSettings.pidSettings_Heading.d;
+    case PARAM_HEADING_MAXOUT:
+    default:
+        return &autopilotSettings.pidSettings_Heading.maxOut;
+    }
+}
+
+AutopilotTuner::Candidate AutopilotTuner::toCandidate(const Autopilot::Settings& autopilotSettings)
+{
+    Candidate candidate(PARAM_COUNT);
+    Autopilot::Settings copy = autopilotSettings;
+
+    for (int i = 0; i < PARAM_COUNT; i++)
+    {
+        const ParameterRange& range = parameterRanges[i];
+        double value = *getParameter(copy, i);
+
+        if (range.logarithmic)
+        {
+            candidate[i] = (log(value) - log(range.min)) / (log(range.max) - log(range.min));
+        }
+        else
+        {
+            candidate[i] = (value - range.min) / (range.max - range.min);
+        }
+
+        // Initial settings may be out of the range (or give NaN for log(0))
+        if (!(candidate[i] >= 0))
+        {
+            candidate[i] = 0;
+        }
+        else if (candidate[i] > 1)
+        {
+            candidate[i] = 1;
+        }
+    }
+
+    return candidate;
+}
+
+Autopilot::Settings AutopilotTuner::toAutopilotSettings(const Candidate& candidate, const Autopilot::Settings& baseSettings)
+{
+    Autopilot::Settings autopilotSettings = baseSettings;
+
+    for (int i = 0; i < PARAM_COUNT; i++)
+    {
+        const ParameterRange& range = parameterRanges[i];
+
+        if (range.logarithmic)
+        {
+            *getParameter(autopilotSettings, i) = exp(log(range.min) + candidate[i] * (log(range.max) - log(range.min)));
+        }
+        else
+        {
+            *getParameter(autopilotSettings, i) = range.min + candidate[i] * (range.max - range.min);
+        }
+    }
+
+    return autopilotSettings;
+}
+
+double AutopilotTuner::evaluate(const Autopilot::Settings& autopilotSettings, const double costLimit)
+{
+    if (missions.empty())
+    {
+        return 0;
+    }
+
+    const double totalLimit = costLimit * missions.size();
+    double totalCost = 0;
+
+    for (const MissionSimulator::Mission& mission : missions)
+    {
+        MissionSimulator::SimulationSettings missionSettings = simulationSettings;
+        double remaining = totalLimit - totalCost;
+        bool limited = false;
+
+        // Cost of a mission is always at least the time it takes, so
+        // no need to run the mission longer than the remaining "budget".
+        if (remaining < missionSettings.maxTime)
+        {
+            missionSettings.maxTime = remaining;
+            limited = true;
+        }
+
+        MissionSimulator::Result result = MissionSimulator::runMission(autopilotSettings, mission, missionSettings);
+
+        if (!result.arrived && limited)
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+
+        totalCost += result.cycles * simulationSettings.cycleTime +
+                settings.overshootWeight * result.overshoot +
+                settings.energyWeight * result.energy;
+
+        if (!result.arrived)
+        {
+            totalCost += settings.notArrivedPenalty + result.finalDistance;
+        }
+
+        if (totalCost > totalLimit)
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+    }
+
+    return totalCost / missions.size();
+}
+
+void AutopilotTuner::evaluateAll(const std::vector<Candidate>& candidates, const Autopilot::Settings& baseSettings,
+                                 const std::vector<double>& costLimits, std::vector<double>& costs)
+{
+    costs.resize(candidates.size());
+
+    workerPool.run(candidates.size(), [&](size_t index, unsigned int)
+    {
+        costs[index] = evaluate(toAutopilotSettings(candidates[index], baseSettings), costLimits[index]);
+    });
+}
+
+Autopilot::Settings AutopilotTuner::tune(const Autopilot::Settings& initialSettings,
+                                         std::function<void(const Progress&)> progressCallback)
+{
+    // mt19937_64's output is defined by the standard, distributions are not
+    // -> convert manually to keep the results the same everywhere.
+    std::mt19937_64 random(settings.seed);
+
+    auto randomDouble = [&random]()
+    {
+        return (random() >> 11) * (1. / 9007199254740992.);
+    };
+
+    const int populationSize = (settings.populationSize < 4 ? 4 : settings.populationSize);
+
+    std::vector<Candidate> population(populationSize);
+    std::vector<double> costs;
+
+    // Initial settings are included in the initial population so the result is never worse than them
+    population[0] = toCandidate(initialSettings);
+
+    for (int i = 1; i < populationSize; i++)
+    {
+        population[i].resize(PARAM_COUNT);
+
+        for (int param = 0; param < PARAM_COUNT; param++)
+        {
+            population[i][param] = randomDouble();
+        }
+    }
+
+    Progress progress;
+    progress.evaluations = 0;
+    progress.terminatedEarly = 0;
+
+    evaluateAll(population, initialSettings,
+                std::vector<double>(populationSize, std::numeric_limits<double>::infinity()), costs);
+
+    progress.evaluations += populationSize;
+
+    for (int generation = 0; generation < settings.generations; generation++)
+    {
+        std::vector<Candidate> trials(populationSize, Candidate(PARAM_COUNT));
+
+        for (int i = 0; i < populationSize; i++)
+        {
+            int a, b, c;
+
+            do { a = random() % populationSize; } while (a == i);
+            do { b = random() % populationSize; } while ((b == i) || (b == a));
+            do { c = random() % populationSize; } while ((c == i) || (c == a) || (c == b));
+
+            const int forcedParam = random() % PARAM_COUNT;
+
+            for (int param = 0; param < PARAM_COUNT; param++)
+            {
+                if ((randomDouble() < settings.crossoverProbability) || (param == forcedParam))
+                {
+                    double value = population[a][param] + settings.differentialWeight * (population[b][param] - population[c][param]);
+
+                    // Out of range -> halfway between the target and the limit
+                    if (value < 0)
+                    {
+                        value = population[i][param] / 2;
+                    }
+                    else if (value > 1)
+                    {
+                        value = (population[i][param] + 1) / 2;
+                    }
+
+                    trials[i][param] = value;
+                }
+                else
+                {
+                    trials[i][param] = population[i][param];
+                }
+            }
+        }
+
+        std::vector<double> trialCosts;
+
+        // Target's cost is the limit for its trial (trial is discarded if worse anyway)
+        evaluateAll(trials, initialSettings, costs, trialCosts);
+
+        progress.evaluations += populationSize;
+
+        for (int i = 0; i < populationSize; i++)
+        {
+            if (trialCosts[i] == std::numeric_limits<double>::infinity())
+            {
+                progress.terminatedEarly++;
+            }
+
+            if (trialCosts[i] <= costs[i])
+            {
+                population[i] = trials[i];
+                costs[i] = trialCosts[i];
+            }
+        }
+
+        if (progressCallback)
+        {
+            progress.generation = generation;
+            progress.bestCost = std::numeric_limits<double>::infinity();
+            progress.meanCost = 0;
+
+            for (double cost : costs)
+            {
+                progress.meanCost += cost / populationSize;
+
+                if (cost < progress.bestCost)
+                {
+                    progress.bestCost = cost;
+                }
+            }
+
+            progressCallback(progress);
+        }
+    }
+
+    int bestIndex = 0;
+
+    for (int i = 1; i < populationSize; i++)
+    {
+        if (costs[i] < costs[bestIndex])
+        {
+            bestIndex = i;
+        }
+    }
+
+    bestCost = costs[bestIndex];
+
+    return toAutopilotSettings(population[bestIndex], initialSettings);
+}
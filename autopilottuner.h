@@ -0,0 +1,128 @@
+/*
+    autopilottuner.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef AUTOPILOTTUNER_H
+#define AUTOPILOTTUNER_H
+
+#include <functional>
+#include <limits>
+#include <vector>
+#include "missionsimulator.h"
+
+// Searches Autopilot::Settings using differential evolution (DE/rand/1/bin).
+// Cost of a candidate is calculated by running a fixed set of missions
+// with MissionSimulator (same missions for every candidate).
+// Trial candidates of one generation are evaluated concurrently. As a trial only
+// replaces its target if it's better, evaluation of a trial is stopped as soon as
+// its (monotonically growing) cost exceeds the target's cost. This doesn't change
+// the result compared to full evaluation, it just skips clearly bad runs.
+// Results are reproducible for a given seed regardless of the number of threads.
+
+class AutopilotTuner
+{
+public:
+    struct Settings
+    {
+        int populationSize;
+        int generations;
+        double differentialWeight;          // "F"
+        double crossoverProbability;        // "CR"
+        uint64_t seed;
+        unsigned int threadCount;           // 0 = number of cores
+
+        // Cost of one mission: time (until arrival confirmed or maxTime) +
+        // notArrivedPenalty (+ final distance) if not arrived +
+        // weights * overshoot / energy.
+        double notArrivedPenalty;           // s
+        double overshootWeight;             // s / m
+        double energyWeight;                // s / (propulsion units * s)
+    };
+
+    struct Progress
+    {
+        int generation;
+        double bestCost;                    // Cost per mission
+        double meanCost;
+        int evaluations;                    // Total evaluations so far
+        int terminatedEarly;                // Evaluations terminated early so far
+    };
+
+    // Parameters tuned (others are kept as in the initial settings)
+    enum Parameter
+    {
+        PARAM_NEARLIMIT = 0,
+        PARAM_CRUISEPROPULSION,
+        PARAM_CRUISEDIRECTIONPROP,
+        PARAM_POSITION_P,
+        PARAM_POSITION_I,
+        PARAM_POSITION_D,
+        PARAM_POSITION_MAXOUT,
+        PARAM_HEADING_P,
+        PARAM_HEADING_I,
+        PARAM_HEADING_D,
+        PARAM_HEADING_MAXOUT,
+
+        PARAM_COUNT
+    };
+
+    AutopilotTuner(const Settings& settings, const std::vector<MissionSimulator::Mission>& missions,
+                   const MissionSimulator::SimulationSettings& simulationSettings);
+
+    static Settings getDefaultSettings(void);
+
+    Autopilot::Settings tune(const Autopilot::Settings& initialSettings,
+                             std::function<void(const Progress&)> progressCallback = nullptr);
+
+    // Cost of the missions divided by the number of missions.
+    // If cost grows over costLimit evaluation is stopped and infinity returned.
+    double evaluate(const Autopilot::Settings& autopilotSettings,
+                    const double costLimit = std::numeric_limits<double>::infinity());
+
+    double getBestCost(void) const { return bestCost; }
+
+private:
+    Settings settings;
+    std::vector<MissionSimulator::Mission> missions;
+    MissionSimulator::SimulationSettings simulationSettings;
+
+    // Threads are kept for all generations
+    WorkerPool workerPool;
+
+    double bestCost = std::numeric_limits<double>::infinity();
+
+    struct ParameterRange
+    {
+        double min;
+        double max;
+        bool logarithmic;
+    };
+
+    static const ParameterRange parameterRanges[PARAM_COUNT];
+    static double* getParameter(Autopilot::Settings& autopilotSettings, const int parameter);
+
+    // Candidates are handled as vectors of normalized (0...1) parameters
+    typedef std::vector<double> Candidate;
+
+    static Candidate toCandidate(const Autopilot::Settings& autopilotSettings);
+    static Autopilot::Settings toAutopilotSettings(const Candidate& candidate, const Autopilot::Settings& baseSettings);
+
+    void evaluateAll(const std::vector<Candidate>& candidates, const Autopilot::Settings& baseSettings,
+                     const std::vector<double>& costLimits, std::vector<double>& costs);
+};
+
+#endif // AUTOPILOTTUNER_H
@@ -0,0 +1,416 @@
+/*
+    batchpid.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "batchpid.h"
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+// "Packs" of doubles used by BatchPID::evaluate. Every pack type offers
+// the same set of operations so the PID-math only needs to be written once.
+// Masks are all ones / all zeros per lane as with the SIMD compare instructions.
+
+struct ScalarPack
+{
+    typedef double Value;
+    typedef bool Mask;
+    static const int width = 1;
+
+    static Value load(const double* p) { return *p; }
+    static void store(double* p, const Value v) { *p = v; }
+    static Value set1(const double d) { return d; }
+    static Value add(const Value a, const Value b) { return a + b; }
+    static Value sub(const Value a, const Value b) { return a - b; }
+    static Value mul(const Value a, const Value b) { return a * b; }
+    static Value neg(const Value a) { return -a; }
+    static Mask gt(const Value a, const Value b) { return a > b; }
+    static Mask lt(const Value a, const Value b) { return a < b; }
+    static Mask ne(const Value a, const Value b) { return a != b; }
+    static Mask mAnd(const Mask a, const Mask b) { return a & b; }
+    static Mask mOr(const Mask a, const Mask b) { return a | b; }
+    static Mask mAndNot(const Mask a, const Mask b) { return (!a) & b; }
+    static Value select(const Mask m, const Value a, const Value b) { return m ? a : b; }
+};
+
+#if defined(__SSE2__)
+struct SSE2Pack
+{
+    typedef __m128d Value;
+    typedef __m128d Mask;
+    static const int width = 2;
+
+    static Value load(const double* p) { return _mm_loadu_pd(p); }
+    static void store(double* p, const Value v) { _mm_storeu_pd(p, v); }
+    static Value set1(const double d) { return _mm_set1_pd(d); }
+    static Value add(const Value a, const Value b) { return _mm_add_pd(a, b); }
+    static Value sub(const Value a, const Value b) { return _mm_sub_pd(a, b); }
+    static Value mul(const Value a, const Value b) { return _mm_mul_pd(a, b); }
+    static Value neg(const Value a) { return _mm_xor_pd(a, _mm_set1_pd(-0.0)); }
+    static Mask gt(const Value a, const Value b) { return _mm_cmpgt_pd(a, b); }
+    static Mask lt(const Value a, const Value b) { return _mm_cmplt_pd(a, b); }
+    static Mask ne(const Value a, const Value b) { return _mm_cmpneq_pd(a, b); }
+    static Mask mAnd(const Mask a, const Mask b) { return _mm_and_pd(a, b); }
+    static Mask mOr(const Mask a, const Mask b) { return _mm_or_pd(a, b); }
+    static Mask mAndNot(const Mask a, const Mask b) { return _mm_andnot_pd(a, b); }
+    static Value select(const Mask m, const Value a, const Value b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+};
+#endif
+
+#if defined(__AVX__)
+struct AVXPack
+{
+    typedef __m256d Value;
+    typedef __m256d Mask;
+    static const int width = 4;
+
+    static Value load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, const Value v) { _mm256_storeu_pd(p, v); }
+    static Value set1(const double d) { return _mm256_set1_pd(d); }
+    static Value add(const Value a, const Value b) { return _mm256_add_pd(a, b); }
+    static Value sub(const Value a, const Value b) { return _mm256_sub_pd(a, b); }
+    static Value mul(const Value a, const Value b) { return _mm256_mul_pd(a, b); }
+    static Value neg(const Value a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+    // Ordered, non-signaling compares equal to C++'s < and >. != is unordered (true for NaNs) as in C++.
+    static Mask gt(const Value a, const Value b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    static Mask lt(const Value a, const Value b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static Mask ne(const Value a, const Value b) { return _mm256_cmp_pd(a, b, _CMP_NEQ_UQ); }
+    static Mask mAnd(const Mask a, const Mask b) { return _mm256_and_pd(a, b); }
+    static Mask mOr(const Mask a, const Mask b) { return _mm256_or_pd(a, b); }
+    static Mask mAndNot(const Mask a, const Mask b) { return _mm256_andnot_pd(a, b); }
+    // Not _mm256_blendv_pd: Some compilers turn it into per-lane branches without AVX2
+    static Value select(const Mask m, const Value a, const Value b) { return _mm256_or_pd(_mm256_and_pd(m, a), _mm256_andnot_pd(m, b)); }
+};
+
+typedef AVXPack WidestPack;
+#elif defined(__SSE2__)
+typedef SSE2Pack WidestPack;
+#else
+typedef ScalarPack WidestPack;
+#endif
+
+// Same as MiniPID::clamp
+template <class Pack> inline typename Pack::Value clamp(const typename Pack::Value value, const typename Pack::Value min, const typename Pack::Value max)
+{
+    return Pack::select(Pack::gt(value, max), max, Pack::select(Pack::lt(value, min), min, value));
+}
+
+// Same as MiniPID::bounded
+template <class Pack> inline typename Pack::Mask bounded(const typename Pack::Value value, const typename Pack::Value min, const typename Pack::Value max)
+{
+    return Pack::mAnd(Pack::lt(min, value), Pack::lt(value, max));
+}
+
+} // namespace
+
+BatchPID::BatchPID()
+{
+
+}
+
+BatchPID::BatchPID(const int count)
+{
+    resize(count);
+}
+
+void BatchPID::resize(const int count)
+{
+    this->count = count;
+
+    // Initial values equal to the ones in MiniPID::init
+    P.resize(count, 0);
+    I.resize(count, 0);
+    D.resize(count, 0);
+    F.resize(count, 0);
+
+    maxIOutput.resize(count, 0);
+    maxError.resize(count, 0);
+    errorSum.resize(count, 0);
+    maxOutput.resize(count, 0);
+    minOutput.resize(count, 0);
+    setpoint.resize(count, 0);
+    lastActual.resize(count, 0);
+    firstRun.resize(count, 1);
+    reversed.resize(count, false);
+    outputRampRate.resize(count, 0);
+    lastOutput.resize(count, 0);
+    outputFilter.resize(count, 0);
+    setpointRange.resize(count, 0);
+}
+
+// Configuration functions below mimic MiniPID's ones line by line,
+// see MiniPID.cpp for the documentation.
+
+void BatchPID::setP(const int index, const double p)
+{
+    P[index] = p;
+    checkSigns(index);
+}
+
+void BatchPID::setI(const int index, const double i)
+{
+    if (I[index] != 0)
+    {
+        errorSum[index] = errorSum[index] * I[index] / i;
+    }
+    if (maxIOutput[index] != 0)
+    {
+        maxError[index] = maxIOutput[index] / i;
+    }
+    I[index] = i;
+    checkSigns(index);
+}
+
+void BatchPID::setD(const int index, const double d)
+{
+    D[index] = d;
+    checkSigns(index);
+}
+
+void BatchPID::setF(const int index, const double f)
+{
+    F[index] = f;
+    checkSigns(index);
+}
+
+void BatchPID::setPID(const int index, const double p, const double i, const double d)
+{
+    P[index] = p;
+    I[index] = i;
+    D[index] = d;
+    checkSigns(index);
+}
+
+void BatchPID::setPID(const int index, const double p, const double i, const double d, const double f)
+{
+    P[index] = p;
+    I[index] = i;
+    D[index] = d;
+    F[index] = f;
+    checkSigns(index);
+}
+
+void BatchPID::setMaxIOutput(const int index, const double maximum)
+{
+    maxIOutput[index] = maximum;
+    if (I[index] != 0)
+    {
+        maxError[index] = maxIOutput[index] / I[index];
+    }
+}
+
+void BatchPID::setOutputLimits(const int index, const double output)
+{
+    setOutputLimits(index, -output, output);
+}
+
+void BatchPID::setOutputLimits(const int index, const double minimum, const double maximum)
+{
+    if (maximum < minimum)
+    {
+        return;
+    }
+
+    maxOutput[index] = maximum;
+    minOutput[index] = minimum;
+
+    if ((maxIOutput[index] == 0) || (maxIOutput[index] > (maximum - minimum)))
+    {
+        setMaxIOutput(index, maximum - minimum);
+    }
+}
+
+void BatchPID::setDirection(const int index, const bool reversed)
+{
+    this->reversed[index] = reversed;
+}
+
+void BatchPID::setSetpoint(const int index, const double setpoint)
+{
+    this->setpoint[index] = setpoint;
+}
+
+void BatchPID::reset(const int index)
+{
+    firstRun[index] = 1;
+    errorSum[index] = 0;
+}
+
+void BatchPID::reset(void)
+{
+    for (int i = 0; i < count; i++)
+    {
+        reset(i);
+    }
+}
+
+void BatchPID::setOutputRampRate(const int index, const double rate)
+{
+    outputRampRate[index] = rate;
+}
+
+void BatchPID::setSetpointRange(const int index, const double range)
+{
+    setpointRange[index] = range;
+}
+
+void BatchPID::setOutputFilter(const int index, const double strength)
+{
+    if ((strength == 0) || ((0 < strength) && (strength < 1)))
+    {
+        outputFilter[index] = strength;
+    }
+}
+
+void BatchPID::checkSigns(const int index)
+{
+    double* values[] = { &P[index], &I[index], &D[index], &F[index] };
+
+    for (double* value : values)
+    {
+        if (reversed[index] ? (*value > 0) : (*value < 0))
+        {
+            *value *= -1;
+        }
+    }
+}
+
+void BatchPID::getOutputs(const double* actual, double* output)
+{
+    int index = evaluate<WidestPack>(0, actual, output);
+
+    // Remaining controllers that don't fill a whole pack
+    evaluate<ScalarPack>(index, actual, output);
+}
+
+void BatchPID::getOutputs(const double* actual, const double* setpoint, double* output)
+{
+    for (int i = 0; i < count; i++)
+    {
+        this->setpoint[i] = setpoint[i];
+    }
+
+    getOutputs(actual, output);
+}
+
+template <class Pack> int BatchPID::evaluate(const int firstIndex, const double* actual, double* output)
+{
+    // This is MiniPID::getOutput with every if-statement replaced by a mask.
+    // Order of the floating point operations is kept the same to get identical results.
+
+    typedef typename Pack::Value Value;
+    typedef typename Pack::Mask Mask;
+
+    const Value zero = Pack::set1(0);
+    const Value one = Pack::set1(1);
+
+    // Local copies of the array pointers so they stay in registers
+    // (stores through the intrinsics could otherwise alias with the vectors' internals).
+    const double* P = this->P.data();
+    const double* I = this->I.data();
+    const double* D = this->D.data();
+    const double* F = this->F.data();
+    const double* maxIOutput = this->maxIOutput.data();
+    const double* maxError = this->maxError.data();
+    const double* minOutput = this->minOutput.data();
+    const double* maxOutput = this->maxOutput.data();
+    const double* outputRampRate = this->outputRampRate.data();
+    const double* outputFilter = this->outputFilter.data();
+    const double* setpointRange = this->setpointRange.data();
+    const double* setpoint = this->setpoint.data();
+    double* errorSum = this->errorSum.data();
+    double* lastActual = this->lastActual.data();
+    double* lastOutput = this->lastOutput.data();
+    double* firstRun = this->firstRun.data();
+
+    int index = firstIndex;
+
+    for (; index + Pack::width <= count; index += Pack::width)
+    {
+        const Value p = Pack::load(&P[index]);
+        const Value i = Pack::load(&I[index]);
+        const Value d = Pack::load(&D[index]);
+        const Value f = Pack::load(&F[index]);
+
+        const Value maxIOut = Pack::load(&maxIOutput[index]);
+        const Value maxErr = Pack::load(&maxError[index]);
+        const Value minOut = Pack::load(&minOutput[index]);
+        const Value maxOut = Pack::load(&maxOutput[index]);
+        const Value rampRate = Pack::load(&outputRampRate[index]);
+        const Value filter = Pack::load(&outputFilter[index]);
+        const Value spRange = Pack::load(&setpointRange[index]);
+
+        const Value act = Pack::load(&actual[index]);
+        Value sp = Pack::load(&setpoint[index]);
+        Value errSum = Pack::load(&errorSum[index]);
+        Value lastAct = Pack::load(&lastActual[index]);
+        Value lastOut = Pack::load(&lastOutput[index]);
+
+        const Mask isFirstRun = Pack::ne(Pack::load(&firstRun[index]), zero);
+        const Mask hasSetpointRange = Pack::ne(spRange, zero);
+        const Mask hasMaxIOutput = Pack::ne(maxIOut, zero);
+        const Mask hasOutputLimits = Pack::ne(minOut, maxOut);
+        const Mask hasRampRate = Pack::ne(rampRate, zero);
+        const Mask hasFilter = Pack::ne(filter, zero);
+
+        sp = Pack::select(hasSetpointRange, clamp<Pack>(sp, Pack::sub(act, spRange), Pack::add(act, spRange)), sp);
+
+        const Value error = Pack::sub(sp, act);
+
+        const Value fOutput = Pack::mul(f, sp);
+        const Value pOutput = Pack::mul(p, error);
+
+        lastAct = Pack::select(isFirstRun, act, lastAct);
+        lastOut = Pack::select(isFirstRun, Pack::add(pOutput, fOutput), lastOut);
+
+        const Value dOutput = Pack::mul(Pack::neg(d), Pack::sub(act, lastAct));
+        lastAct = act;
+
+        Value iOutput = Pack::mul(i, errSum);
+        iOutput = Pack::select(hasMaxIOutput, clamp<Pack>(iOutput, Pack::neg(maxIOut), maxIOut), iOutput);
+
+        Value out = Pack::add(Pack::add(Pack::add(fOutput, pOutput), iOutput), dOutput);
+
+        const Value rampMin = Pack::sub(lastOut, rampRate);
+        const Value rampMax = Pack::add(lastOut, rampRate);
+
+        // Anti-windup: errorSum is reset to the current error if output is
+        // out of limits or ramp range, otherwise accumulated (and limited if maxIOutput is set).
+        const Mask outOfLimits = Pack::mAndNot(bounded<Pack>(out, minOut, maxOut), hasOutputLimits);
+        const Mask outOfRamp = Pack::mAndNot(bounded<Pack>(out, rampMin, rampMax), hasRampRate);
+        const Value accumulated = Pack::add(errSum, error);
+
+        errSum = Pack::select(Pack::mOr(outOfLimits, outOfRamp), error,
+                              Pack::select(hasMaxIOutput, clamp<Pack>(accumulated, Pack::neg(maxErr), maxErr), accumulated));
+
+        out = Pack::select(hasRampRate, clamp<Pack>(out, rampMin, rampMax), out);
+        out = Pack::select(hasOutputLimits, clamp<Pack>(out, minOut, maxOut), out);
+        out = Pack::select(hasFilter, Pack::add(Pack::mul(lastOut, filter), Pack::mul(out, Pack::sub(one, filter))), out);
+
+        Pack::store(&errorSum[index], errSum);
+        Pack::store(&lastActual[index], lastAct);
+        Pack::store(&lastOutput[index], out);
+        Pack::store(&firstRun[index], zero);
+        Pack::store(&output[index], out);
+    }
+
+    return index;
+}
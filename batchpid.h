@@ -0,0 +1,106 @@
+/*
+    batchpid.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BATCHPID_H
+#define BATCHPID_H
+
+#include <vector>
+
+// "Structure of arrays"-version of MiniPID for running a number of controllers
+// at once (Autopilot's position and heading controllers, fleet simulation, tuning
+// sweeps etc.). tools/pidbench verifies it against MiniPID.
+// Configuration functions work like their MiniPID-counterparts (including
+// the quirks like setI scaling errorSum and setOutputLimits touching maxIOutput),
+// but take the index of the controller as the first parameter.
+// getOutputs evaluates all controllers without data-dependent branches
+// (clamps and errorSum-handling are done with masks) using SSE2/AVX when available.
+// Results are bit-identical to MiniPID::getOutput as long as the compiler is not
+// allowed to contract MiniPID's multiply-adds into FMA-instructions (-ffp-contract).
+
+class BatchPID
+{
+public:
+    BatchPID();
+    BatchPID(const int count);
+
+    void resize(const int count);
+    int size(void) const { return count; }
+
+    void setP(const int index, const double p);
+    void setI(const int index, const double i);
+    void setD(const int index, const double d);
+    void setF(const int index, const double f);
+    void setPID(const int index, const double p, const double i, const double d);
+    void setPID(const int index, const double p, const double i, const double d, const double f);
+    void setMaxIOutput(const int index, const double maximum);
+    void setOutputLimits(const int index, const double output);
+    void setOutputLimits(const int index, const double minimum, const double maximum);
+    void setDirection(const int index, const bool reversed);
+    void setSetpoint(const int index, const double setpoint);
+    void reset(const int index);
+    void reset(void);
+    void setOutputRampRate(const int index, const double rate);
+    void setSetpointRange(const int index, const double range);
+    void setOutputFilter(const int index, const double strength);
+
+    // Equals to calling MiniPID::getOutput(actual[n]) for every controller.
+    // actual and output need to have (at least) size() items. They may point to the same array.
+    void getOutputs(const double* actual, double* output);
+
+    // Equals to calling MiniPID::getOutput(actual[n], setpoint[n]) for every controller.
+    void getOutputs(const double* actual, const double* setpoint, double* output);
+
+private:
+    int count = 0;
+
+    // Each member is an array with one item per controller.
+    // Flags (firstRun) are stored as doubles (0 / 1) so they can be loaded into the same registers.
+    std::vector<double> P;
+    std::vector<double> I;
+    std::vector<double> D;
+    std::vector<double> F;
+
+    std::vector<double> maxIOutput;
+    std::vector<double> maxError;
+    std::vector<double> errorSum;
+
+    std::vector<double> maxOutput;
+    std::vector<double> minOutput;
+
+    std::vector<double> setpoint;
+
+    std::vector<double> lastActual;
+
+    std::vector<double> firstRun;
+    std::vector<char> reversed;
+
+    std::vector<double> outputRampRate;
+    std::vector<double> lastOutput;
+
+    std::vector<double> outputFilter;
+
+    std::vector<double> setpointRange;
+
+    void checkSigns(const int index);
+
+    // Evaluates controllers starting from firstIndex as long as there are
+    // enough of them left to fill a Pack. Returns the first index not evaluated.
+    template <class Pack> int evaluate(const int firstIndex, const double* actual, double* output);
+};
+
+#endif // BATCHPID_H
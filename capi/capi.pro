@@ -0,0 +1,28 @@
+# C interface library (libsimferrycontroller) for embedding the solver and
+# autopilot into a simulator. No Qt needed, see simferrycontroller.h.
+
+TEMPLATE = lib
+TARGET = simferrycontroller
+
+CONFIG -= qt
+CONFIG += shared c++11 hide_symbols
+
+DEFINES += SFC_BUILD_LIBRARY
+
+# See SimFerryController.pro
+DEFINES += EIGEN_DONT_VECTORIZE
+DEFINES += EIGEN_DISABLE_UNALIGNED_ARRAY_ASSERT
+
+INCLUDEPATH += $$PWD/..
+
+SOURCES += \
+    $$PWD/../autopilot.cpp \
+    $$PWD/../batchpid.cpp \
+    $$PWD/../losolver.cpp \
+    simferrycontroller.cpp
+
+HEADERS += \
+    $$PWD/../autopilot.h \
+    $$PWD/../batchpid.h \
+    $$PWD/../losolver.h \
+    simferrycontroller.h
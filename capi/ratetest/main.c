@@ -0,0 +1,170 @@
+/*
+    main.c (ratetest, part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+    C test program for the library: Drives the controller as fast as possible
+    with antenna points of a vessel moving on a circle (same geometry as the
+    built-in ferry model) and checks the solved location and heading.
+
+    Usage: ratetest [samples]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "simferrycontroller.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Antenna positions in the vessel's local EUS-coordinates (FerryModel's defaults) */
+static const double refPoints[3][3] =
+{
+    { 0, 3, 10 },
+    { -3, 3, -8 },
+    { 3, 3, -8 }
+};
+
+/* Datagram values (points + reference points) for a vessel at N, E with heading (radians) */
+static void getValues(const double coord_N, const double coord_E, const double heading, double values[18])
+{
+    int i;
+
+    for (i = 0; i < 3; i++)
+    {
+        /* Local EUS -> body (forward, starboard, down) -> NED -> EUS */
+        const double forward = refPoints[i][2];
+        const double starboard = -refPoints[i][0];
+        const double down = -refPoints[i][1];
+
+        const double north = coord_N + cos(heading) * forward - sin(heading) * starboard;
+        const double east = coord_E + sin(heading) * forward + cos(heading) * starboard;
+
+        values[i * 3 + 0] = east;
+        values[i * 3 + 1] = -down;
+        values[i * 3 + 2] = -north;
+
+        values[(i + 3) * 3 + 0] = refPoints[i][0];
+        values[(i + 3) * 3 + 1] = refPoints[i][1];
+        values[(i + 3) * 3 + 2] = refPoints[i][2];
+    }
+}
+
+static double getTime(void)
+{
+    struct timespec time;
+
+    timespec_get(&time, TIME_UTC);
+
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+int main(int argc, char* argv[])
+{
+    const long samples = (argc > 1) ? atol(argv[1]) : 1000000;
+    const double cycleTime = 0.125;
+    SFC_Controller* controller;
+    SFC_Destination destination = { 100, 50, 0 };
+    SFC_Pose pose;
+    SFC_AutopilotOutputs outputs;
+    long sample;
+    long errors = 0;
+    double maxLocationError = 0;
+    double maxHeadingError = 0;
+    double checksum = 0;
+    double startTime, totalTime;
+
+    if (sfc_getApiVersion() != SFC_API_VERSION)
+    {
+        printf("API version mismatch: library %d, header %d\n", sfc_getApiVersion(), SFC_API_VERSION);
+        return 1;
+    }
+
+    controller = sfc_create();
+
+    if (!controller)
+    {
+        printf("sfc_create failed.\n");
+        return 1;
+    }
+
+    sfc_setDestination(controller, &destination);
+
+    startTime = getTime();
+
+    for (sample = 0; sample < samples; sample++)
+    {
+        const double angle = sample * 0.0001;
+        const double coord_N = 50 * cos(angle);
+        const double coord_E = 50 * sin(angle);
+        const double heading = fmod(angle + M_PI / 2 + M_PI, 2 * M_PI) - M_PI;
+        double values[18];
+        double headingError;
+        SFC_Error error;
+
+        getValues(coord_N, coord_E, heading, values);
+
+        error = sfc_process(controller, values, cycleTime, &pose, &outputs, NULL);
+
+        if (error != SFC_ERROR_NONE)
+        {
+            errors++;
+            continue;
+        }
+
+        if (fabs(pose.location_NED[0] - coord_N) > maxLocationError)
+        {
+            maxLocationError = fabs(pose.location_NED[0] - coord_N);
+        }
+
+        if (fabs(pose.location_NED[1] - coord_E) > maxLocationError)
+        {
+            maxLocationError = fabs(pose.location_NED[1] - coord_E);
+        }
+
+        headingError = fabs(fmod(pose.heading - heading + 3 * M_PI, 2 * M_PI) - M_PI);
+
+        if (headingError > maxHeadingError)
+        {
+            maxHeadingError = headingError;
+        }
+
+        /* Keeps the compiler from optimizing anything away */
+        checksum += outputs.propulsion_Front + outputs.propulsion_Back;
+    }
+
+    totalTime = getTime() - startTime;
+
+    sfc_destroy(controller);
+
+    printf("Samples: %ld, errors: %ld\n", samples, errors);
+    printf("Max location error: %g m, max heading error: %g rad\n", maxLocationError, maxHeadingError);
+    printf("Time: %.3f s, %.0f samples / s, %.0f ns / sample\n", totalTime, samples / totalTime, totalTime * 1e9 / samples);
+    printf("Checksum: %g\n", checksum);
+
+    if ((errors != 0) || (maxLocationError > 1e-6) || (maxHeadingError > 1e-6))
+    {
+        printf("FAILED\n");
+        return 1;
+    }
+
+    printf("OK\n");
+    return 0;
+}
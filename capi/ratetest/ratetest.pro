@@ -0,0 +1,17 @@
+# C test program for the library (build capi.pro first)
+
+TEMPLATE = app
+TARGET = ratetest
+
+CONFIG -= qt app_bundle
+CONFIG += console
+
+QMAKE_CFLAGS += -std=c11
+
+INCLUDEPATH += $$PWD/..
+
+LIBS += -L$$OUT_PWD/.. -lsimferrycontroller
+unix: LIBS += -lm
+
+SOURCES += \
+    main.c
@@ -0,0 +1,315 @@
+/*
+    simferrycontroller.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <new>
+#include "simferrycontroller.h"
+#include "losolver.h"
+#include "autopilot.h"
+
+static_assert(SFC_ERROR_INVALID_REFERENCE_POINTS == static_cast<int>(LOSolver::ERROR_INVALID_REFERENCE_POINTS), "Error codes differ");
+static_assert(SFC_ERROR_INVALID_POINTS == static_cast<int>(LOSolver::ERROR_INVALID_POINTS), "Error codes differ");
+static_assert(SFC_ERROR_INVALID_AXES_CONVENTION == static_cast<int>(LOSolver::ERROR_INVALID_AXES_CONVENTION), "Error codes differ");
+static_assert(SFC_ERROR_NOT_KNOWN == static_cast<int>(LOSolver::ERROR_NOT_KNOWN), "Error codes differ");
+static_assert(SFC_AUTOPILOTSTATE_CRUISING == static_cast<int>(Autopilot::STATE_CRUISING), "States differ");
+static_assert(SFC_AUTOPILOTSTATE_NEAR == static_cast<int>(Autopilot::STATE_NEAR), "States differ");
+
+struct SFC_Controller
+{
+    LOSolver loSolver;
+    Autopilot autopilot;
+
+    bool refPointsSet = false;
+    double refPointValues[3 * 3];
+};
+
+typedef Eigen::Transform<double, 3, Eigen::Affine> Transform;
+
+static Autopilot::PIDSettings toPIDSettings(const SFC_PIDSettings& source)
+{
+    Autopilot::PIDSettings settings;
+
+    settings.p = source.p;
+    settings.i = source.i;
+    settings.d = source.d;
+    settings.f = source.f;
+    settings.maxI = source.maxI;
+    settings.maxOut = source.maxOut;
+    settings.rememberI = (source.rememberI != 0);
+
+    return settings;
+}
+
+static SFC_PIDSettings fromPIDSettings(const Autopilot::PIDSettings& source)
+{
+    SFC_PIDSettings settings;
+
+    settings.p = source.p;
+    settings.i = source.i;
+    settings.d = source.d;
+    settings.f = source.f;
+    settings.maxI = source.maxI;
+    settings.maxOut = source.maxOut;
+    settings.rememberI = source.rememberI ? 1 : 0;
+
+    return settings;
+}
+
+static void getPose(const Transform& transform_EUS, SFC_Pose* pose)
+{
+    for (int row = 0; row < 4; row++)
+    {
+        for (int col = 0; col < 4; col++)
+        {
+            pose->transform_EUS[row * 4 + col] = transform_EUS(row, col);
+        }
+    }
+
+    const Eigen::Vector3d location_NED = LOSolver::changeAxesConvention(Eigen::Vector3d(transform_EUS.translation()), LOSolver::AC_EUS, LOSolver::AC_NED);
+
+    pose->location_NED[0] = location_NED(0);
+    pose->location_NED[1] = location_NED(1);
+    pose->location_NED[2] = location_NED(2);
+
+    LOSolver::ErrorCode errorCode;
+    LOSolver::getYawPitchRollAngles(transform_EUS, pose->heading, pose->pitch, pose->roll, errorCode, LOSolver::AC_EUS);
+}
+
+static SFC_Error updateAutopilot(SFC_Controller* controller, const Transform& transform_EUS, const double cycleTime,
+                                 SFC_AutopilotOutputs* outputs, SFC_AutopilotDebugOutputs* debugOutputs)
+{
+    const Transform transform_NED = LOSolver::changeAxesConvention(transform_EUS, LOSolver::AC_EUS, LOSolver::AC_NED);
+
+    Autopilot::Outputs autopilotOutputs;
+    Autopilot::DebugOutputs autopilotDebugOutputs;
+
+    controller->autopilot.update(transform_NED, autopilotOutputs, cycleTime, debugOutputs ? &autopilotDebugOutputs : nullptr);
+
+    outputs->valid = autopilotOutputs.valid ? 1 : 0;
+    outputs->direction_Front = autopilotOutputs.direction_Front;
+    outputs->propulsion_Front = autopilotOutputs.propulsion_Front;
+    outputs->direction_Back = autopilotOutputs.direction_Back;
+    outputs->propulsion_Back = autopilotOutputs.propulsion_Back;
+
+    if (debugOutputs)
+    {
+        debugOutputs->absBearing = autopilotDebugOutputs.absBearing;
+        debugOutputs->relativeBearing = autopilotDebugOutputs.relativeBearing;
+        debugOutputs->distanceToTarget = autopilotDebugOutputs.distanceToTarget;
+        debugOutputs->velocity_N = autopilotDebugOutputs.velocityVec(0);
+        debugOutputs->velocity_E = autopilotDebugOutputs.velocityVec(1);
+        debugOutputs->speed = autopilotDebugOutputs.speed;
+        debugOutputs->directionOfTravel = autopilotDebugOutputs.directionOfTravel;
+        debugOutputs->headingError = autopilotDebugOutputs.headingError;
+        debugOutputs->state = static_cast<int>(autopilotDebugOutputs.state);
+    }
+
+    return SFC_ERROR_NONE;
+}
+
+int sfc_getApiVersion(void)
+{
+    return SFC_API_VERSION;
+}
+
+SFC_Controller* sfc_create(void)
+{
+    SFC_Controller* controller = new (std::nothrow) SFC_Controller;
+
+    if (controller)
+    {
+        Autopilot::Destination destination = { 0, 0, 0 };
+
+        controller->autopilot.init(Autopilot::getDefaultSettings());
+        controller->autopilot.setDestination(destination);
+    }
+
+    return controller;
+}
+
+void sfc_destroy(SFC_Controller* controller)
+{
+    delete controller;
+}
+
+SFC_Error sfc_setReferencePoints(SFC_Controller* controller, const SFC_Vector3 refPoints[3])
+{
+    if (!controller || !refPoints)
+    {
+        return SFC_ERROR_INVALID_ARGUMENT;
+    }
+
+    controller->refPointsSet = false;
+
+    if (!controller->loSolver.setReferencePoints(Eigen::Vector3d(refPoints[0].x, refPoints[0].y, refPoints[0].z),
+                                                 Eigen::Vector3d(refPoints[1].x, refPoints[1].y, refPoints[1].z),
+                                                 Eigen::Vector3d(refPoints[2].x, refPoints[2].y, refPoints[2].z)))
+    {
+        return static_cast<SFC_Error>(controller->loSolver.getLastError());
+    }
+
+    return SFC_ERROR_NONE;
+}
+
+SFC_Error sfc_solve(SFC_Controller* controller, const SFC_Vector3 points[3], SFC_Pose* pose)
+{
+    if (!controller || !points || !pose)
+    {
+        return SFC_ERROR_INVALID_ARGUMENT;
+    }
+
+    Transform transform_EUS;
+
+    controller->loSolver.setPoints(Eigen::Vector3d(points[0].x, points[0].y, points[0].z),
+                                   Eigen::Vector3d(points[1].x, points[1].y, points[1].z),
+                                   Eigen::Vector3d(points[2].x, points[2].y, points[2].z));
+
+    if (!controller->loSolver.getTransformMatrix(transform_EUS))
+    {
+        return static_cast<SFC_Error>(controller->loSolver.getLastError());
+    }
+
+    getPose(transform_EUS, pose);
+
+    return SFC_ERROR_NONE;
+}
+
+void sfc_getDefaultAutopilotSettings(SFC_AutopilotSettings* settings)
+{
+    if (!settings)
+    {
+        return;
+    }
+
+    const Autopilot::Settings defaultSettings = Autopilot::getDefaultSettings();
+
+    settings->nearLimit = defaultSettings.nearLimit;
+    settings->cruisePropulsion = defaultSettings.cruisePropulsion;
+    settings->cruiseDirectionProp = defaultSettings.cruiseDirectionProp;
+    settings->pidSettings_Position = fromPIDSettings(defaultSettings.pidSettings_Position);
+    settings->pidSettings_Heading = fromPIDSettings(defaultSettings.pidSettings_Heading);
+}
+
+SFC_Error sfc_setAutopilotSettings(SFC_Controller* controller, const SFC_AutopilotSettings* settings)
+{
+    if (!controller || !settings)
+    {
+        return SFC_ERROR_INVALID_ARGUMENT;
+    }
+
+    Autopilot::Settings autopilotSettings;
+
+    autopilotSettings.nearLimit = settings->nearLimit;
+    autopilotSettings.cruisePropulsion = settings->cruisePropulsion;
+    autopilotSettings.cruiseDirectionProp = settings->cruiseDirectionProp;
+    autopilotSettings.pidSettings_Position = toPIDSettings(settings->pidSettings_Position);
+    autopilotSettings.pidSettings_Heading = toPIDSettings(settings->pidSettings_Heading);
+
+    controller->autopilot.init(autopilotSettings);
+
+    return SFC_ERROR_NONE;
+}
+
+SFC_Error sfc_setDestination(SFC_Controller* controller, const SFC_Destination* destination)
+{
+    if (!controller || !destination)
+    {
+        return SFC_ERROR_INVALID_ARGUMENT;
+    }
+
+    Autopilot::Destination autopilotDestination = { destination->coord_N, destination->coord_E, destination->heading };
+
+    controller->autopilot.setDestination(autopilotDestination);
+
+    return SFC_ERROR_NONE;
+}
+
+SFC_Error sfc_updateAutopilot(SFC_Controller* controller, const SFC_Pose* pose, const double cycleTime,
+                              SFC_AutopilotOutputs* outputs, SFC_AutopilotDebugOutputs* debugOutputs)
+{
+    if (!controller || !pose || !outputs)
+    {
+        return SFC_ERROR_INVALID_ARGUMENT;
+    }
+
+    Transform transform_EUS;
+
+    for (int row = 0; row < 4; row++)
+    {
+        for (int col = 0; col < 4; col++)
+        {
+            transform_EUS(row, col) = pose->transform_EUS[row * 4 + col];
+        }
+    }
+
+    return updateAutopilot(controller, transform_EUS, cycleTime, outputs, debugOutputs);
+}
+
+SFC_Error sfc_process(SFC_Controller* controller, const double values[18], const double cycleTime,
+                      SFC_Pose* pose, SFC_AutopilotOutputs* outputs, SFC_AutopilotDebugOutputs* debugOutputs)
+{
+    if (!controller || !values || !pose)
+    {
+        return SFC_ERROR_INVALID_ARGUMENT;
+    }
+
+    const double* refValues = &values[3 * 3];
+    bool refPointsChanged = !controller->refPointsSet;
+
+    for (int i = 0; (i < (3 * 3)) && !refPointsChanged; i++)
+    {
+        refPointsChanged = (refValues[i] != controller->refPointValues[i]);
+    }
+
+    if (refPointsChanged)
+    {
+        if (!controller->loSolver.setReferencePoints(Eigen::Vector3d(&refValues[0 * 3]),
+                                                     Eigen::Vector3d(&refValues[1 * 3]),
+                                                     Eigen::Vector3d(&refValues[2 * 3])))
+        {
+            controller->refPointsSet = false;
+            return static_cast<SFC_Error>(controller->loSolver.getLastError());
+        }
+
+        for (int i = 0; i < (3 * 3); i++)
+        {
+            controller->refPointValues[i] = refValues[i];
+        }
+
+        controller->refPointsSet = true;
+    }
+
+    Transform transform_EUS;
+
+    controller->loSolver.setPoints(Eigen::Vector3d(&values[0 * 3]),
+                                   Eigen::Vector3d(&values[1 * 3]),
+                                   Eigen::Vector3d(&values[2 * 3]));
+
+    if (!controller->loSolver.getTransformMatrix(transform_EUS))
+    {
+        return static_cast<SFC_Error>(controller->loSolver.getLastError());
+    }
+
+    getPose(transform_EUS, pose);
+
+    if (outputs)
+    {
+        return updateAutopilot(controller, transform_EUS, cycleTime, outputs, debugOutputs);
+    }
+
+    return SFC_ERROR_NONE;
+}
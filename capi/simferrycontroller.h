@@ -0,0 +1,178 @@
+/*
+    simferrycontroller.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef SIMFERRYCONTROLLER_H
+#define SIMFERRYCONTROLLER_H
+
+/*
+    C interface of the solver (LOSolver) and autopilot for linking them directly
+    into a simulator (GDNative / GDExtension, own simulators etc.).
+
+    - No Qt, plain structs in and out.
+    - Memory is only allocated by sfc_create. Other functions don't allocate
+      and can be called at any rate.
+    - A controller is not thread safe, but separate controllers can be used
+      from different threads.
+    - Units and axes are the same as in the UDP-protocol: Points are given
+      in EUS (x = East, y = Up, z = South), angles are radians.
+    - Structs are only extended by adding fields to the end, in which case
+      SFC_API_VERSION is incremented.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+#   if defined(SFC_BUILD_LIBRARY)
+#       define SFC_EXPORT __declspec(dllexport)
+#   else
+#       define SFC_EXPORT __declspec(dllimport)
+#   endif
+#else
+#   define SFC_EXPORT __attribute__((visibility("default")))
+#endif
+
+#define SFC_API_VERSION 1
+
+/* Same values as LOSolver::ErrorCode (+ SFC_ERROR_INVALID_ARGUMENT) */
+typedef enum SFC_Error
+{
+    SFC_ERROR_NONE = 0,
+
+    SFC_ERROR_INVALID_REFERENCE_POINTS = 100,
+
+    SFC_ERROR_INVALID_POINTS = 200,
+    SFC_ERROR_INVALID_AXES_CONVENTION,
+
+    SFC_ERROR_INVALID_ARGUMENT = 300,   /* NULL-pointer etc. */
+
+    SFC_ERROR_NOT_KNOWN = 0xFF
+} SFC_Error;
+
+typedef struct SFC_Vector3
+{
+    double x;
+    double y;
+    double z;
+} SFC_Vector3;
+
+typedef struct SFC_Pose
+{
+    double transform_EUS[16];   /* Row-major 4x4 (note: not transposed like in the UDP-protocol) */
+    double location_NED[3];     /* North, East, Down */
+    double heading;             /* Radians, 0 = North, clockwise, [-pi, pi] */
+    double pitch;
+    double roll;
+} SFC_Pose;
+
+typedef struct SFC_PIDSettings
+{
+    double p;
+    double i;
+    double d;
+    double f;
+    double maxI;
+    double maxOut;
+    int rememberI;
+} SFC_PIDSettings;
+
+typedef struct SFC_AutopilotSettings
+{
+    double nearLimit;
+    double cruisePropulsion;
+    double cruiseDirectionProp;
+    SFC_PIDSettings pidSettings_Position;
+    SFC_PIDSettings pidSettings_Heading;
+} SFC_AutopilotSettings;
+
+typedef struct SFC_Destination
+{
+    double coord_N;
+    double coord_E;
+    double heading;
+} SFC_Destination;
+
+typedef struct SFC_AutopilotOutputs
+{
+    int valid;
+    double direction_Front;     /* Radians as relative heading */
+    double propulsion_Front;    /* Arbitrary units */
+    double direction_Back;
+    double propulsion_Back;
+} SFC_AutopilotOutputs;
+
+typedef enum SFC_AutopilotState
+{
+    SFC_AUTOPILOTSTATE_UNKNOWN = 0,
+    SFC_AUTOPILOTSTATE_CRUISING,
+    SFC_AUTOPILOTSTATE_NEAR
+} SFC_AutopilotState;
+
+typedef struct SFC_AutopilotDebugOutputs
+{
+    double absBearing;
+    double relativeBearing;
+    double distanceToTarget;
+    double velocity_N;
+    double velocity_E;
+    double speed;
+    double directionOfTravel;
+    double headingError;
+    int state;                  /* SFC_AutopilotState */
+} SFC_AutopilotDebugOutputs;
+
+typedef struct SFC_Controller SFC_Controller;
+
+/* SFC_API_VERSION of the library (may differ from the header used) */
+SFC_EXPORT int sfc_getApiVersion(void);
+
+/* Returns NULL if out of memory. Autopilot uses the default settings and destination 0, 0, 0. */
+SFC_EXPORT SFC_Controller* sfc_create(void);
+SFC_EXPORT void sfc_destroy(SFC_Controller* controller);
+
+SFC_EXPORT SFC_Error sfc_setReferencePoints(SFC_Controller* controller, const SFC_Vector3 refPoints[3]);
+
+/* Solves the pose from the antenna points (reference points must be set) */
+SFC_EXPORT SFC_Error sfc_solve(SFC_Controller* controller, const SFC_Vector3 points[3], SFC_Pose* pose);
+
+SFC_EXPORT void sfc_getDefaultAutopilotSettings(SFC_AutopilotSettings* settings);
+
+/* Also resets the autopilot's internal state */
+SFC_EXPORT SFC_Error sfc_setAutopilotSettings(SFC_Controller* controller, const SFC_AutopilotSettings* settings);
+
+SFC_EXPORT SFC_Error sfc_setDestination(SFC_Controller* controller, const SFC_Destination* destination);
+
+/* Runs one autopilot cycle. cycleTime is the time since the previous update (s). debugOutputs may be NULL. */
+SFC_EXPORT SFC_Error sfc_updateAutopilot(SFC_Controller* controller, const SFC_Pose* pose, const double cycleTime,
+                                         SFC_AutopilotOutputs* outputs, SFC_AutopilotDebugOutputs* debugOutputs);
+
+/*
+    Does the same as SimFerryController for a received datagram: values are the
+    18 values of the datagram (points A, B, C, reference points A, B, C).
+    Reference points are only recalculated when they change.
+    outputs and debugOutputs may be NULL (autopilot is not run if outputs is NULL).
+*/
+SFC_EXPORT SFC_Error sfc_process(SFC_Controller* controller, const double values[18], const double cycleTime,
+                                 SFC_Pose* pose, SFC_AutopilotOutputs* outputs, SFC_AutopilotDebugOutputs* debugOutputs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIMFERRYCONTROLLER_H */
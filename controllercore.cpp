@@ -0,0 +1,244 @@
+/*
+    controllercore.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include "controllercore.h"
+
+OutputBatch::OutputBatch(const int capacity) :
+    arena(capacity * (maxInputSpace / maxDatagramsPerInput + 1)),
+    offsets(capacity),
+    lengths(capacity)
+{
+
+}
+
+bool OutputBatch::hasRoom(void) const
+{
+    return ((arena.size() - used) >= static_cast<size_t>(maxInputSpace)) &&
+            ((offsets.size() - count) >= static_cast<size_t>(maxDatagramsPerInput));
+}
+
+void OutputBatch::commit(const int length)
+{
+    offsets[count] = used;
+    lengths[count] = length;
+    used += length;
+    count++;
+}
+
+ControllerCore::Settings ControllerCore::getDefaultSettings(void)
+{
+    Settings settings;
+
+    settings.framedOutput = false;
+    settings.autopilotActive = true;
+    settings.debugTransform = true;
+    settings.maxVessels = 256;
+    settings.autopilotSettings = Autopilot::getDefaultSettings();
+    settings.destination.coord_N = 0;
+    settings.destination.coord_E = 0;
+    settings.destination.heading = 0;
+
+    return settings;
+}
+
+ControllerCore::ControllerCore(const Settings& settings) :
+    settings(settings),
+    vessels(settings.maxVessels > 0 ? settings.maxVessels : 1)
+{
+    for (Vessel& vessel : vessels)
+    {
+        vessel.autopilot.init(settings.autopilotSettings);
+        vessel.autopilot.setDestination(settings.destination);
+    }
+}
+
+bool ControllerCore::parse(const char* data, const int length, double values[2 * 3 * 3],
+                           bool& hasSequence, int64_t& sequence, int& vessel)
+{
+    // strtod etc. need a terminated string
+    char buffer[2048];
+
+    if ((length <= 0) || (length >= static_cast<int>(sizeof(buffer))))
+    {
+        return false;
+    }
+
+    memcpy(buffer, data, length);
+    buffer[length] = 0;
+
+    char* source = buffer;
+
+    for (int i = 0; i < (2 * 3 * 3); i++)
+    {
+        char* end;
+        values[i] = strtod(source, &end);
+
+        if ((end == source) || ((*end != ';') && (*end != 0)) || ((*end == 0) && (i != (2 * 3 * 3 - 1))))
+        {
+            return false;
+        }
+
+        source = (*end == ';') ? (end + 1) : end;
+    }
+
+    // Optional fields after the points: sequence number and vessel id
+    hasSequence = false;
+    vessel = 0;
+
+    if (*source != 0)
+    {
+        char* end;
+        sequence = strtoll(source, &end, 10);
+        hasSequence = (end != source) && ((*end == ';') || (*end == 0));
+
+        if (hasSequence && (*end == ';'))
+        {
+            source = end + 1;
+            vessel = static_cast<int>(strtol(source, &end, 10));
+
+            if (end == source)
+            {
+                vessel = 0;
+            }
+        }
+    }
+
+    return true;
+}
+
+void ControllerCore::output(const char* command, const int length, OutputBatch& outputs)
+{
+    if (!settings.framedOutput)
+    {
+        memcpy(outputs.getWritePointer(), command, length);
+        outputs.commit(length);
+    }
+    else
+    {
+        outputFrame.append(command, length);
+    }
+}
+
+bool ControllerCore::process(const char* data, const int length, const int64_t kernelTimestamp, OutputBatch& outputs)
+{
+    const int64_t processingStart = UdpReceiver::getRealTime();
+
+    statistics.datagrams++;
+
+    if (kernelTimestamp != 0)
+    {
+        statistics.queueingDelay.add(processingStart - kernelTimestamp);
+    }
+
+    double values[2 * 3 * 3];
+    bool hasSequence;
+    int64_t sequence = 0;
+    int vesselId;
+
+    if (!parse(data, length, values, hasSequence, sequence, vesselId) ||
+            (vesselId < 0) || (vesselId >= static_cast<int>(vessels.size())))
+    {
+        invalidDatagrams++;
+        return false;
+    }
+
+    Vessel& vessel = vessels[vesselId];
+    int64_t cycles = 1;
+
+    if (hasSequence)
+    {
+        // Same rule as MainWindow (a large step back is a restarted sender)
+        const SequenceTracker::Result result = vessel.sequenceTracker.update(sequence, cycles);
+
+        if (result == SequenceTracker::RESULT_STALE)
+        {
+            staleSamples++;
+            return false;
+        }
+        else if (result == SequenceTracker::RESULT_RESTARTED)
+        {
+            sequenceRestarts++;
+        }
+    }
+
+    const double* refValues = &values[3 * 3];
+    bool refPointsChanged = !vessel.refPointsSet;
+
+    for (int i = 0; (i < (3 * 3)) && !refPointsChanged; i++)
+    {
+        refPointsChanged = (refValues[i] != vessel.refPointValues[i]);
+    }
+
+    if (refPointsChanged)
+    {
+        vessel.refPointsSet = vessel.loSolver.setReferencePoints(Eigen::Vector3d(&refValues[0 * 3]),
+                Eigen::Vector3d(&refValues[1 * 3]),
+                Eigen::Vector3d(&refValues[2 * 3]));
+
+        memcpy(vessel.refPointValues, refValues, sizeof(vessel.refPointValues));
+    }
+
+    Eigen::Transform<double, 3, Eigen::Affine> transform_EUS;
+    Eigen::Transform<double, 3, Eigen::Affine> debugTransform;
+
+    vessel.loSolver.setPoints(Eigen::Vector3d(&values[0 * 3]),
+            Eigen::Vector3d(&values[1 * 3]),
+            Eigen::Vector3d(&values[2 * 3]));
+
+    if (!vessel.refPointsSet || !vessel.loSolver.getTransformMatrix(transform_EUS, settings.debugTransform ? &debugTransform : nullptr))
+    {
+        invalidDatagrams++;
+        return false;
+    }
+
+    char buffer[OutputEncoder::bufferSize];
+
+    outputFrame.clear();
+
+    output(buffer, OutputEncoder::encodeTransform(buffer, 1, transform_EUS), outputs);
+
+    if (settings.debugTransform)
+    {
+        output(buffer, OutputEncoder::encodeTransform(buffer, 10, debugTransform), outputs);
+    }
+
+    if (settings.autopilotActive)
+    {
+        Eigen::Transform<double, 3, Eigen::Affine> transform_NED = LOSolver::changeAxesConvention(transform_EUS, LOSolver::AC_EUS, LOSolver::AC_NED);
+        Autopilot::Outputs autopilotOutputs;
+
+        vessel.autopilot.update(transform_NED, autopilotOutputs, nominalCycleTime * cycles);
+
+        output(buffer, OutputEncoder::encodePropulsion(buffer, autopilotOutputs), outputs);
+    }
+
+    if (settings.framedOutput)
+    {
+        const char* frameData;
+        int frameLength = outputFrame.finish(frameData);
+
+        memcpy(outputs.getWritePointer(), frameData, frameLength);
+        outputs.commit(frameLength);
+    }
+
+    statistics.processingTime.add(UdpReceiver::getRealTime() - processingStart);
+
+    return true;
+}
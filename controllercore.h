@@ -0,0 +1,123 @@
+/*
+    controllercore.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef CONTROLLERCORE_H
+#define CONTROLLERCORE_H
+
+#include <vector>
+#include "losolver.h"
+#include "autopilot.h"
+#include "outputencoder.h"
+#include "udpreceiver.h"
+
+// Encoded datagrams waiting to be sent (in one batch).
+// Memory is allocated only when constructing.
+
+class OutputBatch
+{
+public:
+    // Space one input may need at most (framed output with all commands)
+    static const int maxInputSpace = 16 + OutputFrame::maxCommands * (12 + OutputEncoder::bufferSize);
+    static const int maxDatagramsPerInput = 3;
+
+    OutputBatch(const int capacity = 256);
+
+    void clear(void) { used = 0; count = 0; }
+
+    // Room for the outputs of one more input?
+    bool hasRoom(void) const;
+
+    // Write a datagram to getWritePointer() and commit its length
+    char* getWritePointer(void) { return &arena[used]; }
+    void commit(const int length);
+
+    int getCount(void) const { return count; }
+    const char* getData(const int index) const { return &arena[offsets[index]]; }
+    int getLength(const int index) const { return lengths[index]; }
+
+private:
+    std::vector<char> arena;
+    std::vector<int> offsets;
+    std::vector<int> lengths;
+    int used = 0;
+    int count = 0;
+};
+
+// Qt-free version of what MainWindow does for each antenna datagram (parse,
+// solve, autopilot, encode the replies) for the headless controller.
+// Each vessel (id after the sequence number, see README.md) has its own solver
+// and autopilot. Cycle time given to the autopilot is calculated from the
+// sequence numbers when available. Stale samples (sequence number not newer
+// than the last processed one) are dropped.
+
+class ControllerCore
+{
+public:
+    struct Settings
+    {
+        bool framedOutput;
+        bool autopilotActive;
+        bool debugTransform;                // Send the debug transform ("10;") like MainWindow does by default
+        int maxVessels;                     // Vessel ids 0...maxVessels-1 accepted
+        Autopilot::Settings autopilotSettings;
+        Autopilot::Destination destination; // Same for every vessel
+    };
+
+    static Settings getDefaultSettings(void);
+
+    ControllerCore(const Settings& settings);
+
+    // Appends the reply datagram(s) to outputs (which must have room, see OutputBatch::hasRoom).
+    // kernelTimestamp: ns, CLOCK_REALTIME, 0 = not available.
+    // Returns false if the datagram was not a valid (or was a stale) sample.
+    bool process(const char* data, const int length, const int64_t kernelTimestamp, OutputBatch& outputs);
+
+    ReceiveStatistics& getStatistics(void) { return statistics; }
+
+    uint64_t getInvalidDatagrams(void) const { return invalidDatagrams; }
+    uint64_t getStaleSamples(void) const { return staleSamples; }
+    uint64_t getSequenceRestarts(void) const { return sequenceRestarts; }
+
+private:
+    static constexpr double nominalCycleTime = 0.125;
+
+    struct Vessel
+    {
+        LOSolver loSolver;
+        Autopilot autopilot;
+        bool refPointsSet = false;
+        double refPointValues[3 * 3];
+        SequenceTracker sequenceTracker;
+    };
+
+    Settings settings;
+    std::vector<Vessel> vessels;
+    OutputFrame outputFrame;
+    ReceiveStatistics statistics;
+    uint64_t invalidDatagrams = 0;
+    uint64_t staleSamples = 0;
+    uint64_t sequenceRestarts = 0;
+
+    // Parses the 18 values + optional sequence number and vessel id
+    static bool parse(const char* data, const int length, double values[2 * 3 * 3],
+                      bool& hasSequence, int64_t& sequence, int& vessel);
+
+    void output(const char* command, const int length, OutputBatch& outputs);
+};
+
+#endif // CONTROLLERCORE_H
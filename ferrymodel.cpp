@@ -0,0 +1,273 @@
+/*
+    ferrymodel.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "ferrymodel.h"
+#include "losolver.h"
+
+FerryModel::FerryModel()
+{
+    init(getDefaultParameters());
+}
+
+FerryModel::FerryModel(const Parameters& parameters, const Disturbance& disturbance)
+{
+    init(parameters, disturbance);
+}
+
+void FerryModel::init(const Parameters& parameters, const Disturbance& disturbance)
+{
+    this->parameters = parameters;
+    this->disturbance = disturbance;
+
+    state.coord_N = 0;
+    state.coord_E = 0;
+    state.heading = 0;
+    state.speed_Surge = 0;
+    state.speed_Sway = 0;
+    state.yawRate = 0;
+
+    outputs.valid = true;
+    outputs.direction_Front = 0;
+    outputs.propulsion_Front = 0;
+    outputs.direction_Back = 0;
+    outputs.propulsion_Back = 0;
+
+    time = 0;
+    timeRemainder = 0;
+
+    noiseState = disturbance.noiseSeed;
+    spareNoiseValid = false;
+}
+
+uint64_t FerryModel::nextRandom(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+double FerryModel::getNoise(void)
+{
+    if (spareNoiseValid)
+    {
+        spareNoiseValid = false;
+        return spareNoise;
+    }
+
+    // 53 random bits -> (0, 1] (for the logarithm) and [0, 1)
+    const double u1 = ((nextRandom(noiseState) >> 11) + 1) * (1. / 9007199254740992.);
+    const double u2 = (nextRandom(noiseState) >> 11) * (1. / 9007199254740992.);
+    const double radius = disturbance.gnssNoise * sqrt(-2. * log(u1));
+
+    spareNoise = radius * sin(2. * M_PI * u2);
+    spareNoiseValid = true;
+
+    return radius * cos(2. * M_PI * u2);
+}
+
+FerryModel::Parameters FerryModel::getDefaultParameters(void)
+{
+    // These are just "ballpark" values giving a behaviour roughly similar to the
+    // ferry in FerrySim_Godot with the autopilot settings used in MainWindow
+    // (cruising speed about 5 m/s with cruisePropulsion = 50000).
+    Parameters parameters;
+
+    parameters.mass = 200000;
+    parameters.yawInertia = 15000000;
+    parameters.thrusterPosition_Front = 9;
+    parameters.thrusterPosition_Back = -9;
+    parameters.maxPropulsion = 100000;
+
+    parameters.linearDrag_Surge = 1000;
+    parameters.quadraticDrag_Surge = 4000;
+    parameters.linearDrag_Sway = 20000;
+    parameters.quadraticDrag_Sway = 20000;
+    parameters.linearDrag_Yaw = 5000000;
+    parameters.quadraticDrag_Yaw = 50000000;
+
+    parameters.timeStep = 0.01;
+
+    parameters.refPoints[0] = Eigen::Vector3d(0, 3, 10);
+    parameters.refPoints[1] = Eigen::Vector3d(-3, 3, -8);
+    parameters.refPoints[2] = Eigen::Vector3d(3, 3, -8);
+
+    return parameters;
+}
+
+FerryModel::Disturbance FerryModel::getNoDisturbance(void)
+{
+    Disturbance disturbance;
+
+    disturbance.current_N = 0;
+    disturbance.current_E = 0;
+    disturbance.windForce_N = 0;
+    disturbance.windForce_E = 0;
+    disturbance.windMoment = 0;
+    disturbance.gnssNoise = 0;
+    disturbance.noiseSeed = 0;
+
+    return disturbance;
+}
+
+void FerryModel::setState(const State& state)
+{
+    this->state = state;
+}
+
+void FerryModel::setOutputs(const Autopilot::Outputs& outputs)
+{
+    if (outputs.valid)
+    {
+        this->outputs = outputs;
+    }
+}
+
+void FerryModel::advance(const double time)
+{
+    timeRemainder += time;
+
+    // Small epsilon to prevent rounding errors from "eating" steps
+    // (f. ex. 0.125 s not being exactly 12.5 * 0.01 s).
+    while (timeRemainder >= parameters.timeStep * (1 - 1e-9))
+    {
+        step(parameters.timeStep);
+        timeRemainder -= parameters.timeStep;
+    }
+}
+
+static double limit(const double value, const double maximum)
+{
+    if (value > maximum)
+    {
+        return maximum;
+    }
+    else if (value < -maximum)
+    {
+        return -maximum;
+    }
+    return value;
+}
+
+static double drag(const double speed, const double linear, const double quadratic)
+{
+    return -(linear * speed + quadratic * speed * fabs(speed));
+}
+
+void FerryModel::step(const double dt)
+{
+    // Body frame: x = forward (surge), y = starboard (sway), rotation positive clockwise (seen from above).
+    // Thruster's direction is relative to the ferry's heading (positive towards starboard),
+    // this is the same convention the autopilot uses.
+
+    const double cosHeading = cos(state.heading);
+    const double sinHeading = sin(state.heading);
+
+    const double current_Surge = disturbance.current_N * cosHeading + disturbance.current_E * sinHeading;
+    const double current_Sway = -disturbance.current_N * sinHeading + disturbance.current_E * cosHeading;
+    const double wind_Surge = disturbance.windForce_N * cosHeading + disturbance.windForce_E * sinHeading;
+    const double wind_Sway = -disturbance.windForce_N * sinHeading + disturbance.windForce_E * cosHeading;
+
+    const double propulsion_Front = limit(outputs.propulsion_Front, parameters.maxPropulsion);
+    const double propulsion_Back = limit(outputs.propulsion_Back, parameters.maxPropulsion);
+
+    const double thrust_Front_Surge = propulsion_Front * cos(outputs.direction_Front);
+    const double thrust_Front_Sway = propulsion_Front * sin(outputs.direction_Front);
+    const double thrust_Back_Surge = propulsion_Back * cos(outputs.direction_Back);
+    const double thrust_Back_Sway = propulsion_Back * sin(outputs.direction_Back);
+
+    // Drag depends on the speed relative to water
+    const double force_Surge = thrust_Front_Surge + thrust_Back_Surge + wind_Surge +
+            drag(state.speed_Surge - current_Surge, parameters.linearDrag_Surge, parameters.quadraticDrag_Surge);
+
+    const double force_Sway = thrust_Front_Sway + thrust_Back_Sway + wind_Sway +
+            drag(state.speed_Sway - current_Sway, parameters.linearDrag_Sway, parameters.quadraticDrag_Sway);
+
+    const double moment = parameters.thrusterPosition_Front * thrust_Front_Sway +
+            parameters.thrusterPosition_Back * thrust_Back_Sway +
+            disturbance.windMoment +
+            drag(state.yawRate, parameters.linearDrag_Yaw, parameters.quadraticDrag_Yaw);
+
+    // Semi-implicit Euler: velocities first, then positions using the new velocities.
+    state.speed_Surge += (force_Surge / parameters.mass + state.speed_Sway * state.yawRate) * dt;
+    state.speed_Sway += (force_Sway / parameters.mass - state.speed_Surge * state.yawRate) * dt;
+    state.yawRate += (moment / parameters.yawInertia) * dt;
+
+    state.coord_N += (state.speed_Surge * cosHeading - state.speed_Sway * sinHeading) * dt;
+    state.coord_E += (state.speed_Surge * sinHeading + state.speed_Sway * cosHeading) * dt;
+    state.heading = atan2(sin(state.heading + state.yawRate * dt), cos(state.heading + state.yawRate * dt));
+
+    time += dt;
+}
+
+Eigen::Transform<double, 3, Eigen::Affine> FerryModel::getTransform_NED(void) const
+{
+    Eigen::Transform<double, 3, Eigen::Affine> transform;
+
+    transform.setIdentity();
+    transform.translate(Eigen::Vector3d(state.coord_N, state.coord_E, 0));
+    transform.rotate(Eigen::AngleAxisd(state.heading, Eigen::Vector3d::UnitZ()));
+
+    return transform;
+}
+
+void FerryModel::getAntennaPoints(Eigen::Vector3d points[3])
+{
+    Eigen::Transform<double, 3, Eigen::Affine> transform = getTransform_NED();
+
+    for (int i = 0; i < 3; i++)
+    {
+        // Simulator's local EUS-coordinates -> body coordinates (forward, starboard, down)
+        const Eigen::Vector3d& ref = parameters.refPoints[i];
+        Eigen::Vector3d body(ref(2), -ref(0), -ref(1));
+
+        points[i] = LOSolver::changeAxesConvention(Eigen::Vector3d(transform * body), LOSolver::AC_NED, LOSolver::AC_EUS);
+
+        if (disturbance.gnssNoise != 0)
+        {
+            for (int coord = 0; coord < 3; coord++)
+            {
+                points[i](coord) += getNoise();
+            }
+        }
+    }
+}
+
+void FerryModel::getReferencePoints(Eigen::Vector3d refPoints[3]) const
+{
+    for (int i = 0; i < 3; i++)
+    {
+        refPoints[i] = parameters.refPoints[i];
+    }
+}
+
+void FerryModel::getDatagramValues(double values[2 * 3 * 3])
+{
+    Eigen::Vector3d points[3];
+
+    getAntennaPoints(points);
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (int coord = 0; coord < 3; coord++)
+        {
+            values[i * 3 + coord] = points[i](coord);
+            values[(i + 3) * 3 + coord] = parameters.refPoints[i](coord);
+        }
+    }
+}
@@ -0,0 +1,132 @@
+/*
+    ferrymodel.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef FERRYMODEL_H
+#define FERRYMODEL_H
+
+#include <cstdint>
+#include "Eigen/Geometry"
+#include "autopilot.h"
+
+// Simple 3-DOF (surge, sway, yaw) model of the ferry for running the autopilot
+// in a closed loop without FerrySim_Godot. Ferry is driven by two steerable
+// thrusters (front and back) controlled by Autopilot::Outputs.
+// Antenna positions are given in the same form (EUS-coordinates, same order)
+// the simulator sends them, so they can be fed to LOSolver as is.
+// Model is fully deterministic (also the noise as it uses a seeded generator).
+// Noise is generated with splitmix64 and Box-Muller instead of std-library
+// distributions, whose output is implementation-defined.
+
+class FerryModel
+{
+public:
+    struct Parameters
+    {
+        // Note: metres (m) are correct here only if units of your coordinate system is 1 m.
+        double mass;                        // kg
+        double yawInertia;                  // kg * m^2
+        double thrusterPosition_Front;      // m from center, typically positive value
+        double thrusterPosition_Back;       // m from center, typically negative value
+        double maxPropulsion;               // Propulsion (of one thruster) is limited to this (N, same units as Autopilot::Outputs)
+
+        // Drag is modeled as linear + quadratic term (force = -(lin * v + quad * v * |v|))
+        double linearDrag_Surge;            // N / (m / s)
+        double quadraticDrag_Surge;         // N / (m / s)^2
+        double linearDrag_Sway;
+        double quadraticDrag_Sway;
+        double linearDrag_Yaw;              // Nm / (rad / s)
+        double quadraticDrag_Yaw;           // Nm / (rad / s)^2
+
+        double timeStep;                    // s, fixed integration step
+
+        // Antenna (reference) positions relative to the ferry's origin in the
+        // simulator's local EUS-coordinates (ferry's front is towards +Z).
+        Eigen::Vector3d refPoints[3];
+    };
+
+    struct Disturbance
+    {
+        double current_N;                   // Velocity of water, m / s
+        double current_E;
+        double windForce_N;                 // N
+        double windForce_E;
+        double windMoment;                  // Nm, positive turns clockwise (seen from above)
+        double gnssNoise;                   // Standard deviation of antenna coordinates, m (0 = no noise)
+        uint64_t noiseSeed;
+    };
+
+    struct State
+    {
+        double coord_N;                     // North
+        double coord_E;                     // East
+        double heading;                     // Radians
+        double speed_Surge;                 // m / s, relative to ground, positive = forward
+        double speed_Sway;                  // m / s, relative to ground, positive = starboard
+        double yawRate;                     // Radians / s, positive = clockwise
+    };
+
+    FerryModel();
+    FerryModel(const Parameters& parameters, const Disturbance& disturbance = getNoDisturbance());
+    void init(const Parameters& parameters, const Disturbance& disturbance = getNoDisturbance());
+
+    static Parameters getDefaultParameters(void);
+    static Disturbance getNoDisturbance(void);
+
+    // splitmix64 (advances state). Output is the same everywhere.
+    static uint64_t nextRandom(uint64_t& state);
+
+    void setState(const State& state);
+    const State& getState(void) const { return state; }
+    double getTime(void) const { return time; }
+
+    // Outputs are kept until set again (as the simulator does).
+    // Invalid outputs (valid == false) are ignored.
+    void setOutputs(const Autopilot::Outputs& outputs);
+
+    // Advances the simulation by time (s) using fixed steps.
+    // Remainder (if time is not a multiple of timeStep) is carried over to the next call.
+    void advance(const double time);
+
+    // Antenna positions (with noise if enabled) and reference points in EUS-coordinates
+    // in the same order as the values in the datagrams from the simulator.
+    void getAntennaPoints(Eigen::Vector3d points[3]);
+    void getReferencePoints(Eigen::Vector3d refPoints[3]) const;
+    void getDatagramValues(double values[2 * 3 * 3]);
+
+    // Ground truth (no noise) in NED-coordinates. Note: Linear part of this is a "proper"
+    // rotation matrix and differs from the one LOSolver::changeAxesConvention produces.
+    Eigen::Transform<double, 3, Eigen::Affine> getTransform_NED(void) const;
+
+private:
+    Parameters parameters;
+    Disturbance disturbance;
+    State state;
+    Autopilot::Outputs outputs;
+
+    double time = 0;
+    double timeRemainder = 0;
+
+    uint64_t noiseState = 0;
+    double spareNoise = 0;              // Box-Muller gives two values at a time
+    bool spareNoiseValid = false;
+
+    void step(const double dt);
+    double getNoise(void);
+};
+
+#endif // FERRYMODEL_H
@@ -0,0 +1,457 @@
+/*
+    geometrycalibrator.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "geometrycalibrator.h"
+#include <algorithm>
+#include <math.h>
+#include "Eigen/SVD"
+
+GeometryCalibrator::GeometryCalibrator(const Settings& settings, const unsigned int antennaCount)
+{
+    this->settings = settings;
+    this->antennaCount = antennaCount;
+}
+
+GeometryCalibrator::Settings GeometryCalibrator::getDefaultSettings(void)
+{
+    Settings settings;
+
+    settings.maxIterations = 50;
+    settings.huberThreshold = 0;
+    settings.tolerance = 1e-10;
+    settings.pointTolerance = 1e-5;
+
+    return settings;
+}
+
+bool GeometryCalibrator::addEpoch(const Eigen::Vector3d* points)
+{
+    for (unsigned int i = 0; i < antennaCount; i++)
+    {
+        if (!points[i].allFinite())
+        {
+            return false;
+        }
+    }
+
+    measuredPoints.insert(measuredPoints.end(), points, points + antennaCount);
+    epochCount++;
+
+    return true;
+}
+
+bool GeometryCalibrator::fitTransform(const Eigen::Vector3d* from, const Eigen::Vector3d* to, const unsigned int count,
+                                      Eigen::Matrix3d& rotation, Eigen::Vector3d& translation)
+{
+    Eigen::Vector3d fromCentroid = Eigen::Vector3d::Zero();
+    Eigen::Vector3d toCentroid = Eigen::Vector3d::Zero();
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        fromCentroid += from[i];
+        toCentroid += to[i];
+    }
+
+    fromCentroid /= count;
+    toCentroid /= count;
+
+    Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        covariance += (to[i] - toCentroid) * (from[i] - fromCentroid).transpose();
+    }
+
+    Eigen::JacobiSVD<Eigen::Matrix3d> svd(covariance, Eigen::ComputeFullU | Eigen::ComputeFullV);
+
+    // Rank 2 is enough (the third axis follows from the others)
+    if (!(svd.singularValues()(1) > 1e-9 * svd.singularValues()(0)))
+    {
+        return false;
+    }
+
+    // No reflections
+    Eigen::Vector3d signs(1, 1, ((svd.matrixU() * svd.matrixV().transpose()).determinant() < 0) ? -1 : 1);
+
+    rotation = svd.matrixU() * signs.asDiagonal() * svd.matrixV().transpose();
+    translation = toCentroid - rotation * fromCentroid;
+
+    return true;
+}
+
+double GeometryCalibrator::getCost(const std::vector<Pose>& poses, const std::vector<Eigen::Vector3d>& referencePoints,
+                                   double* squaredErrorSum) const
+{
+    const double threshold = settings.huberThreshold;
+    double cost = 0;
+    double squaredSum = 0;
+
+    for (size_t epoch = 0; epoch < epochCount; epoch++)
+    {
+        const Pose& pose = poses[epoch];
+
+        for (unsigned int i = 0; i < antennaCount; i++)
+        {
+            const double squaredError = (pose.rotation * referencePoints[i] + pose.translation -
+                                         measuredPoints[epoch * antennaCount + i]).squaredNorm();
+
+            squaredSum += squaredError;
+
+            if ((threshold <= 0) || (squaredError <= threshold * threshold))
+            {
+                cost += squaredError;
+            }
+            else
+            {
+                cost += 2 * threshold * sqrt(squaredError) - threshold * threshold;
+            }
+        }
+    }
+
+    if (squaredErrorSum)
+    {
+        *squaredErrorSum = squaredSum;
+    }
+
+    return cost;
+}
+
+void GeometryCalibrator::createPattern(void)
+{
+    // Columns (lower triangle): Pose column a of epoch k has rows 6k+a...6k+5 and all
+    // reference point rows, reference point column j has rows j...3N-1 of the reference points.
+    const int referenceSize = 3 * antennaCount;
+    const int referenceStart = static_cast<int>(6 * epochCount);
+    const int size = referenceStart + referenceSize;
+
+    normalMatrix.resize(size, size);
+    normalMatrix.resizeNonZeros(static_cast<int>(epochCount * (21 + 6 * referenceSize) + referenceSize * (referenceSize + 1) / 2));
+
+    int* outer = normalMatrix.outerIndexPtr();
+    int* inner = normalMatrix.innerIndexPtr();
+    int index = 0;
+
+    for (int column = 0; column < referenceStart; column++)
+    {
+        const int blockStart = column - column % 6;
+
+        outer[column] = index;
+
+        for (int row = column; row < blockStart + 6; row++)
+        {
+            inner[index++] = row;
+        }
+
+        for (int row = referenceStart; row < size; row++)
+        {
+            inner[index++] = row;
+        }
+    }
+
+    for (int column = referenceStart; column < size; column++)
+    {
+        outer[column] = index;
+
+        for (int row = column; row < size; row++)
+        {
+            inner[index++] = row;
+        }
+    }
+
+    outer[size] = index;
+
+    diagonalIndices.resize(size);
+
+    for (int column = 0; column < size; column++)
+    {
+        diagonalIndices[column] = outer[column];
+    }
+
+    gradient.resize(size);
+    diagonal.resize(size);
+}
+
+void GeometryCalibrator::buildNormalEquations(void)
+{
+    // Linearized at the current solution. Rotation is updated from the left
+    // (R' = exp([dTheta]x) * R), so for a point q = R * r + t:
+    // dq/dTheta = -[R * r]x, dq/dt = I, dq/dr = R.
+    const double threshold = settings.huberThreshold;
+    const int referenceStart = static_cast<int>(6 * epochCount);
+    const int* outer = normalMatrix.outerIndexPtr();
+    double* values = normalMatrix.valuePtr();
+
+    // Pose columns are written epoch by epoch, the reference point block is summed over them
+    std::fill(values + outer[referenceStart], values + normalMatrix.nonZeros(), 0.0);
+    gradient.setZero();
+
+    Eigen::Matrix<double, Eigen::Dynamic, 6> couplingBlock(3 * antennaCount, 6);
+
+    for (size_t epoch = 0; epoch < epochCount; epoch++)
+    {
+        const Pose& pose = poses[epoch];
+        const int poseStart = static_cast<int>(6 * epoch);
+
+        Eigen::Matrix<double, 6, 6> poseBlock = Eigen::Matrix<double, 6, 6>::Zero();
+        Eigen::Matrix<double, 6, 1> poseGradient = Eigen::Matrix<double, 6, 1>::Zero();
+
+        couplingBlock.setZero();
+
+        for (unsigned int i = 0; i < antennaCount; i++)
+        {
+            const Eigen::Vector3d rotatedPoint = pose.rotation * referencePoints[i];
+            const Eigen::Vector3d error = rotatedPoint + pose.translation - measuredPoints[epoch * antennaCount + i];
+            const double errorNorm = error.norm();
+
+            // Huber weight (iteratively reweighted)
+            const double weight = ((threshold <= 0) || (errorNorm <= threshold)) ? 1 : threshold / errorNorm;
+            const int referenceRow = referenceStart + 3 * i;
+            const Eigen::Vector3d referenceGradient = weight * pose.rotation.transpose() * error;
+
+            // dq/dr^T * dq/dr = R^T * R = I
+            for (int c = 0; c < 3; c++)
+            {
+                values[diagonalIndices[referenceRow + c]] += weight;
+                gradient(referenceRow + c) += referenceGradient(c);
+            }
+
+            if (epoch == 0)
+            {
+                // Fixed pose
+                continue;
+            }
+
+            Eigen::Matrix<double, 3, 6> poseJacobian;
+
+            poseJacobian << 0, rotatedPoint.z(), -rotatedPoint.y(), 1, 0, 0,
+                            -rotatedPoint.z(), 0, rotatedPoint.x(), 0, 1, 0,
+                            rotatedPoint.y(), -rotatedPoint.x(), 0, 0, 0, 1;
+
+            poseBlock.noalias() += weight * poseJacobian.transpose() * poseJacobian;
+            poseGradient.noalias() += weight * poseJacobian.transpose() * error;
+
+            couplingBlock.middleRows<3>(3 * i).noalias() = weight * pose.rotation.transpose() * poseJacobian;
+        }
+
+        if (epoch == 0)
+        {
+            poseBlock.setIdentity();
+        }
+
+        for (int column = 0; column < 6; column++)
+        {
+            for (int row = column; row < 6; row++)
+            {
+                values[outer[poseStart + column] + row - column] = poseBlock(row, column);
+            }
+
+            std::copy(couplingBlock.col(column).data(), couplingBlock.col(column).data() + 3 * antennaCount,
+                      values + outer[poseStart + column] + 6 - column);
+
+            gradient(poseStart + column) = poseGradient(column);
+        }
+    }
+
+    for (int i = 0; i < diagonal.size(); i++)
+    {
+        diagonal(i) = values[diagonalIndices[i]];
+    }
+}
+
+bool GeometryCalibrator::calibrate(const std::vector<Eigen::Vector3d>& initialReferencePoints, Result& result,
+                                   std::function<void(const Progress&)> progressCallback)
+{
+    if ((initialReferencePoints.size() != antennaCount) || (epochCount < 2))
+    {
+        return false;
+    }
+
+    // Initial poses from the initial reference points. Epochs with (nearly) collinear points are dropped.
+    referencePoints = initialReferencePoints;
+    poses.clear();
+    poses.reserve(epochCount);
+
+    size_t validEpochs = 0;
+
+    for (size_t epoch = 0; epoch < epochCount; epoch++)
+    {
+        Pose pose;
+
+        if (fitTransform(referencePoints.data(), &measuredPoints[epoch * antennaCount], antennaCount, pose.rotation, pose.translation))
+        {
+            std::copy(measuredPoints.begin() + epoch * antennaCount, measuredPoints.begin() + (epoch + 1) * antennaCount,
+                      measuredPoints.begin() + validEpochs * antennaCount);
+            poses.push_back(pose);
+            validEpochs++;
+        }
+    }
+
+    epochCount = validEpochs;
+    measuredPoints.resize(epochCount * antennaCount);
+
+    if (epochCount < 2)
+    {
+        return false;
+    }
+
+    const double coordinateCount = 3.0 * epochCount * antennaCount;
+    double squaredErrorSum;
+    double cost = getCost(poses, referencePoints, &squaredErrorSum);
+
+    result.initialRmsError = sqrt(squaredErrorSum / coordinateCount);
+    result.rmsError = result.initialRmsError;
+    result.iterations = 0;
+    result.converged = false;
+
+    createPattern();
+
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>, Eigen::Lower, Eigen::NaturalOrdering<int> > ldlt;
+
+    ldlt.analyzePattern(normalMatrix);
+
+    const int referenceStart = static_cast<int>(6 * epochCount);
+    double lambda = 1e-4;
+    std::vector<Pose> newPoses(epochCount);
+    std::vector<Eigen::Vector3d> newReferencePoints(antennaCount);
+
+    while ((result.iterations < settings.maxIterations) && !result.converged)
+    {
+        buildNormalEquations();
+
+        Progress progress;
+
+        progress.rejectedSteps = 0;
+        progress.pointChange = 0;
+
+        double newCost = cost;
+
+        while (true)
+        {
+            // Marquardt: damping scaled by the diagonal
+            double* values = normalMatrix.valuePtr();
+
+            for (int i = 0; i < diagonal.size(); i++)
+            {
+                values[diagonalIndices[i]] = diagonal(i) * (1 + lambda) + 1e-12;
+            }
+
+            ldlt.factorize(normalMatrix);
+
+            if (ldlt.info() == Eigen::Success)
+            {
+                const Eigen::VectorXd step = ldlt.solve(-gradient);
+
+                for (size_t epoch = 0; epoch < epochCount; epoch++)
+                {
+                    const Eigen::Vector3d rotationStep = step.segment<3>(6 * epoch);
+                    const double angle = rotationStep.norm();
+
+                    newPoses[epoch].rotation = (angle > 0) ?
+                                Eigen::Matrix3d(Eigen::AngleAxisd(angle, rotationStep / angle) * poses[epoch].rotation) :
+                                poses[epoch].rotation;
+                    newPoses[epoch].translation = poses[epoch].translation + step.segment<3>(6 * epoch + 3);
+                }
+
+                for (unsigned int i = 0; i < antennaCount; i++)
+                {
+                    newReferencePoints[i] = referencePoints[i] + step.segment<3>(referenceStart + 3 * i);
+                }
+
+                newCost = getCost(newPoses, newReferencePoints, &squaredErrorSum);
+
+                if (newCost < cost)
+                {
+                    lambda = std::max(lambda / 3, 1e-12);
+                    break;
+                }
+            }
+
+            lambda *= 4;
+            progress.rejectedSteps++;
+
+            if (lambda > 1e12)
+            {
+                // No step decreases the cost any more
+                newCost = cost;
+                result.converged = true;
+                break;
+            }
+        }
+
+        result.iterations++;
+
+        if (newCost < cost)
+        {
+            for (unsigned int i = 0; i < antennaCount; i++)
+            {
+                progress.pointChange = std::max(progress.pointChange, (newReferencePoints[i] - referencePoints[i]).norm());
+            }
+
+            if (((cost - newCost) < settings.tolerance * cost) || (progress.pointChange < settings.pointTolerance))
+            {
+                result.converged = true;
+            }
+
+            poses.swap(newPoses);
+            referencePoints.swap(newReferencePoints);
+            cost = newCost;
+            result.rmsError = sqrt(squaredErrorSum / coordinateCount);
+        }
+
+        if (progressCallback)
+        {
+            progress.iteration = result.iterations;
+            progress.rmsError = result.rmsError;
+            progress.lambda = lambda;
+            progressCallback(progress);
+        }
+    }
+
+    // Per antenna errors
+    result.pointRmsErrors.assign(antennaCount, 0);
+
+    for (size_t epoch = 0; epoch < epochCount; epoch++)
+    {
+        for (unsigned int i = 0; i < antennaCount; i++)
+        {
+            result.pointRmsErrors[i] += (poses[epoch].rotation * referencePoints[i] + poses[epoch].translation -
+                                         measuredPoints[epoch * antennaCount + i]).squaredNorm();
+        }
+    }
+
+    for (unsigned int i = 0; i < antennaCount; i++)
+    {
+        result.pointRmsErrors[i] = sqrt(result.pointRmsErrors[i] / (3.0 * epochCount));
+    }
+
+    // Move to the frame of the initial reference points
+    Eigen::Matrix3d rotation;
+    Eigen::Vector3d translation;
+
+    result.referencePoints = referencePoints;
+
+    if (fitTransform(referencePoints.data(), initialReferencePoints.data(), antennaCount, rotation, translation))
+    {
+        for (unsigned int i = 0; i < antennaCount; i++)
+        {
+            result.referencePoints[i] = rotation * referencePoints[i] + translation;
+        }
+    }
+
+    return true;
+}
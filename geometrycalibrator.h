@@ -0,0 +1,120 @@
+/*
+    geometrycalibrator.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef GEOMETRYCALIBRATOR_H
+#define GEOMETRYCALIBRATOR_H
+
+#include <functional>
+#include <vector>
+#include "Eigen/Geometry"
+#include "Eigen/SparseCholesky"
+
+// Estimates the reference points (antenna geometry in vessel coordinates) from
+// measured antenna positions of many epochs: Minimizes the (optionally Huber-weighted)
+// squared distances between the measured points and the reference points transformed
+// with each epoch's pose, jointly over all poses and the reference points, with
+// Levenberg-Marquardt.
+//
+// Unknowns are ordered pose by pose (6 each) and the reference points last, so the
+// normal matrix is block arrowhead: Block diagonal pose part, reference points coupled
+// to every pose. SimplicialLDLT with natural ordering then eliminates the poses
+// one by one (fill-in only in the small reference point block), so each iteration is
+// linear in the number of epochs. The sparsity pattern is the same for every
+// iteration, so it is analyzed only once.
+//
+// Positions alone only determine the shape of the geometry (distances between the
+// antennas), not the vessel's origin and axes. During the solution the pose of the
+// first epoch is kept fixed, and the result is finally moved (rotated and translated)
+// to best fit the initial reference points.
+
+class GeometryCalibrator
+{
+public:
+    struct Settings
+    {
+        int maxIterations;
+        double huberThreshold;              // m (distance of a point), 0 = plain least squares
+        double tolerance;                   // Stop when the relative decrease of the cost is smaller
+        double pointTolerance;              // or when no reference point moves more than this (m)
+    };
+
+    struct Progress
+    {
+        int iteration;
+        double rmsError;                    // m (per coordinate)
+        double lambda;                      // Damping after the iteration
+        double pointChange;                 // Largest change of a reference point (m)
+        int rejectedSteps;                  // Steps rejected during the iteration
+    };
+
+    struct Result
+    {
+        std::vector<Eigen::Vector3d> referencePoints;
+        double initialRmsError;             // m (per coordinate), initial reference points
+        double rmsError;
+        std::vector<double> pointRmsErrors; // Per antenna
+        int iterations;
+        bool converged;
+    };
+
+    GeometryCalibrator(const Settings& settings, const unsigned int antennaCount);
+
+    static Settings getDefaultSettings(void);
+
+    unsigned int getAntennaCount(void) const { return antennaCount; }
+    size_t getEpochCount(void) const { return epochCount; }
+
+    // antennaCount points. Returns false (and ignores the epoch) if some value is not finite.
+    bool addEpoch(const Eigen::Vector3d* points);
+
+    bool calibrate(const std::vector<Eigen::Vector3d>& initialReferencePoints, Result& result,
+                   std::function<void(const Progress&)> progressCallback = nullptr);
+
+    // Rotation and translation moving points "from" to best fit points "to" (Kabsch).
+    // Returns false if the points are (nearly) on the same line.
+    static bool fitTransform(const Eigen::Vector3d* from, const Eigen::Vector3d* to, const unsigned int count,
+                             Eigen::Matrix3d& rotation, Eigen::Vector3d& translation);
+
+private:
+    Settings settings;
+    unsigned int antennaCount;
+
+    size_t epochCount = 0;
+    std::vector<Eigen::Vector3d> measuredPoints;    // antennaCount per epoch
+
+    struct Pose
+    {
+        Eigen::Matrix3d rotation;
+        Eigen::Vector3d translation;
+    };
+
+    std::vector<Pose> poses;
+    std::vector<Eigen::Vector3d> referencePoints;
+
+    Eigen::SparseMatrix<double> normalMatrix;       // Lower triangle
+    Eigen::VectorXd gradient;
+    Eigen::VectorXd diagonal;                       // Undamped diagonal of normalMatrix
+    std::vector<int> diagonalIndices;               // Indices of the diagonal in normalMatrix.valuePtr()
+
+    double getCost(const std::vector<Pose>& poses, const std::vector<Eigen::Vector3d>& referencePoints,
+                   double* squaredErrorSum = nullptr) const;
+    void createPattern(void);
+    void buildNormalEquations(void);
+};
+
+#endif // GEOMETRYCALIBRATOR_H
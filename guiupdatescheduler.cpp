@@ -0,0 +1,65 @@
+/*
+    guiupdatescheduler.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QGuiApplication>
+#include <QScreen>
+#include "guiupdatescheduler.h"
+
+GuiUpdateScheduler::GuiUpdateScheduler(const int frameInterval, QObject* parent) :
+    QObject(parent),
+    frameInterval(frameInterval)
+{
+    if (this->frameInterval <= 0)
+    {
+        const QScreen* screen = QGuiApplication::primaryScreen();
+        const double refreshRate = screen ? screen->refreshRate() : 0;
+
+        this->frameInterval = (refreshRate >= 1) ? static_cast<int>(1000 / refreshRate) : 16;
+    }
+
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    connect(timer, SIGNAL(timeout()), this, SLOT(on_timer_timeout()));
+
+    sinceLastFrame.start();
+}
+
+void GuiUpdateScheduler::markDirty(const unsigned int parts)
+{
+    requests++;
+    dirtyParts |= parts;
+
+    if (!timer->isActive())
+    {
+        // Right away if the previous frame was long enough ago
+        const qint64 elapsed = sinceLastFrame.elapsed();
+
+        timer->start((elapsed >= frameInterval) ? 0 : static_cast<int>(frameInterval - elapsed));
+    }
+}
+
+void GuiUpdateScheduler::on_timer_timeout()
+{
+    const unsigned int parts = dirtyParts;
+
+    dirtyParts = 0;
+    frames++;
+    sinceLastFrame.restart();
+
+    emit update(parts);
+}
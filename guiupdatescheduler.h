@@ -0,0 +1,64 @@
+/*
+    guiupdatescheduler.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef GUIUPDATESCHEDULER_H
+#define GUIUPDATESCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+// Coalesces widget updates to display frames: Data handlers only store the
+// latest values and mark the corresponding parts (bit flags, defined by the
+// user) dirty. update(parts) is emitted once at the next frame with all parts
+// marked since the previous one, at most once per frame interval.
+// The timer only runs while something is dirty.
+
+class GuiUpdateScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    // frameInterval = 0: Refresh rate of the primary screen
+    explicit GuiUpdateScheduler(const int frameInterval = 0, QObject* parent = nullptr);
+
+    void markDirty(const unsigned int parts);
+
+    int getFrameInterval(void) const { return frameInterval; }
+
+    // Number of markDirty calls / update signals emitted (i.e. updates saved = requests - frames)
+    quint64 getRequests(void) const { return requests; }
+    quint64 getFrames(void) const { return frames; }
+
+signals:
+    void update(unsigned int parts);
+
+private slots:
+    void on_timer_timeout();
+
+private:
+    int frameInterval;
+    QTimer* timer;
+    QElapsedTimer sinceLastFrame;
+    unsigned int dirtyParts = 0;
+
+    quint64 requests = 0;
+    quint64 frames = 0;
+};
+
+#endif // GUIUPDATESCHEDULER_H
@@ -0,0 +1,846 @@
+/*
+    headlessbackend.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include "headlessbackend.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// io_uring is used through the system calls directly (no liburing needed).
+// Multishot recvmsg and provided buffer rings need kernel headers from 6.0 or later.
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_ENTER_EXT_ARG) && defined(__NR_io_uring_setup)
+#define HEADLESS_IO_URING
+#endif
+#endif
+
+#ifdef __linux__
+
+static bool getSocketAddress(const std::string& address, const uint16_t port, sockaddr_in& socketAddress)
+{
+    memset(&socketAddress, 0, sizeof(socketAddress));
+    socketAddress.sin_family = AF_INET;
+    socketAddress.sin_port = htons(port);
+
+    return inet_pton(AF_INET, address.c_str(), &socketAddress.sin_addr) == 1;
+}
+
+// epoll_wait + recvmmsg / sendmmsg
+
+class RecvmmsgBackend : public HeadlessBackend
+{
+public:
+    RecvmmsgBackend();
+    ~RecvmmsgBackend() override;
+
+    bool open(const std::string& bindAddress, const uint16_t bindPort,
+              const std::string& sendAddress, const uint16_t sendPort,
+              const int receiveBufferSize) override;
+    void close(void) override;
+    bool poll(ControllerCore& core, const int timeout) override;
+
+private:
+    static const int batchSize = 64;
+    static const int bufferSize = 2048;
+
+    UdpReceiver receiver;
+    int epollFd = -1;
+    uint64_t kernelDrops = 0;
+
+    std::vector<char> buffers;
+    std::vector<char> controls;
+    std::vector<iovec> receiveIovecs;
+    std::vector<mmsghdr> receiveMessages;
+
+    sockaddr_in sendAddress;
+    OutputBatch outputs;
+    std::vector<iovec> sendIovecs;
+    std::vector<mmsghdr> sendMessages;
+
+    void flush(void);
+};
+
+RecvmmsgBackend::RecvmmsgBackend() :
+    buffers(batchSize * bufferSize),
+    controls(batchSize * UdpReceiver::getControlSpace()),
+    receiveIovecs(batchSize),
+    receiveMessages(batchSize),
+    outputs(batchSize * OutputBatch::maxDatagramsPerInput),
+    sendIovecs(batchSize * OutputBatch::maxDatagramsPerInput),
+    sendMessages(batchSize * OutputBatch::maxDatagramsPerInput)
+{
+    for (int i = 0; i < batchSize; i++)
+    {
+        receiveIovecs[i].iov_base = &buffers[i * bufferSize];
+        receiveIovecs[i].iov_len = bufferSize;
+
+        msghdr& header = receiveMessages[i].msg_hdr;
+        memset(&header, 0, sizeof(header));
+        header.msg_iov = &receiveIovecs[i];
+        header.msg_iovlen = 1;
+        header.msg_control = &controls[i * UdpReceiver::getControlSpace()];
+    }
+
+    for (size_t i = 0; i < sendMessages.size(); i++)
+    {
+        msghdr& header = sendMessages[i].msg_hdr;
+        memset(&header, 0, sizeof(header));
+        header.msg_name = &sendAddress;
+        header.msg_namelen = sizeof(sendAddress);
+        header.msg_iov = &sendIovecs[i];
+        header.msg_iovlen = 1;
+    }
+}
+
+RecvmmsgBackend::~RecvmmsgBackend()
+{
+    close();
+}
+
+bool RecvmmsgBackend::open(const std::string& bindAddress, const uint16_t bindPort,
+                           const std::string& sendAddress, const uint16_t sendPort,
+                           const int receiveBufferSize)
+{
+    close();
+
+    if (!getSocketAddress(sendAddress, sendPort, this->sendAddress) ||
+            !receiver.open(bindAddress, bindPort, receiveBufferSize))
+    {
+        return false;
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+
+    if ((epollFd < 0) || (epoll_ctl(epollFd, EPOLL_CTL_ADD, receiver.getSocketDescriptor(), &event) != 0))
+    {
+        close();
+        return false;
+    }
+
+    kernelDrops = 0;
+    outputs.clear();
+
+    return true;
+}
+
+void RecvmmsgBackend::close(void)
+{
+    if (epollFd >= 0)
+    {
+        ::close(epollFd);
+        epollFd = -1;
+    }
+
+    receiver.close();
+}
+
+bool RecvmmsgBackend::poll(ControllerCore& core, const int timeout)
+{
+    if (epollFd < 0)
+    {
+        return false;
+    }
+
+    epoll_event event;
+    int retVal = epoll_wait(epollFd, &event, 1, timeout);
+
+    if (retVal <= 0)
+    {
+        return (retVal == 0) || (errno == EINTR);
+    }
+
+    statistics.waits++;
+
+    for (;;)
+    {
+        for (int i = 0; i < batchSize; i++)
+        {
+            receiveMessages[i].msg_hdr.msg_controllen = UdpReceiver::getControlSpace();
+        }
+
+        const int received = recvmmsg(receiver.getSocketDescriptor(), receiveMessages.data(), batchSize, MSG_DONTWAIT, nullptr);
+
+        if (received <= 0)
+        {
+            break;
+        }
+
+        statistics.received += received;
+
+        for (int i = 0; i < received; i++)
+        {
+            const msghdr& header = receiveMessages[i].msg_hdr;
+            int64_t kernelTimestamp;
+
+            UdpReceiver::parseControlMessages(header, kernelTimestamp, kernelDrops);
+
+            if (header.msg_flags & MSG_TRUNC)
+            {
+                continue;
+            }
+
+            if (!outputs.hasRoom())
+            {
+                flush();
+            }
+
+            core.process(static_cast<const char*>(receiveIovecs[i].iov_base), receiveMessages[i].msg_len, kernelTimestamp, outputs);
+        }
+
+        flush();
+
+        // Socket was emptied (saves a recvmmsg returning EAGAIN)
+        if (received < batchSize)
+        {
+            break;
+        }
+    }
+
+    core.getStatistics().kernelDrops = kernelDrops;
+
+    return true;
+}
+
+void RecvmmsgBackend::flush(void)
+{
+    const int count = outputs.getCount();
+
+    for (int i = 0; i < count; i++)
+    {
+        sendIovecs[i].iov_base = const_cast<char*>(outputs.getData(i));
+        sendIovecs[i].iov_len = outputs.getLength(i);
+    }
+
+    int index = 0;
+
+    while (index < count)
+    {
+        int retVal = sendmmsg(receiver.getSocketDescriptor(), &sendMessages[index], count - index, MSG_DONTWAIT);
+
+        if (retVal <= 0)
+        {
+            // Skip the failing one (socket buffer full etc.) and try the rest
+            statistics.sendFailures++;
+            index++;
+            continue;
+        }
+
+        index += retVal;
+        statistics.sent += retVal;
+    }
+
+    outputs.clear();
+}
+
+#ifdef HEADLESS_IO_URING
+
+// io_uring: multishot recvmsg (provided buffer ring) + sendmsg
+
+class IoUringBackend : public HeadlessBackend
+{
+public:
+    IoUringBackend();
+    ~IoUringBackend() override;
+
+    bool open(const std::string& bindAddress, const uint16_t bindPort,
+              const std::string& sendAddress, const uint16_t sendPort,
+              const int receiveBufferSize) override;
+    void close(void) override;
+    bool poll(ControllerCore& core, const int timeout) override;
+
+private:
+    static const unsigned submissionEntries = 256;
+    static const unsigned completionEntries = 1024;
+    static const unsigned bufferCount = 256;      // Power of two
+    static const int bufferSize = 2048;
+    static const uint16_t bufferGroup = 0;
+    static const int maxInputsPerBatch = 64;
+
+    enum UserData
+    {
+        USERDATA_RECEIVE = 1,
+        USERDATA_SEND,
+        USERDATA_CANCEL
+    };
+
+    UdpReceiver receiver;
+    int ringFd = -1;
+    uint64_t kernelDrops = 0;
+
+    // Rings (mapped from the kernel)
+    void* submissionRing = MAP_FAILED;
+    size_t submissionRingSize = 0;
+    void* completionRing = MAP_FAILED;
+    size_t completionRingSize = 0;
+    io_uring_sqe* submissionQueueEntries = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t submissionQueueEntriesSize = 0;
+
+    unsigned* submissionHead = nullptr;
+    unsigned* submissionTail = nullptr;
+    unsigned submissionMask = 0;
+    unsigned submissionLocalTail = 0;
+    unsigned* completionHead = nullptr;
+    unsigned* completionTail = nullptr;
+    unsigned completionMask = 0;
+    io_uring_cqe* completionQueueEntries = nullptr;
+
+    // Provided buffers
+    io_uring_buf_ring* bufferRing = static_cast<io_uring_buf_ring*>(MAP_FAILED);
+    size_t bufferRingSize = 0;
+    uint16_t bufferRingTail = 0;
+    std::vector<char> buffers;
+
+    msghdr receiveHeader;
+    bool receiveArmed = false;
+
+    sockaddr_in sendAddress;
+    OutputBatch outputs;
+    std::vector<iovec> sendIovecs;
+    std::vector<msghdr> sendHeaders;
+    int queuedSends = 0;
+    int queuedInputs = 0;
+
+    bool setup(void);
+    io_uring_sqe* getSubmissionQueueEntry(void);
+    int enter(const unsigned minComplete, const int timeout);
+    unsigned getPendingSubmissions(void) const;
+    bool hasCompletions(void) const;
+    void armReceive(void);
+    void recycleBuffer(const uint16_t bufferId);
+    void handleReceive(ControllerCore& core, const io_uring_cqe& cqe);
+    void queueSends(void);
+};
+
+IoUringBackend::IoUringBackend() :
+    buffers(bufferCount * bufferSize),
+    outputs(maxInputsPerBatch * OutputBatch::maxDatagramsPerInput),
+    sendIovecs(maxInputsPerBatch * OutputBatch::maxDatagramsPerInput),
+    sendHeaders(maxInputsPerBatch * OutputBatch::maxDatagramsPerInput)
+{
+    // Multishot: No iovecs, the datagram goes to the selected buffer after
+    // io_uring_recvmsg_out and the control messages (name is not needed)
+    memset(&receiveHeader, 0, sizeof(receiveHeader));
+    receiveHeader.msg_controllen = UdpReceiver::getControlSpace();
+
+    for (size_t i = 0; i < sendHeaders.size(); i++)
+    {
+        msghdr& header = sendHeaders[i];
+        memset(&header, 0, sizeof(header));
+        header.msg_name = &sendAddress;
+        header.msg_namelen = sizeof(sendAddress);
+        header.msg_iov = &sendIovecs[i];
+        header.msg_iovlen = 1;
+    }
+}
+
+IoUringBackend::~IoUringBackend()
+{
+    close();
+}
+
+bool IoUringBackend::open(const std::string& bindAddress, const uint16_t bindPort,
+                          const std::string& sendAddress, const uint16_t sendPort,
+                          const int receiveBufferSize)
+{
+    close();
+
+    if (!getSocketAddress(sendAddress, sendPort, this->sendAddress) ||
+            !receiver.open(bindAddress, bindPort, receiveBufferSize) ||
+            !setup())
+    {
+        close();
+        return false;
+    }
+
+    kernelDrops = 0;
+    outputs.clear();
+    queuedSends = 0;
+    queuedInputs = 0;
+
+    armReceive();
+
+    return true;
+}
+
+bool IoUringBackend::setup(void)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = completionEntries;
+
+#ifdef IORING_SETUP_SINGLE_ISSUER
+    // Only this thread submits (6.0+, lets the kernel skip some locking)
+    params.flags |= IORING_SETUP_SINGLE_ISSUER;
+    ringFd = static_cast<int>(syscall(__NR_io_uring_setup, submissionEntries, &params));
+
+    if (ringFd < 0)
+    {
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = completionEntries;
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, submissionEntries, &params));
+    }
+#else
+    ringFd = static_cast<int>(syscall(__NR_io_uring_setup, submissionEntries, &params));
+#endif
+
+    if ((ringFd < 0) || !(params.features & IORING_FEAT_EXT_ARG))
+    {
+        return false;
+    }
+
+    submissionRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    completionRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        submissionRingSize = completionRingSize = std::max(submissionRingSize, completionRingSize);
+    }
+
+    submissionRing = mmap(nullptr, submissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ringFd, IORING_OFF_SQ_RING);
+
+    if (submissionRing == MAP_FAILED)
+    {
+        return false;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        completionRing = submissionRing;
+    }
+    else
+    {
+        completionRing = mmap(nullptr, completionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                              ringFd, IORING_OFF_CQ_RING);
+
+        if (completionRing == MAP_FAILED)
+        {
+            return false;
+        }
+    }
+
+    submissionQueueEntriesSize = params.sq_entries * sizeof(io_uring_sqe);
+    submissionQueueEntries = static_cast<io_uring_sqe*>(mmap(nullptr, submissionQueueEntriesSize, PROT_READ | PROT_WRITE,
+                                                             MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+
+    if (submissionQueueEntries == MAP_FAILED)
+    {
+        return false;
+    }
+
+    char* sq = static_cast<char*>(submissionRing);
+    char* cq = static_cast<char*>(completionRing);
+
+    submissionHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    submissionTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    submissionMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    submissionLocalTail = *submissionTail;
+
+    // Entries are always used in order
+    unsigned* submissionArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    for (unsigned i = 0; i < params.sq_entries; i++)
+    {
+        submissionArray[i] = i;
+    }
+
+    completionHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    completionTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    completionMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    completionQueueEntries = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // Provided buffer ring (page aligned memory shared with the kernel)
+    bufferRingSize = bufferCount * sizeof(io_uring_buf);
+    bufferRing = static_cast<io_uring_buf_ring*>(mmap(nullptr, bufferRingSize, PROT_READ | PROT_WRITE,
+                                                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+
+    if (bufferRing == MAP_FAILED)
+    {
+        return false;
+    }
+
+    io_uring_buf_reg registration;
+    memset(&registration, 0, sizeof(registration));
+    registration.ring_addr = reinterpret_cast<uint64_t>(bufferRing);
+    registration.ring_entries = bufferCount;
+    registration.bgid = bufferGroup;
+
+    if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PBUF_RING, &registration, 1) != 0)
+    {
+        return false;
+    }
+
+    bufferRingTail = 0;
+
+    for (unsigned i = 0; i < bufferCount; i++)
+    {
+        recycleBuffer(static_cast<uint16_t>(i));
+    }
+
+    __atomic_store_n(&bufferRing->tail, bufferRingTail, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+void IoUringBackend::close(void)
+{
+    if ((ringFd >= 0) && receiveArmed)
+    {
+        // Pending receive keeps the socket open (and the port bound) until
+        // the ring has been torn down in the background
+        io_uring_sqe* sqe = getSubmissionQueueEntry();
+
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = USERDATA_RECEIVE;
+        sqe->user_data = USERDATA_CANCEL;
+
+        enter(2, 100);
+    }
+
+    if (submissionQueueEntries != MAP_FAILED)
+    {
+        munmap(submissionQueueEntries, submissionQueueEntriesSize);
+        submissionQueueEntries = static_cast<io_uring_sqe*>(MAP_FAILED);
+    }
+
+    if ((completionRing != MAP_FAILED) && (completionRing != submissionRing))
+    {
+        munmap(completionRing, completionRingSize);
+    }
+
+    completionRing = MAP_FAILED;
+
+    if (submissionRing != MAP_FAILED)
+    {
+        munmap(submissionRing, submissionRingSize);
+        submissionRing = MAP_FAILED;
+    }
+
+    // Buffers are unregistered when the ring is closed
+    if (ringFd >= 0)
+    {
+        ::close(ringFd);
+        ringFd = -1;
+    }
+
+    if (bufferRing != MAP_FAILED)
+    {
+        munmap(bufferRing, bufferRingSize);
+        bufferRing = static_cast<io_uring_buf_ring*>(MAP_FAILED);
+    }
+
+    receiver.close();
+    receiveArmed = false;
+}
+
+io_uring_sqe* IoUringBackend::getSubmissionQueueEntry(void)
+{
+    if (getPendingSubmissions() >= (submissionMask + 1))
+    {
+        // Full (not with the sizes used)
+        enter(0, 0);
+    }
+
+    io_uring_sqe* sqe = &submissionQueueEntries[submissionLocalTail & submissionMask];
+    memset(sqe, 0, sizeof(*sqe));
+    submissionLocalTail++;
+
+    return sqe;
+}
+
+unsigned IoUringBackend::getPendingSubmissions(void) const
+{
+    return submissionLocalTail - __atomic_load_n(submissionHead, __ATOMIC_ACQUIRE);
+}
+
+bool IoUringBackend::hasCompletions(void) const
+{
+    return __atomic_load_n(completionTail, __ATOMIC_ACQUIRE) != *completionHead;
+}
+
+int IoUringBackend::enter(const unsigned minComplete, const int timeout)
+{
+    __atomic_store_n(submissionTail, submissionLocalTail, __ATOMIC_RELEASE);
+
+    unsigned flags = 0;
+    io_uring_getevents_arg arg;
+    __kernel_timespec waitTime;
+    void* argp = nullptr;
+    size_t argSize = 0;
+
+    if (minComplete > 0)
+    {
+        flags |= IORING_ENTER_GETEVENTS;
+
+        if (timeout >= 0)
+        {
+            waitTime.tv_sec = timeout / 1000;
+            waitTime.tv_nsec = (timeout % 1000) * 1000000LL;
+
+            memset(&arg, 0, sizeof(arg));
+            arg.sigmask_sz = _NSIG / 8;
+            arg.ts = reinterpret_cast<uint64_t>(&waitTime);
+
+            flags |= IORING_ENTER_EXT_ARG;
+            argp = &arg;
+            argSize = sizeof(arg);
+        }
+    }
+
+    return static_cast<int>(syscall(__NR_io_uring_enter, ringFd, getPendingSubmissions(), minComplete, flags, argp, argSize));
+}
+
+void IoUringBackend::armReceive(void)
+{
+    io_uring_sqe* sqe = getSubmissionQueueEntry();
+
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = receiver.getSocketDescriptor();
+    sqe->addr = reinterpret_cast<uint64_t>(&receiveHeader);
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = bufferGroup;
+    sqe->user_data = USERDATA_RECEIVE;
+
+    receiveArmed = true;
+}
+
+void IoUringBackend::recycleBuffer(const uint16_t bufferId)
+{
+    // Made visible to the kernel by updating the tail (after the completions are handled)
+    // Not bufferRing->bufs: The flexible array member is declared in a way that
+    // moves it 8 bytes forward when compiled as C++
+    io_uring_buf& entry = reinterpret_cast<io_uring_buf*>(bufferRing)[bufferRingTail & (bufferCount - 1)];
+
+    entry.addr = reinterpret_cast<uint64_t>(&buffers[bufferId * bufferSize]);
+    entry.len = bufferSize;
+    entry.bid = bufferId;
+
+    bufferRingTail++;
+}
+
+void IoUringBackend::handleReceive(ControllerCore& core, const io_uring_cqe& cqe)
+{
+    if (!(cqe.flags & IORING_CQE_F_MORE))
+    {
+        // Multishot ended (buffers ran out, error)
+        receiveArmed = false;
+    }
+
+    if (cqe.res < 0)
+    {
+        if (cqe.res == -ENOBUFS)
+        {
+            statistics.bufferShortages++;
+        }
+        return;
+    }
+
+    if (!(cqe.flags & IORING_CQE_F_BUFFER))
+    {
+        return;
+    }
+
+    const uint16_t bufferId = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    char* buffer = &buffers[bufferId * bufferSize];
+    const io_uring_recvmsg_out* out = reinterpret_cast<const io_uring_recvmsg_out*>(buffer);
+
+    // Layout: io_uring_recvmsg_out, name, control, payload (sizes of the name and
+    // control areas are the ones given in receiveHeader)
+    char* control = buffer + sizeof(io_uring_recvmsg_out) + receiveHeader.msg_namelen;
+    const char* payload = control + receiveHeader.msg_controllen;
+
+    statistics.received++;
+
+    if (!(out->flags & MSG_TRUNC))
+    {
+        msghdr header;
+        memset(&header, 0, sizeof(header));
+        header.msg_control = control;
+        header.msg_controllen = out->controllen;
+
+        int64_t kernelTimestamp;
+        UdpReceiver::parseControlMessages(header, kernelTimestamp, kernelDrops);
+
+        if (!outputs.hasRoom())
+        {
+            // Only when more than maxInputsPerBatch datagrams were received at once
+            queueSends();
+            enter(0, 0);
+            outputs.clear();
+            queuedSends = 0;
+        }
+
+        core.process(payload, static_cast<int>(out->payloadlen), kernelTimestamp, outputs);
+    }
+
+    recycleBuffer(bufferId);
+}
+
+void IoUringBackend::queueSends(void)
+{
+    for (int i = queuedSends; i < outputs.getCount(); i++)
+    {
+        sendIovecs[i].iov_base = const_cast<char*>(outputs.getData(i));
+        sendIovecs[i].iov_len = outputs.getLength(i);
+
+        io_uring_sqe* sqe = getSubmissionQueueEntry();
+
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = receiver.getSocketDescriptor();
+        sqe->addr = reinterpret_cast<uint64_t>(&sendHeaders[i]);
+        sqe->len = 1;
+        sqe->msg_flags = MSG_DONTWAIT;
+        sqe->user_data = USERDATA_SEND;
+
+        // Only failures are reported (completions would end the next wait right away)
+        sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+
+        statistics.sent++;
+    }
+
+    queuedSends = outputs.getCount();
+}
+
+bool IoUringBackend::poll(ControllerCore& core, const int timeout)
+{
+    if (ringFd < 0)
+    {
+        return false;
+    }
+
+    if (!receiveArmed)
+    {
+        armReceive();
+    }
+
+    // Submits the sends queued by the previous call (and waits if nothing is ready)
+    if (!hasCompletions())
+    {
+        int retVal = enter(1, timeout);
+
+        if ((retVal < 0) && (errno != ETIME) && (errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY))
+        {
+            return false;
+        }
+    }
+    else if (getPendingSubmissions() > 0)
+    {
+        enter(0, 0);
+    }
+
+    // Sends queued before were completed during the submission
+    if (getPendingSubmissions() == 0)
+    {
+        outputs.clear();
+        queuedSends = 0;
+    }
+
+    if (!hasCompletions())
+    {
+        return true;
+    }
+
+    statistics.waits++;
+
+    unsigned head = *completionHead;
+
+    while (head != __atomic_load_n(completionTail, __ATOMIC_ACQUIRE))
+    {
+        const io_uring_cqe& cqe = completionQueueEntries[head & completionMask];
+
+        if (cqe.user_data == USERDATA_RECEIVE)
+        {
+            handleReceive(core, cqe);
+        }
+        else if ((cqe.user_data == USERDATA_SEND) && (cqe.res < 0))
+        {
+            statistics.sendFailures++;
+            statistics.sent--;
+        }
+
+        head++;
+        __atomic_store_n(completionHead, head, __ATOMIC_RELEASE);
+    }
+
+    __atomic_store_n(&bufferRing->tail, bufferRingTail, __ATOMIC_RELEASE);
+
+    queueSends();
+
+    core.getStatistics().kernelDrops = kernelDrops;
+
+    return true;
+}
+
+#endif // HEADLESS_IO_URING
+
+#endif // __linux__
+
+#if defined(HEADLESS_IO_URING)
+const char* const HeadlessBackend::names[] = { "uring", "recvmmsg" };
+const int HeadlessBackend::nameCount = 2;
+#elif defined(__linux__)
+const char* const HeadlessBackend::names[] = { "recvmmsg" };
+const int HeadlessBackend::nameCount = 1;
+#else
+const char* const HeadlessBackend::names[] = { nullptr };
+const int HeadlessBackend::nameCount = 0;
+#endif
+
+HeadlessBackend* HeadlessBackend::create(const std::string& name)
+{
+#ifdef HEADLESS_IO_URING
+    if (name == "uring")
+    {
+        return new IoUringBackend;
+    }
+#endif
+
+#ifdef __linux__
+    if (name == "recvmmsg")
+    {
+        return new RecvmmsgBackend;
+    }
+#endif
+
+    (void)name;
+    return nullptr;
+}
@@ -0,0 +1,75 @@
+/*
+    headlessbackend.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADLESSBACKEND_H
+#define HEADLESSBACKEND_H
+
+#include <cstdint>
+#include <string>
+#include "controllercore.h"
+#include "udpreceiver.h"
+
+// Event loop of the headless controller without Qt: Receives antenna datagrams,
+// runs them through ControllerCore and sends the replies to one address.
+// Kernel drops are updated to the core's ReceiveStatistics.
+// Backends (Linux only, create() returns nullptr elsewhere):
+// - "recvmmsg": epoll_wait + recvmmsg/sendmmsg in batches.
+// - "uring": io_uring with a multishot recvmsg using a provided buffer ring.
+//   Replies are queued as sendmsg requests and submitted with the same
+//   io_uring_enter call that waits for the next datagrams, so a busy loop
+//   needs one system call per wakeup. Sends use MSG_DONTWAIT, so they complete
+//   (or fail like with a full socket buffer) already during the submission,
+//   and only failed sends post a completion.
+
+class HeadlessBackend
+{
+public:
+    struct Statistics
+    {
+        uint64_t waits = 0;             // Blocking waits that returned something to do
+        uint64_t received = 0;
+        uint64_t sent = 0;
+        uint64_t sendFailures = 0;
+        uint64_t bufferShortages = 0;   // uring: provided buffers ran out (receive re-armed)
+    };
+
+    // Available backends (as accepted by create)
+    static const char* const names[];
+    static const int nameCount;
+
+    static HeadlessBackend* create(const std::string& name);
+
+    virtual ~HeadlessBackend() {}
+
+    // receiveBufferSize = 0: system default
+    virtual bool open(const std::string& bindAddress, const uint16_t bindPort,
+                      const std::string& sendAddress, const uint16_t sendPort,
+                      const int receiveBufferSize = 0) = 0;
+    virtual void close(void) = 0;
+
+    // Waits up to timeout ms (-1 = forever) for datagrams and processes everything received.
+    // Returns false on a fatal error.
+    virtual bool poll(ControllerCore& core, const int timeout) = 0;
+
+    const Statistics& getStatistics(void) const { return statistics; }
+
+protected:
+    Statistics statistics;
+};
+
+#endif // HEADLESSBACKEND_H
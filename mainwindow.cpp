@@ -16,21 +16,73 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <cstring>
 #include <QTime>
 #include <QNetworkDatagram>
 #include <QRandomGenerator>
 #include <QMessageBox>
+#include <QFileDialog>
+#include <QHeaderView>
+#include <QGridLayout>
+#include <QDateTime>
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "autopilotsettingsfile.h"
+#include "replaywindow.h"
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
+
+    // Before anything is logged
+    ui->plainTextEdit->setMaximumBlockCount(maxLogLines);
+    guiUpdateScheduler = new GuiUpdateScheduler(0, this);
+    connect(guiUpdateScheduler, SIGNAL(update(unsigned int)), this, SLOT(on_guiUpdateScheduler_update(unsigned int)));
+
     udpClientSocket = new QUdpSocket(this);
     udpServerSocket = new QUdpSocket(this);
 
+    connectSendSocket();
+
+    shmPollTimer = new QTimer(this);
+    shmPollTimer->setInterval(1);
+    shmPollTimer->setTimerType(Qt::PreciseTimer);
+    connect(shmPollTimer, SIGNAL(timeout()), this, SLOT(on_shmPollTimer_timeout()));
+
+    telemetryModel = new TelemetryTableModel(100000, this);
+    ui->tableView_Telemetry->setModel(telemetryModel);
+
+    // Fixed row height: The view doesn't need to ask the size of each row
+    ui->tableView_Telemetry->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    ui->tableView_Telemetry->verticalHeader()->setDefaultSectionSize(ui->tableView_Telemetry->fontMetrics().height() + 4);
+    ui->tableView_Telemetry->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    ui->tableView_Telemetry->horizontalHeader()->setDefaultSectionSize(70);
+    ui->tableView_Telemetry->setColumnWidth(TelemetryTableModel::COLUMN_TIME, 85);
+
+    // Time can't be filtered
+    ui->comboBox_TelemetryFilterColumn->blockSignals(true);
+
+    for (int column = TelemetryTableModel::COLUMN_TIME + 1; column < TelemetryTableModel::COLUMN_COUNT; column++)
+    {
+        ui->comboBox_TelemetryFilterColumn->addItem(telemetryModel->headerData(column, Qt::Horizontal).toString(), column);
+    }
+
+    ui->comboBox_TelemetryFilterColumn->blockSignals(false);
+
+    telemetryRefreshTimer = new QTimer(this);
+    connect(telemetryRefreshTimer, SIGNAL(timeout()), this, SLOT(on_telemetryRefreshTimer_timeout()));
+    telemetryRefreshTimer->start(telemetryRefreshInterval);
+
+    createPlots();
+
+    QGridLayout* mapLayout = new QGridLayout(ui->tab_Map);
+
+    mapLayout->setContentsMargins(2, 2, 2, 2);
+    trackMap = new TrackMapWidget(&trackStore);
+    mapLayout->addWidget(trackMap);
+
     cyclicTimer = new QTimer(this);
     connect(cyclicTimer, SIGNAL(timeout()), this, SLOT(on_cyclicTimer_timeout()));
     cyclicTimer->start(125);
@@ -44,34 +96,12 @@ MainWindow::MainWindow(QWidget *parent)
     autopilotSettings.estimatedAcceleration = 1 / 10000;       // m / (s * s) / unit of propulsion
     autopilotSettings.estimatedAngularAcceleration = 1 / 10000;// Radians / (s * s) / unit of propulsion
 #endif
-    autopilotSettings.nearLimit = 20;                   // Distance from target where to change from "travel" to "orientation"-mode
-    autopilotSettings.cruisePropulsion = 50000;
-    autopilotSettings.cruiseDirectionProp = 0.2;
-
-    autopilotSettings.pidSettings_Position.p = 20000;
-    autopilotSettings.pidSettings_Position.i = 200;
-    autopilotSettings.pidSettings_Position.d = 200000;
-    autopilotSettings.pidSettings_Position.f = 0;
-    autopilotSettings.pidSettings_Position.maxI = 50000;
-    autopilotSettings.pidSettings_Position.maxOut = 20000;
-    autopilotSettings.pidSettings_Position.rememberI = true;
-
-    autopilotSettings.pidSettings_Heading.p = 80000;
-    autopilotSettings.pidSettings_Heading.i = 1000;
-    autopilotSettings.pidSettings_Heading.d = 500000;
-    autopilotSettings.pidSettings_Heading.f = 0;
-    autopilotSettings.pidSettings_Heading.maxI = 50000;
-    autopilotSettings.pidSettings_Heading.maxOut = 20000;
-    autopilotSettings.pidSettings_Heading.rememberI = false;
-
-    autopilot.init(autopilotSettings);
+    autopilotSettings = Autopilot::getDefaultSettings();
 
     autopilotDestination.coord_N = 0;
     autopilotDestination.coord_E = 0;
     autopilotDestination.heading = 0;
 
-    autopilot.setDestination(autopilotDestination);
-
     nearCounter = 0xFFFFF;
 
 }
@@ -86,22 +116,220 @@ void MainWindow::on_pushButton_Bind_clicked()
 {
     addLogLine("Binding...");
 
-    if (!udpClientSocket->bind(QHostAddress(ui->lineEdit_Host->text()), ui->spinBox_Port_Bind->value()))
+    receiveStatistics = ReceiveStatistics();
+
+    // Sender (simulator) may have been restarted meanwhile
+    latestSamples.clear();
+    sequenceTrackers.clear();
+
+    // Own socket gives kernel timestamps and drop counts (Linux, IPv4), otherwise QUdpSocket is used
+    if (udpReceiver.open(ui->lineEdit_Host->text().toStdString(), ui->spinBox_Port_Bind->value(),
+                         ui->spinBox_ReceiveBufferSize->value() * 1024))
+    {
+        receiveNotifier = new QSocketNotifier(udpReceiver.getSocketDescriptor(), QSocketNotifier::Read, this);
+        connect(receiveNotifier, SIGNAL(activated(int)), this, SLOT(on_receiveNotifier_activated()));
+
+        addLogLine("Ok (receive buffer " + QString::number(udpReceiver.getReceiveBufferSize()) + " bytes).");
+    }
+    else if (!udpClientSocket->bind(QHostAddress(ui->lineEdit_Host->text()), ui->spinBox_Port_Bind->value()))
     {
         addLogLine("Binding failed.");
     }
     else
     {
+        if (ui->spinBox_ReceiveBufferSize->value() != 0)
+        {
+            udpClientSocket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, ui->spinBox_ReceiveBufferSize->value() * 1024);
+        }
+
         QObject::connect(udpClientSocket, SIGNAL(readyRead()),
                      this, SLOT(readyRead()));
 
         addLogLine("Ok.");
     }
 
+    connectSendSocket();
+
     ui->pushButton_Bind->setEnabled(false);
     ui->pushButton_Close->setEnabled(true);
 }
 
+void MainWindow::connectSendSocket(void)
+{
+    // Send endpoint is resolved only here (not on every send).
+    QHostAddress host(ui->lineEdit_Host->text());
+    quint16 port = ui->spinBox_Port_Send->value();
+
+    if ((udpServerSocket->state() == QAbstractSocket::ConnectedState) &&
+            (udpServerSocket->peerAddress() == host) &&
+            (udpServerSocket->peerPort() == port))
+    {
+        return;
+    }
+
+    udpServerSocket->abort();
+
+    // New receiver needs to do the handshake again
+    framedOutput = false;
+    debugSubscriptions = DEBUGCHANNEL_TRANSFORM;
+
+    if (host.isNull())
+    {
+        addLogLine("Invalid host address, nothing will be sent.");
+        return;
+    }
+
+    udpServerSocket->connectToHost(host, port, QIODevice::WriteOnly);
+
+    addLogLine("Sending to " + host.toString() + ":" + QString::number(port) + ".");
+}
+
+void MainWindow::sendDatagram(const char* data, const int length)
+{
+    // Simulator gets the commands through the shared memory then
+    if (shmTransport.isOpen())
+    {
+        return;
+    }
+
+    if (udpServerSocket->state() == QAbstractSocket::ConnectedState)
+    {
+        udpServerSocket->write(data, length);
+    }
+}
+
+void MainWindow::sendCommand(const char* data, const int length)
+{
+    // Telemetry is always framed, so the frame is collected also for legacy receivers
+    if (!framedOutput)
+    {
+        sendDatagram(data, length);
+
+        if (!telemetryPublisher.isActive())
+        {
+            return;
+        }
+    }
+
+    if (!outputFrame.append(data, length))
+    {
+        // Frame full
+        flushOutputFrame();
+        outputFrame.append(data, length);
+    }
+
+    if (!outputFrameOpen)
+    {
+        flushOutputFrame();
+    }
+}
+
+void MainWindow::beginOutputFrame(void)
+{
+    outputFrameOpen = true;
+}
+
+void MainWindow::endOutputFrame(void)
+{
+    outputFrameOpen = false;
+    flushOutputFrame();
+}
+
+void MainWindow::flushOutputFrame(void)
+{
+    if (outputFrame.getCommandCount() != 0)
+    {
+        const char* data;
+        int length = outputFrame.finish(data);
+
+        if (framedOutput)
+        {
+            sendDatagram(data, length);
+        }
+
+        // Same encoded frame to all subscribers
+        telemetryPublisher.publish(data, length);
+        outputFrame.clear();
+    }
+}
+
+void MainWindow::handleCapabilities(const QStringList& capabilities)
+{
+    // Receiver lists the capabilities it supports ("CAPS;FRAMED;..."),
+    // reply lists the ones taken into use. Unknown ones are ignored.
+    framedOutput = capabilities.contains("FRAMED");
+
+    QByteArray reply = "CAPS";
+
+    if (framedOutput)
+    {
+        reply += ";FRAMED";
+    }
+
+    if (capabilities.contains("SUBSCRIBE"))
+    {
+        // Receiver subscribes the debug channels it wants (nothing by default)
+        debugSubscriptions = 0;
+        reply += ";SUBSCRIBE";
+    }
+    else
+    {
+        debugSubscriptions = DEBUGCHANNEL_TRANSFORM;
+    }
+
+    sendDatagram(reply.constData(), reply.size());
+
+    addLogLine("Capabilities in use: " + QString(reply));
+}
+
+void MainWindow::handleSubscription(const QStringList& message)
+{
+    // "SUB;<channel>;<channel>..." or "UNSUB;<channel>;<channel>..."
+    const bool subscribe = (message.at(0) == "SUB");
+
+    for (int i = 1; i < message.size(); i++)
+    {
+        unsigned int channel = 0;
+
+        if (message.at(i) == "TRANSFORM")
+        {
+            channel = DEBUGCHANNEL_TRANSFORM;
+        }
+        else if (message.at(i) == "AUTOPILOT")
+        {
+            channel = DEBUGCHANNEL_AUTOPILOT;
+        }
+        else
+        {
+            addLogLine("Unknown debug channel: " + message.at(i));
+            continue;
+        }
+
+        if (subscribe)
+        {
+            debugSubscriptions |= channel;
+        }
+        else
+        {
+            debugSubscriptions &= ~channel;
+        }
+    }
+
+    addLogLine("Debug subscriptions: " +
+               QString((debugSubscriptions & DEBUGCHANNEL_TRANSFORM) ? "TRANSFORM " : "") +
+               QString((debugSubscriptions & DEBUGCHANNEL_AUTOPILOT) ? "AUTOPILOT" : ""));
+}
+
+void MainWindow::on_lineEdit_Host_editingFinished()
+{
+    connectSendSocket();
+}
+
+void MainWindow::on_spinBox_Port_Send_editingFinished()
+{
+    connectSendSocket();
+}
+
 void MainWindow::addLogLine(const QString& line)
 {
     //ui->listWidget->selectionBehavior()
@@ -110,10 +338,17 @@ void MainWindow::addLogLine(const QString& line)
 
     QString timeString = currentTime.toString("hh:mm:ss:zzz");
 
-    ui->plainTextEdit->setMaximumBlockCount(1000);
 //    ui->plainTextEdit->setCenterOnScroll(ui->checkBox_PagedScroll->isChecked());
 //    ui->plainTextEdit->setWordWrapMode(QTextOption::NoWrap);
-    ui->plainTextEdit->appendPlainText(timeString + ": " + line);
+
+    // Appended on the next frame (only the lines that would be kept)
+    if (pendingLogLines.size() >= maxLogLines)
+    {
+        pendingLogLines.removeFirst();
+    }
+
+    pendingLogLines.append(timeString + ": " + line);
+    guiUpdateScheduler->markDirty(GUI_LOG);
 }
 
 void MainWindow::printMatrix3d(Eigen::Matrix3d& matrix)
@@ -163,201 +398,427 @@ static double pointCCoords[3] = { 0, 1, 0 };
 
 void MainWindow::readyRead()
 {
-    // Add "separator line"
-    ui->plainTextEdit->appendPlainText("");
+    while (udpClientSocket->hasPendingDatagrams())
+    {
+        QNetworkDatagram datagram = udpClientSocket->receiveDatagram();
+
+        handleDatagram(datagram.data(), datagram.senderAddress(), datagram.senderPort(), 0);
+    }
 
-    addLogLine("readyRead signal received.");
+    processLatestSamples();
+}
 
-    unsigned short sendPort = ui->spinBox_Port_Send->value();
+void MainWindow::on_receiveNotifier_activated()
+{
+    char buffer[65536];
+    UdpReceiver::DatagramInfo info;
+    int length;
 
-    while (udpClientSocket->hasPendingDatagrams())
+    while ((length = udpReceiver.receive(buffer, sizeof(buffer), info)) >= 0)
     {
-        QNetworkDatagram datagram = udpClientSocket->receiveDatagram();
+        handleDatagram(QByteArray(buffer, length), QHostAddress(info.senderAddress), info.senderPort, info.kernelTimestamp);
+    }
+
+    receiveStatistics.kernelDrops = udpReceiver.getKernelDrops();
+
+    processLatestSamples();
+}
+
+void MainWindow::handleDatagram(const QByteArray& data, const QHostAddress& senderAddress, const quint16 senderPort, const qint64 kernelTimestamp)
+{
+    Q_UNUSED(senderAddress);
+    Q_UNUSED(senderPort);
 
-        addLogLine("New datagram, Size: " + QString::number(datagram.data().size()) +
-                   ", senderAddress: " + datagram.senderAddress().toString() +
-                   ", senderPort: " + QString::number(datagram.senderPort()) + ": "+
-                   datagram.data());
+    receiveStatistics.datagrams++;
 
-        QString dataString = datagram.data();
+    QString dataString = data;
 
-        QStringList subStrings = dataString.split(';');
+    QStringList subStrings = dataString.split(';');
 
-        if (subStrings.size() < (2 * 3 * 3))
+    if (subStrings.at(0) == "CAPS")
+    {
+        handleCapabilities(subStrings);
+        return;
+    }
+
+    if ((subStrings.at(0) == "SUB") || (subStrings.at(0) == "UNSUB"))
+    {
+        handleSubscription(subStrings);
+        return;
+    }
+
+    if (subStrings.size() < (2 * 3 * 3))
+    {
+        addLogLine("Not enough items!");
+        return;
+    }
+
+    InputSample sample;
+
+    for (int i = 0; i < (2 * 3 * 3); i++)
+    {
+        sample.values[i] = subStrings.at(i).toDouble();
+    }
+
+    // Optional fields after the points: sequence number and vessel id
+    bool sequenceOk = false;
+
+    if (subStrings.size() > (2 * 3 * 3))
+    {
+        sample.sequence = subStrings.at(2 * 3 * 3).toLongLong(&sequenceOk);
+    }
+
+    sample.hasSequence = sequenceOk;
+    sample.vessel = (subStrings.size() > (2 * 3 * 3 + 1)) ? subStrings.at(2 * 3 * 3 + 1).toInt() : 0;
+    sample.kernelTimestamp = kernelTimestamp;
+
+    handleInputSample(sample);
+}
+
+void MainWindow::handleInputSample(InputSample& sample)
+{
+    if (!ui->checkBox_LatestOnly->isChecked())
+    {
+        processInputSample(sample, nominalCycleTime);
+        return;
+    }
+
+    // Latest wins: Keep only the newest sample of each vessel
+    // (by sequence number if available, otherwise the last one received)
+    auto latest = latestSamples.find(sample.vessel);
+
+    if (latest == latestSamples.end())
+    {
+        latestSamples.insert(sample.vessel, sample);
+    }
+    else if (!sample.hasSequence || !latest->hasSequence || SequenceTracker::isNewer(sample.sequence, latest->sequence))
+    {
+        // Gaps are counted later using the sequence numbers
+        if (!sample.hasSequence)
         {
-            addLogLine("Not enough items!");
-            continue;
+            sample.skipped = latest->skipped + 1;
         }
 
-        double subValues[2 * 3 * 3];
+        *latest = sample;
+        droppedSamples++;
+    }
+    else
+    {
+        droppedSamples++;
+    }
+}
+
+void MainWindow::processLatestSamples(void)
+{
+    for (auto latest = latestSamples.begin(); latest != latestSamples.end(); ++latest)
+    {
+        // Each sample (also dropped ones) is one simulator cycle
+        qint64 cycles = latest->skipped + 1;
 
-        for (int i = 0; i < (2 * 3 * 3); i++)
+        if (latest->hasSequence)
         {
-            subValues[i] = subStrings.at(i).toDouble();
+            int64_t sequenceCycles;
+            const SequenceTracker::Result result = sequenceTrackers[latest.key()].update(latest->sequence, sequenceCycles);
+
+            if (result == SequenceTracker::RESULT_STALE)
+            {
+                // Older than already processed one
+                droppedSamples++;
+                continue;
+            }
+            else if (result == SequenceTracker::RESULT_RESTARTED)
+            {
+                addLogLine("Sequence numbers of vessel " + QString::number(latest.key()) + " restarted.");
+            }
+
+            cycles = sequenceCycles;
         }
 
-        Eigen::Vector3d refPointA(&subValues[3 * 3]);
-        Eigen::Vector3d refPointB(&subValues[4 * 3]);
-        Eigen::Vector3d refPointC(&subValues[5 * 3]);
+        processInputSample(*latest, nominalCycleTime * cycles);
+    }
 
-        if (((refPointA != oldRefPoints[0]) ||
-                (refPointB != oldRefPoints[1]) ||
-                (refPointC != oldRefPoints[2])) &&
-                (ui->checkBox_AutoUpdateReferenceCoordinates->isChecked()))
-        {
-            addLogLine("Got new reference points.");
+    if (!latestSamples.isEmpty())
+    {
+        latestSamples.clear();
+        guiUpdateScheduler->markDirty(GUI_DROPPED_SAMPLES);
+    }
+}
 
-            addLogLine("refPointA:\t" + QString::number(refPointA(0), 'f', 3) + ",\t" + QString::number(refPointA(1), 'f', 3)+ ",\t" + QString::number(refPointA(2), 'f', 3));
-            addLogLine("refPointB:\t" + QString::number(refPointB(0), 'f', 3) + ",\t" + QString::number(refPointB(1), 'f', 3)+ ",\t" + QString::number(refPointB(2), 'f', 3));
-            addLogLine("refPointC:\t" + QString::number(refPointC(0), 'f', 3) + ",\t" + QString::number(refPointC(1), 'f', 3)+ ",\t" + QString::number(refPointC(2), 'f', 3));
+void MainWindow::processInputSample(const InputSample& sample, const double cycleTime)
+{
+    // Replies through shared memory carry these
+    currentInputSequence = sample.sequence;
+    currentInputHasSequence = sample.hasSequence;
+    currentInputTimestamp = sample.timestamp;
+    currentInputVessel = sample.vessel;
 
-            oldRefPoints[0] = refPointA;
-            oldRefPoints[1] = refPointB;
-            oldRefPoints[2] = refPointC;
+    const qint64 processingStart = UdpReceiver::getRealTime();
 
-            ui->tableWidget_ReferenceCoordinates->item(0, 0)->setText(QString::number(refPointA(0), 'f', 3));
-            ui->tableWidget_ReferenceCoordinates->item(0, 1)->setText(QString::number(refPointA(1), 'f', 3));
-            ui->tableWidget_ReferenceCoordinates->item(0, 2)->setText(QString::number(refPointA(2), 'f', 3));
+    if (sample.kernelTimestamp != 0)
+    {
+        receiveStatistics.queueingDelay.add(processingStart - sample.kernelTimestamp);
+    }
 
-            ui->tableWidget_ReferenceCoordinates->item(1, 0)->setText(QString::number(refPointB(0), 'f', 3));
-            ui->tableWidget_ReferenceCoordinates->item(1, 1)->setText(QString::number(refPointB(1), 'f', 3));
-            ui->tableWidget_ReferenceCoordinates->item(1, 2)->setText(QString::number(refPointB(2), 'f', 3));
+    processAntennaValues(sample.values, cycleTime);
 
-            ui->tableWidget_ReferenceCoordinates->item(2, 0)->setText(QString::number(refPointC(0), 'f', 3));
-            ui->tableWidget_ReferenceCoordinates->item(2, 1)->setText(QString::number(refPointC(1), 'f', 3));
-            ui->tableWidget_ReferenceCoordinates->item(2, 2)->setText(QString::number(refPointC(2), 'f', 3));
+    receiveStatistics.processingTime.add(UdpReceiver::getRealTime() - processingStart);
+}
 
-            if (!loSolver.setReferencePoints(refPointA, refPointB, refPointC))
-            {
-                addLogLine("Setting reference points failed, error code: " + QString::number(loSolver.getLastError()));
-            }
-        }
+MainWindow::Vessel& MainWindow::getVessel(const int vesselId)
+{
+    auto existing = vessels.find(vesselId);
 
-        Eigen::Vector3d pointA(&subValues[0 * 3]);
-        Eigen::Vector3d pointB(&subValues[1 * 3]);
-        Eigen::Vector3d pointC(&subValues[2 * 3]);
+    if (existing != vessels.end())
+    {
+        return existing->second;
+    }
 
-        Eigen::Transform<double, 3, Eigen::Affine> transform_EUS;
+    // New vessels start with the reference points, settings and destination in use
+    Vessel& vessel = vessels[vesselId];
 
-        loSolver.setPoints(pointA, pointB, pointC);
+    for (int point = 0; point < 3; point++)
+    {
+        vessel.refPoints[point] = oldRefPoints[point];
+    }
 
-        Eigen::Transform<double, 3, Eigen::Affine> debugTransform;
+    vessel.loSolver.setReferencePoints(oldRefPoints[0], oldRefPoints[1], oldRefPoints[2]);
+    vessel.autopilot.init(autopilotSettings);
+    vessel.autopilot.setDestination(autopilotDestination);
 
-        if (!loSolver.getTransformMatrix(transform_EUS, &debugTransform))
+    return vessel;
+}
+
+void MainWindow::processAntennaValues(const double* subValues, const double cycleTime)
+{
+    // All commands caused by one input packet are sent in one datagram (if receiver supports it)
+    beginOutputFrame();
+
+    Vessel& vessel = getVessel(currentInputVessel);
+    LOSolver& loSolver = vessel.loSolver;
+
+    Eigen::Vector3d refPointA(&subValues[3 * 3]);
+    Eigen::Vector3d refPointB(&subValues[4 * 3]);
+    Eigen::Vector3d refPointC(&subValues[5 * 3]);
+
+    if (((refPointA != vessel.refPoints[0]) ||
+            (refPointB != vessel.refPoints[1]) ||
+            (refPointC != vessel.refPoints[2])) &&
+            (ui->checkBox_AutoUpdateReferenceCoordinates->isChecked()))
+    {
+        addLogLine("Got new reference points (vessel " + QString::number(currentInputVessel) + ").");
+
+        addLogLine("refPointA:\t" + QString::number(refPointA(0), 'f', 3) + ",\t" + QString::number(refPointA(1), 'f', 3)+ ",\t" + QString::number(refPointA(2), 'f', 3));
+        addLogLine("refPointB:\t" + QString::number(refPointB(0), 'f', 3) + ",\t" + QString::number(refPointB(1), 'f', 3)+ ",\t" + QString::number(refPointB(2), 'f', 3));
+        addLogLine("refPointC:\t" + QString::number(refPointC(0), 'f', 3) + ",\t" + QString::number(refPointC(1), 'f', 3)+ ",\t" + QString::number(refPointC(2), 'f', 3));
+
+        vessel.refPoints[0] = refPointA;
+        vessel.refPoints[1] = refPointB;
+        vessel.refPoints[2] = refPointC;
+
+        oldRefPoints[0] = refPointA;
+        oldRefPoints[1] = refPointB;
+        oldRefPoints[2] = refPointC;
+
+        guiUpdateScheduler->markDirty(GUI_REFERENCE_POINTS);
+
+        if (!loSolver.setReferencePoints(refPointA, refPointB, refPointC))
         {
-            addLogLine("Getting transform matrix failed, error code: " + QString::number(loSolver.getLastError()));
+            addLogLine("Setting reference points failed, error code: " + QString::number(loSolver.getLastError()));
         }
-        else
-        {
-            double heading, pitch, roll;
+    }
 
-            Eigen::Transform<double, 3, Eigen::Affine> transform_NED = LOSolver::changeAxesConvention(transform_EUS, LOSolver::AC_EUS, LOSolver::AC_NED);
+    Eigen::Vector3d pointA(&subValues[0 * 3]);
+    Eigen::Vector3d pointB(&subValues[1 * 3]);
+    Eigen::Vector3d pointC(&subValues[2 * 3]);
 
-            loSolver.getYawPitchRollAngles(transform_EUS, heading, pitch, roll, LOSolver::AC_EUS);
+    Eigen::Transform<double, 3, Eigen::Affine> transform_EUS;
 
-            heading *= 360. / (M_PI * 2);
-            pitch *= 360. / (M_PI * 2);
-            roll *= 360. / (M_PI * 2);
+    loSolver.setPoints(pointA, pointB, pointC);
 
-            heading = fmod((heading + 360), 360);
+    Eigen::Transform<double, 3, Eigen::Affine> debugTransform;
+    const bool debugTransformNeeded = (debugSubscriptions & DEBUGCHANNEL_TRANSFORM);
 
-            addLogLine("Destination\tN: " + QString::number(autopilotDestination.coord_N,'f',3) +
-                       "\tE: " + QString::number(autopilotDestination.coord_E,'f',3) +
-                       "\tHeading: " + QString::number(fmod(autopilotDestination.heading * 360. / (M_PI * 2) + 360, 360),'f',2));
+    if (!loSolver.getTransformMatrix(transform_EUS, debugTransformNeeded ? &debugTransform : nullptr))
+    {
+        addLogLine("Getting transform matrix failed, error code: " + QString::number(loSolver.getLastError()));
+    }
+    else
+    {
+        double heading, pitch, roll;
 
-            addLogLine("Location\tN: " + QString::number(transform_NED(0,3),'f',3) +
-                       "\tE: " + QString::number(transform_NED(1,3),'f',3) +
-                       "\tD: " + QString::number(transform_NED(2,3),'f',2));
+        Eigen::Transform<double, 3, Eigen::Affine> transform_NED = LOSolver::changeAxesConvention(transform_EUS, LOSolver::AC_EUS, LOSolver::AC_NED);
 
-            addLogLine("Heading: " + QString::number(heading,'f',2) +
-                       "\tPitch: " + QString::number(pitch,'f',2) +
-                       "\tRoll: " + QString::number(roll,'f',2));
+        loSolver.getYawPitchRollAngles(transform_EUS, heading, pitch, roll, LOSolver::AC_EUS);
 
-            QString outString =
-                    // Note: Linear (basis) part of the transformation matrix here is transposed.
-                    // Not fixing this now as it would break the compatibility with the simulator.
-                    "1;" +   // "Command id": transform
-                    QString::number(transform_EUS(0,0),'f',3) + ";" + QString::number(transform_EUS(1,0),'f',3) + ";" + QString::number(transform_EUS(2,0),'f',3) + ";" + QString::number(transform_EUS(0,3),'f',3) + ";" +
-                    QString::number(transform_EUS(0,1),'f',3) + ";" + QString::number(transform_EUS(1,1),'f',3) + ";" + QString::number(transform_EUS(2,1),'f',3) + ";" + QString::number(transform_EUS(1,3),'f',3) + ";" +
-                    QString::number(transform_EUS(0,2),'f',3) + ";" + QString::number(transform_EUS(1,2),'f',3) + ";" + QString::number(transform_EUS(2,2),'f',3) + ";" + QString::number(transform_EUS(2,3),'f',3) + ";" +
-                    QString::number(transform_EUS(0,3),'f',3) + ";" + QString::number(transform_EUS(1,3),'f',3) + ";" + QString::number(transform_EUS(2,3),'f',3) + ";" + QString::number(transform_EUS(3,3),'f',3);
+        heading *= 360. / (M_PI * 2);
+        pitch *= 360. / (M_PI * 2);
+        roll *= 360. / (M_PI * 2);
 
-            QByteArray dataToSend = outString.toLatin1();
-            udpServerSocket->writeDatagram(dataToSend, QHostAddress(ui->lineEdit_Host->text()), sendPort);
+        heading = fmod((heading + 360), 360);
 
-            outString =
-                    // Note: Linear (basis) part of the transformation matrix here is transposed.
-                    // Not fixing this now as it would break the compatibility with the simulator.
-                    "10;" +   // "Command id": debugdata
-                    QString::number(debugTransform(0,0),'f',3) + ";" + QString::number(debugTransform(1,0),'f',3) + ";" + QString::number(debugTransform(2,0),'f',3) + ";" + QString::number(debugTransform(0,3),'f',3) + ";" +
-                    QString::number(debugTransform(0,1),'f',3) + ";" + QString::number(debugTransform(1,1),'f',3) + ";" + QString::number(debugTransform(2,1),'f',3) + ";" + QString::number(debugTransform(1,3),'f',3) + ";" +
-                    QString::number(debugTransform(0,2),'f',3) + ";" + QString::number(debugTransform(1,2),'f',3) + ";" + QString::number(debugTransform(2,2),'f',3) + ";" + QString::number(debugTransform(2,3),'f',3) + ";" +
-                    QString::number(debugTransform(0,3),'f',3) + ";" + QString::number(debugTransform(1,3),'f',3) + ";" + QString::number(debugTransform(2,3),'f',3) + ";" + QString::number(debugTransform(3,3),'f',3);
+        TelemetryRecord record;
 
-            dataToSend = outString.toLatin1();
-            udpServerSocket->writeDatagram(dataToSend, QHostAddress(ui->lineEdit_Host->text()), sendPort);
+        record.time = QDateTime::currentMSecsSinceEpoch();
+        record.vessel = currentInputVessel;
+        record.sequence = currentInputHasSequence ? currentInputSequence : -1;
+        record.coord_N = transform_NED(0,3);
+        record.coord_E = transform_NED(1,3);
+        record.coord_D = transform_NED(2,3);
+        record.heading = heading;
+        record.pitch = pitch;
+        record.roll = roll;
+        record.hasOutputs = false;
+        record.hasDebug = false;
 
-            if (ui->checkBox_AutopilotActive->checkState())
-            {
-                Autopilot::Outputs autopilotOutputs;
-                Autopilot::DebugOutputs autopilotDebugOutputs;
+        RecordingRecord recordingRecord = {};
 
-                autopilot.update(transform_NED, autopilotOutputs, 0.125, &autopilotDebugOutputs);
+        recordingRecord.time = UdpReceiver::getRealTime();
+        recordingRecord.sequence = record.sequence;
+        recordingRecord.vessel = currentInputVessel;
+        recordingRecord.flags = 0;
+        memcpy(recordingRecord.points, subValues, sizeof(recordingRecord.points));
+        recordingRecord.destination[0] = autopilotDestination.coord_N;
+        recordingRecord.destination[1] = autopilotDestination.coord_E;
+        recordingRecord.destination[2] = autopilotDestination.heading;
 
-                addLogLine("AP: direction_Front: " + QString::number(autopilotOutputs.direction_Front * 360. / (M_PI * 2),'f', 2) +
-                           "\tpower_Front: " + QString::number(autopilotOutputs.propulsion_Front,'f', 1) +
-                           "\tdirection_Back: " + QString::number(autopilotOutputs.direction_Back * 360. / (M_PI * 2),'f', 2) +
-                           "\tpower_Back: " + QString::number(autopilotOutputs.propulsion_Back,'f', 1));
+        // Note: Linear (basis) part of the transformation matrix is transposed in these.
+        // Not fixing this now as it would break the compatibility with the simulator.
+        sendTransform(1, transform_EUS);    // "Command id": transform
 
-                addLogLine("AP debug:\tabsBearing: " + QString::number(fmod(autopilotDebugOutputs.absBearing * 360. / (M_PI * 2) + 360, 360),'f', 2) +
-                           "\trelativeBearing: " + QString::number(autopilotDebugOutputs.relativeBearing * 360. / (M_PI * 2),'f', 2) +
-                           "\tdistanceToTarget: " + QString::number(autopilotDebugOutputs.distanceToTarget,'f', 3) +
-                           "\tspeed: " + QString::number(autopilotDebugOutputs.speed,'f', 2));
+        if (debugTransformNeeded)
+        {
+            sendTransform(10, debugTransform);  // "Command id": debugdata
+        }
 
-                addLogLine("AP debug2:\tdirectionOfTravel: " + QString::number(fmod(autopilotDebugOutputs.directionOfTravel * 360. / (M_PI * 2) + 360, 360),'f', 2) +
-                           "\theadingError: " + QString::number(autopilotDebugOutputs.headingError * 360. / (M_PI * 2),'f', 2) +
-                           "\tstate: " + QString::number((int)autopilotDebugOutputs.state));
+        if (ui->checkBox_AutopilotActive->checkState())
+        {
+            Autopilot::Outputs autopilotOutputs;
+            Autopilot::DebugOutputs autopilotDebugOutputs;
+
+            // Auto randomizer uses debug outputs too
+            const bool logAutopilotDebug = ui->checkBox_LogAutopilotDebug->isChecked();
+            const bool autopilotDebugNeeded = (debugSubscriptions & DEBUGCHANNEL_AUTOPILOT) ||
+                    logAutopilotDebug || recorder.isOpen() || archiveRecorder.isOpen() ||
+                    ui->checkBox_DestinationRandomizer_Auto_Active->checkState();
+
+            vessel.autopilot.update(transform_NED, autopilotOutputs, cycleTime, autopilotDebugNeeded ? &autopilotDebugOutputs : nullptr);
+
+            record.hasOutputs = true;
+            record.direction_Front = autopilotOutputs.direction_Front * 360. / (M_PI * 2);
+            record.propulsion_Front = autopilotOutputs.propulsion_Front;
+            record.direction_Back = autopilotOutputs.direction_Back * 360. / (M_PI * 2);
+            record.propulsion_Back = autopilotOutputs.propulsion_Back;
+
+            recordingRecord.flags |= RecordingRecord::FLAG_OUTPUTS;
+            recordingRecord.outputs[0] = autopilotOutputs.direction_Front;
+            recordingRecord.outputs[1] = autopilotOutputs.propulsion_Front;
+            recordingRecord.outputs[2] = autopilotOutputs.direction_Back;
+            recordingRecord.outputs[3] = autopilotOutputs.propulsion_Back;
+
+            if (autopilotDebugNeeded)
+            {
+                recordingRecord.flags |= RecordingRecord::FLAG_DEBUG;
+                recordingRecord.debug[0] = autopilotDebugOutputs.absBearing;
+                recordingRecord.debug[1] = autopilotDebugOutputs.relativeBearing;
+                recordingRecord.debug[2] = autopilotDebugOutputs.distanceToTarget;
+                recordingRecord.debug[3] = autopilotDebugOutputs.speed;
+                recordingRecord.debug[4] = autopilotDebugOutputs.directionOfTravel;
+                recordingRecord.debug[5] = autopilotDebugOutputs.headingError;
+                recordingRecord.debug[6] = autopilotDebugOutputs.state;
+            }
 
-                sendAutopilotOutputs(autopilotOutputs);
+            if (logAutopilotDebug)
+            {
+                record.hasDebug = true;
+                record.distanceToTarget = autopilotDebugOutputs.distanceToTarget;
+                record.headingError = autopilotDebugOutputs.headingError * 360. / (M_PI * 2);
+                record.speed = autopilotDebugOutputs.speed;
+                record.state = static_cast<int>(autopilotDebugOutputs.state);
+            }
 
-                if (ui->checkBox_DestinationRandomizer_Auto_Active->checkState() &&
-                        (((autopilotDebugOutputs.distanceToTarget <= ui->doubleSpinBox_DestinationRandomizer_Auto_DistanceLimit->value()) &&
-                        ((fabs(autopilotDebugOutputs.headingError * 360 / (2* M_PI)) <= ui->doubleSpinBox_DestinationRandomizer_Auto_HeadingLimit->value())))  ||
-                         (nearCounter > 0xFFFF /* First round */)))
-                {
-                    nearCounter++;
+            if (debugSubscriptions & DEBUGCHANNEL_AUTOPILOT)
+            {
+                sendAutopilotDebug(autopilotDebugOutputs);
+            }
 
-                    addLogLine("Waiting new waypoint randomizing, " + QString::number(nearCounter) + "/" + QString::number(ui->spinBox_DestinationRandomizer_Auto_TimeLimit->value()));
+            sendAutopilotOutputs(autopilotOutputs);
 
-                    if (nearCounter >= ui->spinBox_DestinationRandomizer_Auto_TimeLimit->value())
-                    {
-                        on_pushButton_Destination_Randomize_clicked();
-                        nearCounter = 0;
-                    }
-                }
-                else
+            if (ui->checkBox_DestinationRandomizer_Auto_Active->checkState() &&
+                    (((autopilotDebugOutputs.distanceToTarget <= ui->doubleSpinBox_DestinationRandomizer_Auto_DistanceLimit->value()) &&
+                    ((fabs(autopilotDebugOutputs.headingError * 360 / (2* M_PI)) <= ui->doubleSpinBox_DestinationRandomizer_Auto_HeadingLimit->value())))  ||
+                     (nearCounter > 0xFFFF /* First round */)))
+            {
+                nearCounter++;
+
+                addLogLine("Waiting new waypoint randomizing, " + QString::number(nearCounter) + "/" + QString::number(ui->spinBox_DestinationRandomizer_Auto_TimeLimit->value()));
+
+                if (nearCounter >= ui->spinBox_DestinationRandomizer_Auto_TimeLimit->value())
                 {
-                    if (ui->checkBox_DestinationRandomizer_Auto_Active->checkState())
-                    {
-                        // This is just to prevent lines from hopping up and down according to proximity
-                        addLogLine("Destination not near enough for new waypoint randomizing");
-                    }
+                    on_pushButton_Destination_Randomize_clicked();
                     nearCounter = 0;
                 }
             }
+            else
+            {
+                if (ui->checkBox_DestinationRandomizer_Auto_Active->checkState())
+                {
+                    // This is just to prevent lines from hopping up and down according to proximity
+                    addLogLine("Destination not near enough for new waypoint randomizing");
+                }
+                nearCounter = 0;
+            }
+        }
 
-            ui->progressBar_Heading->setValue(heading * 100);
-            ui->label_Heading_Value->setText(QString::number(heading,'f', 2));
-            ui->progressBar_Pitch->setValue(pitch * 100);
-            ui->label_Pitch_Value->setText(QString::number(pitch,'f', 2));
-            ui->progressBar_Roll->setValue(roll * 100);
-            ui->label_Roll_Value->setText(QString::number(roll,'f', 2));
+        telemetryModel->append(record);
+
+        if (recorder.isOpen())
+        {
+            recorder.append(recordingRecord);
+        }
+        else if (archiveRecorder.isOpen())
+        {
+            archiveRecorder.append(recordingRecord);
         }
+
+        const double errorN = transform_NED(0,3) - autopilotDestination.coord_N;
+        const double errorE = transform_NED(1,3) - autopilotDestination.coord_E;
+        float plotValues[PLOT_CHANNEL_COUNT];
+
+        plotValues[PLOT_HEADING] = heading;
+        plotValues[PLOT_HEADING_ERROR] = record.hasDebug ? record.headingError : NAN;
+        plotValues[PLOT_PITCH] = pitch;
+        plotValues[PLOT_ROLL] = roll;
+        plotValues[PLOT_ERROR_N] = errorN;
+        plotValues[PLOT_ERROR_E] = errorE;
+        plotValues[PLOT_DISTANCE] = sqrt(errorN * errorN + errorE * errorE);
+        plotValues[PLOT_DIRECTION_FRONT] = record.hasOutputs ? record.direction_Front : NAN;
+        plotValues[PLOT_DIRECTION_BACK] = record.hasOutputs ? record.direction_Back : NAN;
+        plotValues[PLOT_POWER_FRONT] = record.hasOutputs ? record.propulsion_Front : NAN;
+        plotValues[PLOT_POWER_BACK] = record.hasOutputs ? record.propulsion_Back : NAN;
+
+        plotHistory.append(plotClock.elapsed() / 1000., plotValues);
+
+        trackStore.append(currentInputVessel, transform_NED(0,3), transform_NED(1,3), heading * (M_PI * 2) / 360.);
+        guiUpdateScheduler->markDirty(GUI_MAP);
+
+        displayedHeading = heading;
+        displayedPitch = pitch;
+        displayedRoll = roll;
+        guiUpdateScheduler->markDirty(GUI_ATTITUDE);
     }
+
+    endOutputFrame();
 }
 
 void MainWindow::on_pushButton_Close_clicked()
 {
+    if (udpReceiver.isOpen())
+    {
+        delete receiveNotifier;
+        receiveNotifier = nullptr;
+        udpReceiver.close();
+    }
+
     udpClientSocket->close();
 
     QObject::disconnect(udpClientSocket, SIGNAL(readyRead()),
@@ -366,20 +827,93 @@ void MainWindow::on_pushButton_Close_clicked()
     ui->pushButton_Bind->setEnabled(true);
     ui->pushButton_Close->setEnabled(false);
 
+    latestSamples.clear();
+    sequenceTrackers.clear();
+
     addLogLine("UDP client: socket closed.");
+    addLogLine("Receive statistics: " + QString::fromStdString(receiveStatistics.toString()));
+}
+
+void MainWindow::sendTransform(const int commandId, const Eigen::Transform<double, 3, Eigen::Affine>& transform)
+{
+    double values[16];
+
+    OutputEncoder::getTransformValues(transform, values);
+
+    // Telemetry subscribers need the text commands also when using shared memory
+    if (!sendShmRecord(commandId, values, 16) || telemetryPublisher.isActive())
+    {
+        char outBuffer[OutputEncoder::bufferSize];
+        int outLength = OutputEncoder::encodeTransform(outBuffer, commandId, transform);
+
+        sendCommand(outBuffer, outLength);
+    }
+}
+
+void MainWindow::sendAutopilotDebug(const Autopilot::DebugOutputs& debugOutputs)
+{
+    const double values[] =
+    {
+        debugOutputs.absBearing, debugOutputs.relativeBearing, debugOutputs.distanceToTarget,
+        debugOutputs.speed, debugOutputs.directionOfTravel, debugOutputs.headingError,
+        static_cast<double>(debugOutputs.state)
+    };
+
+    if (!sendShmRecord(ShmTransport::RECORD_AUTOPILOTDEBUG, values, sizeof(values) / sizeof(values[0])) || telemetryPublisher.isActive())
+    {
+        char outBuffer[OutputEncoder::bufferSize];
+        int outLength = OutputEncoder::encodeAutopilotDebug(outBuffer, debugOutputs);   // "Command id": autopilot debug data
+
+        sendCommand(outBuffer, outLength);
+    }
+}
+
+bool MainWindow::sendShmRecord(const unsigned int type, const double* values, const int valueCount)
+{
+    if (!shmTransport.isOpen())
+    {
+        return false;
+    }
+
+    ShmTransport::Record record;
+
+    record.type = type;
+    record.vessel = currentInputVessel;
+    record.sequence = currentInputSequence;
+    record.timestamp = currentInputTimestamp;
+    record.valueCount = valueCount;
+    record.reserved = 0;
+
+    for (int i = 0; i < valueCount; i++)
+    {
+        record.values[i] = values[i];
+    }
+
+    shmTransport.send(record);
+    return true;
 }
 
 void MainWindow::sendAutopilotOutputs(const Autopilot::Outputs& autopilotOutputs)
 {
-    QString outString =
-            "2;" +   // "Command id": Propulsion
-            QString::number(autopilotOutputs.direction_Front,'f',3) + ";" + QString::number(autopilotOutputs.propulsion_Front,'f',3) + ";" +
-            QString::number(autopilotOutputs.direction_Back,'f',3) + ";" + QString::number(autopilotOutputs.propulsion_Back,'f',3);
+    const double values[] =
+    {
+        autopilotOutputs.direction_Front, autopilotOutputs.propulsion_Front,
+        autopilotOutputs.direction_Back, autopilotOutputs.propulsion_Back
+    };
 
-    QByteArray dataToSend = outString.toLatin1();
+    if (!sendShmRecord(ShmTransport::RECORD_PROPULSION, values, 4) || telemetryPublisher.isActive())
+    {
+        char outBuffer[OutputEncoder::bufferSize];
+        int outLength = OutputEncoder::encodePropulsion(outBuffer, autopilotOutputs);  // "Command id": Propulsion
+
+        sendCommand(outBuffer, outLength);
+    }
 
-//    dataToSend.append(outString);
-    udpServerSocket->writeDatagram(dataToSend, QHostAddress(ui->lineEdit_Host->text()), ui->spinBox_Port_Send->value());
+    // Built-in model is vessel 0
+    if (ui->checkBox_BuiltInFerryModel->isChecked() && (currentInputVessel == 0))
+    {
+        ferryModel.setOutputs(autopilotOutputs);
+    }
 
     timeAfterSendingAutopilotCommand = 0;
 }
@@ -389,12 +923,42 @@ void MainWindow::on_cyclicTimer_timeout()
 {
     timeAfterSendingAutopilotCommand += cyclicTimer->interval();
 
+    updateReceiveStatistics();
+
+    if (recorder.isOpen())
+    {
+        recorder.flush();
+        ui->label_RecordedSamples->setText("Records: " + QString::number(recorder.getRecordCount()));
+    }
+    else if (archiveRecorder.isOpen())
+    {
+        archiveRecorder.flush();
+        ui->label_RecordedSamples->setText("Records: " + QString::number(archiveRecorder.getRecordCount()));
+    }
+
+    if (telemetryPublisher.isOpen())
+    {
+        ui->label_TelemetryFrames->setText("Frames: " + QString::number(telemetryPublisher.getPublishedFrames()));
+    }
+
+    if (ui->checkBox_BuiltInFerryModel->isChecked())
+    {
+        // Built-in model replaces the data normally coming from the simulator (vessel 0, no sequence numbers)
+        InputSample sample;
+
+        ferryModel.advance(cyclicTimer->interval() / 1000.);
+        ferryModel.getDatagramValues(sample.values);
+
+        processInputSample(sample, cyclicTimer->interval() / 1000.);
+    }
+
     if ((timeAfterSendingAutopilotCommand > (125 * 2.5)) &&
             (ui->checkBox_AutopilotActive->checkState()) &&
-            udpClientSocket->isOpen())
+            (udpClientSocket->isOpen() || udpReceiver.isOpen() || shmTransport.isOpen()))
     {
         Autopilot::Outputs autopilotOutputs;
 
+        autopilotOutputs.valid = true;
         autopilotOutputs.propulsion_Front = 0;
         autopilotOutputs.direction_Front = 0;
         autopilotOutputs.propulsion_Back = 0;
@@ -405,21 +969,403 @@ void MainWindow::on_cyclicTimer_timeout()
 }
 
 
+void MainWindow::updateReceiveStatistics(void)
+{
+    ui->label_KernelDrops->setText("Kernel drops: " + QString::number(receiveStatistics.kernelDrops));
+    ui->label_QueueingDelay->setText("Queue: " + QString::number(receiveStatistics.queueingDelay.last / 1000.,'f',0) +
+                                     " / " + QString::number(receiveStatistics.queueingDelay.max / 1000.,'f',0) + " us");
+    ui->label_ProcessingTime->setText("Proc: " + QString::number(receiveStatistics.processingTime.last / 1000.,'f',0) +
+                                      " / " + QString::number(receiveStatistics.processingTime.max / 1000.,'f',0) + " us");
+}
+
+void MainWindow::on_checkBox_BuiltInFerryModel_stateChanged(int state)
+{
+    if (state)
+    {
+        ferryModel.init(FerryModel::getDefaultParameters());
+        addLogLine("Built-in ferry model started.");
+    }
+    else
+    {
+        addLogLine("Built-in ferry model stopped.");
+    }
+}
+
+void MainWindow::on_checkBox_SharedMemory_stateChanged(int state)
+{
+    if (state)
+    {
+        if (!shmTransport.open(ShmTransport::defaultName, ShmTransport::ROLE_CONTROLLER))
+        {
+            addLogLine("Opening shared memory transport failed.");
+            ui->checkBox_SharedMemory->setChecked(false);
+            return;
+        }
+
+        shmPollTimer->start();
+        addLogLine("Shared memory transport opened (" + QString(ShmTransport::defaultName) + ").");
+    }
+    else if (shmTransport.isOpen())
+    {
+        shmPollTimer->stop();
+        shmTransport.close();
+        addLogLine("Shared memory transport closed.");
+    }
+}
+
+void MainWindow::on_shmPollTimer_timeout()
+{
+    // GUI-thread can't sleep on the futex so records are polled here
+    ShmTransport::Record record;
+
+    while (shmTransport.receive(record))
+    {
+        if ((record.type != ShmTransport::RECORD_ANTENNAPOINTS) || (record.valueCount < (2 * 3 * 3)))
+        {
+            continue;
+        }
+
+        InputSample sample;
+
+        for (int i = 0; i < (2 * 3 * 3); i++)
+        {
+            sample.values[i] = record.values[i];
+        }
+
+        sample.sequence = record.sequence;
+        sample.hasSequence = true;
+        sample.vessel = record.vessel;
+        sample.timestamp = record.timestamp;
+
+        handleInputSample(sample);
+    }
+
+    processLatestSamples();
+}
+
+void MainWindow::on_checkBox_PublishTelemetry_stateChanged(int state)
+{
+    if (state)
+    {
+        if (!telemetryPublisher.setSubscribers(ui->lineEdit_TelemetrySubscribers->text().toStdString()))
+        {
+            addLogLine("Invalid telemetry subscriber list (expecting host:port, host:port...).");
+            ui->checkBox_PublishTelemetry->setChecked(false);
+            return;
+        }
+
+        if (!telemetryPublisher.open())
+        {
+            addLogLine("Opening telemetry socket failed.");
+            ui->checkBox_PublishTelemetry->setChecked(false);
+            return;
+        }
+
+        addLogLine("Publishing telemetry to " + QString::number(telemetryPublisher.getSubscriberCount()) + " subscriber(s).");
+    }
+    else if (telemetryPublisher.isOpen())
+    {
+        telemetryPublisher.close();
+        addLogLine("Telemetry publishing stopped.");
+    }
+}
+
+void MainWindow::on_checkBox_Record_stateChanged(int state)
+{
+    if (state)
+    {
+        QString selectedFilter;
+        QString fileName = QFileDialog::getSaveFileName(this, "Record to",
+                                                        "recording-" + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss") + ".sfcrec",
+                                                        "Recordings (*.sfcrec);;Compressed archives (*.sfcarc);;All files (*)",
+                                                        &selectedFilter);
+
+        // Archive for long-term storage (can't be replayed directly, see tools/archive)
+        const bool archive = fileName.endsWith(".sfcarc", Qt::CaseInsensitive) ||
+                (!fileName.endsWith(".sfcrec", Qt::CaseInsensitive) && selectedFilter.contains("*.sfcarc"));
+
+        if (fileName.isEmpty() ||
+                !(archive ? archiveRecorder.open(fileName.toStdString()) : recorder.open(fileName.toStdString())))
+        {
+            if (!fileName.isEmpty())
+            {
+                addLogLine("Opening recording file " + fileName + " failed.");
+            }
+
+            ui->checkBox_Record->setChecked(false);
+            return;
+        }
+
+        addLogLine("Recording to " + fileName + ".");
+    }
+    else if (recorder.isOpen())
+    {
+        recorder.close();
+        addLogLine("Recording stopped, " + QString::number(recorder.getRecordCount()) + " records.");
+    }
+    else if (archiveRecorder.isOpen())
+    {
+        const bool ok = archiveRecorder.close();
+
+        addLogLine("Recording stopped, " + QString::number(archiveRecorder.getRecordCount()) + " records, " +
+                   QString::number(archiveRecorder.getBytesWritten()) + " bytes" + (ok ? "." : " (write error)."));
+    }
+}
+
+void MainWindow::on_pushButton_Replay_clicked()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, "Replay recording", QString(),
+                                                    "Recordings (*.sfcrec);;All files (*)");
+
+    if (fileName.isEmpty())
+    {
+        return;
+    }
+
+    ReplayWindow* replayWindow = new ReplayWindow(this);
+
+    if (!replayWindow->open(fileName))
+    {
+        addLogLine("Opening recording " + fileName + " failed.");
+        delete replayWindow;
+        return;
+    }
+
+    replayWindow->show();
+}
+
+void MainWindow::on_lineEdit_TelemetrySubscribers_editingFinished()
+{
+    if (telemetryPublisher.isOpen())
+    {
+        if (!telemetryPublisher.setSubscribers(ui->lineEdit_TelemetrySubscribers->text().toStdString()))
+        {
+            addLogLine("Invalid telemetry subscriber list, keeping the old one.");
+            return;
+        }
+
+        addLogLine("Publishing telemetry to " + QString::number(telemetryPublisher.getSubscriberCount()) + " subscriber(s).");
+    }
+}
+
+void MainWindow::on_telemetryRefreshTimer_timeout()
+{
+    // New rows are added in one batch at most once per interval
+    if (telemetryModel->refresh() && ui->checkBox_TelemetryFollow->isChecked())
+    {
+        ui->tableView_Telemetry->scrollToBottom();
+    }
+
+    ui->label_TelemetryRecords->setText("Records: " + QString::number(telemetryModel->getRecordCount()) +
+                                        ", shown: " + QString::number(telemetryModel->rowCount()));
+}
+
+void MainWindow::createPlots(void)
+{
+    QGridLayout* layout = new QGridLayout(ui->tab_Plots);
+
+    layout->setContentsMargins(2, 2, 2, 2);
+    layout->setSpacing(2);
+
+    PlotWidget* plot;
+
+    plot = new PlotWidget("Heading", &plotHistory);
+    plot->addChannel(PLOT_HEADING, "heading", Qt::darkBlue);
+    plot->addChannel(PLOT_HEADING_ERROR, "error", Qt::red);
+    plotWidgets.append(plot);
+
+    plot = new PlotWidget("Pitch / roll", &plotHistory);
+    plot->addChannel(PLOT_PITCH, "pitch", Qt::darkBlue);
+    plot->addChannel(PLOT_ROLL, "roll", Qt::darkGreen);
+    plotWidgets.append(plot);
+
+    plot = new PlotWidget("Thruster direction", &plotHistory);
+    plot->addChannel(PLOT_DIRECTION_FRONT, "front", Qt::darkBlue);
+    plot->addChannel(PLOT_DIRECTION_BACK, "back", Qt::darkGreen);
+    plotWidgets.append(plot);
+
+    plot = new PlotWidget("Position error", &plotHistory);
+    plot->addChannel(PLOT_ERROR_N, "N", Qt::darkBlue);
+    plot->addChannel(PLOT_ERROR_E, "E", Qt::darkGreen);
+    plotWidgets.append(plot);
+
+    plot = new PlotWidget("Distance to target", &plotHistory);
+    plot->addChannel(PLOT_DISTANCE, "m", Qt::darkBlue);
+    plotWidgets.append(plot);
+
+    plot = new PlotWidget("Thruster power", &plotHistory);
+    plot->addChannel(PLOT_POWER_FRONT, "front", Qt::darkBlue);
+    plot->addChannel(PLOT_POWER_BACK, "back", Qt::darkGreen);
+    plotWidgets.append(plot);
+
+    for (int i = 0; i < plotWidgets.size(); i++)
+    {
+        layout->addWidget(plotWidgets[i], i / 3, i % 3);
+        connect(plotWidgets[i], SIGNAL(spanChanged(double)), this, SLOT(on_plotWidget_spanChanged(double)));
+    }
+
+    plotClock.start();
+
+    plotRefreshTimer = new QTimer(this);
+    connect(plotRefreshTimer, SIGNAL(timeout()), this, SLOT(on_plotRefreshTimer_timeout()));
+    plotRefreshTimer->start(plotRefreshInterval);
+}
+
+void MainWindow::on_plotRefreshTimer_timeout()
+{
+    // Redrawing doesn't depend on the rate of the samples
+    if ((plotHistory.getRevision() == plottedRevision) || !ui->tab_Plots->isVisible())
+    {
+        return;
+    }
+
+    plottedRevision = plotHistory.getRevision();
+
+    for (PlotWidget* plot : plotWidgets)
+    {
+        plot->update();
+    }
+}
+
+void MainWindow::on_plotWidget_spanChanged(double seconds)
+{
+    // All plots show the same time range
+    for (PlotWidget* plot : plotWidgets)
+    {
+        plot->setSpan(seconds);
+    }
+}
+
+void MainWindow::on_guiUpdateScheduler_update(unsigned int parts)
+{
+    if (parts & GUI_LOG)
+    {
+        ui->plainTextEdit->appendPlainText(pendingLogLines.join('\n'));
+        pendingLogLines.clear();
+    }
+
+    if (parts & GUI_ATTITUDE)
+    {
+        ui->progressBar_Heading->setValue(displayedHeading * 100);
+        ui->label_Heading_Value->setText(QString::number(displayedHeading,'f', 2));
+        ui->progressBar_Pitch->setValue(displayedPitch * 100);
+        ui->label_Pitch_Value->setText(QString::number(displayedPitch,'f', 2));
+        ui->progressBar_Roll->setValue(displayedRoll * 100);
+        ui->label_Roll_Value->setText(QString::number(displayedRoll,'f', 2));
+    }
+
+    if (parts & GUI_REFERENCE_POINTS)
+    {
+        for (int point = 0; point < 3; point++)
+        {
+            for (int coord = 0; coord < 3; coord++)
+            {
+                ui->tableWidget_ReferenceCoordinates->item(point, coord)->setText(QString::number(oldRefPoints[point](coord), 'f', 3));
+            }
+        }
+    }
+
+    if (parts & GUI_DROPPED_SAMPLES)
+    {
+        ui->label_DroppedSamples->setText("Dropped: " + QString::number(droppedSamples));
+    }
+
+    if (parts & GUI_MAP)
+    {
+        trackMap->setDestination(autopilotDestination.coord_N, autopilotDestination.coord_E,
+                                 autopilotDestination.heading, autopilotSettings.nearLimit);
+        trackMap->setFollowedVessel(currentInputVessel);
+
+        // Hidden widgets are not painted
+        trackMap->update();
+    }
+}
+
+void MainWindow::on_lineEdit_TelemetryFilter_editingFinished()
+{
+    const int column = ui->comboBox_TelemetryFilterColumn->currentData().toInt();
+
+    if (!telemetryModel->setFilter(column, ui->lineEdit_TelemetryFilter->text()))
+    {
+        addLogLine("Invalid telemetry filter (expecting value, >value, <value or min..max).");
+        return;
+    }
+
+    if (ui->checkBox_TelemetryFollow->isChecked())
+    {
+        ui->tableView_Telemetry->scrollToBottom();
+    }
+}
+
+void MainWindow::on_comboBox_TelemetryFilterColumn_currentIndexChanged(int)
+{
+    // Shows the filter of the selected column (doesn't change it)
+    ui->lineEdit_TelemetryFilter->setText(telemetryModel->getFilter(ui->comboBox_TelemetryFilterColumn->currentData().toInt()));
+}
+
+void MainWindow::on_pushButton_TelemetryClearFilters_clicked()
+{
+    ui->lineEdit_TelemetryFilter->clear();
+    telemetryModel->clearFilters();
+}
+
+void MainWindow::on_pushButton_LoadAutopilotSettings_clicked()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, "Load autopilot settings", QString(),
+                                                    "Autopilot settings (*.ini);;All files (*)");
+
+    if (fileName.isEmpty())
+    {
+        return;
+    }
+
+    if (!AutopilotSettingsFile::load(fileName.toStdString(), autopilotSettings))
+    {
+        QString errorText = "Loading autopilot settings from " + fileName + " failed.";
+
+        addLogLine(errorText);
+
+        QMessageBox msgBox;
+        msgBox.setText("Error.");
+        msgBox.setInformativeText(errorText);
+
+        QPushButton *okButton = msgBox.addButton(QMessageBox::Ok);
+
+        msgBox.setDefaultButton(okButton);
+
+        msgBox.exec();
+        return;
+    }
+
+    for (auto& vessel : vessels)
+    {
+        vessel.second.autopilot.init(autopilotSettings);
+        vessel.second.autopilot.setDestination(autopilotDestination);
+    }
+
+    addLogLine("Autopilot settings loaded from " + fileName + ".");
+}
+
 void MainWindow::on_pushButton_Destination_Set_clicked()
 {
     autopilotDestination.coord_N = ui->doubleSpinBox_Destination_N->value();
     autopilotDestination.coord_E = ui->doubleSpinBox_Destination_E->value();
     autopilotDestination.heading = ui->doubleSpinBox_Destination_Heading->value() * 2. * M_PI / 360.;
 
-    autopilot.setDestination(autopilotDestination);
+    for (auto& vessel : vessels)
+    {
+        vessel.second.autopilot.setDestination(autopilotDestination);
+    }
 
-    QString outString =
-            "3;" +   // "Command id": Set destination
-            QString::number(autopilotDestination.coord_E,'f',3) + ";" + QString::number(-autopilotDestination.coord_N,'f',3) + ";" +
-            QString::number(autopilotDestination.heading,'f',3);
+    const double values[] = { autopilotDestination.coord_E, -autopilotDestination.coord_N, autopilotDestination.heading };
 
-    QByteArray dataToSend = outString.toLatin1();
-    udpServerSocket->writeDatagram(dataToSend, QHostAddress(ui->lineEdit_Host->text()), ui->spinBox_Port_Send->value());
+    if (!sendShmRecord(ShmTransport::RECORD_DESTINATION, values, 3) || telemetryPublisher.isActive())
+    {
+        char outBuffer[OutputEncoder::bufferSize];
+        int outLength = OutputEncoder::encodeDestination(outBuffer, autopilotDestination);    // "Command id": Set destination
+
+        sendCommand(outBuffer, outLength);
+    }
 
     nearCounter = 0;
 }
@@ -481,6 +1427,17 @@ void MainWindow::on_pushButton_UseReferenceCoordinates_clicked()
     oldRefPoints[1] = refPointB;
     oldRefPoints[2] = refPointC;
 
+    // Used by all vessels (until new ones are received if "auto update" is on)
+    for (auto& vessel : vessels)
+    {
+        vessel.second.refPoints[0] = refPointA;
+        vessel.second.refPoints[1] = refPointB;
+        vessel.second.refPoints[2] = refPointC;
+        vessel.second.loSolver.setReferencePoints(refPointA, refPointB, refPointC);
+    }
+
+    LOSolver loSolver;
+
     if (!loSolver.setReferencePoints(refPointA, refPointB, refPointC))
     {
         QString errorText = "Setting reference points failed, error code: " + QString::number(loSolver.getLastError());
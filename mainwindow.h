@@ -19,12 +19,29 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <map>
 #include <QMainWindow>
 #include <QUdpSocket>
 #include <QTimer>
+#include <QMap>
+#include <QSocketNotifier>
+#include <QElapsedTimer>
 #include "Eigen/Geometry"
 #include "losolver.h"
 #include "autopilot.h"
+#include "ferrymodel.h"
+#include "guiupdatescheduler.h"
+#include "plothistory.h"
+#include "plotwidget.h"
+#include "outputencoder.h"
+#include "recording.h"
+#include "telemetryarchive.h"
+#include "shmtransport.h"
+#include "telemetrypublisher.h"
+#include "telemetrytablemodel.h"
+#include "trackmapwidget.h"
+#include "trackstore.h"
+#include "udpreceiver.h"
 
 
 QT_BEGIN_NAMESPACE
@@ -52,23 +69,188 @@ private slots:
 
     void on_pushButton_UseReferenceCoordinates_clicked();
 
+    void on_checkBox_BuiltInFerryModel_stateChanged(int state);
+
+    void on_pushButton_LoadAutopilotSettings_clicked();
+
+    void on_lineEdit_Host_editingFinished();
+    void on_spinBox_Port_Send_editingFinished();
+
+    void on_checkBox_SharedMemory_stateChanged(int state);
+    void on_shmPollTimer_timeout();
+
+    void on_checkBox_PublishTelemetry_stateChanged(int state);
+    void on_receiveNotifier_activated();
+    void on_lineEdit_TelemetrySubscribers_editingFinished();
+    void on_checkBox_Record_stateChanged(int state);
+    void on_pushButton_Replay_clicked();
+
+    void on_telemetryRefreshTimer_timeout();
+    void on_plotRefreshTimer_timeout();
+    void on_plotWidget_spanChanged(double seconds);
+    void on_guiUpdateScheduler_update(unsigned int parts);
+    void on_lineEdit_TelemetryFilter_editingFinished();
+    void on_comboBox_TelemetryFilterColumn_currentIndexChanged(int);
+    void on_pushButton_TelemetryClearFilters_clicked();
+
 private:
     void addLogLine(const QString& line);
+    // cycleTime = time (s) since the previous sample (of this vessel)
+    void processAntennaValues(const double* subValues, const double cycleTime);
+
+    // Cycle time of the simulator
+    static constexpr double nominalCycleTime = 0.125;
+
+    struct InputSample
+    {
+        double values[2 * 3 * 3];
+        qint64 sequence = 0;
+        bool hasSequence = false;
+        int vessel = 0;
+        qint64 skipped = 0;     // Older samples replaced by this one (without sequence numbers)
+        quint64 timestamp = 0;  // Shared memory transport only
+        qint64 kernelTimestamp = 0; // ns, CLOCK_REALTIME, 0 = not available
+    };
 
-    LOSolver loSolver;
-    Eigen::Vector3d oldRefPoints[3];
+    void handleDatagram(const QByteArray& data, const QHostAddress& senderAddress, const quint16 senderPort, const qint64 kernelTimestamp);
+
+    void handleInputSample(InputSample& sample);
+    void processLatestSamples(void);
+    void processInputSample(const InputSample& sample, const double cycleTime);
+
+    // Of the sample being processed
+    qint64 currentInputSequence = 0;
+    bool currentInputHasSequence = false;
+    quint64 currentInputTimestamp = 0;
+    int currentInputVessel = 0;
+
+    // For "latest only"-mode (newest sample per vessel)
+    QMap<int, InputSample> latestSamples;
+    QMap<int, SequenceTracker> sequenceTrackers;
+    qint64 droppedSamples = 0;
+
+    // Reference points shown in the table (set by hand or the latest received ones)
+    Eigen::Vector3d oldRefPoints[3] = { Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero() };
 
     Autopilot::Settings autopilotSettings;
-    Autopilot autopilot;
     Autopilot::Destination autopilotDestination;
 
+    // Each vessel (id after the sequence number) has its own solver, reference points
+    // and autopilot (like in ControllerCore). Created when the first sample arrives.
+    struct Vessel
+    {
+        LOSolver loSolver;
+        Eigen::Vector3d refPoints[3];
+        Autopilot autopilot;
+    };
+
+    std::map<int, Vessel> vessels;
+    Vessel& getVessel(const int vesselId);
+
+    FerryModel ferryModel;
+
     Ui::MainWindow *ui;
     QUdpSocket* udpClientSocket = nullptr;
     QUdpSocket* udpServerSocket = nullptr;
+
+    // Used instead of udpClientSocket when available
+    UdpReceiver udpReceiver;
+    QSocketNotifier* receiveNotifier = nullptr;
+    ReceiveStatistics receiveStatistics;
+    void updateReceiveStatistics(void);
     void printMatrix3d(Eigen::Matrix3d& matrix);
     void printTransform(Eigen::Transform<double, 3, Eigen::Affine>& matrix);
 
     void sendAutopilotOutputs(const Autopilot::Outputs& autopilotOutputs);
+    void sendTransform(const int commandId, const Eigen::Transform<double, 3, Eigen::Affine>& transform);
+    void sendAutopilotDebug(const Autopilot::DebugOutputs& debugOutputs);
+
+    // Returns false if shared memory transport is not in use (-> use UDP)
+    bool sendShmRecord(const unsigned int type, const double* values, const int valueCount);
+
+    ShmTransport shmTransport;
+    TelemetryPublisher telemetryPublisher;
+    RecordingWriter recorder;
+    ArchiveWriter archiveRecorder;     // When recording to an archive (.sfcarc)
+    QTimer* shmPollTimer = nullptr;
+
+    // Processed samples are shown in the table instead of the log.
+    // The view is updated by the timer (not per sample).
+    TelemetryTableModel* telemetryModel = nullptr;
+    QTimer* telemetryRefreshTimer = nullptr;
+    static constexpr int telemetryRefreshInterval = 100;   // ms
+
+    // Plots are redrawn by the timer if new samples have arrived (and the tab is visible)
+    enum PlotChannel
+    {
+        PLOT_HEADING = 0,
+        PLOT_HEADING_ERROR,
+        PLOT_PITCH,
+        PLOT_ROLL,
+        PLOT_ERROR_N,
+        PLOT_ERROR_E,
+        PLOT_DISTANCE,
+        PLOT_DIRECTION_FRONT,
+        PLOT_DIRECTION_BACK,
+        PLOT_POWER_FRONT,
+        PLOT_POWER_BACK,
+
+        PLOT_CHANNEL_COUNT
+    };
+
+    PlotHistory plotHistory { PLOT_CHANNEL_COUNT };
+    QElapsedTimer plotClock;
+    QList<PlotWidget*> plotWidgets;
+    QTimer* plotRefreshTimer = nullptr;
+    uint64_t plottedRevision = 0;
+    static constexpr int plotRefreshInterval = 50;          // ms
+    void createPlots(void);
+
+    // Widgets showing per-sample state are updated at most once per display frame
+    // (with the latest values), not per datagram
+    enum GuiPart
+    {
+        GUI_LOG = 1 << 0,
+        GUI_ATTITUDE = 1 << 1,
+        GUI_REFERENCE_POINTS = 1 << 2,
+        GUI_DROPPED_SAMPLES = 1 << 3,
+        GUI_MAP = 1 << 4
+    };
+
+    GuiUpdateScheduler* guiUpdateScheduler = nullptr;
+    QStringList pendingLogLines;
+    static constexpr int maxLogLines = 1000;
+    double displayedHeading = 0;
+    double displayedPitch = 0;
+    double displayedRoll = 0;
+
+    TrackStore trackStore;
+    TrackMapWidget* trackMap = nullptr;
+
+    void connectSendSocket(void);
+    void sendDatagram(const char* data, const int length);
+
+    // Sends a command as such or as a part of a frame in framed output mode
+    void sendCommand(const char* data, const int length);
+    void beginOutputFrame(void);
+    void endOutputFrame(void);
+    void flushOutputFrame(void);
+    void handleCapabilities(const QStringList& capabilities);
+    void handleSubscription(const QStringList& message);
+
+    bool framedOutput = false;
+
+    // Debug data is only calculated and sent if subscribed.
+    // Receivers not using the "SUBSCRIBE"-capability get the debug transform ("10;") as before.
+    enum DebugChannel
+    {
+        DEBUGCHANNEL_TRANSFORM = 1 << 0,    // "10;"
+        DEBUGCHANNEL_AUTOPILOT = 1 << 1     // "11;"
+    };
+
+    unsigned int debugSubscriptions = DEBUGCHANNEL_TRANSFORM;
+    bool outputFrameOpen = false;
+    OutputFrame outputFrame;
 
     QTimer* cyclicTimer = nullptr;
     unsigned int timeAfterSendingAutopilotCommand = 10000;
@@ -0,0 +1,249 @@
+/*
+    missionsimulator.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "missionsimulator.h"
+#include "losolver.h"
+
+// splitmix64 (as FerryModel's noise). Used instead of std-library distributions as their
+// output is implementation-defined (missions should be the same everywhere).
+static double randomDouble(uint64_t& state, const double min, const double max)
+{
+    // 53 random bits -> [0, 1)
+    return min + (FerryModel::nextRandom(state) >> 11) * (1. / 9007199254740992.) * (max - min);
+}
+
+MissionSimulator::MissionRanges MissionSimulator::getDefaultMissionRanges(void)
+{
+    MissionRanges ranges;
+
+    ranges.destination_N_Min = 0;
+    ranges.destination_N_Max = 100;
+    ranges.destination_E_Min = -50;
+    ranges.destination_E_Max = 50;
+    ranges.destination_Heading_Min = 0;
+    ranges.destination_Heading_Max = 359.99 * 2. * M_PI / 360.;
+    ranges.start_Heading_Min = 0;
+    ranges.start_Heading_Max = 2. * M_PI;
+    ranges.maxCurrent = 0;
+    ranges.maxWindForce = 0;
+    ranges.gnssNoise = 0;
+
+    return ranges;
+}
+
+MissionSimulator::SimulationSettings MissionSimulator::getDefaultSimulationSettings(void)
+{
+    SimulationSettings settings;
+
+    settings.cycleTime = 0.125;
+    settings.maxTime = 600;
+    settings.arrivalDistance = 1;
+    settings.arrivalHeadingError = 5. * 2. * M_PI / 360.;
+    settings.arrivalCycles = 80;
+    settings.ferryParameters = FerryModel::getDefaultParameters();
+
+    return settings;
+}
+
+MissionSimulator::Mission MissionSimulator::generateMission(const uint64_t baseSeed, const uint64_t index, const MissionRanges& ranges)
+{
+    Mission mission;
+
+    uint64_t state = baseSeed;
+    state = FerryModel::nextRandom(state) ^ index;
+    mission.seed = FerryModel::nextRandom(state);
+
+    uint64_t random = mission.seed;
+
+    mission.start.coord_N = 0;
+    mission.start.coord_E = 0;
+    mission.start.heading = randomDouble(random, ranges.start_Heading_Min, ranges.start_Heading_Max);
+    mission.start.speed_Surge = 0;
+    mission.start.speed_Sway = 0;
+    mission.start.yawRate = 0;
+
+    mission.destination.coord_N = randomDouble(random, ranges.destination_N_Min, ranges.destination_N_Max);
+    mission.destination.coord_E = randomDouble(random, ranges.destination_E_Min, ranges.destination_E_Max);
+    mission.destination.heading = randomDouble(random, ranges.destination_Heading_Min, ranges.destination_Heading_Max);
+
+    double currentDirection = randomDouble(random, 0, 2. * M_PI);
+    double currentSpeed = randomDouble(random, 0, ranges.maxCurrent);
+    double windDirection = randomDouble(random, 0, 2. * M_PI);
+    double windForce = randomDouble(random, 0, ranges.maxWindForce);
+
+    mission.disturbance = FerryModel::getNoDisturbance();
+    mission.disturbance.current_N = currentSpeed * cos(currentDirection);
+    mission.disturbance.current_E = currentSpeed * sin(currentDirection);
+    mission.disturbance.windForce_N = windForce * cos(windDirection);
+    mission.disturbance.windForce_E = windForce * sin(windDirection);
+    mission.disturbance.gnssNoise = ranges.gnssNoise;
+    // Own stream (not the one above) for the noise
+    mission.disturbance.noiseSeed = FerryModel::nextRandom(random);
+
+    return mission;
+}
+
+MissionSimulator::Result MissionSimulator::runMission(const Autopilot::Settings& autopilotSettings, const Mission& mission,
+                                                      const SimulationSettings& simulationSettings)
+{
+    Result result;
+
+    result.seed = mission.seed;
+    result.arrived = false;
+    result.timeToArrive = -1;
+    result.settlingTime = -1;
+    result.overshoot = 0;
+    result.energy = 0;
+    result.stateFlips = 0;
+    result.cycles = 0;
+    result.finalDistance = 0;
+    result.finalHeadingError = 0;
+
+    FerryModel model(simulationSettings.ferryParameters, mission.disturbance);
+    model.setState(mission.start);
+
+    LOSolver loSolver;
+    Eigen::Vector3d refPoints[3];
+    model.getReferencePoints(refPoints);
+
+    if (!loSolver.setReferencePoints(refPoints[0], refPoints[1], refPoints[2]))
+    {
+        return result;
+    }
+
+    Autopilot autopilot(autopilotSettings);
+    autopilot.setDestination(mission.destination);
+
+    // Overshoot is measured along the line from start to destination
+    Eigen::Vector2d destination_2D_NE(mission.destination.coord_N, mission.destination.coord_E);
+    Eigen::Vector2d approachDirection = destination_2D_NE - Eigen::Vector2d(mission.start.coord_N, mission.start.coord_E);
+
+    if (approachDirection.norm() != 0)
+    {
+        approachDirection.normalize();
+    }
+
+    Autopilot::State lastState = Autopilot::STATE_UNKNOWN;
+    int cyclesWithinLimits = 0;
+    const int maxCycles = static_cast<int>(simulationSettings.maxTime / simulationSettings.cycleTime);
+
+    for (int cycle = 0; cycle < maxCycles; cycle++)
+    {
+        const double time = cycle * simulationSettings.cycleTime;
+
+        Eigen::Vector3d points[3];
+        model.getAntennaPoints(points);
+
+        Eigen::Transform<double, 3, Eigen::Affine> transform_EUS;
+
+        loSolver.setPoints(points[0], points[1], points[2]);
+
+        if (!loSolver.getTransformMatrix(transform_EUS))
+        {
+            // Can only happen with degenerate antenna positions (huge noise)
+            model.advance(simulationSettings.cycleTime);
+            continue;
+        }
+
+        Eigen::Transform<double, 3, Eigen::Affine> transform_NED = LOSolver::changeAxesConvention(transform_EUS, LOSolver::AC_EUS, LOSolver::AC_NED);
+
+        Autopilot::Outputs outputs;
+        Autopilot::DebugOutputs debugOutputs;
+
+        autopilot.update(transform_NED, outputs, simulationSettings.cycleTime, &debugOutputs);
+        model.setOutputs(outputs);
+
+        result.cycles++;
+        result.energy += (fabs(outputs.propulsion_Front) + fabs(outputs.propulsion_Back)) * simulationSettings.cycleTime;
+
+        if ((lastState != Autopilot::STATE_UNKNOWN) && (debugOutputs.state != lastState))
+        {
+            result.stateFlips++;
+        }
+        lastState = debugOutputs.state;
+
+        const FerryModel::State& state = model.getState();
+        double pastDestination = (Eigen::Vector2d(state.coord_N, state.coord_E) - destination_2D_NE).dot(approachDirection);
+
+        if (pastDestination > result.overshoot)
+        {
+            result.overshoot = pastDestination;
+        }
+
+        result.finalDistance = debugOutputs.distanceToTarget;
+        result.finalHeadingError = debugOutputs.headingError;
+
+        if ((debugOutputs.distanceToTarget <= simulationSettings.arrivalDistance) &&
+                (fabs(debugOutputs.headingError) <= simulationSettings.arrivalHeadingError))
+        {
+            if (result.timeToArrive < 0)
+            {
+                result.timeToArrive = time;
+            }
+
+            if (cyclesWithinLimits == 0)
+            {
+                result.settlingTime = time;
+            }
+
+            cyclesWithinLimits++;
+
+            if (cyclesWithinLimits >= simulationSettings.arrivalCycles)
+            {
+                result.arrived = true;
+                break;
+            }
+        }
+        else
+        {
+            cyclesWithinLimits = 0;
+        }
+
+        model.advance(simulationSettings.cycleTime);
+    }
+
+    if (!result.arrived)
+    {
+        result.settlingTime = -1;
+    }
+
+    return result;
+}
+
+void MissionSimulator::runMissions(const Autopilot::Settings& autopilotSettings, const std::vector<Mission>& missions,
+                                   const SimulationSettings& simulationSettings, std::vector<Result>& results,
+                                   unsigned int threadCount)
+{
+    WorkerPool workerPool(threadCount);
+
+    runMissions(autopilotSettings, missions, simulationSettings, results, workerPool);
+}
+
+void MissionSimulator::runMissions(const Autopilot::Settings& autopilotSettings, const std::vector<Mission>& missions,
+                                   const SimulationSettings& simulationSettings, std::vector<Result>& results,
+                                   WorkerPool& workerPool)
+{
+    results.resize(missions.size());
+
+    // Missions are handed out one at a time (one mission is long enough to
+    // make that negligible). Threads only write to their "own" results.
+    workerPool.run(missions.size(), [&](size_t index, unsigned int)
+    {
+        results[index] = runMission(autopilotSettings, missions[index], simulationSettings);
+    });
+}
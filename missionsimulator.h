@@ -0,0 +1,111 @@
+/*
+    missionsimulator.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MISSIONSIMULATOR_H
+#define MISSIONSIMULATOR_H
+
+#include <vector>
+#include <cstdint>
+#include "autopilot.h"
+#include "ferrymodel.h"
+#include "workerpool.h"
+
+// Runs "missions" (drive from start to a destination) in a closed loop:
+// FerryModel -> LOSolver -> Autopilot -> FerryModel, using the same
+// processing steps as MainWindow does for the datagrams from the simulator.
+// Missions are generated from a seed so every run is reproducible and
+// independent of the number of threads used.
+
+class MissionSimulator
+{
+public:
+    struct Mission
+    {
+        uint64_t seed;                      // Also used for the model's noise generator
+        FerryModel::State start;
+        FerryModel::Disturbance disturbance;
+        Autopilot::Destination destination;
+    };
+
+    // Ranges for the random missions. Defaults equal to the ones
+    // of the destination randomizer in the UI.
+    struct MissionRanges
+    {
+        double destination_N_Min;
+        double destination_N_Max;
+        double destination_E_Min;
+        double destination_E_Max;
+        double destination_Heading_Min;     // Radians
+        double destination_Heading_Max;
+        double start_Heading_Min;           // Start position is always 0, 0
+        double start_Heading_Max;
+        double maxCurrent;                  // m / s, random direction
+        double maxWindForce;                // N, random direction
+        double gnssNoise;                   // m
+    };
+
+    struct SimulationSettings
+    {
+        double cycleTime;                   // s, autopilot update interval (simulator sends data at this rate)
+        double maxTime;                     // s, mission is aborted (not arrived) after this
+
+        // Same criteria as in the automatic destination randomizer:
+        // Mission is finished when ferry stays within these limits for arrivalCycles.
+        double arrivalDistance;             // m
+        double arrivalHeadingError;         // Radians
+        int arrivalCycles;
+
+        FerryModel::Parameters ferryParameters;
+    };
+
+    struct Result
+    {
+        uint64_t seed;
+        bool arrived;
+        double timeToArrive;                // s, first time within arrival limits (-1 if never)
+        double settlingTime;                // s, start of the final period within arrival limits (-1 if not arrived)
+        double overshoot;                   // m, how far the ferry went past the destination along the direction of approach
+        double energy;                      // Sum of |propulsion| of both thrusters * time (propulsion units * s)
+        int stateFlips;                     // Transitions between STATE_CRUISING and STATE_NEAR
+        int cycles;                         // Autopilot cycles run
+        double finalDistance;               // m
+        double finalHeadingError;           // Radians
+    };
+
+    static MissionRanges getDefaultMissionRanges(void);
+    static SimulationSettings getDefaultSimulationSettings(void);
+
+    // Deterministic function of (baseSeed, index) only
+    static Mission generateMission(const uint64_t baseSeed, const uint64_t index, const MissionRanges& ranges);
+
+    static Result runMission(const Autopilot::Settings& autopilotSettings, const Mission& mission,
+                             const SimulationSettings& simulationSettings);
+
+    // Runs all missions using threadCount threads (0 = number of cores).
+    // results[n] corresponds to missions[n].
+    static void runMissions(const Autopilot::Settings& autopilotSettings, const std::vector<Mission>& missions,
+                            const SimulationSettings& simulationSettings, std::vector<Result>& results,
+                            unsigned int threadCount = 0);
+
+    // As above, on the threads of workerPool
+    static void runMissions(const Autopilot::Settings& autopilotSettings, const std::vector<Mission>& missions,
+                            const SimulationSettings& simulationSettings, std::vector<Result>& results,
+                            WorkerPool& workerPool);
+};
+
+#endif // MISSIONSIMULATOR_H
@@ -0,0 +1,318 @@
+/*
+    outputencoder.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <math.h>
+#include "outputencoder.h"
+
+static char* writeUnsigned(char* dest, uint64_t value)
+{
+    char digits[20];
+    int count = 0;
+
+    do
+    {
+        digits[count++] = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    while (count > 0)
+    {
+        *dest++ = digits[--count];
+    }
+
+    return dest;
+}
+
+// Writes mantissa * 2^exponent (exponent >= 0) exactly, without the locale dependent printf
+static char* writeLargeInteger(char* dest, uint64_t mantissa, int exponent)
+{
+    // Base 1e9 "digits", least significant first (2^1024 has 309 decimal digits -> 35 limbs)
+    const uint32_t limbBase = 1000000000;
+    uint32_t limbs[35];
+    int count = 0;
+
+    do
+    {
+        limbs[count++] = static_cast<uint32_t>(mantissa % limbBase);
+        mantissa /= limbBase;
+    } while (mantissa != 0);
+
+    while (exponent > 0)
+    {
+        // limb < 2^30 -> (limb << 32) + carry fits to 64 bits
+        const int step = (exponent < 32) ? exponent : 32;
+        uint64_t carry = 0;
+
+        for (int i = 0; i < count; i++)
+        {
+            const uint64_t product = (static_cast<uint64_t>(limbs[i]) << step) + carry;
+            limbs[i] = static_cast<uint32_t>(product % limbBase);
+            carry = product / limbBase;
+        }
+
+        while (carry != 0)
+        {
+            limbs[count++] = static_cast<uint32_t>(carry % limbBase);
+            carry /= limbBase;
+        }
+
+        exponent -= step;
+    }
+
+    dest = writeUnsigned(dest, limbs[count - 1]);
+
+    for (int i = count - 2; i >= 0; i--)
+    {
+        uint32_t limb = limbs[i];
+
+        for (int digit = 8; digit >= 0; digit--)
+        {
+            dest[digit] = '0' + (limb % 10);
+            limb /= 10;
+        }
+
+        dest += 9;
+    }
+
+    return dest;
+}
+
+char* OutputEncoder::writeFixed3(char* dest, const double value)
+{
+    if (isnan(value))
+    {
+        memcpy(dest, "nan", 3);
+        return dest + 3;
+    }
+
+    // Note: -0.0 is not < 0
+    if (value < 0)
+    {
+        *dest++ = '-';
+    }
+
+    const double absValue = fabs(value);
+
+    if (isinf(absValue))
+    {
+        memcpy(dest, "inf", 3);
+        return dest + 3;
+    }
+
+    // absValue = mantissa * 2^-shift exactly
+    uint64_t bits;
+    memcpy(&bits, &absValue, sizeof(bits));
+
+    int biasedExponent = static_cast<int>(bits >> 52);
+    uint64_t mantissa = bits & ((static_cast<uint64_t>(1) << 52) - 1);
+
+    if (biasedExponent == 0)
+    {
+        biasedExponent = 1;     // Subnormal
+    }
+    else
+    {
+        mantissa |= static_cast<uint64_t>(1) << 52;
+    }
+
+    const int shift = 1075 - biasedExponent;
+    uint64_t thousandths;
+
+    if (absValue >= 1e16)
+    {
+        // Integer that doesn't fit the fast path after scaling by 1000 (1e16 > 2^53 -> shift < 0)
+        dest = writeLargeInteger(dest, mantissa, -shift);
+        memcpy(dest, ".000", 4);
+        return dest + 4;
+    }
+    else if (shift <= 0)
+    {
+        // Integer (< 1e16, so * 1000 fits to 64 bits)
+        thousandths = (mantissa << -shift) * 1000;
+    }
+    else if (shift >= 64)
+    {
+        // mantissa * 1000 < 2^63 <= half of the divisor -> rounds to zero
+        thousandths = 0;
+    }
+    else
+    {
+        // mantissa < 2^53 -> mantissa * 1000 < 2^63 (exact)
+        const uint64_t scaled = mantissa * 1000;
+        const uint64_t remainder = scaled & ((static_cast<uint64_t>(1) << shift) - 1);
+
+        thousandths = scaled >> shift;
+
+        // Ties away from zero
+        if (remainder >= (static_cast<uint64_t>(1) << (shift - 1)))
+        {
+            thousandths++;
+        }
+    }
+
+    dest = writeUnsigned(dest, thousandths / 1000);
+
+    const unsigned int fraction = static_cast<unsigned int>(thousandths % 1000);
+
+    dest[0] = '.';
+    dest[1] = '0' + fraction / 100;
+    dest[2] = '0' + (fraction / 10) % 10;
+    dest[3] = '0' + fraction % 10;
+
+    return dest + 4;
+}
+
+char* OutputEncoder::writeCommandId(char* dest, const int commandId)
+{
+    dest = writeUnsigned(dest, static_cast<unsigned int>(commandId));
+    *dest++ = ';';
+    return dest;
+}
+
+void OutputEncoder::getTransformValues(const Eigen::Transform<double, 3, Eigen::Affine>& transform, double values[16])
+{
+    // Row, column of the values in the order they are sent
+    static const int order[16][2] =
+    {
+        { 0, 0 }, { 1, 0 }, { 2, 0 }, { 0, 3 },
+        { 0, 1 }, { 1, 1 }, { 2, 1 }, { 1, 3 },
+        { 0, 2 }, { 1, 2 }, { 2, 2 }, { 2, 3 },
+        { 0, 3 }, { 1, 3 }, { 2, 3 }, { 3, 3 }
+    };
+
+    for (int i = 0; i < 16; i++)
+    {
+        values[i] = transform(order[i][0], order[i][1]);
+    }
+}
+
+int OutputEncoder::encodeTransform(char* buffer, const int commandId, const Eigen::Transform<double, 3, Eigen::Affine>& transform)
+{
+    double values[16];
+
+    getTransformValues(transform, values);
+
+    char* dest = writeCommandId(buffer, commandId);
+
+    for (int i = 0; i < 16; i++)
+    {
+        if (i != 0)
+        {
+            *dest++ = ';';
+        }
+
+        dest = writeFixed3(dest, values[i]);
+    }
+
+    return static_cast<int>(dest - buffer);
+}
+
+int OutputEncoder::encodePropulsion(char* buffer, const Autopilot::Outputs& outputs)
+{
+    char* dest = writeCommandId(buffer, 2);
+
+    dest = writeFixed3(dest, outputs.direction_Front);
+    *dest++ = ';';
+    dest = writeFixed3(dest, outputs.propulsion_Front);
+    *dest++ = ';';
+    dest = writeFixed3(dest, outputs.direction_Back);
+    *dest++ = ';';
+    dest = writeFixed3(dest, outputs.propulsion_Back);
+
+    return static_cast<int>(dest - buffer);
+}
+
+int OutputEncoder::encodeDestination(char* buffer, const Autopilot::Destination& destination)
+{
+    char* dest = writeCommandId(buffer, 3);
+
+    dest = writeFixed3(dest, destination.coord_E);
+    *dest++ = ';';
+    dest = writeFixed3(dest, -destination.coord_N);
+    *dest++ = ';';
+    dest = writeFixed3(dest, destination.heading);
+
+    return static_cast<int>(dest - buffer);
+}
+
+int OutputEncoder::encodeAutopilotDebug(char* buffer, const Autopilot::DebugOutputs& debugOutputs)
+{
+    char* dest = writeCommandId(buffer, 11);
+
+    dest = writeFixed3(dest, debugOutputs.absBearing);
+    *dest++ = ';';
+    dest = writeFixed3(dest, debugOutputs.relativeBearing);
+    *dest++ = ';';
+    dest = writeFixed3(dest, debugOutputs.distanceToTarget);
+    *dest++ = ';';
+    dest = writeFixed3(dest, debugOutputs.speed);
+    *dest++ = ';';
+    dest = writeFixed3(dest, debugOutputs.directionOfTravel);
+    *dest++ = ';';
+    dest = writeFixed3(dest, debugOutputs.headingError);
+    *dest++ = ';';
+    dest = writeUnsigned(dest, static_cast<unsigned int>(debugOutputs.state));
+
+    return static_cast<int>(dest - buffer);
+}
+
+void OutputFrame::clear(void)
+{
+    length = headerSpace;
+    commandCount = 0;
+}
+
+bool OutputFrame::append(const char* command, const int length)
+{
+    if (commandCount >= maxCommands)
+    {
+        return false;
+    }
+
+    char* dest = buffer + this->length;
+
+    dest = writeUnsigned(dest, static_cast<unsigned int>(length));
+    *dest++ = ';';
+    memcpy(dest, command, length);
+
+    this->length = static_cast<int>(dest + length - buffer);
+    commandCount++;
+
+    return true;
+}
+
+int OutputFrame::finish(const char*& data)
+{
+    char header[headerSpace];
+    char* headerEnd = header;
+
+    *headerEnd++ = 'F';
+    *headerEnd++ = ';';
+    headerEnd = writeUnsigned(headerEnd, static_cast<unsigned int>(commandCount));
+    *headerEnd++ = ';';
+
+    const int headerLength = static_cast<int>(headerEnd - header);
+    char* start = buffer + headerSpace - headerLength;
+
+    memcpy(start, header, headerLength);
+
+    data = start;
+    return length - (headerSpace - headerLength);
+}
@@ -0,0 +1,102 @@
+/*
+    outputencoder.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef OUTPUTENCODER_H
+#define OUTPUTENCODER_H
+
+#include "Eigen/Geometry"
+#include "autopilot.h"
+
+// Encodes the commands sent to the simulator directly into a caller-supplied
+// buffer without any memory allocations. Output is byte-identical to the
+// earlier QString::number(value, 'f', 3)-based strings:
+// - Value is rounded correctly from its exact binary value, ties away from zero
+//   (like double-conversion used by Qt).
+// - Negative values rounding to zero keep their sign ("-0.000"), -0.0 doesn't.
+// - "nan", "inf" and "-inf" for special values.
+// Returned lengths don't include (nor is there written) a terminating zero.
+
+class OutputEncoder
+{
+public:
+    // Longest possible number (-DBL_MAX with 3 decimals): Sign, 309 integer digits, point and decimals
+    static const int maxNumberLength = 1 + 309 + 1 + 3;
+
+    // Enough for any of the messages (16 values + separators + command id)
+    static const int bufferSize = 4 + 16 * (maxNumberLength + 1);
+
+    // Commands one input can cause at most (every debug channel subscribed):
+    // "1;" (transform), "10;" (debug transform), "11;" (autopilot debug),
+    // "2;" (propulsion) and "3;" (destination, when the autopilot randomizes it)
+    static const int maxCommandsPerInput = 5;
+
+    // Writes value with 3 decimals to dest, returns pointer to the end of the written characters.
+    // Dest must have room for maxNumberLength characters.
+    static char* writeFixed3(char* dest, const double value);
+
+    // "1;" (transform) and "10;" (debug data) messages.
+    // Note: Linear (basis) part of the transformation matrix is transposed (see mainwindow.cpp).
+    static int encodeTransform(char* buffer, const int commandId, const Eigen::Transform<double, 3, Eigen::Affine>& transform);
+
+    // Values of the "1;" / "10;" message in the order they are sent
+    static void getTransformValues(const Eigen::Transform<double, 3, Eigen::Affine>& transform, double values[16]);
+
+    // "2;" (propulsion) message
+    static int encodePropulsion(char* buffer, const Autopilot::Outputs& outputs);
+
+    // "3;" (set destination) message
+    static int encodeDestination(char* buffer, const Autopilot::Destination& destination);
+
+    // "11;" (autopilot debug data) message:
+    // absBearing;relativeBearing;distanceToTarget;speed;directionOfTravel;headingError;state
+    static int encodeAutopilotDebug(char* buffer, const Autopilot::DebugOutputs& debugOutputs);
+
+private:
+    static char* writeCommandId(char* dest, const int commandId);
+};
+
+// Collects several encoded commands into one "framed" datagram:
+// "F;<command count>;<length of command 1>;<command 1><length of command 2>;<command 2>..."
+// Lengths are in bytes (decimal), commands are in the same format as when sent separately.
+// Receivers need to request this using the capability handshake (see README.md).
+
+class OutputFrame
+{
+public:
+    static const int maxCommands = OutputEncoder::maxCommandsPerInput;
+
+    void clear(void);
+
+    // Returns false (nothing appended) if the frame is full
+    bool append(const char* command, const int length);
+
+    int getCommandCount(void) const { return commandCount; }
+
+    // Finishes the frame (writes the header). Returns length of the data.
+    int finish(const char*& data);
+
+private:
+    // Header is written (right-aligned) in front of the commands when finishing
+    static const int headerSpace = 16;
+
+    char buffer[headerSpace + maxCommands * (12 + OutputEncoder::bufferSize)];
+    int length = headerSpace;
+    int commandCount = 0;
+};
+
+#endif // OUTPUTENCODER_H
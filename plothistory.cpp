@@ -0,0 +1,182 @@
+/*
+    plothistory.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <limits>
+#include "plothistory.h"
+
+PlotHistory::PlotHistory(const int channelCount, const int capacityLog2) :
+    channelCount(channelCount),
+    capacityLog2(capacityLog2 > baseLevel ? capacityLog2 : baseLevel),
+    mask((uint64_t(1) << this->capacityLog2) - 1),
+    times(mask + 1),
+    values((mask + 1) * channelCount)
+{
+    for (int level = baseLevel; level <= this->capacityLog2; level++)
+    {
+        levelMins.push_back(std::vector<float>(((mask + 1) >> level) * channelCount));
+        levelMaxs.push_back(std::vector<float>(((mask + 1) >> level) * channelCount));
+    }
+}
+
+void PlotHistory::clear(void)
+{
+    endIndex = 0;
+}
+
+uint64_t PlotHistory::getFirstIndex(void) const
+{
+    return (endIndex > mask) ? (endIndex - mask - 1) : 0;
+}
+
+double PlotHistory::getFirstTime(void) const
+{
+    return isEmpty() ? 0 : times[getFirstIndex() & mask];
+}
+
+double PlotHistory::getLastTime(void) const
+{
+    return isEmpty() ? 0 : times[(endIndex - 1) & mask];
+}
+
+void PlotHistory::append(const double time, const float* newValues)
+{
+    const uint64_t index = endIndex;
+    const uint64_t slot = index & mask;
+
+    times[slot] = (isEmpty() || (time >= getLastTime())) ? time : getLastTime();
+
+    for (int channel = 0; channel < channelCount; channel++)
+    {
+        const float value = newValues[channel];
+
+        values[channel * (mask + 1) + slot] = value;
+
+        for (int level = baseLevel; level <= capacityLog2; level++)
+        {
+            const uint64_t blocks = (mask + 1) >> level;
+            const uint64_t blockSlot = channel * blocks + ((index >> level) & (blocks - 1));
+            float& min = levelMins[level - baseLevel][blockSlot];
+            float& max = levelMaxs[level - baseLevel][blockSlot];
+
+            if ((index & ((uint64_t(1) << level) - 1)) == 0)
+            {
+                // First sample of the block
+                min = value;
+                max = value;
+            }
+            else
+            {
+                // fmin/fmax ignore NaNs
+                min = std::fmin(min, value);
+                max = std::fmax(max, value);
+            }
+        }
+    }
+
+    endIndex++;
+}
+
+uint64_t PlotHistory::findIndex(const double time, uint64_t first) const
+{
+    uint64_t count = endIndex - first;
+
+    while (count > 0)
+    {
+        const uint64_t step = count / 2;
+        const uint64_t middle = first + step;
+
+        if (times[middle & mask] < time)
+        {
+            first = middle + 1;
+            count -= step + 1;
+        }
+        else
+        {
+            count = step;
+        }
+    }
+
+    return first;
+}
+
+void PlotHistory::getRange(const int channel, uint64_t first, const uint64_t end, float& min, float& max) const
+{
+    const float* channelValues = &values[channel * (mask + 1)];
+    const uint64_t baseMask = (uint64_t(1) << baseLevel) - 1;
+
+    // Samples before the first full block
+    while ((first < end) && ((first & baseMask) != 0))
+    {
+        min = std::fmin(min, channelValues[first & mask]);
+        max = std::fmax(max, channelValues[first & mask]);
+        first++;
+    }
+
+    // Blocks, as large as the alignment of the start allows
+    while ((end - first) > baseMask)
+    {
+        int level = baseLevel;
+
+        while ((level < capacityLog2) && ((first & ((uint64_t(2) << level) - 1)) == 0) &&
+               ((end - first) >= (uint64_t(2) << level)))
+        {
+            level++;
+        }
+
+        const uint64_t blocks = (mask + 1) >> level;
+        const uint64_t blockSlot = channel * blocks + ((first >> level) & (blocks - 1));
+
+        min = std::fmin(min, levelMins[level - baseLevel][blockSlot]);
+        max = std::fmax(max, levelMaxs[level - baseLevel][blockSlot]);
+        first += uint64_t(1) << level;
+    }
+
+    // Rest
+    while (first < end)
+    {
+        min = std::fmin(min, channelValues[first & mask]);
+        max = std::fmax(max, channelValues[first & mask]);
+        first++;
+    }
+}
+
+void PlotHistory::getEnvelope(const double startTime, const double endTime, const int columns,
+                              const std::vector<int>& channels, float* mins, float* maxs) const
+{
+    const double columnLength = (endTime - startTime) / columns;
+    uint64_t first = findIndex(startTime, getFirstIndex());
+
+    for (int column = 0; column < columns; column++)
+    {
+        const uint64_t end = findIndex(startTime + (column + 1) * columnLength, first);
+
+        for (size_t i = 0; i < channels.size(); i++)
+        {
+            float& min = mins[i * columns + column];
+            float& max = maxs[i * columns + column];
+
+            min = std::numeric_limits<float>::quiet_NaN();
+            max = std::numeric_limits<float>::quiet_NaN();
+
+            getRange(channels[i], first, end, min, max);
+        }
+
+        first = end;
+    }
+}
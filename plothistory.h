@@ -0,0 +1,83 @@
+/*
+    plothistory.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLOTHISTORY_H
+#define PLOTHISTORY_H
+
+#include <cstdint>
+#include <vector>
+
+// History of time-stamped samples (a value for each channel) for plotting.
+// Samples are kept in a ring buffer (the oldest ones are overwritten).
+//
+// Min and max of blocks of 2^k samples (k = baseLevel...) are updated when
+// appending, so the min/max of any range of samples can be combined from
+// a few blocks and less than 2 * 2^baseLevel samples. Decimating the
+// visible time range to one min/max pair per pixel column therefore costs
+// about the same regardless of how many samples the range contains.
+
+class PlotHistory
+{
+public:
+    // Capacity is 2^capacityLog2 samples
+    PlotHistory(const int channelCount, const int capacityLog2 = 19);
+
+    // values[channelCount], NaN = no value. Time (s) should not decrease,
+    // older times are replaced with the latest one.
+    void append(const double time, const float* values);
+    void clear(void);
+
+    int getChannelCount(void) const { return channelCount; }
+    bool isEmpty(void) const { return endIndex == getFirstIndex(); }
+    double getFirstTime(void) const;
+    double getLastTime(void) const;
+
+    // Incremented on every append (to check if redrawing is needed)
+    uint64_t getRevision(void) const { return endIndex; }
+
+    // Splits [startTime, endTime) to columns of equal length and gets min and max of
+    // the given channels' samples in each (mins[i * columns + column] for channels[i]).
+    // Columns without samples (or only NaNs) get NaN.
+    void getEnvelope(const double startTime, const double endTime, const int columns,
+                     const std::vector<int>& channels, float* mins, float* maxs) const;
+
+private:
+    static const int baseLevel = 4;     // Smallest block = 16 samples
+
+    const int channelCount;
+    const int capacityLog2;
+    const uint64_t mask;
+
+    uint64_t endIndex = 0;              // Total number of samples appended
+
+    std::vector<double> times;
+    std::vector<float> values;          // [channel][sample]
+
+    // For each level (baseLevel...capacityLog2): [channel][block] min and max
+    std::vector<std::vector<float>> levelMins;
+    std::vector<std::vector<float>> levelMaxs;
+
+    uint64_t getFirstIndex(void) const;
+
+    // First sample with time >= given (searching from first)
+    uint64_t findIndex(const double time, uint64_t first) const;
+
+    void getRange(const int channel, uint64_t first, const uint64_t end, float& min, float& max) const;
+};
+
+#endif // PLOTHISTORY_H
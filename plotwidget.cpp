@@ -0,0 +1,187 @@
+/*
+    plotwidget.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <QPainter>
+#include <QWheelEvent>
+#include <QVector>
+#include <QLineF>
+#include "plotwidget.h"
+
+PlotWidget::PlotWidget(const QString& title, const PlotHistory* history, QWidget* parent) :
+    QWidget(parent),
+    title(title),
+    history(history)
+{
+    // Everything is painted in paintEvent
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void PlotWidget::addChannel(const int channel, const QString& name, const QColor& color)
+{
+    channels.push_back(channel);
+    names.push_back(name);
+    colors.push_back(color);
+}
+
+void PlotWidget::setSpan(const double seconds)
+{
+    const double newSpan = std::fmin(std::fmax(seconds, minSpan), maxSpan);
+
+    if (newSpan != span)
+    {
+        span = newSpan;
+        update();
+        emit spanChanged(span);
+    }
+}
+
+void PlotWidget::wheelEvent(QWheelEvent* event)
+{
+    if (event->angleDelta().y() > 0)
+    {
+        setSpan(span / 2);
+    }
+    else if (event->angleDelta().y() < 0)
+    {
+        setSpan(span * 2);
+    }
+
+    event->accept();
+}
+
+void PlotWidget::paintEvent(QPaintEvent* event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    const int textHeight = fontMetrics().height();
+    const QRect plotRect(45, textHeight + 2, width() - 45 - 2, height() - textHeight - 2 - 2);
+
+    painter.fillRect(rect(), palette().base());
+    painter.setPen(palette().mid().color());
+    painter.drawRect(plotRect.adjusted(0, 0, -1, -1));
+
+    // Title and legend
+    painter.setPen(palette().text().color());
+    painter.drawText(2, textHeight - fontMetrics().descent(), title);
+
+    int legendX = fontMetrics().horizontalAdvance(title) + 12;
+
+    for (size_t i = 0; i < channels.size(); i++)
+    {
+        painter.setPen(colors[i]);
+        painter.drawText(legendX, textHeight - fontMetrics().descent(), names[i]);
+        legendX += fontMetrics().horizontalAdvance(names[i]) + 8;
+    }
+
+    const QString spanText = (span >= 3600) ? QString::number(span / 3600, 'g', 3) + " h" :
+                             (span >= 60) ? QString::number(span / 60, 'g', 3) + " min" :
+                                            QString::number(span, 'g', 3) + " s";
+
+    painter.setPen(palette().text().color());
+    painter.drawText(width() - fontMetrics().horizontalAdvance(spanText) - 4, textHeight - fontMetrics().descent(), spanText);
+
+    const int columns = plotRect.width() - 2;
+
+    if (history->isEmpty() || channels.empty() || (columns <= 0) || (plotRect.height() <= 2))
+    {
+        return;
+    }
+
+    const double endTime = history->getLastTime();
+    const double startTime = endTime - span;
+
+    mins.resize(channels.size() * columns);
+    maxs.resize(channels.size() * columns);
+
+    history->getEnvelope(startTime, endTime, columns, channels, mins.data(), maxs.data());
+
+    // Scale to the visible values (fmin/fmax skip NaNs)
+    double yMin = NAN;
+    double yMax = NAN;
+
+    for (size_t i = 0; i < mins.size(); i++)
+    {
+        yMin = std::fmin(yMin, mins[i]);
+        yMax = std::fmax(yMax, maxs[i]);
+    }
+
+    if (std::isnan(yMin))
+    {
+        return;
+    }
+
+    if (yMax - yMin < 1e-6)
+    {
+        yMin -= 1;
+        yMax += 1;
+    }
+
+    const double margin = (yMax - yMin) * 0.05;
+
+    yMin -= margin;
+    yMax += margin;
+
+    painter.setPen(palette().text().color());
+    painter.drawText(2, plotRect.top() + textHeight - fontMetrics().descent(), QString::number(yMax, 'g', 4));
+    painter.drawText(2, plotRect.bottom(), QString::number(yMin, 'g', 4));
+
+    const double yScale = (plotRect.height() - 3) / (yMax - yMin);
+    const double yBase = plotRect.bottom() - 1;
+    const int maxGapColumns = static_cast<int>(maxGap * columns / span);
+
+    QVector<QLineF> lines;
+
+    for (size_t i = 0; i < channels.size(); i++)
+    {
+        const float* channelMins = &mins[i * columns];
+        const float* channelMaxs = &maxs[i * columns];
+        int previousColumn = -1;
+        double previousY = 0;
+
+        lines.clear();
+
+        for (int column = 0; column < columns; column++)
+        {
+            if (std::isnan(channelMins[column]))
+            {
+                continue;
+            }
+
+            const double x = plotRect.left() + 1 + column + 0.5;
+            const double y1 = yBase - (channelMins[column] - yMin) * yScale;
+            const double y2 = yBase - (channelMaxs[column] - yMin) * yScale;
+            const double y = (y1 + y2) / 2;
+
+            // Vertical min...max line (at least one pixel)
+            lines.append(QLineF(x, y1 + 0.5, x, y2 - 0.5));
+
+            if ((previousColumn >= 0) && ((column - previousColumn) <= (maxGapColumns + 1)))
+            {
+                lines.append(QLineF(x - (column - previousColumn), previousY, x, y));
+            }
+
+            previousColumn = column;
+            previousY = y;
+        }
+
+        painter.setPen(colors[i]);
+        painter.drawLines(lines);
+    }
+}
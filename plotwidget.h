@@ -0,0 +1,69 @@
+/*
+    plotwidget.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLOTWIDGET_H
+#define PLOTWIDGET_H
+
+#include <vector>
+#include <QWidget>
+#include <QColor>
+#include "plothistory.h"
+
+// Scrolling time-series plot of some channels of a PlotHistory.
+// The latest span seconds are drawn as one min/max line per pixel column,
+// y-axis is scaled to the visible values. Data is read only when painting,
+// so the owner decides the redraw rate (update()). Mouse wheel changes the span.
+
+class PlotWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PlotWidget(const QString& title, const PlotHistory* history, QWidget* parent = nullptr);
+
+    void addChannel(const int channel, const QString& name, const QColor& color);
+
+    void setSpan(const double seconds);
+    double getSpan(void) const { return span; }
+
+signals:
+    void spanChanged(double seconds);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+
+private:
+    static constexpr double minSpan = 5;            // s
+    static constexpr double maxSpan = 24 * 3600;    // s
+    static constexpr double maxGap = 1;             // s, longer gaps are not connected
+
+    QString title;
+    const PlotHistory* history;
+    double span = 60;
+
+    std::vector<int> channels;
+    std::vector<QString> names;
+    std::vector<QColor> colors;
+
+    // Reused between paints
+    std::vector<float> mins;
+    std::vector<float> maxs;
+};
+
+#endif // PLOTWIDGET_H
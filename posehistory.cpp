@@ -0,0 +1,150 @@
+/*
+    posehistory.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "posehistory.h"
+
+PoseHistory::PoseHistory(const int chunkCount, const int chunkSize) :
+    chunkSize(chunkSize > 0 ? chunkSize : 1),
+    chunks(chunkCount > 1 ? chunkCount : 2, std::vector<Pose>(this->chunkSize))
+{
+
+}
+
+void PoseHistory::clear(void)
+{
+    firstChunk = 0;
+    firstOffset = 0;
+    count = 0;
+}
+
+const PoseHistory::Pose& PoseHistory::at(const size_t index) const
+{
+    const size_t position = firstOffset + index;
+
+    return chunks[(firstChunk + position / chunkSize) % chunks.size()][position % chunkSize];
+}
+
+void PoseHistory::dropFirst(const size_t poses)
+{
+    firstOffset += poses;
+    count -= poses;
+    firstChunk = (firstChunk + firstOffset / chunkSize) % chunks.size();
+    firstOffset %= chunkSize;
+}
+
+bool PoseHistory::append(const Pose& pose)
+{
+    if ((count > 0) && (pose.time <= getLastTime()))
+    {
+        return false;
+    }
+
+    if ((firstOffset + count) >= capacity())
+    {
+        // Ring full: Oldest chunk is dropped
+        dropFirst(chunkSize - firstOffset);
+    }
+
+    const size_t position = firstOffset + count;
+
+    chunks[(firstChunk + position / chunkSize) % chunks.size()][position % chunkSize] = pose;
+    count++;
+
+    if (maxAge > 0)
+    {
+        dropFirst(findIndex(pose.time - maxAge));
+    }
+
+    return true;
+}
+
+bool PoseHistory::append(const int64_t time, const Eigen::Transform<double, 3, Eigen::Affine>& transform)
+{
+    Pose pose;
+
+    pose.time = time;
+    pose.position = transform.translation();
+    pose.orientation = Eigen::Quaterniond(transform.linear());
+    pose.orientation.normalize();
+
+    return append(pose);
+}
+
+size_t PoseHistory::findIndex(const int64_t time) const
+{
+    size_t first = 0;
+    size_t length = count;
+
+    while (length > 0)
+    {
+        const size_t step = length / 2;
+
+        if (at(first + step).time < time)
+        {
+            first += step + 1;
+            length -= step + 1;
+        }
+        else
+        {
+            length = step;
+        }
+    }
+
+    return first;
+}
+
+PoseHistory::Pose PoseHistory::interpolate(const Pose& pose1, const Pose& pose2, const int64_t time)
+{
+    const double fraction = static_cast<double>(time - pose1.time) / static_cast<double>(pose2.time - pose1.time);
+    Pose pose;
+
+    pose.time = time;
+    pose.position = pose1.position + fraction * (pose2.position - pose1.position);
+    pose.orientation = pose1.orientation.slerp(fraction, pose2.orientation);
+
+    return pose;
+}
+
+bool PoseHistory::getPose(const int64_t time, Pose& pose) const
+{
+    if ((count == 0) || (time < getFirstTime()) || (time > getLastTime()))
+    {
+        return false;
+    }
+
+    const size_t index = findIndex(time);
+
+    if (at(index).time == time)
+    {
+        pose = at(index);
+    }
+    else
+    {
+        pose = interpolate(at(index - 1), at(index), time);
+    }
+
+    return true;
+}
+
+void PoseHistory::getPoses(const int64_t t0, const int64_t t1, std::vector<Pose>& poses) const
+{
+    for (size_t index = findIndex(t0); (index < count) && (at(index).time <= t1); index++)
+    {
+        poses.push_back(at(index));
+    }
+}
@@ -0,0 +1,98 @@
+/*
+    posehistory.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef POSEHISTORY_H
+#define POSEHISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Eigen/Geometry"
+
+// Time-ordered history of poses (LOSolver results) for "pose at time t" and
+// "poses between t0 and t1" queries.
+//
+// Memory is allocated when constructing: chunkCount chunks of chunkSize poses
+// used as a ring. Eviction:
+// - When all chunks are full, the oldest chunk is dropped as a whole
+//   (so the history holds (chunkCount - 1) * chunkSize...chunkCount * chunkSize poses).
+// - If maxAge is set, poses older than (latest time - maxAge) are dropped when appending.
+//
+// Lookups are a binary search over the poses (oldest to newest through the
+// ring's index arithmetic), O(log n). Times are ns (any epoch) and must increase,
+// appending an older or equal time is rejected.
+
+class PoseHistory
+{
+public:
+    struct Pose
+    {
+        int64_t time;
+        Eigen::Vector3d position;
+        Eigen::Quaterniond orientation;
+    };
+
+    explicit PoseHistory(const int chunkCount = 64, const int chunkSize = 1024);
+
+    // 0 = no age limit
+    void setMaxAge(const int64_t maxAge) { this->maxAge = maxAge; }
+
+    bool append(const Pose& pose);
+
+    // Translation and the rotation of the transform (as from LOSolver::getTransformMatrix)
+    bool append(const int64_t time, const Eigen::Transform<double, 3, Eigen::Affine>& transform);
+
+    void clear(void);
+
+    size_t size(void) const { return count; }
+    bool empty(void) const { return count == 0; }
+    size_t capacity(void) const { return chunks.size() * chunkSize; }
+
+    // 0 <= index < size(), oldest first
+    const Pose& at(const size_t index) const;
+
+    int64_t getFirstTime(void) const { return at(0).time; }
+    int64_t getLastTime(void) const { return at(count - 1).time; }
+
+    // Index of the first pose with time >= given (size() if none)
+    size_t findIndex(const int64_t time) const;
+
+    // Pose at the time: Position interpolated linearly and orientation with SLERP
+    // between the surrounding poses. Returns false if time is outside the history.
+    bool getPose(const int64_t time, Pose& pose) const;
+
+    // Poses with t0 <= time <= t1 (appended to poses)
+    void getPoses(const int64_t t0, const int64_t t1, std::vector<Pose>& poses) const;
+
+    static Pose interpolate(const Pose& pose1, const Pose& pose2, const int64_t time);
+
+private:
+    const size_t chunkSize;
+
+    std::vector<std::vector<Pose>> chunks;
+
+    size_t firstChunk = 0;      // Ring index of the chunk of the oldest pose
+    size_t firstOffset = 0;     // Index of the oldest pose in its chunk
+    size_t count = 0;
+
+    int64_t maxAge = 0;
+
+    void dropFirst(const size_t poses);
+};
+
+#endif // POSEHISTORY_H
@@ -0,0 +1,70 @@
+/*
+    posesolver.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <string.h>
+#include "posesolver.h"
+
+// changeAxesConvention turns the body axes too: Its linear part is R * bodyAxesFlip
+static const Eigen::Matrix3d bodyAxesFlip = Eigen::Vector3d(1, -1, -1).asDiagonal();
+
+bool PoseSolver::solve(const double* points, const double* referencePoints, Pose& pose)
+{
+    if (!referencePointsSet || (memcmp(currentReferencePoints, referencePoints, sizeof(currentReferencePoints)) != 0))
+    {
+        memcpy(currentReferencePoints, referencePoints, sizeof(currentReferencePoints));
+        referencePointsSet = true;
+        loSolver.setReferencePoints(Eigen::Vector3d(&referencePoints[0 * 3]), Eigen::Vector3d(&referencePoints[1 * 3]), Eigen::Vector3d(&referencePoints[2 * 3]));
+    }
+
+    LOSolver::ErrorCode errorCode;
+
+    if (!loSolver.getReferencePointsValidity() ||
+            !loSolver.setPoints(Eigen::Vector3d(&points[0 * 3]), Eigen::Vector3d(&points[1 * 3]), Eigen::Vector3d(&points[2 * 3])) ||
+            !loSolver.getTransformMatrix(pose.transform_EUS) ||
+            !LOSolver::getYawPitchRollAngles(pose.transform_EUS, pose.heading, pose.pitch, pose.roll, errorCode, LOSolver::AC_EUS))
+    {
+        return false;
+    }
+
+    const Eigen::Transform<double, 3, Eigen::Affine> transform_NED = LOSolver::changeAxesConvention(pose.transform_EUS, LOSolver::AC_EUS, LOSolver::AC_NED);
+
+    pose.position_NED = transform_NED.translation();
+    pose.orientation_NED = Eigen::Quaterniond(transform_NED.linear() * bodyAxesFlip);
+    pose.orientation_NED.normalize();
+    pose.heading = wrapHeading(pose.heading);
+
+    return true;
+}
+
+void PoseSolver::getHeadingPitchRoll(const Eigen::Quaterniond& orientation_NED, double& heading, double& pitch, double& roll)
+{
+    Eigen::Transform<double, 3, Eigen::Affine> transform_NED;
+    LOSolver::ErrorCode errorCode;
+
+    transform_NED.setIdentity();
+    transform_NED.linear() = orientation_NED.toRotationMatrix() * bodyAxesFlip;
+
+    LOSolver::getYawPitchRollAngles(transform_NED, heading, pitch, roll, errorCode, LOSolver::AC_NED);
+    heading = wrapHeading(heading);
+}
+
+double PoseSolver::wrapHeading(const double heading)
+{
+    return fmod(heading + 2 * M_PI, 2 * M_PI);
+}
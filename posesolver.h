@@ -0,0 +1,62 @@
+/*
+    posesolver.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef POSESOLVER_H
+#define POSESOLVER_H
+
+#include "losolver.h"
+
+// LOSolver for series of samples (recordings, logs): The reference points are
+// only set (LOSolver::setReferencePoints calculates their basis) when they
+// change. Not thread safe, use one solver per thread.
+//
+// Orientation is the rotation from body axes (forward, starboard, down) to NED
+// like FerryModel::getTransform_NED, so a level vessel heading north has the
+// identity quaternion. Heading is in [0, 2 pi), angles are in radians.
+
+class PoseSolver
+{
+public:
+    struct Pose
+    {
+        Eigen::Transform<double, 3, Eigen::Affine> transform_EUS;  // As from LOSolver::getTransformMatrix
+        Eigen::Vector3d position_NED;
+        Eigen::Quaterniond orientation_NED;
+        double heading;
+        double pitch;
+        double roll;
+    };
+
+    // points: Antenna points A, B, C, referencePoints: reference points A, B, C
+    // (9 values each, as in the datagram)
+    bool solve(const double* points, const double* referencePoints, Pose& pose);
+
+    LOSolver::ErrorCode getLastError(void) { return loSolver.getLastError(); }
+
+    // Of an orientation like Pose::orientation_NED
+    static void getHeadingPitchRoll(const Eigen::Quaterniond& orientation_NED, double& heading, double& pitch, double& roll);
+
+private:
+    LOSolver loSolver;
+    double currentReferencePoints[3 * 3];
+    bool referencePointsSet = false;
+
+    static double wrapHeading(const double heading);
+};
+
+#endif // POSESOLVER_H
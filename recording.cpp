@@ -0,0 +1,351 @@
+/*
+    recording.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include "recording.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+
+struct FileHeader
+{
+    char magic[8];
+    uint32_t size;      // Record size / index interval
+    uint32_t reserved;
+};
+
+const char recordingMagic[8] = "SFCREC1";
+const char indexMagic[8] = "SFCIDX1";
+
+bool writeHeader(FILE* file, const char* magic, const uint32_t size)
+{
+    FileHeader header;
+
+    memcpy(header.magic, magic, sizeof(header.magic));
+    header.size = size;
+    header.reserved = 0;
+
+    return fwrite(&header, sizeof(header), 1, file) == 1;
+}
+
+}
+
+RecordingWriter::~RecordingWriter()
+{
+    close();
+}
+
+bool RecordingWriter::open(const std::string& fileName)
+{
+    close();
+
+    file = fopen(fileName.c_str(), "wb");
+    indexFile = fopen((fileName + ".idx").c_str(), "wb");
+
+    if (!file || !indexFile ||
+            !writeHeader(file, recordingMagic, sizeof(RecordingRecord)) ||
+            !writeHeader(indexFile, indexMagic, indexInterval))
+    {
+        close();
+        return false;
+    }
+
+    recordCount = 0;
+    lastTime = INT64_MIN;
+
+    return true;
+}
+
+void RecordingWriter::close(void)
+{
+    if (file)
+    {
+        fclose(file);
+        file = nullptr;
+    }
+
+    if (indexFile)
+    {
+        fclose(indexFile);
+        indexFile = nullptr;
+    }
+}
+
+bool RecordingWriter::append(const RecordingRecord& record)
+{
+    if (!file)
+    {
+        return false;
+    }
+
+    RecordingRecord written = record;
+
+    // Index needs the times in order (system clock can step back)
+    if (written.time < lastTime)
+    {
+        written.time = lastTime;
+    }
+
+    lastTime = written.time;
+
+    if (fwrite(&written, sizeof(written), 1, file) != 1)
+    {
+        return false;
+    }
+
+    if ((recordCount % indexInterval) == 0)
+    {
+        const int64_t entry[2] = { written.time, static_cast<int64_t>(recordCount) };
+
+        fwrite(entry, sizeof(entry), 1, indexFile);
+    }
+
+    recordCount++;
+
+    return true;
+}
+
+void RecordingWriter::flush(void)
+{
+    if (file)
+    {
+        fflush(file);
+        fflush(indexFile);
+    }
+}
+
+RecordingReader::~RecordingReader()
+{
+    close();
+}
+
+uint64_t RecordingReader::findRecord(const int64_t time) const
+{
+    if (index.empty() || (time <= index[0].time))
+    {
+        return 0;
+    }
+
+    // Last index entry before the time, then the records after it
+    size_t first = 0;
+    size_t count = index.size();
+
+    while (count > 0)
+    {
+        const size_t step = count / 2;
+
+        if (index[first + step].time < time)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+        {
+            count = step;
+        }
+    }
+
+    uint64_t record = index[first - 1].record;
+
+    while ((record < recordCount) && (records[record].time < time))
+    {
+        record++;
+    }
+
+    return record;
+}
+
+bool RecordingReader::loadIndex(const std::string& fileName, bool& headerValid)
+{
+    const uint64_t expectedEntries = (recordCount + RecordingWriter::indexInterval - 1) / RecordingWriter::indexInterval;
+    FILE* file = fopen((fileName + ".idx").c_str(), "rb");
+    FileHeader header;
+    bool ok = false;
+
+    headerValid = false;
+
+    if (!file)
+    {
+        return false;
+    }
+
+    if ((fread(&header, sizeof(header), 1, file) == 1) &&
+            (memcmp(header.magic, indexMagic, sizeof(header.magic)) == 0) &&
+            (header.size == RecordingWriter::indexInterval))
+    {
+        headerValid = true;
+        index.resize(expectedEntries);
+
+        // Entries beyond the records are ignored (file not flushed yet), missing ones are not
+        ok = (expectedEntries == 0) || (fread(index.data(), sizeof(IndexEntry), expectedEntries, file) == expectedEntries);
+
+        // Checking only the last entry (checking all would read the whole recording)
+        ok = ok && ((expectedEntries == 0) ||
+                    ((index.back().record == (expectedEntries - 1) * RecordingWriter::indexInterval) &&
+                     (index.back().time == records[index.back().record].time)));
+    }
+
+    fclose(file);
+
+    return ok;
+}
+
+void RecordingReader::rebuildIndex(const std::string& fileName, const bool save)
+{
+    index.clear();
+
+    for (uint64_t record = 0; record < recordCount; record += RecordingWriter::indexInterval)
+    {
+        index.push_back({ records[record].time, record });
+    }
+
+    indexRebuilt = true;
+
+    if (!save)
+    {
+        return;
+    }
+
+    // Saving is optional (e.g. read-only directory)
+    FILE* file = fopen((fileName + ".idx").c_str(), "wb");
+
+    if (file)
+    {
+        writeHeader(file, indexMagic, RecordingWriter::indexInterval);
+        fwrite(index.data(), sizeof(IndexEntry), index.size(), file);
+        fclose(file);
+    }
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+bool RecordingReader::open(const std::string& fileName)
+{
+    close();
+
+    const int fd = ::open(fileName.c_str(), O_RDONLY);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat fileStat;
+    FileHeader header;
+
+    if ((fstat(fd, &fileStat) != 0) ||
+            (static_cast<size_t>(fileStat.st_size) < (sizeof(FileHeader) + sizeof(RecordingRecord))) ||
+            (pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) ||
+            (memcmp(header.magic, recordingMagic, sizeof(header.magic)) != 0) ||
+            (header.size != sizeof(RecordingRecord)))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    mappingSize = fileStat.st_size;
+    mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        mapping = nullptr;
+        return false;
+    }
+
+    // Seeking jumps around, no use reading ahead much
+    madvise(mapping, mappingSize, MADV_RANDOM);
+
+    records = reinterpret_cast<const RecordingRecord*>(static_cast<const char*>(mapping) + sizeof(FileHeader));
+
+    // Partially written last record is ignored
+    recordCount = (mappingSize - sizeof(FileHeader)) / sizeof(RecordingRecord);
+
+    indexRebuilt = false;
+
+    // An index with a valid header but missing entries may still be being written
+    // (recording in progress), it is not overwritten
+    bool indexHeaderValid;
+
+    if (!loadIndex(fileName, indexHeaderValid))
+    {
+        rebuildIndex(fileName, !indexHeaderValid);
+    }
+
+    return true;
+}
+
+void RecordingReader::release(const uint64_t firstRecord, const uint64_t count)
+{
+    if (!mapping || (count == 0))
+    {
+        return;
+    }
+
+    // Only whole pages within the range
+    const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t start = (reinterpret_cast<uintptr_t>(&records[firstRecord]) + pageSize - 1) & ~(pageSize - 1);
+    const uintptr_t end = reinterpret_cast<uintptr_t>(&records[firstRecord + count]) & ~(pageSize - 1);
+
+    if (end > start)
+    {
+        madvise(reinterpret_cast<void*>(start), end - start, MADV_DONTNEED);
+    }
+}
+
+void RecordingReader::close(void)
+{
+    if (mapping)
+    {
+        munmap(mapping, mappingSize);
+    }
+
+    mapping = nullptr;
+    mappingSize = 0;
+    records = nullptr;
+    recordCount = 0;
+    index.clear();
+}
+
+#else
+
+bool RecordingReader::open(const std::string& fileName)
+{
+    (void)fileName;
+    return false;
+}
+
+void RecordingReader::release(const uint64_t firstRecord, const uint64_t count)
+{
+    (void)firstRecord;
+    (void)count;
+}
+
+void RecordingReader::close(void)
+{
+
+}
+
+#endif
@@ -0,0 +1,128 @@
+/*
+    recording.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Recording of processed samples: The antenna and reference points as received,
+// destination and the autopilot's outputs (and debug outputs) calculated from them.
+// Pose is not stored, LOSolver gives it from the points.
+//
+// File: 16 byte header ("SFCREC1", record size) + fixed size records (native byte order).
+// Times are made non-decreasing when writing.
+//
+// Index (<file>.idx): 16 byte header ("SFCIDX1", interval) + an entry
+// (time, record number) for every indexInterval'th record. Written along with
+// the recording; the reader rebuilds it if it is missing or doesn't match the
+// recording (e.g. recording was not closed properly) and saves it if missing.
+
+struct RecordingRecord
+{
+    enum Flags
+    {
+        FLAG_OUTPUTS = 1 << 0,  // Autopilot was active
+        FLAG_DEBUG = 1 << 1     // Debug outputs were calculated
+    };
+
+    int64_t time;               // ns since epoch, when processed
+    int64_t sequence;           // -1 = not available
+    int32_t vessel;
+    uint32_t flags;
+    double points[2 * 3 * 3];   // As received (antenna points A, B, C, reference points A, B, C)
+    double destination[3];      // N, E, heading (radians)
+    double outputs[4];          // direction_Front, propulsion_Front, direction_Back, propulsion_Back
+    double debug[7];            // absBearing, relativeBearing, distanceToTarget, speed,
+                                // directionOfTravel, headingError, state
+};
+
+class RecordingWriter
+{
+public:
+    static const int indexInterval = 256;
+
+    ~RecordingWriter();
+
+    bool open(const std::string& fileName);
+    void close(void);
+    bool isOpen(void) const { return file != nullptr; }
+
+    bool append(const RecordingRecord& record);
+
+    // Makes the written records visible to readers (also done when closing)
+    void flush(void);
+
+    uint64_t getRecordCount(void) const { return recordCount; }
+
+private:
+    FILE* file = nullptr;
+    FILE* indexFile = nullptr;
+    uint64_t recordCount = 0;
+    int64_t lastTime = INT64_MIN;
+};
+
+// Memory maps the recording, so records are only read from the disk when used.
+// Only available on Unix-like systems (open() fails elsewhere).
+
+class RecordingReader
+{
+public:
+    ~RecordingReader();
+
+    bool open(const std::string& fileName);
+    void close(void);
+    bool isOpen(void) const { return records != nullptr; }
+
+    uint64_t getRecordCount(void) const { return recordCount; }
+    const RecordingRecord& getRecord(const uint64_t index) const { return records[index]; }
+    int64_t getFirstTime(void) const { return records[0].time; }
+    int64_t getLastTime(void) const { return records[recordCount - 1].time; }
+
+    // First record with time >= given (getRecordCount() if none)
+    uint64_t findRecord(const int64_t time) const;
+
+    bool wasIndexRebuilt(void) const { return indexRebuilt; }
+
+    // Drops the pages of the records from memory (e.g. after a sequential pass
+    // over a large recording). They are read again if used.
+    void release(const uint64_t firstRecord, const uint64_t count);
+
+private:
+    struct IndexEntry
+    {
+        int64_t time;
+        uint64_t record;
+    };
+
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    const RecordingRecord* records = nullptr;
+    uint64_t recordCount = 0;
+
+    std::vector<IndexEntry> index;
+    bool indexRebuilt = false;
+
+    bool loadIndex(const std::string& fileName, bool& headerValid);
+    void rebuildIndex(const std::string& fileName, const bool save);
+};
+
+#endif // RECORDING_H
@@ -0,0 +1,306 @@
+/*
+    replaywindow.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QDateTime>
+#include <QFileInfo>
+#include "replaywindow.h"
+
+ReplayWindow::ReplayWindow(QWidget* parent) :
+    QWidget(parent, Qt::Window),
+    poseHistory(historyRecords / 1024 + 1, 1024)
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    resize(640, 480);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    QHBoxLayout* controls = new QHBoxLayout();
+
+    label_Info = new QLabel(this);
+    layout->addWidget(label_Info);
+
+    slider = new QSlider(Qt::Horizontal, this);
+    slider->setObjectName("slider");
+    layout->addWidget(slider);
+
+    const char* const stepTexts[] = { "<<", "<", ">", ">>" };
+    const int steps[] = { -100, -1, 1, 100 };
+
+    for (int i = 0; i < 4; i++)
+    {
+        QPushButton* button = new QPushButton(stepTexts[i], this);
+
+        button->setProperty("step", steps[i]);
+        button->setToolTip("Step " + QString::number(steps[i]) + " record(s)");
+        connect(button, SIGNAL(clicked()), this, SLOT(stepClicked()));
+        controls->addWidget(button);
+    }
+
+    controls->addStretch();
+    controls->addWidget(new QLabel("Go to (s from start):", this));
+
+    lineEdit_GoTo = new QLineEdit(this);
+    lineEdit_GoTo->setObjectName("lineEdit_GoTo");
+    controls->addWidget(lineEdit_GoTo);
+
+    layout->addLayout(controls);
+
+    plainTextEdit_State = new QPlainTextEdit(this);
+    plainTextEdit_State->setReadOnly(true);
+    plainTextEdit_State->setLineWrapMode(QPlainTextEdit::NoWrap);
+    layout->addWidget(plainTextEdit_State);
+
+    QMetaObject::connectSlotsByName(this);
+}
+
+bool ReplayWindow::open(const QString& fileName)
+{
+    if (!reader.open(fileName.toStdString()) || (reader.getRecordCount() == 0))
+    {
+        return false;
+    }
+
+    setWindowTitle("Replay - " + QFileInfo(fileName).fileName());
+
+    poseHistory.clear();
+
+    const int64_t duration = reader.getLastTime() - reader.getFirstTime();
+
+    // 1 ms steps if the slider's range allows
+    sliderStep = 1000000;
+
+    while ((duration / sliderStep) > INT_MAX)
+    {
+        sliderStep *= 10;
+    }
+
+    label_Info->setText(QString::number(reader.getRecordCount()) + " records, " +
+                        QString::number(duration / 1e9, 'f', 1) + " s" +
+                        (reader.wasIndexRebuilt() ? " (index rebuilt)" : ""));
+
+    slider->blockSignals(true);
+    slider->setRange(0, static_cast<int>(duration / sliderStep));
+    slider->setValue(0);
+    slider->blockSignals(false);
+
+    showRecord(0, reader.getFirstTime());
+
+    return true;
+}
+
+void ReplayWindow::moveSlider(const int64_t time)
+{
+    slider->blockSignals(true);
+    slider->setValue(static_cast<int>((time - reader.getFirstTime()) / sliderStep));
+    slider->blockSignals(false);
+}
+
+void ReplayWindow::on_slider_valueChanged(int value)
+{
+    if (!reader.isOpen())
+    {
+        return;
+    }
+
+    const int64_t time = reader.getFirstTime() + value * sliderStep;
+    uint64_t record = reader.findRecord(time);
+
+    if (record >= reader.getRecordCount())
+    {
+        record = reader.getRecordCount() - 1;
+    }
+
+    showRecord(record, time);
+}
+
+void ReplayWindow::on_lineEdit_GoTo_editingFinished()
+{
+    bool ok;
+    const double seconds = lineEdit_GoTo->text().toDouble(&ok);
+
+    if (!ok || !reader.isOpen())
+    {
+        return;
+    }
+
+    const int64_t time = reader.getFirstTime() + static_cast<int64_t>(seconds * 1e9);
+    uint64_t record = reader.findRecord(time);
+
+    if (record >= reader.getRecordCount())
+    {
+        record = reader.getRecordCount() - 1;
+    }
+
+    moveSlider(time);
+    showRecord(record, time);
+}
+
+void ReplayWindow::stepClicked()
+{
+    if (!reader.isOpen())
+    {
+        return;
+    }
+
+    const int step = sender()->property("step").toInt();
+    int64_t record = static_cast<int64_t>(currentRecord) + step;
+
+    if (record < 0)
+    {
+        record = 0;
+    }
+    else if (record >= static_cast<int64_t>(reader.getRecordCount()))
+    {
+        record = reader.getRecordCount() - 1;
+    }
+
+    const int64_t time = reader.getRecord(record).time;
+
+    moveSlider(time);
+    showRecord(record, time);
+}
+
+bool ReplayWindow::solve(const RecordingRecord& record, PoseHistory::Pose& pose_NED)
+{
+    PoseSolver::Pose pose;
+
+    if (!poseSolver.solve(&record.points[0], &record.points[3 * 3], pose))
+    {
+        return false;
+    }
+
+    pose_NED.time = record.time;
+    pose_NED.position = pose.position_NED;
+    pose_NED.orientation = pose.orientation_NED;
+
+    return true;
+}
+
+void ReplayWindow::fillPoseHistory(const uint64_t recordIndex, const int32_t vessel)
+{
+    const uint64_t first = (recordIndex > historyRecords / 2) ? (recordIndex - historyRecords / 2) : 0;
+    const uint64_t end = std::min(first + historyRecords, reader.getRecordCount());
+
+    poseHistory.clear();
+    historyVessel = vessel;
+
+    for (uint64_t i = first; i < end; i++)
+    {
+        const RecordingRecord& record = reader.getRecord(i);
+        PoseHistory::Pose pose;
+
+        // Records with older or equal times than the previous one are rejected by the history
+        if ((record.vessel == vessel) && solve(record, pose))
+        {
+            poseHistory.append(pose);
+        }
+    }
+}
+
+static QString formatPose(const PoseHistory::Pose& pose)
+{
+    double heading, pitch, roll;
+
+    PoseSolver::getHeadingPitchRoll(pose.orientation, heading, pitch, roll);
+
+    return "N: " + QString::number(pose.position(0), 'f', 3) +
+            "\tE: " + QString::number(pose.position(1), 'f', 3) +
+            "\tD: " + QString::number(pose.position(2), 'f', 2) +
+            "\nHeading: " + QString::number(heading * 360. / (M_PI * 2), 'f', 2) +
+            "\tPitch: " + QString::number(pitch * 360. / (M_PI * 2), 'f', 2) +
+            "\tRoll: " + QString::number(roll * 360. / (M_PI * 2), 'f', 2);
+}
+
+void ReplayWindow::showRecord(const uint64_t recordIndex, const int64_t time)
+{
+    const RecordingRecord& record = reader.getRecord(recordIndex);
+    QString text;
+
+    currentRecord = recordIndex;
+
+    text += "Record " + QString::number(recordIndex + 1) + "/" + QString::number(reader.getRecordCount()) +
+            "\tTime: " + QDateTime::fromMSecsSinceEpoch(record.time / 1000000).toString("yyyy-MM-dd hh:mm:ss.zzz") +
+            " (" + QString::number((record.time - reader.getFirstTime()) / 1e9, 'f', 3) + " s)" +
+            "\nVessel: " + QString::number(record.vessel) +
+            "\tSequence: " + ((record.sequence >= 0) ? QString::number(record.sequence) : QString("-")) + "\n";
+
+    for (int point = 0; point < 6; point++)
+    {
+        text += QString((point < 3) ? "Antenna " : "Reference ") + QChar('A' + point % 3) + ":\t" +
+                QString::number(record.points[point * 3 + 0], 'f', 3) + ",\t" +
+                QString::number(record.points[point * 3 + 1], 'f', 3) + ",\t" +
+                QString::number(record.points[point * 3 + 2], 'f', 3) + "\n";
+    }
+
+    PoseHistory::Pose pose;
+
+    text += "\nLOSolver:\n";
+    text += solve(record, pose) ? formatPose(pose) : QString("Failed, error code: " + QString::number(poseSolver.getLastError()));
+
+    // Between the previous (solved) record of the same vessel and this one
+    if ((time < record.time) && (recordIndex > 0))
+    {
+        if (poseHistory.empty() || (historyVessel != record.vessel) ||
+                (time < poseHistory.getFirstTime()) || (record.time > poseHistory.getLastTime()))
+        {
+            fillPoseHistory(recordIndex, record.vessel);
+        }
+
+        PoseHistory::Pose interpolatedPose;
+
+        if (poseHistory.getPose(time, interpolatedPose))
+        {
+            text += "\n\nInterpolated to " + QString::number((time - reader.getFirstTime()) / 1e9, 'f', 3) + " s:\n" +
+                    formatPose(interpolatedPose);
+        }
+    }
+
+    text += "\n\nDestination\tN: " + QString::number(record.destination[0], 'f', 3) +
+            "\tE: " + QString::number(record.destination[1], 'f', 3) +
+            "\tHeading: " + QString::number(fmod(record.destination[2] * 360. / (M_PI * 2) + 360, 360), 'f', 2);
+
+    if (record.flags & RecordingRecord::FLAG_OUTPUTS)
+    {
+        text += "\nAP: direction_Front: " + QString::number(record.outputs[0] * 360. / (M_PI * 2), 'f', 2) +
+                "\tpower_Front: " + QString::number(record.outputs[1], 'f', 1) +
+                "\tdirection_Back: " + QString::number(record.outputs[2] * 360. / (M_PI * 2), 'f', 2) +
+                "\tpower_Back: " + QString::number(record.outputs[3], 'f', 1);
+    }
+    else
+    {
+        text += "\nAP: not active";
+    }
+
+    if (record.flags & RecordingRecord::FLAG_DEBUG)
+    {
+        text += "\nAP debug:\tabsBearing: " + QString::number(fmod(record.debug[0] * 360. / (M_PI * 2) + 360, 360), 'f', 2) +
+                "\trelativeBearing: " + QString::number(record.debug[1] * 360. / (M_PI * 2), 'f', 2) +
+                "\tdistanceToTarget: " + QString::number(record.debug[2], 'f', 3) +
+                "\tspeed: " + QString::number(record.debug[3], 'f', 2) +
+                "\nAP debug2:\tdirectionOfTravel: " + QString::number(fmod(record.debug[4] * 360. / (M_PI * 2) + 360, 360), 'f', 2) +
+                "\theadingError: " + QString::number(record.debug[5] * 360. / (M_PI * 2), 'f', 2) +
+                "\tstate: " + QString::number(static_cast<int>(record.debug[6]));
+    }
+
+    plainTextEdit_State->setPlainText(text);
+}
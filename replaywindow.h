@@ -0,0 +1,80 @@
+/*
+    replaywindow.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef REPLAYWINDOW_H
+#define REPLAYWINDOW_H
+
+#include <QWidget>
+#include <QSlider>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPlainTextEdit>
+#include "recording.h"
+#include "posehistory.h"
+#include "posesolver.h"
+
+// Viewer of a recording: The timeline seeks to any time through the recording's
+// index, buttons step record by record. Shows the recorded state (inputs,
+// destination, autopilot outputs) and the pose LOSolver gives for it. Only the
+// records shown are read from the (memory mapped) file. Poses between records are
+// interpolated from a PoseHistory of the records around the shown one, so seeking
+// within it doesn't solve the records again.
+
+class ReplayWindow : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit ReplayWindow(QWidget* parent = nullptr);
+
+    bool open(const QString& fileName);
+
+private slots:
+    void on_slider_valueChanged(int value);
+    void on_lineEdit_GoTo_editingFinished();
+    void stepClicked();
+
+private:
+    RecordingReader reader;
+    PoseSolver poseSolver;
+
+    // Records solved to poseHistory around the shown one (poses of one vessel)
+    static const int historyRecords = 4096;
+
+    PoseHistory poseHistory;
+    int32_t historyVessel = 0;
+
+    uint64_t currentRecord = 0;
+    int64_t sliderStep = 1000000;   // ns per slider step
+
+    QLabel* label_Info;
+    QSlider* slider;
+    QLineEdit* lineEdit_GoTo;
+    QPlainTextEdit* plainTextEdit_State;
+
+    // Time (ns) of the slider: Pose is interpolated between the records around it
+    void showRecord(const uint64_t record, const int64_t time);
+    void moveSlider(const int64_t time);
+
+    bool solve(const RecordingRecord& record, PoseHistory::Pose& pose_NED);
+
+    // Solves the vessel's records around recordIndex to poseHistory
+    void fillPoseHistory(const uint64_t recordIndex, const int32_t vessel);
+};
+
+#endif // REPLAYWINDOW_H
@@ -0,0 +1,337 @@
+/*
+    shmtransport.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <chrono>
+#include "shmtransport.h"
+
+#ifdef __linux__
+#include <climits>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+const char* const ShmTransport::defaultName = "/SimFerryController";
+
+static const uint32_t segmentMagic = 0x53464331;    // "SFC1"
+static const uint32_t segmentVersion = 1;
+
+// Indices are on their own cache lines so producer and consumer don't
+// invalidate each other's lines on every access ("false sharing").
+struct alignas(64) PaddedIndex
+{
+    std::atomic<uint32_t> value;
+};
+
+struct ShmTransport::Ring
+{
+    PaddedIndex head;       // Next write position, written by the producer only
+    PaddedIndex tail;       // Next read position, written by the consumer only
+    PaddedIndex futexWord;  // Incremented on every write, consumer sleeps on this
+    PaddedIndex sleeping;   // Consumer is (about to be) sleeping on the futex
+    Record records[ringCapacity];
+};
+
+struct ShmTransport::Segment
+{
+    std::atomic<uint32_t> magic;    // Written last when initializing
+    uint32_t version;
+    uint32_t ringCapacity;
+    uint32_t recordSize;
+    Ring rings[2];                  // 0: simulator -> controller, 1: controller -> simulator
+};
+
+uint64_t ShmTransport::getTimestamp(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ShmTransport::~ShmTransport()
+{
+    close();
+}
+
+#ifdef __linux__
+
+static void futexWait(std::atomic<uint32_t>* word, const uint32_t expected, const int64_t timeout)
+{
+    struct timespec timeoutSpec;
+
+    timeoutSpec.tv_sec = timeout / 1000000000;
+    timeoutSpec.tv_nsec = timeout % 1000000000;
+
+    // Not FUTEX_PRIVATE_FLAG as the futex is shared between processes
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected,
+            (timeout >= 0) ? &timeoutSpec : nullptr, nullptr, 0);
+}
+
+static void futexWake(std::atomic<uint32_t>* word)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+bool ShmTransport::open(const std::string& name, const Role role)
+{
+    close();
+
+    const bool create = (role == ROLE_CONTROLLER);
+
+    fd = shm_open(name.c_str(), O_RDWR | (create ? O_CREAT : 0), 0600);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat fileStat;
+
+    if ((fstat(fd, &fileStat) != 0) ||
+            (create && (fileStat.st_size != sizeof(Segment)) && (ftruncate(fd, sizeof(Segment)) != 0)) ||
+            (!create && (fileStat.st_size != sizeof(Segment))))
+    {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (mapping == MAP_FAILED)
+    {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    Segment* newSegment = static_cast<Segment*>(mapping);
+
+    if (create)
+    {
+        // (Re)initialize, possibly left over from earlier run
+        newSegment->magic.store(0, std::memory_order_relaxed);
+
+        for (Ring& ring : newSegment->rings)
+        {
+            ring.head.value.store(0, std::memory_order_relaxed);
+            ring.tail.value.store(0, std::memory_order_relaxed);
+            ring.futexWord.value.store(0, std::memory_order_relaxed);
+            ring.sleeping.value.store(0, std::memory_order_relaxed);
+        }
+
+        newSegment->version = segmentVersion;
+        newSegment->ringCapacity = ringCapacity;
+        newSegment->recordSize = sizeof(Record);
+        newSegment->magic.store(segmentMagic, std::memory_order_release);
+    }
+    else if ((newSegment->magic.load(std::memory_order_acquire) != segmentMagic) ||
+             (newSegment->version != segmentVersion) ||
+             (newSegment->ringCapacity != ringCapacity) ||
+             (newSegment->recordSize != sizeof(Record)))
+    {
+        munmap(mapping, sizeof(Segment));
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    segment = newSegment;
+    this->name = name;
+    this->role = role;
+
+    receiveRing = &segment->rings[(role == ROLE_CONTROLLER) ? 0 : 1];
+    sendRing = &segment->rings[(role == ROLE_CONTROLLER) ? 1 : 0];
+
+    return true;
+}
+
+void ShmTransport::close(void)
+{
+    if (segment)
+    {
+        munmap(segment, sizeof(Segment));
+        segment = nullptr;
+        sendRing = nullptr;
+        receiveRing = nullptr;
+
+        if (role == ROLE_CONTROLLER)
+        {
+            shm_unlink(name.c_str());
+        }
+    }
+
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool ShmTransport::send(const Record& record)
+{
+    if (!sendRing)
+    {
+        return false;
+    }
+
+    const uint32_t head = sendRing->head.value.load(std::memory_order_relaxed);
+    const uint32_t tail = sendRing->tail.value.load(std::memory_order_acquire);
+
+    if ((head - tail) >= ringCapacity)
+    {
+        sendFailures++;
+        return false;
+    }
+
+    sendRing->records[head & (ringCapacity - 1)] = record;
+    sendRing->head.value.store(head + 1, std::memory_order_release);
+
+    // Futex syscall only if the consumer is sleeping. Sequentially consistent
+    // ordering pairs with the consumer setting "sleeping" and re-checking head.
+    sendRing->futexWord.value.fetch_add(1, std::memory_order_seq_cst);
+
+    if (sendRing->sleeping.value.load(std::memory_order_seq_cst))
+    {
+        futexWake(&sendRing->futexWord.value);
+    }
+
+    return true;
+}
+
+bool ShmTransport::receive(Record& record)
+{
+    if (!receiveRing)
+    {
+        return false;
+    }
+
+    const uint32_t tail = receiveRing->tail.value.load(std::memory_order_relaxed);
+    const uint32_t head = receiveRing->head.value.load(std::memory_order_acquire);
+
+    if (head == tail)
+    {
+        return false;
+    }
+
+    record = receiveRing->records[tail & (ringCapacity - 1)];
+    receiveRing->tail.value.store(tail + 1, std::memory_order_release);
+
+    return true;
+}
+
+bool ShmTransport::waitReceive(Record& record, const WaitMode mode, const int64_t timeout)
+{
+    if (!receiveRing)
+    {
+        return false;
+    }
+
+    const uint64_t startTime = getTimestamp();
+
+    if (mode == WAIT_BUSYPOLL)
+    {
+        for (unsigned int spins = 1; ; spins++)
+        {
+            if (receive(record))
+            {
+                return true;
+            }
+
+            if ((spins & 0xFF) == 0)
+            {
+                // Let the other side run if sharing the core
+                sched_yield();
+
+                if ((timeout >= 0) && (static_cast<int64_t>(getTimestamp() - startTime) >= timeout))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    while (true)
+    {
+        if (receive(record))
+        {
+            return true;
+        }
+
+        const uint32_t futexValue = receiveRing->futexWord.value.load(std::memory_order_seq_cst);
+
+        receiveRing->sleeping.value.store(1, std::memory_order_seq_cst);
+
+        // Re-check after announcing sleeping (sender may have written just before)
+        if (receive(record))
+        {
+            receiveRing->sleeping.value.store(0, std::memory_order_relaxed);
+            return true;
+        }
+
+        int64_t remaining = -1;
+
+        if (timeout >= 0)
+        {
+            remaining = timeout - static_cast<int64_t>(getTimestamp() - startTime);
+
+            if (remaining <= 0)
+            {
+                receiveRing->sleeping.value.store(0, std::memory_order_relaxed);
+                return false;
+            }
+        }
+
+        // Returns immediately if futexValue has already changed
+        futexWait(&receiveRing->futexWord.value, futexValue, remaining);
+
+        receiveRing->sleeping.value.store(0, std::memory_order_relaxed);
+    }
+}
+
+#else
+
+bool ShmTransport::open(const std::string&, const Role)
+{
+    return false;
+}
+
+void ShmTransport::close(void)
+{
+}
+
+bool ShmTransport::send(const Record&)
+{
+    return false;
+}
+
+bool ShmTransport::receive(Record&)
+{
+    return false;
+}
+
+bool ShmTransport::waitReceive(Record&, const WaitMode, const int64_t)
+{
+    return false;
+}
+
+#endif
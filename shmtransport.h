@@ -0,0 +1,112 @@
+/*
+    shmtransport.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef SHMTRANSPORT_H
+#define SHMTRANSPORT_H
+
+#include <cstdint>
+#include <string>
+
+// Transport for a simulator running on the same host: A POSIX shared memory
+// segment with two single-producer/single-consumer ring buffers of fixed size
+// records (simulator -> controller and controller -> simulator).
+// Receiving side can either sleep on a futex (woken by the sender only when
+// actually sleeping) or busy-poll.
+// Only available on Linux (open() fails elsewhere).
+
+class ShmTransport
+{
+public:
+    // Record types are the command ids of the UDP-protocol ("1;" -> 1 etc.)
+    // with the values in the same order, except for the antenna points
+    // (same 18 values as in the datagrams from the simulator).
+    enum RecordType
+    {
+        RECORD_ANTENNAPOINTS = 0,
+        RECORD_TRANSFORM = 1,
+        RECORD_PROPULSION = 2,
+        RECORD_DESTINATION = 3,
+        RECORD_DEBUGTRANSFORM = 10,
+        RECORD_AUTOPILOTDEBUG = 11
+    };
+
+    struct Record
+    {
+        uint32_t type;
+        uint32_t vessel;
+        uint64_t sequence;      // Replies carry the sequence of the antenna points they were calculated from
+        uint64_t timestamp;     // ns, getTimestamp() of the sender (echoed in replies like sequence)
+        uint32_t valueCount;
+        uint32_t reserved;
+        double values[18];
+    };
+
+    enum Role
+    {
+        ROLE_CONTROLLER = 0,    // Creates the segment, receives antenna points
+        ROLE_SIMULATOR          // Attaches to an existing segment, receives commands
+    };
+
+    enum WaitMode
+    {
+        WAIT_FUTEX = 0,
+        WAIT_BUSYPOLL
+    };
+
+    static const char* const defaultName;
+    static const uint32_t ringCapacity = 256;   // Records, power of two
+
+    ShmTransport() {}
+    ~ShmTransport();
+
+    bool open(const std::string& name, const Role role);
+    void close(void);
+    bool isOpen(void) const { return segment != nullptr; }
+
+    // Returns false if the ring is full (record is dropped)
+    bool send(const Record& record);
+
+    // Non-blocking, returns false if there's nothing to receive
+    bool receive(Record& record);
+
+    // Waits until a record is received or timeout (ns, < 0 = infinite) expires
+    bool waitReceive(Record& record, const WaitMode mode, const int64_t timeout);
+
+    uint64_t getSendFailures(void) const { return sendFailures; }
+
+    // CLOCK_MONOTONIC, ns
+    static uint64_t getTimestamp(void);
+
+private:
+    struct Ring;
+    struct Segment;
+
+    Segment* segment = nullptr;
+    Ring* sendRing = nullptr;
+    Ring* receiveRing = nullptr;
+    int fd = -1;
+    std::string name;
+    Role role = ROLE_CONTROLLER;
+    uint64_t sendFailures = 0;
+
+    // Not copyable
+    ShmTransport(const ShmTransport&);
+    ShmTransport& operator=(const ShmTransport&);
+};
+
+#endif // SHMTRANSPORT_H
@@ -0,0 +1,930 @@
+/*
+    telemetryarchive.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include "telemetryarchive.h"
+
+// readRecords decodes the double columns directly to the records
+static_assert((offsetof(RecordingRecord, debug) - offsetof(RecordingRecord, points)) ==
+              (TelemetryArchive::COLUMN_DEBUG - TelemetryArchive::COLUMN_POINTS) * sizeof(double),
+              "Double fields of RecordingRecord must be consecutive");
+static_assert((sizeof(RecordingRecord) % sizeof(double)) == 0, "RecordingRecord size must be a multiple of double");
+
+namespace
+{
+
+struct FileHeader
+{
+    char magic[8];
+    uint32_t columnCount;
+    uint32_t reserved;
+};
+
+struct ChunkHeader
+{
+    char magic[4];
+    uint32_t recordCount;
+    int64_t firstTime;
+    int64_t lastTime;
+    uint32_t columnSizes[TelemetryArchive::COLUMN_COUNT];
+};
+
+const char archiveMagic[8] = "SFCARC1";
+const char chunkMagic[4] = { 'C', 'H', 'N', 'K' };
+
+const char* const pointNames[6] = { "antennaA", "antennaB", "antennaC", "refPointA", "refPointB", "refPointC" };
+const char* const destinationNames[3] = { "destination_N", "destination_E", "destination_heading" };
+const char* const outputNames[4] = { "direction_Front", "propulsion_Front", "direction_Back", "propulsion_Back" };
+const char* const debugNames[7] = { "absBearing", "relativeBearing", "distanceToTarget", "speed",
+                                    "directionOfTravel", "headingError", "state" };
+
+int countLeadingZeros(const uint64_t value)
+{
+#if defined(__GNUC__)
+    return __builtin_clzll(value);
+#else
+    int count = 0;
+
+    while (!(value & (1ULL << (63 - count))))
+    {
+        count++;
+    }
+
+    return count;
+#endif
+}
+
+int countTrailingZeros(const uint64_t value)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(value);
+#else
+    int count = 0;
+
+    while (!(value & (1ULL << count)))
+    {
+        count++;
+    }
+
+    return count;
+#endif
+}
+
+uint64_t doubleToBits(const double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double bitsToDouble(const uint64_t bits)
+{
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+bool fitsSigned(const int64_t value, const int bits)
+{
+    return (value >= -(INT64_C(1) << (bits - 1))) && (value < (INT64_C(1) << (bits - 1)));
+}
+
+int64_t signExtend(const uint64_t value, const int bits)
+{
+    const uint64_t signBit = UINT64_C(1) << (bits - 1);
+    return static_cast<int64_t>((value ^ signBit) - signBit);
+}
+
+// Delta-of-delta prefix codes: '0' = 0, '10' + 7 bits, '110' + 12 bits,
+// '1110' + 20 bits, '11110' + 32 bits, '11111' + 64 bits.
+// (Gorilla's ranges are for seconds, these fit nanosecond jitter better.)
+const int dodBits[5] = { 7, 12, 20, 32, 64 };
+
+// First byte of a double column
+enum DoubleEncoding
+{
+    ENCODING_XOR = 0,
+    ENCODING_DECIMAL = 1    // + index of the scale
+};
+
+const double decimalScales[] = { 1e3, 1e6 };
+
+// Reads zero bits past the end of the data, overrun() tells if that happened
+class BitReader
+{
+public:
+    BitReader(const uint8_t* data, const size_t size) :
+        data(data), size(size)
+    {
+
+    }
+
+    uint64_t read(const int bits)
+    {
+        if (bits > 32)
+        {
+            const uint64_t high = read32(bits - 32);
+            return (high << 32) | read32(32);
+        }
+
+        return read32(bits);
+    }
+
+    bool overrun(void) const { return consumedBits > size * 8; }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t position = 0;
+    size_t consumedBits = 0;
+    uint64_t accumulator = 0;
+    int accumulatedBits = 0;
+
+    uint64_t read32(const int bits)
+    {
+        if (accumulatedBits < bits)
+        {
+            while (accumulatedBits <= 56)
+            {
+                accumulator = (accumulator << 8) | ((position < size) ? data[position] : 0);
+                position++;
+                accumulatedBits += 8;
+            }
+        }
+
+        accumulatedBits -= bits;
+        consumedBits += bits;
+
+        return (accumulator >> accumulatedBits) & ((UINT64_C(1) << bits) - 1);
+    }
+};
+
+#if defined(_WIN32)
+int seekFile(FILE* file, const int64_t offset, const int origin) { return _fseeki64(file, offset, origin); }
+int64_t tellFile(FILE* file) { return _ftelli64(file); }
+#else
+int seekFile(FILE* file, const int64_t offset, const int origin) { return fseeko(file, offset, origin); }
+int64_t tellFile(FILE* file) { return ftello(file); }
+#endif
+
+}
+
+std::string TelemetryArchive::getColumnName(const int column)
+{
+    switch (column)
+    {
+    case COLUMN_TIME:
+        return "time";
+    case COLUMN_SEQUENCE:
+        return "sequence";
+    case COLUMN_VESSEL:
+        return "vessel";
+    case COLUMN_FLAGS:
+        return "flags";
+    default:
+        break;
+    }
+
+    if ((column >= COLUMN_POINTS) && (column < COLUMN_DESTINATION))
+    {
+        return std::string(pointNames[(column - COLUMN_POINTS) / 3]) + "_" + static_cast<char>('x' + (column - COLUMN_POINTS) % 3);
+    }
+    else if ((column >= COLUMN_DESTINATION) && (column < COLUMN_OUTPUTS))
+    {
+        return destinationNames[column - COLUMN_DESTINATION];
+    }
+    else if ((column >= COLUMN_OUTPUTS) && (column < COLUMN_DEBUG))
+    {
+        return outputNames[column - COLUMN_OUTPUTS];
+    }
+    else if ((column >= COLUMN_DEBUG) && (column < COLUMN_COUNT))
+    {
+        return debugNames[column - COLUMN_DEBUG];
+    }
+
+    return "";
+}
+
+int TelemetryArchive::findColumn(const std::string& name)
+{
+    for (int column = 0; column < COLUMN_COUNT; column++)
+    {
+        if (getColumnName(column) == name)
+        {
+            return column;
+        }
+    }
+
+    return -1;
+}
+
+void ArchiveWriter::BitWriter::write32(const uint32_t value, const int bits)
+{
+    accumulator = (accumulator << bits) | (value & ((UINT64_C(1) << bits) - 1));
+    accumulatedBits += bits;
+
+    while (accumulatedBits >= 8)
+    {
+        accumulatedBits -= 8;
+        bytes.push_back(static_cast<uint8_t>(accumulator >> accumulatedBits));
+    }
+}
+
+void ArchiveWriter::BitWriter::write(uint64_t value, const int bits)
+{
+    if (bits > 32)
+    {
+        write32(static_cast<uint32_t>(value >> 32), bits - 32);
+        write32(static_cast<uint32_t>(value), 32);
+    }
+    else
+    {
+        write32(static_cast<uint32_t>(value), bits);
+    }
+}
+
+void ArchiveWriter::BitWriter::finish(void)
+{
+    if (accumulatedBits > 0)
+    {
+        bytes.push_back(static_cast<uint8_t>(accumulator << (8 - accumulatedBits)));
+        accumulatedBits = 0;
+    }
+}
+
+void ArchiveWriter::BitWriter::clear(void)
+{
+    bytes.clear();
+    accumulator = 0;
+    accumulatedBits = 0;
+}
+
+ArchiveWriter::~ArchiveWriter()
+{
+    close();
+}
+
+bool ArchiveWriter::open(const std::string& fileName, const unsigned int chunkSize)
+{
+    close();
+
+    file = fopen(fileName.c_str(), "wb");
+
+    if (!file)
+    {
+        return false;
+    }
+
+    FileHeader header;
+
+    memcpy(header.magic, archiveMagic, sizeof(header.magic));
+    header.columnCount = TelemetryArchive::COLUMN_COUNT;
+    header.reserved = 0;
+
+    if (fwrite(&header, sizeof(header), 1, file) != 1)
+    {
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+
+    this->chunkSize = (chunkSize > 0) ? chunkSize : 1;
+    chunkRecords = 0;
+    lastTime = INT64_MIN;
+    recordCount = 0;
+    bytesWritten = sizeof(header);
+    writeError = false;
+
+    return true;
+}
+
+bool ArchiveWriter::close(void)
+{
+    if (!file)
+    {
+        return false;
+    }
+
+    if (chunkRecords > 0)
+    {
+        writeChunk();
+    }
+
+    writeError |= (fclose(file) != 0);
+    file = nullptr;
+
+    return !writeError;
+}
+
+void ArchiveWriter::encodeInteger(IntegerEncoder& encoder, BitWriter& writer, const uint64_t value)
+{
+    if (chunkRecords == 0)
+    {
+        writer.write(value, 64);
+        encoder.previous = value;
+        encoder.previousDelta = 0;
+        return;
+    }
+
+    // Unsigned arithmetic wraps the same way when decoding
+    const uint64_t delta = value - encoder.previous;
+    const int64_t deltaOfDelta = static_cast<int64_t>(delta - encoder.previousDelta);
+
+    encoder.previous = value;
+    encoder.previousDelta = delta;
+
+    if (deltaOfDelta == 0)
+    {
+        writer.write(0, 1);
+        return;
+    }
+
+    for (int i = 0; i < 5; i++)
+    {
+        if ((i == 4) || fitsSigned(deltaOfDelta, dodBits[i]))
+        {
+            // i + 1 ones followed by a zero (except for the last one)
+            if (i < 4)
+            {
+                writer.write((UINT64_C(1) << (i + 2)) - 2, i + 2);
+            }
+            else
+            {
+                writer.write(0x1F, 5);
+            }
+
+            writer.write(static_cast<uint64_t>(deltaOfDelta), dodBits[i]);
+            return;
+        }
+    }
+}
+
+void ArchiveWriter::encodeDouble(const int column, const double value)
+{
+    DoubleColumn& doubleColumn = doubleColumns[column - TelemetryArchive::integerColumnCount];
+    XorEncoder& encoder = doubleColumn.xorEncoder;
+    BitWriter& writer = doubleColumn.xorBits;
+    const uint64_t bits = doubleToBits(value);
+
+    for (int i = 0; i < decimalScaleCount; i++)
+    {
+        if (chunkRecords == 0)
+        {
+            doubleColumn.decimalValid[i] = true;
+        }
+
+        if (doubleColumn.decimalValid[i])
+        {
+            const double scaled = value * decimalScales[i];
+
+            // Exact only if dividing gives the very same value back
+            if ((fabs(scaled) < 9007199254740992.) &&
+                    (doubleToBits(static_cast<double>(llround(scaled)) / decimalScales[i]) == bits))
+            {
+                encodeInteger(doubleColumn.decimalEncoders[i], doubleColumn.decimalBits[i], static_cast<uint64_t>(llround(scaled)));
+            }
+            else
+            {
+                doubleColumn.decimalValid[i] = false;
+                doubleColumn.decimalBits[i].clear();
+            }
+        }
+    }
+
+    if (chunkRecords == 0)
+    {
+        writer.write(bits, 64);
+        encoder.previous = bits;
+        encoder.previousLeading = -1;
+        encoder.previousTrailing = 0;
+        return;
+    }
+
+    const uint64_t xorValue = bits ^ encoder.previous;
+
+    encoder.previous = bits;
+
+    if (xorValue == 0)
+    {
+        writer.write(0, 1);
+        return;
+    }
+
+    int leading = countLeadingZeros(xorValue);
+    const int trailing = countTrailingZeros(xorValue);
+
+    if (leading > 31)
+    {
+        leading = 31;
+    }
+
+    if ((encoder.previousLeading >= 0) &&
+            (leading >= encoder.previousLeading) && (trailing >= encoder.previousTrailing))
+    {
+        // Meaningful bits fit in the previous window
+        writer.write(0x2, 2);
+        writer.write(xorValue >> encoder.previousTrailing, 64 - encoder.previousLeading - encoder.previousTrailing);
+    }
+    else
+    {
+        const int significant = 64 - leading - trailing;
+
+        writer.write(0x3, 2);
+        writer.write(leading, 5);
+        writer.write(significant - 1, 6);
+        writer.write(xorValue >> trailing, significant);
+
+        encoder.previousLeading = leading;
+        encoder.previousTrailing = trailing;
+    }
+}
+
+bool ArchiveWriter::append(const RecordingRecord& record)
+{
+    if (!file)
+    {
+        return false;
+    }
+
+    // Chunks' time ranges need the times in order (like in the recording)
+    const int64_t time = (record.time < lastTime) ? lastTime : record.time;
+
+    lastTime = time;
+
+    if (chunkRecords == 0)
+    {
+        chunkFirstTime = time;
+    }
+
+    const uint64_t integers[TelemetryArchive::integerColumnCount] =
+    {
+        static_cast<uint64_t>(time),
+        static_cast<uint64_t>(record.sequence),
+        static_cast<uint64_t>(static_cast<int64_t>(record.vessel)),
+        record.flags
+    };
+
+    for (int i = 0; i < TelemetryArchive::integerColumnCount; i++)
+    {
+        encodeInteger(integerEncoders[i], integerColumns[i], integers[i]);
+    }
+
+    for (int i = 0; i < 18; i++)
+    {
+        encodeDouble(TelemetryArchive::COLUMN_POINTS + i, record.points[i]);
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        encodeDouble(TelemetryArchive::COLUMN_DESTINATION + i, record.destination[i]);
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        encodeDouble(TelemetryArchive::COLUMN_OUTPUTS + i, record.outputs[i]);
+    }
+
+    for (int i = 0; i < 7; i++)
+    {
+        encodeDouble(TelemetryArchive::COLUMN_DEBUG + i, record.debug[i]);
+    }
+
+    chunkRecords++;
+    recordCount++;
+
+    if (chunkRecords >= chunkSize)
+    {
+        return writeChunk();
+    }
+
+    return true;
+}
+
+bool ArchiveWriter::writeChunk(void)
+{
+    ChunkHeader header;
+
+    memcpy(header.magic, chunkMagic, sizeof(header.magic));
+    header.recordCount = chunkRecords;
+    header.firstTime = chunkFirstTime;
+    header.lastTime = lastTime;
+
+    // Double columns: Smallest valid encoding
+    const BitWriter* chosen[TelemetryArchive::COLUMN_COUNT];
+    uint8_t encodings[TelemetryArchive::COLUMN_COUNT];
+
+    for (int column = 0; column < TelemetryArchive::COLUMN_COUNT; column++)
+    {
+        if (TelemetryArchive::isIntegerColumn(column))
+        {
+            integerColumns[column].finish();
+            chosen[column] = &integerColumns[column];
+            header.columnSizes[column] = static_cast<uint32_t>(chosen[column]->bytes.size());
+            continue;
+        }
+
+        DoubleColumn& doubleColumn = doubleColumns[column - TelemetryArchive::integerColumnCount];
+
+        doubleColumn.xorBits.finish();
+        chosen[column] = &doubleColumn.xorBits;
+        encodings[column] = ENCODING_XOR;
+
+        for (int i = 0; i < decimalScaleCount; i++)
+        {
+            doubleColumn.decimalBits[i].finish();
+
+            if (doubleColumn.decimalValid[i] && (doubleColumn.decimalBits[i].bytes.size() < chosen[column]->bytes.size()))
+            {
+                chosen[column] = &doubleColumn.decimalBits[i];
+                encodings[column] = static_cast<uint8_t>(ENCODING_DECIMAL + i);
+            }
+        }
+
+        header.columnSizes[column] = static_cast<uint32_t>(1 + chosen[column]->bytes.size());
+    }
+
+    bool ok = (fwrite(&header, sizeof(header), 1, file) == 1);
+    bytesWritten += sizeof(header);
+
+    for (int column = 0; column < TelemetryArchive::COLUMN_COUNT; column++)
+    {
+        if (!TelemetryArchive::isIntegerColumn(column))
+        {
+            ok = ok && (fwrite(&encodings[column], 1, 1, file) == 1);
+        }
+
+        ok = ok && (chosen[column]->bytes.empty() || (fwrite(chosen[column]->bytes.data(), chosen[column]->bytes.size(), 1, file) == 1));
+        bytesWritten += header.columnSizes[column];
+    }
+
+    for (BitWriter& column : integerColumns)
+    {
+        column.clear();
+    }
+
+    for (DoubleColumn& column : doubleColumns)
+    {
+        column.xorBits.clear();
+
+        for (BitWriter& decimalColumn : column.decimalBits)
+        {
+            decimalColumn.clear();
+        }
+    }
+
+    chunkRecords = 0;
+    writeError |= !ok;
+
+    return ok;
+}
+
+void ArchiveWriter::flush(void)
+{
+    if (file)
+    {
+        fflush(file);
+    }
+}
+
+ArchiveReader::~ArchiveReader()
+{
+    close();
+}
+
+bool ArchiveReader::open(const std::string& fileName)
+{
+    close();
+
+    file = fopen(fileName.c_str(), "rb");
+
+    if (!file)
+    {
+        return false;
+    }
+
+    FileHeader header;
+
+    if ((fread(&header, sizeof(header), 1, file) != 1) ||
+            (memcmp(header.magic, archiveMagic, sizeof(header.magic)) != 0) ||
+            (header.columnCount != TelemetryArchive::COLUMN_COUNT))
+    {
+        close();
+        return false;
+    }
+
+    seekFile(file, 0, SEEK_END);
+    const int64_t fileSize = tellFile(file);
+    int64_t offset = sizeof(header);
+
+    while (true)
+    {
+        ChunkHeader chunkHeader;
+
+        if ((seekFile(file, offset, SEEK_SET) != 0) ||
+                (fread(&chunkHeader, sizeof(chunkHeader), 1, file) != 1) ||
+                (memcmp(chunkHeader.magic, chunkMagic, sizeof(chunkHeader.magic)) != 0))
+        {
+            break;
+        }
+
+        ChunkInfo chunk;
+        int64_t dataSize = 0;
+
+        chunk.firstRecord = recordCount;
+        chunk.recordCount = chunkHeader.recordCount;
+        chunk.firstTime = chunkHeader.firstTime;
+        chunk.lastTime = chunkHeader.lastTime;
+        chunk.offset = offset + sizeof(chunkHeader);
+
+        for (int column = 0; column < TelemetryArchive::COLUMN_COUNT; column++)
+        {
+            chunk.columnSizes[column] = chunkHeader.columnSizes[column];
+            dataSize += chunkHeader.columnSizes[column];
+        }
+
+        if (chunk.offset + dataSize > fileSize)
+        {
+            break;
+        }
+
+        chunks.push_back(chunk);
+        recordCount += chunk.recordCount;
+        offset = chunk.offset + dataSize;
+    }
+
+    return true;
+}
+
+void ArchiveReader::close(void)
+{
+    if (file)
+    {
+        fclose(file);
+        file = nullptr;
+    }
+
+    chunks.clear();
+    recordCount = 0;
+}
+
+size_t ArchiveReader::findChunk(const int64_t time) const
+{
+    size_t first = 0;
+    size_t count = chunks.size();
+
+    while (count > 0)
+    {
+        const size_t step = count / 2;
+
+        if (chunks[first + step].lastTime < time)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+        {
+            count = step;
+        }
+    }
+
+    return first;
+}
+
+bool ArchiveReader::loadColumn(const size_t chunk, const int column)
+{
+    if (!file || (chunk >= chunks.size()) || (column < 0) || (column >= TelemetryArchive::COLUMN_COUNT))
+    {
+        return false;
+    }
+
+    const ChunkInfo& info = chunks[chunk];
+    int64_t offset = info.offset;
+
+    for (int i = 0; i < column; i++)
+    {
+        offset += info.columnSizes[i];
+    }
+
+    columnData.resize(info.columnSizes[column]);
+
+    return (seekFile(file, offset, SEEK_SET) == 0) &&
+            (columnData.empty() || (fread(columnData.data(), columnData.size(), 1, file) == 1));
+}
+
+bool ArchiveReader::decodeIntegers(const uint8_t* data, const size_t size, const uint32_t count, int64_t* values, const size_t stride)
+{
+    BitReader reader(data, size);
+    uint64_t value = 0;
+    uint64_t delta = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (i == 0)
+        {
+            value = reader.read(64);
+        }
+        else
+        {
+            int prefix = 0;
+
+            while ((prefix < 5) && reader.read(1))
+            {
+                prefix++;
+            }
+
+            if (prefix > 0)
+            {
+                const int bits = dodBits[prefix - 1];
+                delta += static_cast<uint64_t>((bits == 64) ? static_cast<int64_t>(reader.read(64)) : signExtend(reader.read(bits), bits));
+            }
+
+            value += delta;
+        }
+
+        values[i * stride] = static_cast<int64_t>(value);
+    }
+
+    return !reader.overrun();
+}
+
+bool ArchiveReader::decodeXor(const uint8_t* data, const size_t size, const uint32_t count, double* values, const size_t stride)
+{
+    BitReader reader(data, size);
+    uint64_t bits = 0;
+    int leading = -1;
+    int trailing = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (i == 0)
+        {
+            bits = reader.read(64);
+        }
+        else if (reader.read(1))
+        {
+            if (reader.read(1))
+            {
+                leading = static_cast<int>(reader.read(5));
+                const int significant = static_cast<int>(reader.read(6)) + 1;
+                trailing = 64 - leading - significant;
+
+                if (trailing < 0)
+                {
+                    return false;
+                }
+            }
+            else if (leading < 0)
+            {
+                return false;
+            }
+
+            bits ^= reader.read(64 - leading - trailing) << trailing;
+        }
+
+        values[i * stride] = bitsToDouble(bits);
+    }
+
+    return !reader.overrun();
+}
+
+bool ArchiveReader::decodeDoubles(const std::vector<uint8_t>& data, const uint32_t count, double* values, const size_t stride)
+{
+    if (data.empty())
+    {
+        return false;
+    }
+
+    const uint8_t encoding = data[0];
+
+    if (encoding == ENCODING_XOR)
+    {
+        return decodeXor(data.data() + 1, data.size() - 1, count, values, stride);
+    }
+    else if (encoding - ENCODING_DECIMAL >= static_cast<int>(sizeof(decimalScales) / sizeof(decimalScales[0])))
+    {
+        return false;
+    }
+
+    std::vector<int64_t> scaled(count);
+    const double scale = decimalScales[encoding - ENCODING_DECIMAL];
+
+    if (!decodeIntegers(data.data() + 1, data.size() - 1, count, scaled.data(), 1))
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        values[i * stride] = static_cast<double>(scaled[i]) / scale;
+    }
+
+    return true;
+}
+
+bool ArchiveReader::readColumn(const size_t chunk, const int column, std::vector<int64_t>& values)
+{
+    if (!TelemetryArchive::isIntegerColumn(column) || !loadColumn(chunk, column))
+    {
+        return false;
+    }
+
+    values.resize(chunks[chunk].recordCount);
+
+    return decodeIntegers(columnData.data(), columnData.size(), chunks[chunk].recordCount, values.data(), 1);
+}
+
+bool ArchiveReader::readColumn(const size_t chunk, const int column, std::vector<double>& values)
+{
+    if (TelemetryArchive::isIntegerColumn(column) || !loadColumn(chunk, column))
+    {
+        return false;
+    }
+
+    values.resize(chunks[chunk].recordCount);
+
+    return decodeDoubles(columnData, chunks[chunk].recordCount, values.data(), 1);
+}
+
+bool ArchiveReader::readRecords(const size_t chunk, std::vector<RecordingRecord>& records)
+{
+    if (chunk >= chunks.size())
+    {
+        return false;
+    }
+
+    records.resize(chunks[chunk].recordCount);
+
+    if (records.empty())
+    {
+        return true;
+    }
+
+    const uint32_t count = chunks[chunk].recordCount;
+    const size_t stride = sizeof(RecordingRecord) / sizeof(double);
+    std::vector<int64_t> integers(count);
+
+    for (int column = 0; column < TelemetryArchive::COLUMN_COUNT; column++)
+    {
+        if (!loadColumn(chunk, column))
+        {
+            return false;
+        }
+
+        if (TelemetryArchive::isIntegerColumn(column))
+        {
+            if (!decodeIntegers(columnData.data(), columnData.size(), count, integers.data(), 1))
+            {
+                return false;
+            }
+
+            for (uint32_t i = 0; i < count; i++)
+            {
+                switch (column)
+                {
+                case TelemetryArchive::COLUMN_TIME:
+                    records[i].time = integers[i];
+                    break;
+                case TelemetryArchive::COLUMN_SEQUENCE:
+                    records[i].sequence = integers[i];
+                    break;
+                case TelemetryArchive::COLUMN_VESSEL:
+                    records[i].vessel = static_cast<int32_t>(integers[i]);
+                    break;
+                default:
+                    records[i].flags = static_cast<uint32_t>(integers[i]);
+                    break;
+                }
+            }
+        }
+        else
+        {
+            // Double fields are consecutive in the record, starting from points
+            double* first = reinterpret_cast<double*>(reinterpret_cast<char*>(records.data()) + offsetof(RecordingRecord, points)) +
+                    (column - TelemetryArchive::COLUMN_POINTS);
+
+            if (!decodeDoubles(columnData, count, first, stride))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,202 @@
+/*
+    telemetryarchive.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TELEMETRYARCHIVE_H
+#define TELEMETRYARCHIVE_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "recording.h"
+
+// Compressed, columnar archive of recording records for long-term storage.
+//
+// Records are stored in chunks (default 4096 records). Each field of the record
+// is a column of its own in the chunk, compressed Gorilla-style:
+// - Integer columns (time, sequence, vessel, flags): delta-of-delta with
+//   variable length prefix codes (1 bit when the delta doesn't change).
+// - Double columns: XOR with the previous value, only the meaningful bits
+//   are stored (1 bit when the value doesn't change).
+//   Values parsed from the simulator's text (a fixed number of decimals) have
+//   noisy mantissas that don't XOR-compress well, so these are also encoded as
+//   integers (value * 10^3 or 10^6) with delta-of-delta while they stay exact.
+//   Smallest of the encodings is stored (first byte of the column tells which).
+//
+// File: 16 byte header ("SFCARC1", column count) + chunks. Chunk header
+// contains record count, time range and the compressed size of each column,
+// so columns not needed are skipped without decoding (or even reading) them.
+// Native byte order (like the recording).
+
+class TelemetryArchive
+{
+public:
+    enum Column
+    {
+        COLUMN_TIME = 0,
+        COLUMN_SEQUENCE,
+        COLUMN_VESSEL,
+        COLUMN_FLAGS,
+        COLUMN_POINTS,                          // 18 columns (RecordingRecord::points)
+        COLUMN_DESTINATION = COLUMN_POINTS + 18,
+        COLUMN_OUTPUTS = COLUMN_DESTINATION + 3,
+        COLUMN_DEBUG = COLUMN_OUTPUTS + 4,
+        COLUMN_COUNT = COLUMN_DEBUG + 7
+    };
+
+    static const int integerColumnCount = COLUMN_POINTS;
+
+    static bool isIntegerColumn(const int column) { return column < integerColumnCount; }
+
+    // E.g. "time", "antennaA_x", "refPointC_z", "destination_N", "propulsion_Back", "headingError"
+    static std::string getColumnName(const int column);
+
+    // -1 if not found
+    static int findColumn(const std::string& name);
+};
+
+// Encodes records as they are appended (no records are buffered), a chunk is
+// written when full. Records of an unfinished chunk are lost if the archive is
+// not closed.
+
+class ArchiveWriter
+{
+public:
+    ~ArchiveWriter();
+
+    bool open(const std::string& fileName, const unsigned int chunkSize = 4096);
+    bool close(void);
+    bool isOpen(void) const { return file != nullptr; }
+
+    bool append(const RecordingRecord& record);
+
+    // Makes the written chunks visible to readers
+    void flush(void);
+
+    uint64_t getRecordCount(void) const { return recordCount; }
+    uint64_t getBytesWritten(void) const { return bytesWritten; }
+
+private:
+    static const int decimalScaleCount = 2;     // 10^3, 10^6
+
+    struct IntegerEncoder
+    {
+        uint64_t previous;
+        uint64_t previousDelta;
+    };
+
+    struct XorEncoder
+    {
+        uint64_t previous;
+        int previousLeading;
+        int previousTrailing;
+    };
+
+    class BitWriter
+    {
+    public:
+        std::vector<uint8_t> bytes;
+
+        void write(uint64_t value, const int bits);
+        void finish(void);
+        void clear(void);
+
+    private:
+        uint64_t accumulator = 0;
+        int accumulatedBits = 0;
+
+        void write32(const uint32_t value, const int bits);
+    };
+
+    struct DoubleColumn
+    {
+        XorEncoder xorEncoder;
+        BitWriter xorBits;
+
+        IntegerEncoder decimalEncoders[decimalScaleCount];
+        BitWriter decimalBits[decimalScaleCount];
+        bool decimalValid[decimalScaleCount];
+    };
+
+    FILE* file = nullptr;
+    unsigned int chunkSize = 4096;
+    unsigned int chunkRecords = 0;
+    int64_t chunkFirstTime = 0;
+    int64_t lastTime = INT64_MIN;
+    uint64_t recordCount = 0;
+    uint64_t bytesWritten = 0;
+    bool writeError = false;
+
+    IntegerEncoder integerEncoders[TelemetryArchive::integerColumnCount];
+    BitWriter integerColumns[TelemetryArchive::integerColumnCount];
+    DoubleColumn doubleColumns[TelemetryArchive::COLUMN_COUNT - TelemetryArchive::integerColumnCount];
+
+    void encodeInteger(IntegerEncoder& encoder, BitWriter& writer, const uint64_t value);
+    void encodeDouble(const int column, const double value);
+    bool writeChunk(void);
+};
+
+class ArchiveReader
+{
+public:
+    struct ChunkInfo
+    {
+        uint64_t firstRecord;
+        uint32_t recordCount;
+        int64_t firstTime;
+        int64_t lastTime;
+        int64_t offset;                                     // Of the first column's data
+        uint32_t columnSizes[TelemetryArchive::COLUMN_COUNT];
+    };
+
+    ~ArchiveReader();
+
+    // Reads the chunk headers only. A truncated last chunk is ignored.
+    bool open(const std::string& fileName);
+    void close(void);
+    bool isOpen(void) const { return file != nullptr; }
+
+    uint64_t getRecordCount(void) const { return recordCount; }
+    size_t getChunkCount(void) const { return chunks.size(); }
+    const ChunkInfo& getChunk(const size_t chunk) const { return chunks[chunk]; }
+
+    // First chunk with lastTime >= given (getChunkCount() if none)
+    size_t findChunk(const int64_t time) const;
+
+    // Decodes one column of a chunk (values are replaced).
+    // Integer columns can only be read as integers and double columns as doubles.
+    bool readColumn(const size_t chunk, const int column, std::vector<int64_t>& values);
+    bool readColumn(const size_t chunk, const int column, std::vector<double>& values);
+
+    // Decodes all columns of a chunk (records are replaced)
+    bool readRecords(const size_t chunk, std::vector<RecordingRecord>& records);
+
+private:
+    FILE* file = nullptr;
+    std::vector<ChunkInfo> chunks;
+    uint64_t recordCount = 0;
+    std::vector<uint8_t> columnData;
+
+    bool loadColumn(const size_t chunk, const int column);
+
+    static bool decodeIntegers(const uint8_t* data, const size_t size, const uint32_t count, int64_t* values, const size_t stride);
+    static bool decodeXor(const uint8_t* data, const size_t size, const uint32_t count, double* values, const size_t stride);
+    static bool decodeDoubles(const std::vector<uint8_t>& data, const uint32_t count, double* values, const size_t stride);
+};
+
+#endif // TELEMETRYARCHIVE_H
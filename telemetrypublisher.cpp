@@ -0,0 +1,290 @@
+/*
+    telemetrypublisher.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <vector>
+#include <cstring>
+#include "telemetrypublisher.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+TelemetryPublisher::~TelemetryPublisher()
+{
+    close();
+    clearSubscribers();
+}
+
+#ifndef _WIN32
+
+struct TelemetryPublisher::Batch
+{
+    std::vector<sockaddr_in> addresses;
+    std::vector<iovec> iovecs;
+#ifdef __linux__
+    std::vector<mmsghdr> messages;
+#else
+    std::vector<msghdr> messages;
+#endif
+};
+
+static bool parseSubscriber(const std::string& entry, sockaddr_in& address)
+{
+    const size_t separator = entry.rfind(':');
+
+    if ((separator == std::string::npos) || (separator == 0) || (separator == (entry.size() - 1)))
+    {
+        return false;
+    }
+
+    const std::string host = entry.substr(0, separator);
+    const std::string port = entry.substr(separator + 1);
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_NUMERICSERV;
+
+    addrinfo* result = nullptr;
+
+    if ((getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0) || !result)
+    {
+        return false;
+    }
+
+    memcpy(&address, result->ai_addr, sizeof(address));
+    freeaddrinfo(result);
+
+    return true;
+}
+
+bool TelemetryPublisher::setSubscribers(const std::string& list)
+{
+    std::vector<sockaddr_in> addresses;
+    size_t start = 0;
+
+    while (start < list.size())
+    {
+        size_t end = list.find_first_of(" ,;\t", start);
+
+        if (end == std::string::npos)
+        {
+            end = list.size();
+        }
+
+        if (end != start)
+        {
+            sockaddr_in address;
+
+            if (!parseSubscriber(list.substr(start, end - start), address))
+            {
+                return false;
+            }
+
+            addresses.push_back(address);
+        }
+
+        start = end + 1;
+    }
+
+    clearSubscribers();
+
+    if (addresses.empty())
+    {
+        return true;
+    }
+
+    batch = new Batch;
+    batch->addresses = addresses;
+    batch->iovecs.resize(addresses.size());
+    batch->messages.resize(addresses.size());
+
+    for (size_t i = 0; i < addresses.size(); i++)
+    {
+#ifdef __linux__
+        msghdr& header = batch->messages[i].msg_hdr;
+        batch->messages[i].msg_len = 0;
+#else
+        msghdr& header = batch->messages[i];
+#endif
+        memset(&header, 0, sizeof(header));
+        header.msg_name = &batch->addresses[i];
+        header.msg_namelen = sizeof(sockaddr_in);
+        header.msg_iov = &batch->iovecs[i];
+        header.msg_iovlen = 1;
+    }
+
+    return true;
+}
+
+void TelemetryPublisher::clearSubscribers(void)
+{
+    delete batch;
+    batch = nullptr;
+}
+
+int TelemetryPublisher::getSubscriberCount(void) const
+{
+    return batch ? static_cast<int>(batch->addresses.size()) : 0;
+}
+
+void TelemetryPublisher::setMulticastTtl(const int ttl)
+{
+    multicastTtl = ttl;
+
+    if (fd >= 0)
+    {
+        unsigned char value = static_cast<unsigned char>(ttl);
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &value, sizeof(value));
+    }
+}
+
+bool TelemetryPublisher::open(void)
+{
+    close();
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    // Consumers on this host (multicast) get the datagrams too
+    unsigned char loop = 1;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    setMulticastTtl(multicastTtl);
+
+    return true;
+}
+
+void TelemetryPublisher::close(void)
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+int TelemetryPublisher::publish(const char* data, const int length)
+{
+    if (!isActive())
+    {
+        return 0;
+    }
+
+    const int count = getSubscriberCount();
+
+    // Same data for everyone, only the iovecs need to be updated
+    for (int i = 0; i < count; i++)
+    {
+        batch->iovecs[i].iov_base = const_cast<char*>(data);
+        batch->iovecs[i].iov_len = length;
+    }
+
+    int sent = 0;
+
+#ifdef __linux__
+    int index = 0;
+
+    while (index < count)
+    {
+        int retVal = sendmmsg(fd, &batch->messages[index], count - index, MSG_DONTWAIT);
+
+        if (retVal <= 0)
+        {
+            // Skip the failing one (unreachable, buffer full etc.) and try the rest
+            sendFailures++;
+            index++;
+            continue;
+        }
+
+        index += retVal;
+        sent += retVal;
+    }
+#else
+    for (int i = 0; i < count; i++)
+    {
+        if (sendmsg(fd, &batch->messages[i], MSG_DONTWAIT) < 0)
+        {
+            sendFailures++;
+        }
+        else
+        {
+            sent++;
+        }
+    }
+#endif
+
+    publishedFrames++;
+
+    return sent;
+}
+
+#else
+
+struct TelemetryPublisher::Batch
+{
+};
+
+bool TelemetryPublisher::setSubscribers(const std::string& list)
+{
+    (void)list;
+    return false;
+}
+
+void TelemetryPublisher::clearSubscribers(void)
+{
+    delete batch;
+    batch = nullptr;
+}
+
+int TelemetryPublisher::getSubscriberCount(void) const
+{
+    return 0;
+}
+
+void TelemetryPublisher::setMulticastTtl(const int ttl)
+{
+    multicastTtl = ttl;
+}
+
+bool TelemetryPublisher::open(void)
+{
+    return false;
+}
+
+void TelemetryPublisher::close(void)
+{
+}
+
+int TelemetryPublisher::publish(const char* data, const int length)
+{
+    (void)data;
+    (void)length;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*
+    telemetrypublisher.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TELEMETRYPUBLISHER_H
+#define TELEMETRYPUBLISHER_H
+
+#include <cstdint>
+#include <string>
+
+// Sends the same (already encoded) datagram to a list of subscribers
+// (IPv4 unicast and/or multicast groups). The message headers for all
+// subscribers are built when the list is set, so publishing only points
+// one iovec per subscriber to the data and sends them all with one
+// sendmmsg-call (a sendto per subscriber on non-Linux systems).
+// Not available on Windows (open() fails).
+
+class TelemetryPublisher
+{
+public:
+    TelemetryPublisher() {}
+    ~TelemetryPublisher();
+
+    // "host:port" entries separated by spaces, commas or semicolons.
+    // Returns false (and keeps the old list) if any of the entries is invalid.
+    bool setSubscribers(const std::string& list);
+    void clearSubscribers(void);
+    int getSubscriberCount(void) const;
+
+    // Hops for multicast datagrams (default 1 = local network only)
+    void setMulticastTtl(const int ttl);
+
+    bool open(void);
+    void close(void);
+    bool isOpen(void) const { return fd >= 0; }
+
+    // True if there's someone to publish to
+    bool isActive(void) const { return (fd >= 0) && (getSubscriberCount() != 0); }
+
+    // Returns the number of subscribers the datagram was sent to
+    int publish(const char* data, const int length);
+
+    uint64_t getPublishedFrames(void) const { return publishedFrames; }
+    uint64_t getSendFailures(void) const { return sendFailures; }
+
+private:
+    struct Batch;
+
+    Batch* batch = nullptr;
+    int fd = -1;
+    int multicastTtl = 1;
+    uint64_t publishedFrames = 0;
+    uint64_t sendFailures = 0;
+
+    // Not copyable
+    TelemetryPublisher(const TelemetryPublisher&);
+    TelemetryPublisher& operator=(const TelemetryPublisher&);
+};
+
+#endif // TELEMETRYPUBLISHER_H
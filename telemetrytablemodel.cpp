@@ -0,0 +1,351 @@
+/*
+    telemetrytablemodel.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <limits>
+#include <QDateTime>
+#include "telemetrytablemodel.h"
+
+static const char* const columnNames[TelemetryTableModel::COLUMN_COUNT] =
+{
+    "Time",
+    "Vessel",
+    "Seq",
+    "N",
+    "E",
+    "D",
+    "Heading",
+    "Pitch",
+    "Roll",
+    "Dir front",
+    "Power front",
+    "Dir back",
+    "Power back",
+    "Distance",
+    "Hdg error",
+    "Speed",
+    "State"
+};
+
+TelemetryTableModel::TelemetryTableModel(const int capacity, QObject* parent) :
+    QAbstractTableModel(parent),
+    records(capacity > 0 ? capacity : 1)
+{
+
+}
+
+void TelemetryTableModel::append(const TelemetryRecord& record)
+{
+    records[appended % records.size()] = record;
+    appended++;
+}
+
+quint64 TelemetryTableModel::getOldestIndex(void) const
+{
+    return (appended > records.size()) ? (appended - records.size()) : 0;
+}
+
+int TelemetryTableModel::getRecordCount(void) const
+{
+    return static_cast<int>(appended - getOldestIndex());
+}
+
+bool TelemetryTableModel::refresh(void)
+{
+    const quint64 oldest = getOldestIndex();
+
+    // Overwritten records first (rows are in the order of the indices)
+    int removeCount = 0;
+
+    while ((removeCount < static_cast<int>(rows.size())) && (rows[removeCount] < oldest))
+    {
+        removeCount++;
+    }
+
+    if (removeCount > 0)
+    {
+        beginRemoveRows(QModelIndex(), 0, removeCount - 1);
+        rows.erase(rows.begin(), rows.begin() + removeCount);
+        endRemoveRows();
+    }
+
+    if (indexed < oldest)
+    {
+        indexed = oldest;
+    }
+
+    std::vector<quint64> newRows;
+
+    for (; indexed < appended; indexed++)
+    {
+        if (matches(getRecord(indexed)))
+        {
+            newRows.push_back(indexed);
+        }
+    }
+
+    if (newRows.empty())
+    {
+        return false;
+    }
+
+    beginInsertRows(QModelIndex(), static_cast<int>(rows.size()), static_cast<int>(rows.size() + newRows.size() - 1));
+    rows.insert(rows.end(), newRows.begin(), newRows.end());
+    endInsertRows();
+
+    return true;
+}
+
+void TelemetryTableModel::clear(void)
+{
+    beginResetModel();
+    appended = 0;
+    indexed = 0;
+    rows.clear();
+    endResetModel();
+}
+
+bool TelemetryTableModel::setFilter(const int column, const QString& expression)
+{
+    if ((column < 0) || (column >= COLUMN_COUNT) || (column == COLUMN_TIME))
+    {
+        return false;
+    }
+
+    Filter filter;
+    const QString trimmed = expression.trimmed();
+
+    if (!trimmed.isEmpty())
+    {
+        bool ok1 = true;
+        bool ok2 = true;
+        const int rangeSeparator = trimmed.indexOf("..");
+
+        if (rangeSeparator >= 0)
+        {
+            filter.min = trimmed.left(rangeSeparator).toDouble(&ok1);
+            filter.max = trimmed.mid(rangeSeparator + 2).toDouble(&ok2);
+        }
+        else if (trimmed.startsWith('>'))
+        {
+            filter.min = trimmed.mid(1).toDouble(&ok1);
+            filter.max = std::numeric_limits<double>::infinity();
+        }
+        else if (trimmed.startsWith('<'))
+        {
+            filter.min = -std::numeric_limits<double>::infinity();
+            filter.max = trimmed.mid(1).toDouble(&ok1);
+        }
+        else
+        {
+            filter.min = trimmed.toDouble(&ok1);
+            filter.max = filter.min;
+        }
+
+        if (!ok1 || !ok2 || (filter.min > filter.max))
+        {
+            return false;
+        }
+
+        filter.active = true;
+        filter.expression = trimmed;
+    }
+
+    filters[column] = filter;
+    rebuildRows();
+    emit headerDataChanged(Qt::Horizontal, column, column);
+
+    return true;
+}
+
+void TelemetryTableModel::clearFilters(void)
+{
+    for (Filter& filter : filters)
+    {
+        filter = Filter();
+    }
+
+    rebuildRows();
+    emit headerDataChanged(Qt::Horizontal, 0, COLUMN_COUNT - 1);
+}
+
+void TelemetryTableModel::rebuildRows(void)
+{
+    beginResetModel();
+
+    rows.clear();
+
+    for (indexed = getOldestIndex(); indexed < appended; indexed++)
+    {
+        if (matches(getRecord(indexed)))
+        {
+            rows.push_back(indexed);
+        }
+    }
+
+    endResetModel();
+}
+
+double TelemetryTableModel::getValue(const TelemetryRecord& record, const int column)
+{
+    const double notAvailable = std::numeric_limits<double>::quiet_NaN();
+
+    switch (column)
+    {
+    case COLUMN_TIME:
+        return record.time;
+    case COLUMN_VESSEL:
+        return record.vessel;
+    case COLUMN_SEQUENCE:
+        return (record.sequence >= 0) ? record.sequence : notAvailable;
+    case COLUMN_N:
+        return record.coord_N;
+    case COLUMN_E:
+        return record.coord_E;
+    case COLUMN_D:
+        return record.coord_D;
+    case COLUMN_HEADING:
+        return record.heading;
+    case COLUMN_PITCH:
+        return record.pitch;
+    case COLUMN_ROLL:
+        return record.roll;
+    case COLUMN_DIRECTION_FRONT:
+        return record.hasOutputs ? record.direction_Front : notAvailable;
+    case COLUMN_POWER_FRONT:
+        return record.hasOutputs ? record.propulsion_Front : notAvailable;
+    case COLUMN_DIRECTION_BACK:
+        return record.hasOutputs ? record.direction_Back : notAvailable;
+    case COLUMN_POWER_BACK:
+        return record.hasOutputs ? record.propulsion_Back : notAvailable;
+    case COLUMN_DISTANCE:
+        return record.hasDebug ? record.distanceToTarget : notAvailable;
+    case COLUMN_HEADING_ERROR:
+        return record.hasDebug ? record.headingError : notAvailable;
+    case COLUMN_SPEED:
+        return record.hasDebug ? record.speed : notAvailable;
+    case COLUMN_STATE:
+        return record.hasDebug ? record.state : notAvailable;
+    default:
+        return notAvailable;
+    }
+}
+
+bool TelemetryTableModel::matches(const TelemetryRecord& record) const
+{
+    for (int column = 0; column < COLUMN_COUNT; column++)
+    {
+        if (filters[column].active)
+        {
+            // NaN (value not available) never matches
+            const double value = getValue(record, column);
+
+            if (!((value >= filters[column].min) && (value <= filters[column].max)))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int TelemetryTableModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(rows.size());
+}
+
+int TelemetryTableModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : COLUMN_COUNT;
+}
+
+QVariant TelemetryTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || (index.row() >= static_cast<int>(rows.size())))
+    {
+        return QVariant();
+    }
+
+    if (role == Qt::TextAlignmentRole)
+    {
+        return static_cast<int>((index.column() == COLUMN_TIME) ? (Qt::AlignLeft | Qt::AlignVCenter) : (Qt::AlignRight | Qt::AlignVCenter));
+    }
+
+    if (role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+
+    const quint64 recordIndex = rows[index.row()];
+
+    if (recordIndex < getOldestIndex())
+    {
+        // Already overwritten, row removed on the next refresh
+        return QVariant();
+    }
+
+    const TelemetryRecord& record = getRecord(recordIndex);
+
+    if (index.column() == COLUMN_TIME)
+    {
+        return QDateTime::fromMSecsSinceEpoch(record.time).toString("hh:mm:ss:zzz");
+    }
+
+    const double value = getValue(record, index.column());
+
+    if (std::isnan(value))
+    {
+        return QString();
+    }
+
+    switch (index.column())
+    {
+    case COLUMN_VESSEL:
+    case COLUMN_SEQUENCE:
+    case COLUMN_STATE:
+        return QString::number(static_cast<qint64>(value));
+    case COLUMN_N:
+    case COLUMN_E:
+    case COLUMN_DISTANCE:
+        return QString::number(value, 'f', 3);
+    case COLUMN_POWER_FRONT:
+    case COLUMN_POWER_BACK:
+        return QString::number(value, 'f', 1);
+    default:
+        return QString::number(value, 'f', 2);
+    }
+}
+
+QVariant TelemetryTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if ((role != Qt::DisplayRole) || (orientation != Qt::Horizontal) ||
+            (section < 0) || (section >= COLUMN_COUNT))
+    {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+
+    QString name = columnNames[section];
+
+    if (filters[section].active)
+    {
+        name += " *";
+    }
+
+    return name;
+}
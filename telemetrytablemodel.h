@@ -0,0 +1,142 @@
+/*
+    telemetrytablemodel.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TELEMETRYTABLEMODEL_H
+#define TELEMETRYTABLEMODEL_H
+
+#include <vector>
+#include <deque>
+#include <QAbstractTableModel>
+
+// One processed sample (angles in degrees)
+struct TelemetryRecord
+{
+    qint64 time;                // ms since epoch
+    int vessel;
+    qint64 sequence;
+    double coord_N;
+    double coord_E;
+    double coord_D;
+    double heading;
+    double pitch;
+    double roll;
+
+    bool hasOutputs;            // Autopilot active
+    double direction_Front;
+    double propulsion_Front;
+    double direction_Back;
+    double propulsion_Back;
+
+    bool hasDebug;              // Autopilot debug outputs calculated
+    double distanceToTarget;
+    double headingError;
+    double speed;
+    int state;
+};
+
+// Table of the latest processed samples. Records are kept in a ring buffer
+// allocated when constructing (oldest ones are overwritten). Appending only
+// stores the record, the view is updated by refresh() (call it at the rate
+// the table should be updated). Text is formatted only for the rows the view
+// asks for (i.e. the visible ones).
+//
+// Rows can be filtered by the values of the columns (all filters need to match):
+// "value", ">value", "<value" or "min..max" (inclusive), e.g. vessel "3" or
+// distance "0..20".
+
+class TelemetryTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        COLUMN_TIME = 0,
+        COLUMN_VESSEL,
+        COLUMN_SEQUENCE,
+        COLUMN_N,
+        COLUMN_E,
+        COLUMN_D,
+        COLUMN_HEADING,
+        COLUMN_PITCH,
+        COLUMN_ROLL,
+        COLUMN_DIRECTION_FRONT,
+        COLUMN_POWER_FRONT,
+        COLUMN_DIRECTION_BACK,
+        COLUMN_POWER_BACK,
+        COLUMN_DISTANCE,
+        COLUMN_HEADING_ERROR,
+        COLUMN_SPEED,
+        COLUMN_STATE,
+
+        COLUMN_COUNT
+    };
+
+    explicit TelemetryTableModel(const int capacity = 100000, QObject* parent = nullptr);
+
+    void append(const TelemetryRecord& record);
+
+    // Shows the records appended since the previous call and removes the overwritten ones
+    // (one insert and one remove at most). Returns true if rows were added.
+    bool refresh(void);
+
+    void clear(void);
+
+    // Empty expression clears the filter of the column. Returns false if the expression
+    // is invalid (or the column can't be filtered), the filter is not changed then.
+    bool setFilter(const int column, const QString& expression);
+    void clearFilters(void);
+    bool isFiltered(const int column) const { return filters[column].active; }
+    QString getFilter(const int column) const { return filters[column].expression; }
+
+    // Records in the buffer (not only the shown ones)
+    int getRecordCount(void) const;
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    struct Filter
+    {
+        bool active = false;
+        QString expression;
+        double min;
+        double max;
+    };
+
+    std::vector<TelemetryRecord> records;
+    quint64 appended = 0;       // Total number of records appended (index of the next one)
+    quint64 indexed = 0;        // Records checked against the filters so far
+
+    // Indices (total count based) of the shown records, oldest first
+    std::deque<quint64> rows;
+
+    Filter filters[COLUMN_COUNT];
+
+    quint64 getOldestIndex(void) const;
+    const TelemetryRecord& getRecord(const quint64 index) const { return records[index % records.size()]; }
+
+    static double getValue(const TelemetryRecord& record, const int column);
+    bool matches(const TelemetryRecord& record) const;
+
+    void rebuildRows(void);
+};
+
+#endif // TELEMETRYTABLEMODEL_H
@@ -0,0 +1,6 @@
+include(../common.pri)
+
+TARGET = archive
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,317 @@
+/*
+    main.cpp (archive, part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Telemetry archive tool: Converts recordings (.sfcrec) to compressed
+// columnar archives (.sfcarc) and back, and reports the compression ratio
+// and decode throughput of an archive (all columns and selected columns).
+
+#include <string.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTextStream>
+#include "recording.h"
+#include "telemetryarchive.h"
+
+static QString formatRatio(const double raw, const double compressed)
+{
+    return QString::number(compressed > 0 ? raw / compressed : 0, 'f', 2);
+}
+
+static int pack(QTextStream& out, const QString& inFile, const QString& outFile, const unsigned int chunkSize, const bool verify)
+{
+    RecordingReader reader;
+    ArchiveWriter writer;
+
+    if (!reader.open(inFile.toStdString()))
+    {
+        out << "Can't open recording " << inFile << "\n";
+        return 1;
+    }
+
+    if (!writer.open(outFile.toStdString(), chunkSize))
+    {
+        out << "Can't create archive " << outFile << "\n";
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (uint64_t i = 0; i < reader.getRecordCount(); i++)
+    {
+        writer.append(reader.getRecord(i));
+    }
+
+    if (!writer.close())
+    {
+        out << "Writing archive " << outFile << " failed\n";
+        return 1;
+    }
+
+    const double elapsed = timer.nsecsElapsed() * 1e-9;
+    const double rawSize = static_cast<double>(reader.getRecordCount()) * sizeof(RecordingRecord);
+
+    out << "Packed " << reader.getRecordCount() << " records: " << QString::number(rawSize, 'f', 0) << " -> " <<
+           writer.getBytesWritten() << " bytes (ratio " << formatRatio(rawSize, writer.getBytesWritten()) << "), " <<
+           QString::number(reader.getRecordCount() / elapsed * 1e-6, 'f', 2) << " M records/s\n";
+
+    if (!verify)
+    {
+        return 0;
+    }
+
+    ArchiveReader archive;
+    std::vector<RecordingRecord> records;
+    uint64_t record = 0;
+    uint64_t mismatches = 0;
+
+    if (!archive.open(outFile.toStdString()))
+    {
+        out << "Can't open archive " << outFile << "\n";
+        return 1;
+    }
+
+    for (size_t chunk = 0; chunk < archive.getChunkCount(); chunk++)
+    {
+        if (!archive.readRecords(chunk, records))
+        {
+            out << "Decoding chunk " << chunk << " failed\n";
+            return 1;
+        }
+
+        for (const RecordingRecord& decoded : records)
+        {
+            mismatches += (memcmp(&decoded, &reader.getRecord(record++), sizeof(RecordingRecord)) != 0);
+        }
+    }
+
+    out << "Verified " << record << " records, mismatches: " << mismatches << "\n";
+
+    return ((mismatches == 0) && (record == reader.getRecordCount())) ? 0 : 1;
+}
+
+static int unpack(QTextStream& out, const QString& inFile, const QString& outFile)
+{
+    ArchiveReader reader;
+    RecordingWriter writer;
+    std::vector<RecordingRecord> records;
+
+    if (!reader.open(inFile.toStdString()))
+    {
+        out << "Can't open archive " << inFile << "\n";
+        return 1;
+    }
+
+    if (!writer.open(outFile.toStdString()))
+    {
+        out << "Can't create recording " << outFile << "\n";
+        return 1;
+    }
+
+    for (size_t chunk = 0; chunk < reader.getChunkCount(); chunk++)
+    {
+        if (!reader.readRecords(chunk, records))
+        {
+            out << "Decoding chunk " << chunk << " failed\n";
+            return 1;
+        }
+
+        for (const RecordingRecord& record : records)
+        {
+            if (!writer.append(record))
+            {
+                out << "Writing recording " << outFile << " failed\n";
+                return 1;
+            }
+        }
+    }
+
+    writer.close();
+
+    out << "Unpacked " << writer.getRecordCount() << " records\n";
+
+    return 0;
+}
+
+static int info(QTextStream& out, const QString& inFile, const QStringList& columnNames)
+{
+    ArchiveReader reader;
+
+    if (!reader.open(inFile.toStdString()))
+    {
+        out << "Can't open archive " << inFile << "\n";
+        return 1;
+    }
+
+    std::vector<int> selectedColumns;
+
+    for (const QString& name : columnNames)
+    {
+        const int column = TelemetryArchive::findColumn(name.toStdString());
+
+        if (column < 0)
+        {
+            out << "Unknown column " << name << "\n";
+            return 1;
+        }
+
+        selectedColumns.push_back(column);
+    }
+
+    const uint64_t recordCount = reader.getRecordCount();
+    const double rawSize = static_cast<double>(recordCount) * sizeof(RecordingRecord);
+    const double fileSize = QFileInfo(inFile).size();
+
+    out << recordCount << " records in " << reader.getChunkCount() << " chunks\n";
+
+    if (recordCount == 0)
+    {
+        return 0;
+    }
+
+    out << "Size: " << QString::number(fileSize, 'f', 0) << " bytes, as a recording: " << QString::number(rawSize, 'f', 0) <<
+           " bytes (ratio " << formatRatio(rawSize, fileSize) << ")\n\n";
+
+    // Compressed size per column
+    out << QString("Column").leftJustified(20) << "bits/value\tratio\n";
+
+    for (int column = 0; column < TelemetryArchive::COLUMN_COUNT; column++)
+    {
+        uint64_t bytes = 0;
+
+        for (size_t chunk = 0; chunk < reader.getChunkCount(); chunk++)
+        {
+            bytes += reader.getChunk(chunk).columnSizes[column];
+        }
+
+        const int rawBits = (column == TelemetryArchive::COLUMN_VESSEL) || (column == TelemetryArchive::COLUMN_FLAGS) ? 32 : 64;
+
+        out << QString::fromStdString(TelemetryArchive::getColumnName(column)).leftJustified(20) <<
+               QString::number(bytes * 8. / recordCount, 'f', 2) << "\t\t" <<
+               formatRatio(rawBits * recordCount, bytes * 8.) << "\n";
+    }
+
+    // Decode throughput (includes reading the file, usually from the page cache)
+    std::vector<RecordingRecord> records;
+    QElapsedTimer timer;
+    timer.start();
+
+    for (size_t chunk = 0; chunk < reader.getChunkCount(); chunk++)
+    {
+        if (!reader.readRecords(chunk, records))
+        {
+            out << "Decoding chunk " << chunk << " failed\n";
+            return 1;
+        }
+    }
+
+    double elapsed = timer.nsecsElapsed() * 1e-9;
+
+    out << "\nDecode, all columns: " << QString::number(recordCount / elapsed * 1e-6, 'f', 2) << " M records/s (" <<
+           QString::number(rawSize / elapsed * 1e-6, 'f', 0) << " MB/s as records)\n";
+
+    if (selectedColumns.empty())
+    {
+        return 0;
+    }
+
+    std::vector<int64_t> integers;
+    std::vector<double> doubles;
+    uint64_t selectedBytes = 0;
+
+    timer.start();
+
+    for (size_t chunk = 0; chunk < reader.getChunkCount(); chunk++)
+    {
+        for (int column : selectedColumns)
+        {
+            const bool ok = TelemetryArchive::isIntegerColumn(column) ?
+                        reader.readColumn(chunk, column, integers) : reader.readColumn(chunk, column, doubles);
+
+            if (!ok)
+            {
+                out << "Decoding chunk " << chunk << " failed\n";
+                return 1;
+            }
+
+            selectedBytes += reader.getChunk(chunk).columnSizes[column];
+        }
+    }
+
+    elapsed = timer.nsecsElapsed() * 1e-9;
+
+    out << "Decode, " << selectedColumns.size() << " column(s): " << QString::number(recordCount / elapsed * 1e-6, 'f', 2) <<
+           " M records/s (" << QString::number(recordCount * selectedColumns.size() / elapsed * 1e-6, 'f', 1) <<
+           " M values/s, " << selectedBytes << " bytes read)\n";
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("archive");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Converts recordings to compressed telemetry archives and back.\n\n"
+                                     "archive pack <recording.sfcrec> <archive.sfcarc>\n"
+                                     "archive unpack <archive.sfcarc> <recording.sfcrec>\n"
+                                     "archive info <archive.sfcarc>");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "pack, unpack or info.");
+    parser.addPositionalArgument("files", "Input (and output) file.");
+
+    QCommandLineOption chunkSizeOption("chunk-size", "Records per chunk (pack).", "count", "4096");
+    QCommandLineOption verifyOption("verify", "Check that the archive decodes to the recording (pack).");
+    QCommandLineOption columnsOption("columns", "Comma separated columns to measure decoding of (info), e.g. time,antennaA_x.", "columns");
+
+    parser.addOptions({ chunkSizeOption, verifyOption, columnsOption });
+    parser.process(app);
+
+    QTextStream out(stdout);
+    const QStringList arguments = parser.positionalArguments();
+    const QString command = arguments.value(0);
+
+    if ((command == "pack") && (arguments.size() == 3))
+    {
+        return pack(out, arguments[1], arguments[2], parser.value(chunkSizeOption).toUInt(), parser.isSet(verifyOption));
+    }
+    else if ((command == "unpack") && (arguments.size() == 3))
+    {
+        return unpack(out, arguments[1], arguments[2]);
+    }
+    else if ((command == "info") && (arguments.size() == 2))
+    {
+        QStringList columns;
+
+        // QString::SkipEmptyParts is deprecated in Qt 5.15 (Qt::SkipEmptyParts needs 5.14)
+        for (const QString& column : parser.value(columnsOption).split(','))
+        {
+            if (!column.isEmpty())
+            {
+                columns.append(column);
+            }
+        }
+
+        return info(out, arguments[1], columns);
+    }
+
+    parser.showHelp(1);
+}
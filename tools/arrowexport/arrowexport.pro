@@ -0,0 +1,6 @@
+include(../common.pri)
+
+TARGET = arrowexport
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,529 @@
+/*
+    main.cpp (arrowexport, part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Arrow export: Converts a recording (.sfcrec) or an archive (.sfcarc) to an
+// Arrow IPC file for analysis (pandas.read_feather, polars, DuckDB etc.).
+// Values are exported at full precision, with the pose (position, orientation
+// quaternion and yaw/pitch/roll) solved by LOSolver from the recorded points.
+//
+// Records are converted in batches (one Arrow record batch each), so memory use
+// doesn't depend on the length of the recording. Columns of a batch are filled
+// on all cores (threads of a WorkerPool, kept for all batches): Pose is solved in
+// slices of rows, other columns one column per task.
+
+#include <algorithm>
+#include <string.h>
+#include <math.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include "arrowwriter.h"
+#include "ferrymodel.h"
+#include "posesolver.h"
+#include "recording.h"
+#include "telemetryarchive.h"
+#include "workerpool.h"
+
+// Reads records from a recording or an archive
+class RecordSource
+{
+public:
+    bool open(const std::string& fileName)
+    {
+        archiveChunk = 0;
+        pendingPosition = 0;
+        pending.clear();
+        nextRecord = 0;
+
+        if (archive.open(fileName))
+        {
+            recordCount = archive.getRecordCount();
+            return true;
+        }
+
+        if (recording.open(fileName))
+        {
+            recordCount = recording.getRecordCount();
+            return true;
+        }
+
+        return false;
+    }
+
+    uint64_t getRecordCount(void) const { return recordCount; }
+
+    // Returns false on decoding error. Empty records = end.
+    bool read(std::vector<RecordingRecord>& records, const size_t maxRecords)
+    {
+        records.clear();
+
+        if (recording.isOpen())
+        {
+            const uint64_t first = nextRecord;
+
+            while ((records.size() < maxRecords) && (nextRecord < recordCount))
+            {
+                records.push_back(recording.getRecord(nextRecord++));
+            }
+
+            // Copied, keeps the memory use bounded with multi-GB recordings
+            recording.release(first, nextRecord - first);
+
+            return true;
+        }
+
+        while (records.size() < maxRecords)
+        {
+            if (pendingPosition >= pending.size())
+            {
+                if (archiveChunk >= archive.getChunkCount())
+                {
+                    break;
+                }
+
+                if (!archive.readRecords(archiveChunk++, pending))
+                {
+                    return false;
+                }
+
+                pendingPosition = 0;
+            }
+
+            const size_t count = std::min(maxRecords - records.size(), pending.size() - pendingPosition);
+
+            records.insert(records.end(), pending.begin() + pendingPosition, pending.begin() + pendingPosition + count);
+            pendingPosition += count;
+        }
+
+        return true;
+    }
+
+private:
+    RecordingReader recording;
+    ArchiveReader archive;
+    uint64_t recordCount = 0;
+    uint64_t nextRecord = 0;
+
+    size_t archiveChunk = 0;
+    std::vector<RecordingRecord> pending;
+    size_t pendingPosition = 0;
+};
+
+// Source of an exported column
+enum ColumnSource
+{
+    SOURCE_TIME,
+    SOURCE_SEQUENCE,
+    SOURCE_VESSEL,
+    SOURCE_POINT,           // index: 0..17
+    SOURCE_DESTINATION,     // index: 0..2
+    SOURCE_OUTPUT,          // index: 0..3
+    SOURCE_DEBUG,           // index: 0..5
+    SOURCE_STATE,
+    SOURCE_POSE             // index: see poseColumnNames
+};
+
+struct ExportColumn
+{
+    ColumnSource source;
+    int index;
+    ArrowWriter::Field field;
+};
+
+static const char* const poseColumnNames[] =
+{
+    "pose_N", "pose_E", "pose_D", "pose_qw", "pose_qx", "pose_qy", "pose_qz", "heading", "pitch", "roll"
+};
+
+static const int poseColumnCount = sizeof(poseColumnNames) / sizeof(poseColumnNames[0]);
+
+static std::vector<ExportColumn> getExportColumns(const bool pose)
+{
+    std::vector<ExportColumn> columns;
+
+    columns.push_back({ SOURCE_TIME, 0, { "time", ArrowWriter::TYPE_TIMESTAMP_NS, false } });
+    columns.push_back({ SOURCE_SEQUENCE, 0, { "sequence", ArrowWriter::TYPE_INT64, true } });
+    columns.push_back({ SOURCE_VESSEL, 0, { "vessel", ArrowWriter::TYPE_INT32, false } });
+
+    // Same names as in the archive
+    for (int i = 0; i < 18; i++)
+    {
+        columns.push_back({ SOURCE_POINT, i, { TelemetryArchive::getColumnName(TelemetryArchive::COLUMN_POINTS + i), ArrowWriter::TYPE_FLOAT64, false } });
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        columns.push_back({ SOURCE_DESTINATION, i, { TelemetryArchive::getColumnName(TelemetryArchive::COLUMN_DESTINATION + i), ArrowWriter::TYPE_FLOAT64, false } });
+    }
+
+    if (pose)
+    {
+        for (int i = 0; i < poseColumnCount; i++)
+        {
+            columns.push_back({ SOURCE_POSE, i, { poseColumnNames[i], ArrowWriter::TYPE_FLOAT64, true } });
+        }
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        columns.push_back({ SOURCE_OUTPUT, i, { TelemetryArchive::getColumnName(TelemetryArchive::COLUMN_OUTPUTS + i), ArrowWriter::TYPE_FLOAT64, true } });
+    }
+
+    for (int i = 0; i < 6; i++)
+    {
+        columns.push_back({ SOURCE_DEBUG, i, { TelemetryArchive::getColumnName(TelemetryArchive::COLUMN_DEBUG + i), ArrowWriter::TYPE_FLOAT64, true } });
+    }
+
+    columns.push_back({ SOURCE_STATE, 0, { "state", ArrowWriter::TYPE_INT32, true } });
+
+    return columns;
+}
+
+template <typename T>
+static inline void setValue(ArrowWriter::Column& column, const size_t row, const T value)
+{
+    memcpy(&column.values[row * sizeof(T)], &value, sizeof(T));
+}
+
+static inline void setValid(ArrowWriter::Column& column, const size_t row)
+{
+    column.validity[row / 8] |= static_cast<uint8_t>(1 << (row % 8));
+}
+
+// Fills a non-pose column for all rows
+static void fillColumn(const ExportColumn& exportColumn, const std::vector<RecordingRecord>& records, ArrowWriter::Column& column)
+{
+    int64_t nullCount = 0;
+
+    for (size_t row = 0; row < records.size(); row++)
+    {
+        const RecordingRecord& record = records[row];
+        bool valid = true;
+
+        switch (exportColumn.source)
+        {
+        case SOURCE_TIME:
+            setValue<int64_t>(column, row, record.time);
+            break;
+        case SOURCE_SEQUENCE:
+            valid = (record.sequence >= 0);
+            setValue<int64_t>(column, row, valid ? record.sequence : 0);
+            break;
+        case SOURCE_VESSEL:
+            setValue<int32_t>(column, row, record.vessel);
+            break;
+        case SOURCE_POINT:
+            setValue<double>(column, row, record.points[exportColumn.index]);
+            break;
+        case SOURCE_DESTINATION:
+            setValue<double>(column, row, record.destination[exportColumn.index]);
+            break;
+        case SOURCE_OUTPUT:
+            valid = (record.flags & RecordingRecord::FLAG_OUTPUTS);
+            setValue<double>(column, row, valid ? record.outputs[exportColumn.index] : 0);
+            break;
+        case SOURCE_DEBUG:
+            valid = (record.flags & RecordingRecord::FLAG_DEBUG);
+            setValue<double>(column, row, valid ? record.debug[exportColumn.index] : 0);
+            break;
+        case SOURCE_STATE:
+            valid = (record.flags & RecordingRecord::FLAG_DEBUG);
+            setValue<int32_t>(column, row, valid ? static_cast<int32_t>(record.debug[6]) : 0);
+            break;
+        case SOURCE_POSE:
+            break;
+        }
+
+        if (valid)
+        {
+            setValid(column, row);
+        }
+        else
+        {
+            nullCount++;
+        }
+    }
+
+    column.nullCount = nullCount;
+}
+
+// Pose columns of a record
+static bool solvePose(PoseSolver& solver, const RecordingRecord& record, double pose[poseColumnCount])
+{
+    PoseSolver::Pose solved;
+
+    if (!solver.solve(&record.points[0], &record.points[3 * 3], solved))
+    {
+        return false;
+    }
+
+    pose[0] = solved.position_NED(0);
+    pose[1] = solved.position_NED(1);
+    pose[2] = solved.position_NED(2);
+    pose[3] = solved.orientation_NED.w();
+    pose[4] = solved.orientation_NED.x();
+    pose[5] = solved.orientation_NED.y();
+    pose[6] = solved.orientation_NED.z();
+    pose[7] = solved.heading;
+    pose[8] = solved.pitch;
+    pose[9] = solved.roll;
+
+    return true;
+}
+
+// Solves the poses of the built-in ferry model at different headings and compares
+// them to FerryModel::getTransform_NED (and the heading to the model's state).
+// Returns false if they differ.
+static bool checkPoses(QTextStream& out)
+{
+    FerryModel model(FerryModel::getDefaultParameters());
+    PoseSolver solver;
+    RecordingRecord record;
+    double maxPositionError = 0;
+    double maxOrientationError = 0;
+    double maxHeadingError = 0;
+    bool solved = true;
+
+    memset(&record, 0, sizeof(record));
+
+    for (int i = 0; i < 360; i++)
+    {
+        const FerryModel::State state = { 100 * cos(i * 0.1), -50 * sin(i * 0.3), i * (M_PI / 180) - M_PI, 0, 0, 0 };
+        double pose[poseColumnCount];
+
+        model.setState(state);
+        model.getDatagramValues(record.points);
+
+        if (!solvePose(solver, record, pose))
+        {
+            solved = false;
+            break;
+        }
+
+        const Eigen::Transform<double, 3, Eigen::Affine> expected = model.getTransform_NED();
+        const Eigen::Quaterniond expectedOrientation(expected.linear());
+        const Eigen::Quaterniond orientation(pose[3], pose[4], pose[5], pose[6]);
+        const double expectedHeading = fmod(state.heading + 2 * M_PI, 2 * M_PI);
+        double heading, pitch, roll;
+
+        // Heading of the solver and of the quaternion (as ReplayWindow shows it)
+        PoseSolver::getHeadingPitchRoll(orientation, heading, pitch, roll);
+
+        const double headingError = std::max(fabs(pose[7] - expectedHeading), fabs(heading - expectedHeading));
+
+        maxPositionError = std::max(maxPositionError, (Eigen::Vector3d(pose[0], pose[1], pose[2]) - expected.translation()).norm());
+        maxOrientationError = std::max(maxOrientationError, expectedOrientation.angularDistance(orientation));
+        maxHeadingError = std::max(maxHeadingError, std::min(headingError, 2 * M_PI - headingError));
+    }
+
+    const bool ok = solved && (maxPositionError < 1e-6) && (maxOrientationError < 1e-6) && (maxHeadingError < 1e-6);
+
+    out << "Pose check against FerryModel::getTransform_NED: " << (ok ? "ok" : "FAILED") <<
+           (solved ? "" : " (solving failed)") << ", max errors: position " << QString::number(maxPositionError, 'g', 3) <<
+           " m, orientation " << QString::number(maxOrientationError, 'g', 3) <<
+           " rad, heading " << QString::number(maxHeadingError, 'g', 3) << " rad\n";
+
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("arrowexport");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Exports a recording (.sfcrec) or an archive (.sfcarc) to an Arrow IPC (Feather V2) file.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("input", "Recording or archive.");
+    parser.addPositionalArgument("output", "Arrow file (.arrow / .feather).");
+
+    QCommandLineOption batchRowsOption("batch-rows", "Rows per record batch.", "count", "65536");
+    QCommandLineOption threadsOption("threads", "Number of threads (0 = all cores).", "count", "0");
+    QCommandLineOption noPoseOption("no-pose", "Don't solve and export the pose.");
+    QCommandLineOption checkOption("check", "Check the pose against the built-in ferry model and exit.");
+
+    parser.addOptions({ batchRowsOption, threadsOption, noPoseOption, checkOption });
+    parser.process(app);
+
+    QTextStream out(stdout);
+    const QStringList arguments = parser.positionalArguments();
+
+    if (parser.isSet(checkOption))
+    {
+        return checkPoses(out) ? 0 : 1;
+    }
+
+    if (arguments.size() != 2)
+    {
+        parser.showHelp(1);
+    }
+
+    WorkerPool workerPool(parser.value(threadsOption).toUInt());
+    const unsigned int threadCount = workerPool.getThreadCount();
+
+    // Multiple of 8, so that pose slices don't share validity bytes
+    size_t batchRows = parser.value(batchRowsOption).toUInt();
+    batchRows = (batchRows < 8) ? 8 : (batchRows & ~static_cast<size_t>(7));
+
+    const size_t poseSliceRows = 1024;
+
+    RecordSource source;
+
+    if (!source.open(arguments[0].toStdString()))
+    {
+        out << "Can't open " << arguments[0] << "\n";
+        return 1;
+    }
+
+    const std::vector<ExportColumn> exportColumns = getExportColumns(!parser.isSet(noPoseOption));
+    std::vector<ArrowWriter::Field> fields;
+    int firstPoseColumn = -1;
+
+    for (size_t i = 0; i < exportColumns.size(); i++)
+    {
+        fields.push_back(exportColumns[i].field);
+
+        if ((exportColumns[i].source == SOURCE_POSE) && (firstPoseColumn < 0))
+        {
+            firstPoseColumn = static_cast<int>(i);
+        }
+    }
+
+    ArrowWriter writer;
+
+    if (!writer.open(arguments[1].toStdString(), fields))
+    {
+        out << "Can't create " << arguments[1] << "\n";
+        return 1;
+    }
+
+    std::vector<RecordingRecord> records;
+    std::vector<ArrowWriter::Column> columns(exportColumns.size());
+    std::vector<PoseSolver> solvers(threadCount);
+    uint64_t rowsWritten = 0;
+    int batchCount = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while (true)
+    {
+        if (!source.read(records, batchRows))
+        {
+            out << "Decoding " << arguments[0] << " failed\n";
+            return 1;
+        }
+
+        if (records.empty())
+        {
+            break;
+        }
+
+        const size_t rows = records.size();
+
+        for (size_t i = 0; i < columns.size(); i++)
+        {
+            columns[i].values.resize(rows * ArrowWriter::getTypeSize(fields[i].type));
+            columns[i].validity.assign((rows + 7) / 8, 0);
+        }
+
+        // Tasks: Pose slices first (the heavier ones), then the other columns
+        const size_t poseTasks = (firstPoseColumn >= 0) ? (rows + poseSliceRows - 1) / poseSliceRows : 0;
+        const size_t taskCount = poseTasks + exportColumns.size() - (firstPoseColumn >= 0 ? poseColumnCount : 0);
+        std::vector<int64_t> poseNulls(poseTasks, 0);
+
+        workerPool.run(taskCount, [&](size_t task, unsigned int threadIndex)
+        {
+            if (task < poseTasks)
+            {
+                const size_t lastRow = std::min(rows, (task + 1) * poseSliceRows);
+
+                for (size_t row = task * poseSliceRows; row < lastRow; row++)
+                {
+                    double pose[poseColumnCount];
+                    const bool valid = solvePose(solvers[threadIndex], records[row], pose);
+
+                    for (int i = 0; i < poseColumnCount; i++)
+                    {
+                        ArrowWriter::Column& column = columns[firstPoseColumn + i];
+
+                        setValue<double>(column, row, valid ? pose[i] : 0);
+
+                        if (valid)
+                        {
+                            setValid(column, row);
+                        }
+                    }
+
+                    poseNulls[task] += !valid;
+                }
+            }
+            else
+            {
+                // Skipping the pose columns
+                size_t column = task - poseTasks;
+
+                if ((firstPoseColumn >= 0) && (column >= static_cast<size_t>(firstPoseColumn)))
+                {
+                    column += poseColumnCount;
+                }
+
+                fillColumn(exportColumns[column], records, columns[column]);
+            }
+        });
+
+        if (firstPoseColumn >= 0)
+        {
+            int64_t nullCount = 0;
+
+            for (int64_t nulls : poseNulls)
+            {
+                nullCount += nulls;
+            }
+
+            for (int i = 0; i < poseColumnCount; i++)
+            {
+                columns[firstPoseColumn + i].nullCount = nullCount;
+            }
+        }
+
+        if (!writer.writeBatch(static_cast<int64_t>(rows), columns))
+        {
+            out << "Writing " << arguments[1] << " failed\n";
+            return 1;
+        }
+
+        rowsWritten += rows;
+        batchCount++;
+    }
+
+    if (!writer.close())
+    {
+        out << "Writing " << arguments[1] << " failed\n";
+        return 1;
+    }
+
+    const double elapsed = timer.nsecsElapsed() * 1e-9;
+
+    out << "Exported " << rowsWritten << " rows (" << fields.size() << " columns) in " << batchCount << " batches, " <<
+           writer.getBytesWritten() << " bytes, " << QString::number(elapsed, 'f', 2) << " s (" <<
+           QString::number(rowsWritten / elapsed * 1e-6, 'f', 2) << " M rows/s, " << threadCount << " threads)\n";
+
+    return 0;
+}
@@ -0,0 +1,6 @@
+include(../common.pri)
+
+TARGET = calibrate
+
+SOURCES += \
+    main.cpp
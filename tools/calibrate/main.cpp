@@ -0,0 +1,381 @@
+/*
+    main.cpp (calibrate, part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Reference geometry calibration: Estimates the reference points from recorded
+// antenna positions (GeometryCalibrator), starting from roughly known ones.
+//
+// Input (by extension, or --format):
+// - csv: A sample per line, 3N values (antenna points) or 6N (+ reference points,
+//   those of the first sample are the initial guess). Separators: , ; space or tab.
+// - bin: Raw doubles (native byte order), 3N per sample.
+// - sfcrec: Recording (3 antennas, initial guess from the first record of the vessel).
+// --reference gives (or overrides) the initial guess.
+
+#include <algorithm>
+#include <locale.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include "geometrycalibrator.h"
+#include "recording.h"
+
+static bool parseValues(const QString& text, const int count, std::vector<Eigen::Vector3d>& points)
+{
+    const QStringList parts = text.split(',');
+
+    if (parts.size() != count * 3)
+    {
+        return false;
+    }
+
+    points.resize(count);
+
+    for (int i = 0; i < count * 3; i++)
+    {
+        bool ok;
+        points[i / 3](i % 3) = parts[i].toDouble(&ok);
+
+        if (!ok)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Returns the number of values (0 if the line is not numeric)
+static int parseLine(char* line, double* values, const int maxCount)
+{
+    int count = 0;
+    char* position = line;
+
+    while (true)
+    {
+        while ((*position == ',') || (*position == ';') || (*position == ' ') || (*position == '\t') ||
+               (*position == '\r') || (*position == '\n'))
+        {
+            position++;
+        }
+
+        if (*position == '\0')
+        {
+            return count;
+        }
+
+        char* valueEnd;
+        const double value = strtod(position, &valueEnd);
+
+        if ((valueEnd == position) || (count >= maxCount))
+        {
+            return 0;
+        }
+
+        values[count++] = value;
+        position = valueEnd;
+    }
+}
+
+static QString formatPoints(const std::vector<Eigen::Vector3d>& points)
+{
+    QString text;
+
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            if (!text.isEmpty())
+            {
+                text += ",";
+            }
+
+            text += QString::number(points[i](c), 'f', 4);
+        }
+    }
+
+    return text;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("calibrate");
+
+    // QCoreApplication sets the locale from the environment, strtod needs '.'
+    setlocale(LC_NUMERIC, "C");
+
+    GeometryCalibrator::Settings calibratorSettings = GeometryCalibrator::getDefaultSettings();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Estimates the reference points (antenna geometry) from recorded antenna positions.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("input", "Antenna positions (.csv, raw doubles or .sfcrec).");
+
+    QCommandLineOption formatOption("format", "Input format: csv, bin or sfcrec (default: by extension).", "format");
+    QCommandLineOption antennasOption("antennas", "Number of antennas (csv and bin).", "count", "3");
+    QCommandLineOption referenceOption("reference", "Initial reference points (3 comma separated values per antenna).", "values");
+    QCommandLineOption vesselOption("vessel", "Vessel (sfcrec, default: vessel of the first record).", "vessel");
+    QCommandLineOption stepOption("step", "Use every n:th sample.", "n", "1");
+    QCommandLineOption iterationsOption("iterations", "Maximum number of iterations.", "count", QString::number(calibratorSettings.maxIterations));
+    QCommandLineOption huberOption("huber", "Huber threshold (m) for robustness against outliers (0 = off).", "metres", "0");
+
+    parser.addOptions({ formatOption, antennasOption, referenceOption, vesselOption, stepOption, iterationsOption, huberOption });
+    parser.process(app);
+
+    QTextStream out(stdout);
+    const QStringList arguments = parser.positionalArguments();
+
+    if (arguments.size() != 1)
+    {
+        parser.showHelp(1);
+    }
+
+    const QString inFile = arguments[0];
+    QString format = parser.value(formatOption);
+
+    if (format.isEmpty())
+    {
+        format = inFile.endsWith(".sfcrec", Qt::CaseInsensitive) ? "sfcrec" :
+                 (inFile.endsWith(".csv", Qt::CaseInsensitive) || inFile.endsWith(".txt", Qt::CaseInsensitive)) ? "csv" : "bin";
+    }
+
+    const int antennaCount = (format == "sfcrec") ? 3 : parser.value(antennasOption).toInt();
+    const uint64_t step = std::max(1ULL, parser.value(stepOption).toULongLong());
+
+    if (antennaCount < 3)
+    {
+        out << "At least 3 antennas needed\n";
+        return 1;
+    }
+
+    calibratorSettings.maxIterations = parser.value(iterationsOption).toInt();
+    calibratorSettings.huberThreshold = parser.value(huberOption).toDouble();
+
+    GeometryCalibrator calibrator(calibratorSettings, antennaCount);
+    std::vector<Eigen::Vector3d> initialReferencePoints;
+    std::vector<Eigen::Vector3d> points(antennaCount);
+    uint64_t samples = 0;
+    uint64_t rejected = 0;
+
+    if (parser.isSet(referenceOption) && !parseValues(parser.value(referenceOption), antennaCount, initialReferencePoints))
+    {
+        out << "Reference points need " << antennaCount * 3 << " numbers\n";
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (format == "sfcrec")
+    {
+        RecordingReader recording;
+
+        if (!recording.open(inFile.toStdString()))
+        {
+            out << "Can't open recording " << inFile << "\n";
+            return 1;
+        }
+
+        if (recording.getRecordCount() == 0)
+        {
+            out << "Empty recording\n";
+            return 1;
+        }
+
+        const int32_t vessel = parser.isSet(vesselOption) ? parser.value(vesselOption).toInt() : recording.getRecord(0).vessel;
+
+        for (uint64_t i = 0; i < recording.getRecordCount(); i++)
+        {
+            const RecordingRecord& record = recording.getRecord(i);
+
+            if ((i & 0xffff) == 0xffff)
+            {
+                // Records already read aren't needed any more
+                recording.release(i - 0xffff, 0xffff);
+            }
+
+            if (record.vessel != vessel)
+            {
+                continue;
+            }
+
+            if (initialReferencePoints.empty())
+            {
+                for (int point = 0; point < 3; point++)
+                {
+                    initialReferencePoints.push_back(Eigen::Vector3d(&record.points[9 + point * 3]));
+                }
+            }
+
+            if ((samples++ % step) == 0)
+            {
+                for (int point = 0; point < 3; point++)
+                {
+                    points[point] = Eigen::Vector3d(&record.points[point * 3]);
+                }
+
+                rejected += calibrator.addEpoch(points.data()) ? 0 : 1;
+            }
+        }
+
+        out << "Vessel " << vessel << "\n";
+    }
+    else if ((format == "csv") || (format == "bin"))
+    {
+        FILE* file = fopen(inFile.toLocal8Bit().constData(), (format == "csv") ? "r" : "rb");
+
+        if (!file)
+        {
+            out << "Can't open " << inFile << "\n";
+            return 1;
+        }
+
+        std::vector<double> values(antennaCount * 6);
+
+        if (format == "bin")
+        {
+            if (initialReferencePoints.empty())
+            {
+                out << "Raw binary input needs --reference\n";
+                return 1;
+            }
+
+            while (fread(values.data(), sizeof(double), antennaCount * 3, file) == size_t(antennaCount * 3))
+            {
+                if ((samples++ % step) == 0)
+                {
+                    for (int point = 0; point < antennaCount; point++)
+                    {
+                        points[point] = Eigen::Vector3d(&values[point * 3]);
+                    }
+
+                    rejected += calibrator.addEpoch(points.data()) ? 0 : 1;
+                }
+            }
+        }
+        else
+        {
+            char line[4096];
+
+            while (fgets(line, sizeof(line), file))
+            {
+                const int count = parseLine(line, values.data(), antennaCount * 6);
+
+                if ((count != antennaCount * 3) && (count != antennaCount * 6))
+                {
+                    continue;
+                }
+
+                if (initialReferencePoints.empty() && (count == antennaCount * 6))
+                {
+                    for (int point = 0; point < antennaCount; point++)
+                    {
+                        initialReferencePoints.push_back(Eigen::Vector3d(&values[(antennaCount + point) * 3]));
+                    }
+                }
+
+                if ((samples++ % step) == 0)
+                {
+                    for (int point = 0; point < antennaCount; point++)
+                    {
+                        points[point] = Eigen::Vector3d(&values[point * 3]);
+                    }
+
+                    rejected += calibrator.addEpoch(points.data()) ? 0 : 1;
+                }
+            }
+
+            if (initialReferencePoints.empty())
+            {
+                out << "No reference points in the input, use --reference\n";
+                return 1;
+            }
+        }
+
+        fclose(file);
+    }
+    else
+    {
+        out << "Unknown format " << format << "\n";
+        return 1;
+    }
+
+    out << "Samples: " << samples << ", epochs used: " << calibrator.getEpochCount() <<
+           ", rejected (not finite): " << rejected << " (read in " << QString::number(timer.nsecsElapsed() * 1e-9, 'f', 3) << " s)\n";
+    out.flush();
+
+    timer.restart();
+
+    GeometryCalibrator::Result result;
+
+    if (!calibrator.calibrate(initialReferencePoints, result, [&](const GeometryCalibrator::Progress& progress)
+    {
+        out << "Iteration " << progress.iteration << ": RMS error " << QString::number(progress.rmsError * 1000, 'f', 3) <<
+               " mm, point change " << QString::number(progress.pointChange * 1000, 'f', 3) << " mm, lambda " <<
+               QString::number(progress.lambda, 'g', 3) << ", rejected steps " << progress.rejectedSteps << "\n";
+        out.flush();
+    }))
+    {
+        out << "Calibration failed (needs valid initial reference points and at least 2 epochs with non-collinear antennas)\n";
+        return 1;
+    }
+
+    out << (result.converged ? "Converged" : "Not converged") << " in " << result.iterations << " iterations (" <<
+           QString::number(timer.nsecsElapsed() * 1e-9, 'f', 3) << " s), " << calibrator.getEpochCount() << " epochs\n";
+    out << "RMS error (per coordinate): " << QString::number(result.initialRmsError * 1000, 'f', 3) << " mm initially, " <<
+           QString::number(result.rmsError * 1000, 'f', 3) << " mm calibrated\n\n";
+
+    out << "Point  " << QString("Initial x, y, z").leftJustified(30) << QString("Calibrated x, y, z").leftJustified(30) <<
+           "Change (mm)  RMS error (mm)\n";
+
+    for (int i = 0; i < antennaCount; i++)
+    {
+        QString initial;
+        QString calibrated;
+
+        for (int c = 0; c < 3; c++)
+        {
+            initial += QString::number(initialReferencePoints[i](c), 'f', 4).leftJustified(10);
+            calibrated += QString::number(result.referencePoints[i](c), 'f', 4).leftJustified(10);
+        }
+
+        out << QString(1, char('A' + i)).leftJustified(7) << initial << calibrated <<
+               QString::number((result.referencePoints[i] - initialReferencePoints[i]).norm() * 1000, 'f', 1).leftJustified(13) <<
+               QString::number(result.pointRmsErrors[i] * 1000, 'f', 3) << "\n";
+    }
+
+    out << "\nDistances (initial -> calibrated, m):\n";
+
+    for (int i = 0; i < antennaCount; i++)
+    {
+        for (int j = i + 1; j < antennaCount; j++)
+        {
+            out << "  " << char('A' + i) << char('A' + j) << ": " <<
+                   QString::number((initialReferencePoints[j] - initialReferencePoints[i]).norm(), 'f', 4) << " -> " <<
+                   QString::number((result.referencePoints[j] - result.referencePoints[i]).norm(), 'f', 4) << "\n";
+        }
+    }
+
+    out << "\nCalibrated reference points (posesolve --reference): " << formatPoints(result.referencePoints) << "\n";
+
+    return 0;
+}
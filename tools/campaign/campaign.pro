@@ -0,0 +1,6 @@
+include(../common.pri)
+
+TARGET = campaign
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,178 @@
+/*
+    main.cpp (campaign, part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Monte Carlo mission campaign: Runs a number of seeded random missions
+// through the closed loop simulation (FerryModel + LOSolver + Autopilot)
+// on all cores and reports KPIs per mission and as a summary.
+
+#include <algorithm>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include "missionsimulator.h"
+
+static double percentile(std::vector<double> values, const double fraction)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+
+    std::sort(values.begin(), values.end());
+    return values[static_cast<size_t>(fraction * (values.size() - 1) + 0.5)];
+}
+
+static void printStatistics(QTextStream& out, const QString& name, const std::vector<double>& values)
+{
+    double sum = 0;
+
+    for (double value : values)
+    {
+        sum += value;
+    }
+
+    out << name.leftJustified(16) <<
+           "mean: " << QString::number(values.empty() ? 0 : sum / values.size(), 'f', 3) <<
+           "\tp50: " << QString::number(percentile(values, 0.5), 'f', 3) <<
+           "\tp95: " << QString::number(percentile(values, 0.95), 'f', 3) <<
+           "\tmax: " << QString::number(percentile(values, 1), 'f', 3) << "\n";
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("campaign");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs seeded random missions through a closed loop simulation of the autopilot.");
+    parser.addHelpOption();
+
+    QCommandLineOption missionsOption("missions", "Number of missions.", "count", "1000");
+    QCommandLineOption seedOption("seed", "Base seed for the missions.", "seed", "1");
+    QCommandLineOption threadsOption("threads", "Number of threads (0 = all cores).", "count", "0");
+    QCommandLineOption csvOption("csv", "Write per mission results to this file.", "file");
+    QCommandLineOption maxTimeOption("max-time", "Maximum time for one mission (s).", "seconds", "600");
+    QCommandLineOption currentOption("max-current", "Maximum (random) water current (m/s).", "speed", "0");
+    QCommandLineOption windOption("max-wind", "Maximum (random) wind force (N).", "force", "0");
+    QCommandLineOption noiseOption("noise", "GNSS noise (standard deviation, m).", "metres", "0");
+
+    parser.addOptions({ missionsOption, seedOption, threadsOption, csvOption, maxTimeOption,
+                        currentOption, windOption, noiseOption });
+    parser.process(app);
+
+    QTextStream out(stdout);
+
+    const int missionCount = parser.value(missionsOption).toInt();
+    const uint64_t baseSeed = parser.value(seedOption).toULongLong();
+
+    MissionSimulator::MissionRanges ranges = MissionSimulator::getDefaultMissionRanges();
+    ranges.maxCurrent = parser.value(currentOption).toDouble();
+    ranges.maxWindForce = parser.value(windOption).toDouble();
+    ranges.gnssNoise = parser.value(noiseOption).toDouble();
+
+    MissionSimulator::SimulationSettings simulationSettings = MissionSimulator::getDefaultSimulationSettings();
+    simulationSettings.maxTime = parser.value(maxTimeOption).toDouble();
+
+    std::vector<MissionSimulator::Mission> missions;
+
+    for (int i = 0; i < missionCount; i++)
+    {
+        missions.push_back(MissionSimulator::generateMission(baseSeed, i, ranges));
+    }
+
+    std::vector<MissionSimulator::Result> results;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    MissionSimulator::runMissions(Autopilot::getDefaultSettings(), missions, simulationSettings, results,
+                                  parser.value(threadsOption).toUInt());
+
+    double elapsed = timer.nsecsElapsed() * 1e-9;
+
+    if (parser.isSet(csvOption))
+    {
+        QFile file(parser.value(csvOption));
+
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        {
+            out << "Can't open file " << parser.value(csvOption) << "\n";
+            return 1;
+        }
+
+        QTextStream csv(&file);
+
+        csv << "index;seed;destination_N;destination_E;destination_Heading;arrived;timeToArrive;settlingTime;overshoot;energy;stateFlips;finalDistance;finalHeadingError\n";
+
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const MissionSimulator::Mission& mission = missions[i];
+            const MissionSimulator::Result& result = results[i];
+
+            csv << i << ";" << result.seed << ";" <<
+                   QString::number(mission.destination.coord_N, 'f', 3) << ";" <<
+                   QString::number(mission.destination.coord_E, 'f', 3) << ";" <<
+                   QString::number(mission.destination.heading * 360. / (M_PI * 2), 'f', 2) << ";" <<
+                   (result.arrived ? 1 : 0) << ";" <<
+                   QString::number(result.timeToArrive, 'f', 3) << ";" <<
+                   QString::number(result.settlingTime, 'f', 3) << ";" <<
+                   QString::number(result.overshoot, 'f', 3) << ";" <<
+                   QString::number(result.energy, 'f', 0) << ";" <<
+                   result.stateFlips << ";" <<
+                   QString::number(result.finalDistance, 'f', 3) << ";" <<
+                   QString::number(result.finalHeadingError * 360. / (M_PI * 2), 'f', 2) << "\n";
+        }
+    }
+
+    std::vector<double> timesToArrive, settlingTimes, overshoots, energies, stateFlips;
+    int arrived = 0;
+    double simulatedTime = 0;
+
+    for (const MissionSimulator::Result& result : results)
+    {
+        simulatedTime += result.cycles * simulationSettings.cycleTime;
+
+        if (result.arrived)
+        {
+            arrived++;
+            timesToArrive.push_back(result.timeToArrive);
+            settlingTimes.push_back(result.settlingTime);
+        }
+
+        overshoots.push_back(result.overshoot);
+        energies.push_back(result.energy);
+        stateFlips.push_back(result.stateFlips);
+    }
+
+    out << "Missions: " << missionCount << ", arrived: " << arrived <<
+           " (" << QString::number(missionCount ? 100. * arrived / missionCount : 0, 'f', 1) << " %)\n";
+
+    printStatistics(out, "Time to arrive", timesToArrive);
+    printStatistics(out, "Settling time", settlingTimes);
+    printStatistics(out, "Overshoot", overshoots);
+    printStatistics(out, "Energy", energies);
+    printStatistics(out, "State flips", stateFlips);
+
+    out << "Elapsed: " << QString::number(elapsed, 'f', 3) << " s, " <<
+           QString::number(missionCount / elapsed, 'f', 1) << " missions/s, " <<
+           QString::number(simulatedTime / elapsed, 'f', 0) << " x real time\n";
+
+    return 0;
+}
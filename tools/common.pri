@@ -0,0 +1,62 @@
+# Common settings and sources for the command line tools.
+# Tools share the solver, autopilot and simulation code with SimFerryController.
+
+QT -= gui
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# See SimFerryController.pro
+DEFINES += EIGEN_DONT_VECTORIZE
+DEFINES += EIGEN_DISABLE_UNALIGNED_ARRAY_ASSERT
+
+INCLUDEPATH += $$PWD/..
+
+SOURCES += \
+    $$PWD/../MiniPID/MiniPID.cpp \
+    $$PWD/../arrowwriter.cpp \
+    $$PWD/../autopilot.cpp \
+    $$PWD/../autopilotsettingsfile.cpp \
+    $$PWD/../autopilottuner.cpp \
+    $$PWD/../batchpid.cpp \
+    $$PWD/../controllercore.cpp \
+    $$PWD/../ferrymodel.cpp \
+    $$PWD/../geometrycalibrator.cpp \
+    $$PWD/../headlessbackend.cpp \
+    $$PWD/../losolver.cpp \
+    $$PWD/../missionsimulator.cpp \
+    $$PWD/../outputencoder.cpp \
+    $$PWD/../posehistory.cpp \
+    $$PWD/../posesolver.cpp \
+    $$PWD/../recording.cpp \
+    $$PWD/../shmtransport.cpp \
+    $$PWD/../telemetryarchive.cpp \
+    $$PWD/../udpreceiver.cpp \
+    $$PWD/../workerpool.cpp
+
+HEADERS += \
+    $$PWD/../MiniPID/MiniPID.h \
+    $$PWD/../arrowwriter.h \
+    $$PWD/../autopilot.h \
+    $$PWD/../autopilotsettingsfile.h \
+    $$PWD/../autopilottuner.h \
+    $$PWD/../batchpid.h \
+    $$PWD/../controllercore.h \
+    $$PWD/../ferrymodel.h \
+    $$PWD/../geometrycalibrator.h \
+    $$PWD/../headlessbackend.h \
+    $$PWD/../losolver.h \
+    $$PWD/../missionsimulator.h \
+    $$PWD/../outputencoder.h \
+    $$PWD/../posehistory.h \
+    $$PWD/../posesolver.h \
+    $$PWD/../recording.h \
+    $$PWD/../shmtransport.h \
+    $$PWD/../telemetryarchive.h \
+    $$PWD/../udpreceiver.h \
+    $$PWD/../workerpool.h
+
+# shm_open (needed by older glibc)
+linux: LIBS += -lrt
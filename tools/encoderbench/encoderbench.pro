@@ -0,0 +1,6 @@
+include(../common.pri)
+
+TARGET = encoderbench
+
+SOURCES += \
+    main.cpp
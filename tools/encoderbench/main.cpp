@@ -0,0 +1,275 @@
+/*
+    main.cpp (encoderbench, part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Output encoder benchmark: Checks that OutputEncoder produces byte-identical
+// messages to the earlier QString-based code and measures the cost per message.
+
+#include <random>
+#include <string.h>
+#include <math.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include "outputencoder.h"
+
+typedef Eigen::Transform<double, 3, Eigen::Affine> Transform;
+
+// Earlier implementation (from MainWindow)
+static QByteArray encodeTransform_QString(const QString& commandId, const Transform& transform_EUS)
+{
+    QString outString =
+            commandId +
+            QString::number(transform_EUS(0,0),'f',3) + ";" + QString::number(transform_EUS(1,0),'f',3) + ";" + QString::number(transform_EUS(2,0),'f',3) + ";" + QString::number(transform_EUS(0,3),'f',3) + ";" +
+            QString::number(transform_EUS(0,1),'f',3) + ";" + QString::number(transform_EUS(1,1),'f',3) + ";" + QString::number(transform_EUS(2,1),'f',3) + ";" + QString::number(transform_EUS(1,3),'f',3) + ";" +
+            QString::number(transform_EUS(0,2),'f',3) + ";" + QString::number(transform_EUS(1,2),'f',3) + ";" + QString::number(transform_EUS(2,2),'f',3) + ";" + QString::number(transform_EUS(2,3),'f',3) + ";" +
+            QString::number(transform_EUS(0,3),'f',3) + ";" + QString::number(transform_EUS(1,3),'f',3) + ";" + QString::number(transform_EUS(2,3),'f',3) + ";" + QString::number(transform_EUS(3,3),'f',3);
+
+    return outString.toLatin1();
+}
+
+static QByteArray encodePropulsion_QString(const Autopilot::Outputs& autopilotOutputs)
+{
+    QString outString =
+            "2;" +   // "Command id": Propulsion
+            QString::number(autopilotOutputs.direction_Front,'f',3) + ";" + QString::number(autopilotOutputs.propulsion_Front,'f',3) + ";" +
+            QString::number(autopilotOutputs.direction_Back,'f',3) + ";" + QString::number(autopilotOutputs.propulsion_Back,'f',3);
+
+    return outString.toLatin1();
+}
+
+static QByteArray encodeDestination_QString(const Autopilot::Destination& autopilotDestination)
+{
+    QString outString =
+            "3;" +   // "Command id": Set destination
+            QString::number(autopilotDestination.coord_E,'f',3) + ";" + QString::number(-autopilotDestination.coord_N,'f',3) + ";" +
+            QString::number(autopilotDestination.heading,'f',3);
+
+    return outString.toLatin1();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("encoderbench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Verifies and benchmarks the allocation-free output encoder.");
+    parser.addHelpOption();
+
+    QCommandLineOption verifyOption("verify", "Number of random values to verify.", "count", "1000000");
+    QCommandLineOption messagesOption("messages", "Number of messages to benchmark.", "count", "200000");
+    QCommandLineOption seedOption("seed", "Seed for the random values.", "seed", "1");
+
+    parser.addOptions({ verifyOption, messagesOption, seedOption });
+    parser.process(app);
+
+    QTextStream out(stdout);
+
+    std::mt19937_64 random(parser.value(seedOption).toULongLong());
+
+    // Verify single values: Special cases, ties, random bit patterns and "typical" values
+    const double specialValues[] =
+    {
+        0, -0.0, 0.0005, -0.0005, 0.0625, -0.0625, 1.0625, 2.1875, -2.1875, 0.9995, 999.9995,
+        -0.0001, -0.0004999, 1e-300, 5e-324, 1e15, 9.999999999999998e15, 1e16, 1e20, -1e300,
+        1.7976931348623157e308, -1.7976931348623157e308, 2.2250738585072014e-308, 9007199254740993e5, 123456.5, 4503599627370495.5, NAN, INFINITY, -INFINITY
+    };
+
+    std::vector<double> values(specialValues, specialValues + sizeof(specialValues) / sizeof(specialValues[0]));
+    const qint64 verifyCount = parser.value(verifyOption).toLongLong();
+
+    for (qint64 i = 0; i < verifyCount; i++)
+    {
+        uint64_t bits = random();
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+
+        values.push_back(value);
+
+        // Multiples of 1/2^n contain exact ties
+        values.push_back((static_cast<int64_t>(random() % 2000000001) - 1000000000) / static_cast<double>(1 << (random() % 20)));
+        values.push_back((static_cast<int64_t>(random() % 2000000001) - 1000000000) * 1e-6);
+    }
+
+    qint64 mismatches = 0;
+
+    for (double value : values)
+    {
+        char buffer[OutputEncoder::maxNumberLength];
+        int length = static_cast<int>(OutputEncoder::writeFixed3(buffer, value) - buffer);
+
+        QByteArray reference = QString::number(value, 'f', 3).toLatin1();
+
+        if (reference != QByteArray(buffer, length))
+        {
+            if (mismatches < 10)
+            {
+                out << "Mismatch: " << QString::number(value, 'g', 17) << ": " << reference << " vs " << QByteArray(buffer, length) << "\n";
+            }
+
+            mismatches++;
+        }
+    }
+
+    out << "Verified " << values.size() << " values, mismatches: " << mismatches << "\n";
+
+    // Benchmark with "realistic" messages
+    const int messageCount = parser.value(messagesOption).toInt();
+
+    std::vector<Transform> transforms(messageCount);
+    std::vector<Autopilot::Outputs> outputs(messageCount);
+    std::vector<Autopilot::Destination> destinations(messageCount);
+
+    auto randomDouble = [&random](const double min, const double max)
+    {
+        return min + (random() >> 11) * (1. / 9007199254740992.) * (max - min);
+    };
+
+    for (int i = 0; i < messageCount; i++)
+    {
+        transforms[i] = Eigen::AngleAxisd(randomDouble(-M_PI, M_PI), Eigen::Vector3d::UnitY());
+        transforms[i].translation() = Eigen::Vector3d(randomDouble(-1000, 1000), randomDouble(-1, 1), randomDouble(-1000, 1000));
+
+        outputs[i].valid = true;
+        outputs[i].direction_Front = randomDouble(-M_PI, M_PI);
+        outputs[i].propulsion_Front = randomDouble(-50000, 50000);
+        outputs[i].direction_Back = randomDouble(-M_PI, M_PI);
+        outputs[i].propulsion_Back = randomDouble(-50000, 50000);
+
+        destinations[i].coord_N = randomDouble(-1000, 1000);
+        destinations[i].coord_E = randomDouble(-1000, 1000);
+        destinations[i].heading = randomDouble(0, 2 * M_PI);
+    }
+
+    qint64 messageMismatches = 0;
+    char buffer[OutputEncoder::bufferSize];
+
+    for (int i = 0; i < messageCount; i++)
+    {
+        int length = OutputEncoder::encodeTransform(buffer, 1, transforms[i]);
+        messageMismatches += (encodeTransform_QString("1;", transforms[i]) != QByteArray(buffer, length));
+
+        length = OutputEncoder::encodeTransform(buffer, 10, transforms[i]);
+        messageMismatches += (encodeTransform_QString("10;", transforms[i]) != QByteArray(buffer, length));
+
+        length = OutputEncoder::encodePropulsion(buffer, outputs[i]);
+        messageMismatches += (encodePropulsion_QString(outputs[i]) != QByteArray(buffer, length));
+
+        length = OutputEncoder::encodeDestination(buffer, destinations[i]);
+        messageMismatches += (encodeDestination_QString(destinations[i]) != QByteArray(buffer, length));
+    }
+
+    out << "Verified " << messageCount * 4 << " messages, mismatches: " << messageMismatches << "\n";
+
+    // All commands of one input (every debug channel subscribed) must fit in one frame, also with the longest numbers
+    std::vector<QByteArray> frameCommands;
+    Transform longTransform;
+    Autopilot::Outputs longOutputs;
+    Autopilot::DebugOutputs longDebugOutputs;
+    Autopilot::Destination longDestination;
+    const double longValue = -1.7976931348623157e308;
+
+    longTransform.matrix().setConstant(longValue);
+    longOutputs.valid = true;
+    longOutputs.direction_Front = longOutputs.propulsion_Front = longOutputs.direction_Back = longOutputs.propulsion_Back = longValue;
+    longDebugOutputs.absBearing = longDebugOutputs.relativeBearing = longDebugOutputs.distanceToTarget = longValue;
+    longDebugOutputs.velocityVec = Eigen::Vector2d(longValue, longValue);
+    longDebugOutputs.speed = longDebugOutputs.directionOfTravel = longDebugOutputs.headingError = longValue;
+    longDebugOutputs.state = Autopilot::State(0);
+    longDestination.coord_N = longDestination.coord_E = longDestination.heading = longValue;
+
+    frameCommands.push_back(QByteArray(buffer, OutputEncoder::encodeTransform(buffer, 1, longTransform)));
+    frameCommands.push_back(QByteArray(buffer, OutputEncoder::encodeTransform(buffer, 10, longTransform)));
+    frameCommands.push_back(QByteArray(buffer, OutputEncoder::encodeAutopilotDebug(buffer, longDebugOutputs)));
+    frameCommands.push_back(QByteArray(buffer, OutputEncoder::encodePropulsion(buffer, longOutputs)));
+    frameCommands.push_back(QByteArray(buffer, OutputEncoder::encodeDestination(buffer, longDestination)));
+
+    OutputFrame frame;
+    bool frameOk = (static_cast<int>(frameCommands.size()) <= OutputEncoder::maxCommandsPerInput);
+
+    for (const QByteArray& command : frameCommands)
+    {
+        frameOk = frameOk && frame.append(command.constData(), command.size());
+    }
+
+    if (frameOk)
+    {
+        // "F;<count>;<length>;<command>..."
+        const char* frameData;
+        const int frameLength = frame.finish(frameData);
+        QByteArray expected = "F;" + QByteArray::number(static_cast<int>(frameCommands.size())) + ";";
+
+        for (const QByteArray& command : frameCommands)
+        {
+            expected += QByteArray::number(command.size()) + ";" + command;
+        }
+
+        frameOk = (QByteArray(frameData, frameLength) == expected);
+    }
+
+    out << "Frame with all " << frameCommands.size() << " commands of one input: " << (frameOk ? "ok" : "FAILED") << "\n";
+
+    // Checksum of the results keeps the compiler from optimizing the encoding away
+    qint64 checksum = 0;
+    QElapsedTimer timer;
+
+    timer.start();
+
+    for (int i = 0; i < messageCount; i++)
+    {
+        checksum += encodeTransform_QString("1;", transforms[i]).size();
+    }
+
+    double transform_QString = timer.nsecsElapsed() / static_cast<double>(messageCount);
+
+    timer.start();
+
+    for (int i = 0; i < messageCount; i++)
+    {
+        checksum += OutputEncoder::encodeTransform(buffer, 1, transforms[i]);
+    }
+
+    double transform_Encoder = timer.nsecsElapsed() / static_cast<double>(messageCount);
+
+    timer.start();
+
+    for (int i = 0; i < messageCount; i++)
+    {
+        checksum += encodePropulsion_QString(outputs[i]).size();
+    }
+
+    double propulsion_QString = timer.nsecsElapsed() / static_cast<double>(messageCount);
+
+    timer.start();
+
+    for (int i = 0; i < messageCount; i++)
+    {
+        checksum += OutputEncoder::encodePropulsion(buffer, outputs[i]);
+    }
+
+    double propulsion_Encoder = timer.nsecsElapsed() / static_cast<double>(messageCount);
+
+    out << "Transform (\"1;\"):\tQString: " << QString::number(transform_QString, 'f', 1) << " ns/message\tencoder: " <<
+           QString::number(transform_Encoder, 'f', 1) << " ns/message\t(" << QString::number(transform_QString / transform_Encoder, 'f', 1) << " x)\n";
+    out << "Propulsion (\"2;\"):\tQString: " << QString::number(propulsion_QString, 'f', 1) << " ns/message\tencoder: " <<
+           QString::number(propulsion_Encoder, 'f', 1) << " ns/message\t(" << QString::number(propulsion_QString / propulsion_Encoder, 'f', 1) << " x)\n";
+    out << "(checksum " << checksum << ")\n";
+
+    return ((mismatches == 0) && (messageMismatches == 0) && frameOk) ? 0 : 1;
+}
@@ -0,0 +1,8 @@
+include(../common.pri)
+
+QT += network
+
+TARGET = headless
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,743 @@
+/*
+    main.cpp (headless, part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Headless controller: Does what SimFerryController does for antenna datagrams
+// (solver, autopilot, replies to the send port) without the UI, using one of
+// the event loops: io_uring ("uring"), epoll + recvmmsg/sendmmsg ("recvmmsg")
+// or Qt's event loop with QUdpSocket like MainWindow ("qt").
+//
+// --bench forks a controller process for each event loop and acts as the
+// simulator, sending bursts of datagrams (one per vessel) over loopback.
+// Measured: round trip time of each sample (send -> propulsion reply), system
+// calls made by the controller process (counted by the kernel if perf allows,
+// see openSystemCallCounter) and the controller's wakeups (voluntary context
+// switches).
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <locale.h>
+#include <time.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/perf_event.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QUdpSocket>
+#include <QNetworkDatagram>
+#include <QTimer>
+#include "autopilotsettingsfile.h"
+#include "controllercore.h"
+#include "ferrymodel.h"
+#include "headlessbackend.h"
+
+// System call counting for --bench: The kernel counts the raw_syscalls:sys_enter
+// tracepoint of the controller process (perf, needs tracefs and a permissive
+// perf_event_paranoid or root). The controller itself calls libc directly.
+
+static const uint64_t systemCallsUnavailable = UINT64_MAX;
+
+static long getTracepointId(const char* name)
+{
+    const char* roots[] = { "/sys/kernel/tracing/events/", "/sys/kernel/debug/tracing/events/" };
+
+    for (const char* root : roots)
+    {
+        const std::string path = std::string(root) + name + "/id";
+        FILE* file = fopen(path.c_str(), "r");
+
+        if (!file)
+        {
+            continue;
+        }
+
+        long id = -1;
+
+        if (fscanf(file, "%ld", &id) != 1)
+        {
+            id = -1;
+        }
+
+        fclose(file);
+
+        if (id >= 0)
+        {
+            return id;
+        }
+    }
+
+    return -1;
+}
+
+// Counts system calls of this process and of the threads it creates later. Returns -1 if not available.
+static int openSystemCallCounter(void)
+{
+    const long id = getTracepointId("raw_syscalls/sys_enter");
+
+    if (id < 0)
+    {
+        return -1;
+    }
+
+    perf_event_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.type = PERF_TYPE_TRACEPOINT;
+    attributes.size = sizeof(attributes);
+    attributes.config = static_cast<uint64_t>(id);
+    attributes.inherit = 1;
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+
+static uint64_t readSystemCallCounter(const int fd)
+{
+    uint64_t count = 0;
+
+    if ((fd < 0) || (read(fd, &count, sizeof(count)) != sizeof(count)))
+    {
+        return systemCallsUnavailable;
+    }
+
+    return count;
+}
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void handleStopSignal(int signal)
+{
+    (void)signal;
+    stopRequested = 1;
+}
+
+struct ServerSettings
+{
+    std::string backend;
+    std::string bindAddress;
+    uint16_t bindPort;
+    std::string sendAddress;
+    uint16_t sendPort;
+    int receiveBufferSize;
+    ControllerCore::Settings coreSettings;
+};
+
+// Qt event loop like MainWindow::readyRead. Returns when stopCheck returns true.
+template <typename StopCheck>
+static bool runQtLoop(const ServerSettings& settings, ControllerCore& core, const int checkInterval, StopCheck stopCheck)
+{
+    QUdpSocket socket;
+
+    if (!socket.bind(QHostAddress(QString::fromStdString(settings.bindAddress)), settings.bindPort))
+    {
+        return false;
+    }
+
+    if (settings.receiveBufferSize > 0)
+    {
+        socket.setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, settings.receiveBufferSize);
+    }
+
+    const QHostAddress sendHost(QString::fromStdString(settings.sendAddress));
+    OutputBatch outputs(OutputBatch::maxDatagramsPerInput);
+
+    QObject::connect(&socket, &QUdpSocket::readyRead, [&]()
+    {
+        while (socket.hasPendingDatagrams())
+        {
+            QNetworkDatagram datagram = socket.receiveDatagram();
+
+            outputs.clear();
+            core.process(datagram.data().constData(), datagram.data().size(), 0, outputs);
+
+            for (int i = 0; i < outputs.getCount(); i++)
+            {
+                socket.writeDatagram(outputs.getData(i), outputs.getLength(i), sendHost, settings.sendPort);
+            }
+        }
+    });
+
+    QTimer timer;
+
+    QObject::connect(&timer, &QTimer::timeout, [&]()
+    {
+        if (stopCheck())
+        {
+            QCoreApplication::quit();
+        }
+    });
+
+    timer.start(checkInterval);
+    QCoreApplication::exec();
+
+    return true;
+}
+
+// Headless backend loop. Returns when stopCheck returns true.
+template <typename StopCheck>
+static bool runBackendLoop(const ServerSettings& settings, ControllerCore& core, const int checkInterval, StopCheck stopCheck)
+{
+    HeadlessBackend* backend = HeadlessBackend::create(settings.backend);
+
+    if (!backend || !backend->open(settings.bindAddress, settings.bindPort,
+                                   settings.sendAddress, settings.sendPort, settings.receiveBufferSize))
+    {
+        delete backend;
+        return false;
+    }
+
+    bool ok = true;
+
+    while (ok && !stopCheck())
+    {
+        ok = backend->poll(core, checkInterval);
+    }
+
+    delete backend;
+    return ok;
+}
+
+template <typename StopCheck>
+static bool runServer(const ServerSettings& settings, ControllerCore& core, const int checkInterval, StopCheck stopCheck)
+{
+    if (settings.backend == "qt")
+    {
+        return runQtLoop(settings, core, checkInterval, stopCheck);
+    }
+
+    return runBackendLoop(settings, core, checkInterval, stopCheck);
+}
+
+// Benchmark
+
+struct BenchSettings
+{
+    int bursts;
+    int warmup;             // Bursts not included in the results
+    int vessels;            // Datagrams per burst
+    int interval;           // us between the bursts (0 = next burst when all replies arrived)
+    uint16_t port;
+};
+
+struct BenchResult
+{
+    bool ok;
+    double p50;             // us
+    double p99;
+    double max;
+    double systemCallsPerSample;  // Negative if not available
+    double wakeupsPerSample;
+    int lostReplies;
+    int mismatches;         // Replies in wrong order
+};
+
+// Sent by the controller process to the parent
+struct ServerReport
+{
+    uint64_t systemCalls;
+    uint64_t wakeups;
+    uint64_t datagrams;
+};
+
+static int64_t getMonotonicTime(void)
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+static uint64_t getVoluntaryContextSwitches(void)
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw;
+}
+
+static int runBenchServer(const std::string& backend, const BenchSettings& benchSettings, const int readyFd, const int reportFd)
+{
+    ServerSettings settings;
+    settings.backend = backend;
+    settings.bindAddress = "127.0.0.1";
+    settings.bindPort = benchSettings.port;
+    settings.sendAddress = "127.0.0.1";
+    settings.sendPort = benchSettings.port + 1;
+    settings.receiveBufferSize = 0;
+    settings.coreSettings = ControllerCore::getDefaultSettings();
+    settings.coreSettings.maxVessels = benchSettings.vessels;
+
+    // Opened before the event loop creates its threads (they inherit the counter)
+    const int systemCallCounter = openSystemCallCounter();
+    ControllerCore core(settings.coreSettings);
+
+    const uint64_t expected = static_cast<uint64_t>(benchSettings.bursts) * benchSettings.vessels;
+    uint64_t lastDatagrams = 0;
+    int idleChecks = 0;
+    bool started = false;
+    ServerReport report = { 0, 0, 0 };
+    uint64_t systemCallsStart = 0;
+    uint64_t wakeupsStart = 0;
+
+    // First check is done right after opening: Tells the parent to start
+    auto stopCheck = [&]()
+    {
+        if (!started)
+        {
+            started = true;
+            char ready = 1;
+            systemCallsStart = readSystemCallCounter(systemCallCounter);
+            wakeupsStart = getVoluntaryContextSwitches();
+            return write(readyFd, &ready, 1) != 1;
+        }
+
+        const uint64_t datagrams = core.getStatistics().datagrams;
+
+        idleChecks = (datagrams == lastDatagrams) ? (idleChecks + 1) : 0;
+        lastDatagrams = datagrams;
+
+        if ((datagrams >= expected) || (idleChecks > 20))
+        {
+            if (report.datagrams == 0)
+            {
+                const uint64_t systemCalls = readSystemCallCounter(systemCallCounter);
+                report.systemCalls = ((systemCalls == systemCallsUnavailable) || (systemCallsStart == systemCallsUnavailable)) ?
+                            systemCallsUnavailable : (systemCalls - systemCallsStart);
+                report.wakeups = getVoluntaryContextSwitches() - wakeupsStart;
+                report.datagrams = datagrams;
+            }
+            return true;
+        }
+
+        return false;
+    };
+
+    const bool ok = runServer(settings, core, 100, stopCheck);
+
+    if (systemCallCounter >= 0)
+    {
+        ::close(systemCallCounter);
+    }
+
+    if (!ok)
+    {
+        return 1;
+    }
+
+    return (write(reportFd, &report, sizeof(report)) == sizeof(report)) ? 0 : 1;
+}
+
+static int encodeSample(FerryModel& model, const int burst, const int vessel, char* buffer, const int bufferSize)
+{
+    const double angle = burst * 0.001 + vessel;
+    FerryModel::State state = { 50 * cos(angle), 50 * sin(angle), angle + M_PI / 2, 2, 0, 0.04 };
+    double values[2 * 3 * 3];
+
+    model.setState(state);
+    model.getDatagramValues(values);
+
+    int length = 0;
+
+    for (int i = 0; i < (2 * 3 * 3); i++)
+    {
+        length += snprintf(buffer + length, bufferSize - length, i ? ";%.6f" : "%.6f", values[i]);
+    }
+
+    length += snprintf(buffer + length, bufferSize - length, ";%d;%d", burst + 1, vessel);
+
+    return length;
+}
+
+static BenchResult runBench(const std::string& backend, const BenchSettings& settings)
+{
+    BenchResult result = { false, 0, 0, 0, 0, 0, 0, 0 };
+    int readyPipe[2];
+    int reportPipe[2];
+
+    if ((pipe(readyPipe) != 0) || (pipe(reportPipe) != 0))
+    {
+        return result;
+    }
+
+    pid_t child = fork();
+
+    if (child == 0)
+    {
+        ::close(readyPipe[0]);
+        ::close(reportPipe[0]);
+        int retVal = runBenchServer(backend, settings, readyPipe[1], reportPipe[1]);
+        fflush(stdout);
+        _exit(retVal);
+    }
+
+    ::close(readyPipe[1]);
+    ::close(reportPipe[1]);
+
+    char ready = 0;
+    const bool childReady = (child > 0) && (read(readyPipe[0], &ready, 1) == 1);
+
+    ::close(readyPipe[0]);
+
+    int fd = childReady ? socket(AF_INET, SOCK_DGRAM, 0) : -1;
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(settings.port + 1);
+
+    if ((fd >= 0) && (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0))
+    {
+        address.sin_port = htons(settings.port);
+
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    else if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+
+    if (fd < 0)
+    {
+        if (child > 0)
+        {
+            kill(child, SIGTERM);
+            waitpid(child, nullptr, 0);
+        }
+        ::close(reportPipe[0]);
+        return result;
+    }
+
+    timeval timeout = { 0, 200000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    const int receiveBufferSize = 4 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBufferSize, sizeof(receiveBufferSize));
+
+    FerryModel model(FerryModel::getDefaultParameters());
+    std::vector<std::vector<char>> datagrams(settings.vessels, std::vector<char>(1024));
+    std::vector<int> lengths(settings.vessels);
+    std::vector<int64_t> sendTimes(settings.vessels);
+    std::vector<double> roundTripTimes;
+    int64_t nextBurst = getMonotonicTime();
+
+    roundTripTimes.reserve(static_cast<size_t>(settings.bursts) * settings.vessels);
+
+    for (int burst = 0; burst < settings.bursts; burst++)
+    {
+        for (int vessel = 0; vessel < settings.vessels; vessel++)
+        {
+            lengths[vessel] = encodeSample(model, burst, vessel, datagrams[vessel].data(), 1024);
+        }
+
+        if (settings.interval > 0)
+        {
+            nextBurst += settings.interval * 1000LL;
+
+            timespec wakeup = { static_cast<time_t>(nextBurst / 1000000000), static_cast<long>(nextBurst % 1000000000) };
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, nullptr);
+        }
+
+        for (int vessel = 0; vessel < settings.vessels; vessel++)
+        {
+            sendTimes[vessel] = getMonotonicTime();
+            send(fd, datagrams[vessel].data(), lengths[vessel], 0);
+        }
+
+        // Replies come in the order the samples were sent: transform (+ debug transform) + propulsion for each
+        int sample = 0;
+        bool transformReceived = false;
+
+        while (sample < settings.vessels)
+        {
+            char buffer[OutputEncoder::bufferSize];
+            const ssize_t length = recv(fd, buffer, sizeof(buffer), 0);
+
+            if (length < 0)
+            {
+                result.lostReplies += settings.vessels - sample;
+                break;
+            }
+
+            const int64_t now = getMonotonicTime();
+
+            if ((length >= 2) && (strncmp(buffer, "1;", 2) == 0))
+            {
+                if (transformReceived)
+                {
+                    result.mismatches++;
+                }
+                transformReceived = true;
+            }
+            else if ((length >= 3) && (strncmp(buffer, "10;", 3) == 0))
+            {
+                if (!transformReceived)
+                {
+                    result.mismatches++;
+                }
+            }
+            else if ((length >= 2) && (strncmp(buffer, "2;", 2) == 0))
+            {
+                if (!transformReceived)
+                {
+                    result.mismatches++;
+                }
+
+                if (burst >= settings.warmup)
+                {
+                    roundTripTimes.push_back(now - sendTimes[sample]);
+                }
+
+                transformReceived = false;
+                sample++;
+            }
+            else
+            {
+                result.mismatches++;
+            }
+        }
+
+        if ((sample < settings.vessels) && (waitpid(child, nullptr, WNOHANG) == child))
+        {
+            // Controller died
+            break;
+        }
+    }
+
+    ::close(fd);
+
+    ServerReport report;
+    const bool reported = (read(reportPipe[0], &report, sizeof(report)) == sizeof(report));
+
+    ::close(reportPipe[0]);
+    waitpid(child, nullptr, 0);
+
+    if (!reported || roundTripTimes.empty() || (report.datagrams == 0))
+    {
+        return result;
+    }
+
+    std::sort(roundTripTimes.begin(), roundTripTimes.end());
+
+    result.ok = true;
+    result.p50 = roundTripTimes[roundTripTimes.size() / 2] / 1000.;
+    result.p99 = roundTripTimes[(roundTripTimes.size() * 99) / 100] / 1000.;
+    result.max = roundTripTimes.back() / 1000.;
+    result.systemCallsPerSample = (report.systemCalls == systemCallsUnavailable) ?
+                -1 : static_cast<double>(report.systemCalls) / report.datagrams;
+    result.wakeupsPerSample = static_cast<double>(report.wakeups) / report.datagrams;
+
+    return result;
+}
+
+static bool parseDestination(const QString& text, Autopilot::Destination& destination)
+{
+    const QStringList parts = text.split(',');
+    bool ok[3] = { false, false, false };
+
+    if (parts.size() != 3)
+    {
+        return false;
+    }
+
+    destination.coord_N = parts[0].toDouble(&ok[0]);
+    destination.coord_E = parts[1].toDouble(&ok[1]);
+    destination.heading = parts[2].toDouble(&ok[2]) * M_PI / 180;
+
+    return ok[0] && ok[1] && ok[2];
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("headless");
+
+    // QCoreApplication sets the locale from the environment, the protocol needs '.' (strtod, snprintf)
+    setlocale(LC_NUMERIC, "C");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("SimFerryController without the UI (io_uring, recvmmsg or Qt event loop).");
+    parser.addHelpOption();
+
+    QCommandLineOption backendOption("backend", "Event loop: uring, recvmmsg or qt (--bench: all if not given).", "backend", "uring");
+    QCommandLineOption bindAddressOption("bind", "Address to listen to (IPv4).", "address", "0.0.0.0");
+    QCommandLineOption portOption("port", "Port to listen to.", "port", "65511");
+    QCommandLineOption sendHostOption("send-host", "Address to send the replies to (IPv4).", "address", "127.0.0.1");
+    QCommandLineOption sendPortOption("send-port", "Port to send the replies to.", "port", "65512");
+    QCommandLineOption receiveBufferOption("receive-buffer", "Receive buffer size (kB, 0 = system default).", "kB", "0");
+    QCommandLineOption framedOption("framed", "Send all replies to one datagram in one frame (see FRAMED in README.md).");
+    QCommandLineOption noAutopilotOption("no-autopilot", "Send only the transforms.");
+    QCommandLineOption noDebugTransformOption("no-debug-transform", "Don't send the debug transform (\"10;\").");
+    QCommandLineOption settingsOption("settings", "Autopilot settings (ini-file).", "file");
+    QCommandLineOption destinationOption("destination", "Destination of every vessel: north,east,heading (m, m, deg).", "n,e,heading", "0,0,0");
+    QCommandLineOption statsIntervalOption("stats-interval", "Print receive statistics every n seconds (0 = never).", "seconds", "10");
+    QCommandLineOption benchOption("bench", "Compare the event loops over loopback (see --bench-* options).");
+    QCommandLineOption burstsOption("bench-bursts", "Number of bursts.", "count", "5000");
+    QCommandLineOption warmupOption("bench-warmup", "Number of bursts not included in the results.", "count", "200");
+    QCommandLineOption vesselsOption("bench-vessels", "Datagrams (vessels) per burst.", "count", "16");
+    QCommandLineOption intervalOption("bench-interval", "Time between the bursts (us, 0 = as fast as possible).", "us", "1000");
+    QCommandLineOption benchPortOption("bench-port", "First of the two UDP ports used.", "port", "65531");
+
+    parser.addOptions({ backendOption, bindAddressOption, portOption, sendHostOption, sendPortOption,
+                        receiveBufferOption, framedOption, noAutopilotOption, noDebugTransformOption, settingsOption,
+                        destinationOption, statsIntervalOption, benchOption, burstsOption, warmupOption, vesselsOption,
+                        intervalOption, benchPortOption });
+    parser.process(app);
+
+    QTextStream out(stdout);
+    const std::string backendName = parser.value(backendOption).toStdString();
+
+    if (parser.isSet(benchOption))
+    {
+        BenchSettings settings;
+        settings.bursts = parser.value(burstsOption).toInt();
+        settings.warmup = parser.value(warmupOption).toInt();
+        settings.vessels = parser.value(vesselsOption).toInt();
+        settings.interval = parser.value(intervalOption).toInt();
+        settings.port = parser.value(benchPortOption).toUShort();
+
+        if ((settings.bursts <= settings.warmup) || (settings.vessels <= 0) || (settings.vessels > 64))
+        {
+            out << "Invalid number of bursts or vessels (1...64).\n";
+            return 1;
+        }
+
+        std::vector<std::string> backends;
+
+        for (int i = 0; i < HeadlessBackend::nameCount; i++)
+        {
+            backends.push_back(HeadlessBackend::names[i]);
+        }
+
+        backends.push_back("qt");
+
+        out << "backend\tp50_us\tp99_us\tmax_us\tsyscalls/sample\twakeups/sample\tlost\tmismatches\n";
+
+        bool failed = false;
+
+        for (const std::string& backend : backends)
+        {
+            if ((backendName != "all") && (backendName != backend) && parser.isSet(backendOption))
+            {
+                continue;
+            }
+
+            // Output must be flushed before forking (child would print it again)
+            out.flush();
+            fflush(stdout);
+
+            const BenchResult result = runBench(backend, settings);
+
+            if (!result.ok)
+            {
+                out << QString::fromStdString(backend) << "\tfailed\n";
+                failed = true;
+                continue;
+            }
+
+            out << QString::fromStdString(backend) << "\t" <<
+                   QString::number(result.p50, 'f', 1) << "\t" <<
+                   QString::number(result.p99, 'f', 1) << "\t" <<
+                   QString::number(result.max, 'f', 1) << "\t" <<
+                   ((result.systemCallsPerSample < 0) ? QString("n/a") : QString::number(result.systemCallsPerSample, 'f', 2)) << "\t" <<
+                   QString::number(result.wakeupsPerSample, 'f', 2) << "\t" <<
+                   result.lostReplies << "\t" << result.mismatches << "\n";
+            out.flush();
+        }
+
+        return failed ? 1 : 0;
+    }
+
+    ServerSettings settings;
+    settings.backend = backendName;
+    settings.bindAddress = parser.value(bindAddressOption).toStdString();
+    settings.bindPort = parser.value(portOption).toUShort();
+    settings.sendAddress = parser.value(sendHostOption).toStdString();
+    settings.sendPort = parser.value(sendPortOption).toUShort();
+    settings.receiveBufferSize = parser.value(receiveBufferOption).toInt() * 1024;
+    settings.coreSettings = ControllerCore::getDefaultSettings();
+    settings.coreSettings.framedOutput = parser.isSet(framedOption);
+    settings.coreSettings.autopilotActive = !parser.isSet(noAutopilotOption);
+    settings.coreSettings.debugTransform = !parser.isSet(noDebugTransformOption);
+
+    if (parser.isSet(settingsOption) &&
+            !AutopilotSettingsFile::load(parser.value(settingsOption).toStdString(), settings.coreSettings.autopilotSettings))
+    {
+        out << "Loading autopilot settings from " << parser.value(settingsOption) << " failed.\n";
+        return 1;
+    }
+
+    if (!parseDestination(parser.value(destinationOption), settings.coreSettings.destination))
+    {
+        out << "Invalid destination " << parser.value(destinationOption) << ".\n";
+        return 1;
+    }
+
+    ControllerCore core(settings.coreSettings);
+
+    signal(SIGINT, handleStopSignal);
+    signal(SIGTERM, handleStopSignal);
+
+    const int64_t statsInterval = parser.value(statsIntervalOption).toLongLong() * 1000000000LL;
+    int64_t nextStats = getMonotonicTime() + statsInterval;
+
+    auto stopCheck = [&]()
+    {
+        if ((statsInterval > 0) && (getMonotonicTime() >= nextStats))
+        {
+            nextStats += statsInterval;
+            out << QString::fromStdString(core.getStatistics().toString()) << ", invalid " <<
+                   core.getInvalidDatagrams() << ", stale " << core.getStaleSamples() << ", sequence restarts " << core.getSequenceRestarts() << "\n";
+            out.flush();
+        }
+
+        return stopRequested != 0;
+    };
+
+    out << "Listening to " << parser.value(bindAddressOption) << ":" << settings.bindPort <<
+           " (" << QString::fromStdString(backendName) << "), sending to " <<
+           parser.value(sendHostOption) << ":" << settings.sendPort << "\n";
+    out.flush();
+
+    if (!runServer(settings, core, 100, stopCheck))
+    {
+        out << "Opening the " << QString::fromStdString(backendName) << " event loop failed.\n";
+        return 1;
+    }
+
+    out << QString::fromStdString(core.getStatistics().toString()) << ", invalid " <<
+           core.getInvalidDatagrams() << ", stale " << core.getStaleSamples() << ", sequence restarts " << core.getSequenceRestarts() << "\n";
+
+    return 0;
+}
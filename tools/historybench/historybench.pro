@@ -0,0 +1,6 @@
+include(../common.pri)
+
+TARGET = historybench
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,223 @@
+/*
+    main.cpp (historybench, part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Pose history benchmark: Checks PoseHistory's lookups (with the ring wrapping
+// around, chunks evicted and the age limit) against a plain linear search over
+// the poses appended and measures the cost of a "pose at time" query.
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include "posehistory.h"
+
+// Reference: Linear search over the poses kept
+static bool getPose_Linear(const std::deque<PoseHistory::Pose>& poses, const int64_t time, PoseHistory::Pose& pose)
+{
+    for (size_t i = 0; i < poses.size(); i++)
+    {
+        if (poses[i].time == time)
+        {
+            pose = poses[i];
+            return true;
+        }
+        else if (poses[i].time > time)
+        {
+            if (i == 0)
+            {
+                return false;
+            }
+
+            pose = PoseHistory::interpolate(poses[i - 1], poses[i], time);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool equal(const PoseHistory::Pose& pose1, const PoseHistory::Pose& pose2)
+{
+    return (pose1.time == pose2.time) && (pose1.position == pose2.position) &&
+            (pose1.orientation.coeffs() == pose2.orientation.coeffs());
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("historybench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Verifies and benchmarks the pose history.");
+    parser.addHelpOption();
+
+    QCommandLineOption posesOption("poses", "Number of poses to append.", "count", "200000");
+    QCommandLineOption queriesOption("queries", "Number of queries to benchmark.", "count", "1000000");
+    QCommandLineOption seedOption("seed", "Seed for the random times and poses.", "seed", "1");
+
+    parser.addOptions({ posesOption, queriesOption, seedOption });
+    parser.process(app);
+
+    QTextStream out(stdout);
+
+    std::mt19937_64 random(parser.value(seedOption).toULongLong());
+    std::uniform_real_distribution<double> uniform(-1, 1);
+
+    const int chunkCount = 8;
+    const int chunkSize = 256;
+    const int64_t maxAge = 1500 * 1000000LL;
+
+    const int poseCount = parser.value(posesOption).toInt();
+    qint64 mismatches = 0;
+    qint64 checks = 0;
+
+    // Without and with the age limit: Kept poses must be the newest ones the eviction policy allows
+    for (int useMaxAge = 0; useMaxAge < 2; useMaxAge++)
+    {
+        PoseHistory history(chunkCount, chunkSize);
+        std::deque<PoseHistory::Pose> reference;
+        std::vector<int64_t> allTimes;
+        int64_t time = 0;
+
+        history.setMaxAge(useMaxAge ? maxAge : 0);
+
+        for (int i = 0; i < poseCount; i++)
+        {
+            PoseHistory::Pose pose;
+
+            // 1 ms average, irregular
+            time += 1 + static_cast<int64_t>(random() % 2000000);
+            pose.time = time;
+            pose.position = Eigen::Vector3d(uniform(random), uniform(random), uniform(random)) * 100;
+            pose.orientation = Eigen::Quaterniond(uniform(random), uniform(random), uniform(random), uniform(random)).normalized();
+
+            if (!history.append(pose) || history.append(pose))
+            {
+                // Newer time must be accepted, the same time rejected
+                mismatches++;
+            }
+
+            reference.push_back(pose);
+
+            // Eviction: Whole oldest chunk when the ring is full, older than maxAge
+            if (reference.size() > history.size())
+            {
+                reference.erase(reference.begin(), reference.begin() + (reference.size() - history.size()));
+            }
+
+            // Age limit keeps the poses of the last maxAge, the ring at least chunkCount - 1 chunks
+            allTimes.push_back(time);
+
+            const size_t ageKept = useMaxAge ? static_cast<size_t>(allTimes.end() - std::lower_bound(allTimes.begin(), allTimes.end(), time - maxAge)) :
+                                               allTimes.size();
+
+            mismatches += (history.size() < std::min(ageKept, static_cast<size_t>((chunkCount - 1) * chunkSize))) ||
+                    (history.size() > std::min(ageKept, history.capacity()));
+
+            if ((i % 97) != 0)
+            {
+                continue;
+            }
+
+            // Random times around the kept ones, exact times and ranges
+            for (int query = 0; query < 20; query++)
+            {
+                const int64_t first = history.getFirstTime();
+                const int64_t queryTime = first - 1000000 + static_cast<int64_t>(random() % static_cast<uint64_t>(time - first + 2000001));
+                PoseHistory::Pose pose1, pose2;
+                const bool found1 = history.getPose(queryTime, pose1);
+                const bool found2 = getPose_Linear(reference, queryTime, pose2);
+
+                mismatches += (found1 != found2) || (found1 && !equal(pose1, pose2));
+
+                const PoseHistory::Pose& exact = reference[random() % reference.size()];
+
+                mismatches += !history.getPose(exact.time, pose1) || !equal(pose1, exact);
+
+                std::vector<PoseHistory::Pose> poses;
+                const int64_t t1 = queryTime + static_cast<int64_t>(random() % 50000000);
+                size_t expected = 0;
+
+                history.getPoses(queryTime, t1, poses);
+
+                for (const PoseHistory::Pose& referencePose : reference)
+                {
+                    if ((referencePose.time >= queryTime) && (referencePose.time <= t1))
+                    {
+                        mismatches += (expected >= poses.size()) || !equal(poses[expected], referencePose);
+                        expected++;
+                    }
+                }
+
+                mismatches += (expected != poses.size());
+                checks += 3;
+            }
+        }
+
+        out << (useMaxAge ? "With" : "Without") << " age limit: " << history.size() << " poses kept (" <<
+               QString::number((history.getLastTime() - history.getFirstTime()) / 1e9, 'f', 3) << " s)\n";
+    }
+
+    out << "Verified " << checks << " queries, mismatches: " << mismatches << "\n";
+
+    // Benchmark: "Pose at time" queries in a full history
+    PoseHistory history;
+    int64_t time = 0;
+
+    for (size_t i = 0; i < history.capacity(); i++)
+    {
+        PoseHistory::Pose pose;
+
+        time += 1000000;
+        pose.time = time;
+        pose.position = Eigen::Vector3d(uniform(random), uniform(random), uniform(random));
+        pose.orientation = Eigen::Quaterniond(uniform(random), uniform(random), uniform(random), uniform(random)).normalized();
+        history.append(pose);
+    }
+
+    const int queryCount = parser.value(queriesOption).toInt();
+    std::vector<int64_t> queryTimes(queryCount);
+
+    for (int i = 0; i < queryCount; i++)
+    {
+        queryTimes[i] = history.getFirstTime() + static_cast<int64_t>(random() % static_cast<uint64_t>(history.getLastTime() - history.getFirstTime()));
+    }
+
+    // Checksum of the results keeps the compiler from optimizing the queries away
+    double checksum = 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < queryCount; i++)
+    {
+        PoseHistory::Pose pose;
+
+        history.getPose(queryTimes[i], pose);
+        checksum += pose.position(0);
+    }
+
+    const double nsPerQuery = timer.nsecsElapsed() / static_cast<double>(queryCount);
+
+    out << "getPose with " << history.size() << " poses: " << QString::number(nsPerQuery, 'f', 1) << " ns/query\n";
+    out << "(checksum " << QString::number(checksum, 'g', 6) << ")\n";
+
+    return (mismatches == 0) ? 0 : 1;
+}
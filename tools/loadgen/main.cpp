@@ -0,0 +1,471 @@
+/*
+    main.cpp (loadgen, part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Load generator: Stands in for FerrySim_Godot by sending antenna datagrams
+// (same text format as the simulator) for a number of vessels at a given rate
+// and listening for the "1;", "2;" and "10;" replies of SimFerryController.
+// Reports round trip time, loss and reordering.
+//
+// Replies don't carry any sequence number, so every sample is "tagged" by
+// lifting the antennas by (tag * tagStep) metres. Lifting doesn't change the
+// rotation (or N/E-coordinates) so autopilot is not affected, but the tag
+// comes back in the Up-coordinate of the transform in the "1;" reply.
+
+#include <algorithm>
+#include <random>
+#include <math.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QNetworkDatagram>
+#include <QTextStream>
+#include <QTimer>
+#include <QUdpSocket>
+#include "ferrymodel.h"
+
+static const int tagCount = 10000;
+static const double tagStep = 0.002;        // m, replies have 1 mm resolution
+static const double vesselSpacing = 1000;   // m, vessels are placed to the east from each other
+
+enum Motion
+{
+    MOTION_CIRCLE = 0,      // Scripted: Constant speed on a circle
+    MOTION_RANDOM,          // Built-in ferry model with random (seeded) propulsion
+    MOTION_CLOSEDLOOP       // Built-in ferry model using propulsion ("2;") from the controller
+};
+
+struct SentSample
+{
+    qint64 sequence = -1;   // Running number over all vessels
+    qint64 sendTime = 0;    // ns
+    bool replied = false;
+};
+
+struct Statistics
+{
+    qint64 sent = 0;
+    qint64 replies_Transform = 0;
+    qint64 replies_Propulsion = 0;
+    qint64 replies_Debug = 0;
+    qint64 replies_Other = 0;
+    qint64 matched = 0;
+    qint64 unmatched = 0;           // Duplicate, too late (tag reused) or unknown tag
+    qint64 reordered = 0;           // Reply to an older sample after a newer one
+    qint64 frames = 0;              // Datagrams in framed output mode
+    std::vector<double> roundTripTimes;    // ms
+};
+
+static double percentile(std::vector<double> values, const double fraction)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+
+    std::sort(values.begin(), values.end());
+    return values[static_cast<size_t>(fraction * (values.size() - 1) + 0.5)];
+}
+
+static QString roundTripTimeString(const std::vector<double>& roundTripTimes)
+{
+    return "p50: " + QString::number(percentile(roundTripTimes, 0.5), 'f', 3) +
+            " ms, p99: " + QString::number(percentile(roundTripTimes, 0.99), 'f', 3) +
+            " ms, max: " + QString::number(percentile(roundTripTimes, 1), 'f', 3) + " ms";
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("loadgen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Sends simulated antenna datagrams to SimFerryController and measures the replies.");
+    parser.addHelpOption();
+
+    QCommandLineOption hostOption("host", "Address of the controller.", "address", "127.0.0.1");
+    QCommandLineOption sendPortOption("send-port", "Port the controller listens to (controller's \"Bind\" port).", "port", "65511");
+    QCommandLineOption listenPortOption("listen-port", "Port for the replies (controller's \"Send\" port).", "port", "65512");
+    QCommandLineOption vesselsOption("vessels", "Number of vessels.", "count", "1");
+    QCommandLineOption rateOption("rate", "Datagrams per second per vessel.", "hz", "8");
+    QCommandLineOption durationOption("duration", "Duration of sending (s).", "seconds", "10");
+    QCommandLineOption drainOption("drain", "Time to wait for late replies after sending (s).", "seconds", "1");
+    QCommandLineOption motionOption("motion", "Motion of the vessels: circle, random or closed-loop.", "motion", "circle");
+    QCommandLineOption seedOption("seed", "Seed for the random motion.", "seed", "1");
+    QCommandLineOption sequenceOption("sequence", "Append sequence number and vessel id to the datagrams.");
+    QCommandLineOption framedOption("framed", "Request framed output (all replies to one packet in one datagram).");
+
+    parser.addOptions({ hostOption, sendPortOption, listenPortOption, vesselsOption, rateOption,
+                        durationOption, drainOption, motionOption, seedOption, framedOption,
+                        sequenceOption });
+    parser.process(app);
+
+    QTextStream out(stdout);
+
+    const QHostAddress host(parser.value(hostOption));
+    const quint16 sendPort = parser.value(sendPortOption).toUShort();
+    const int vesselCount = qMax(1, parser.value(vesselsOption).toInt());
+    const double rate = parser.value(rateOption).toDouble();
+    const double duration = parser.value(durationOption).toDouble();
+    const double drain = parser.value(drainOption).toDouble();
+    const bool appendSequence = parser.isSet(sequenceOption);
+
+    Motion motion;
+
+    if (parser.value(motionOption) == "circle")
+    {
+        motion = MOTION_CIRCLE;
+    }
+    else if (parser.value(motionOption) == "random")
+    {
+        motion = MOTION_RANDOM;
+    }
+    else if (parser.value(motionOption) == "closed-loop")
+    {
+        motion = MOTION_CLOSEDLOOP;
+    }
+    else
+    {
+        out << "Unknown motion " << parser.value(motionOption) << "\n";
+        return 1;
+    }
+
+    if (rate <= 0)
+    {
+        out << "Rate must be positive.\n";
+        return 1;
+    }
+
+    if (vesselCount * rate * 2 > tagCount)
+    {
+        out << "Warning: Tags are reused in less than 2 seconds, late replies may be matched incorrectly.\n";
+    }
+
+    QUdpSocket socket;
+
+    if (!socket.bind(QHostAddress::Any, parser.value(listenPortOption).toUShort()))
+    {
+        out << "Binding to port " << parser.value(listenPortOption) << " failed.\n";
+        return 1;
+    }
+
+    std::vector<FerryModel> models(vesselCount, FerryModel(FerryModel::getDefaultParameters()));
+
+    for (int vessel = 0; vessel < vesselCount; vessel++)
+    {
+        FerryModel::State state = { 0, vessel * vesselSpacing, 0, 0, 0, 0 };
+        models[vessel].setState(state);
+    }
+
+    // mt19937_64's output is defined by the standard, distributions are not
+    std::mt19937_64 random(parser.value(seedOption).toULongLong());
+
+    auto randomDouble = [&random](const double min, const double max)
+    {
+        return min + (random() >> 11) * (1. / 9007199254740992.) * (max - min);
+    };
+
+    std::vector<SentSample> samples(tagCount);
+    Statistics statistics;
+    std::vector<double> intervalRoundTripTimes;
+    qint64 highestRepliedSequence = -1;
+    qint64 ticksSent = 0;
+    qint64 nextRandomOutputsTick = 0;
+    bool sending = true;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    auto sendTick = [&]()
+    {
+        const double time = ticksSent / rate;
+
+        if ((motion == MOTION_RANDOM) && (ticksSent >= nextRandomOutputsTick))
+        {
+            // New random propulsion every 10 seconds
+            for (FerryModel& model : models)
+            {
+                Autopilot::Outputs outputs;
+
+                outputs.valid = true;
+                outputs.direction_Front = randomDouble(-M_PI, M_PI);
+                outputs.propulsion_Front = randomDouble(0, 20000);
+                outputs.direction_Back = randomDouble(-M_PI, M_PI);
+                outputs.propulsion_Back = randomDouble(0, 20000);
+
+                model.setOutputs(outputs);
+            }
+
+            nextRandomOutputsTick += static_cast<qint64>(ceil(10 * rate));
+        }
+
+        for (int vessel = 0; vessel < vesselCount; vessel++)
+        {
+            FerryModel& model = models[vessel];
+
+            if (motion == MOTION_CIRCLE)
+            {
+                const double radius = 50;
+                const double speed = 2;
+                double angle = time * speed / radius + vessel;
+
+                FerryModel::State state = { radius * cos(angle), vessel * vesselSpacing + radius * sin(angle),
+                                            angle + M_PI / 2, speed, 0, speed / radius };
+                model.setState(state);
+            }
+            else if (ticksSent != 0)
+            {
+                model.advance(1. / rate);
+            }
+
+            double values[2 * 3 * 3];
+            model.getDatagramValues(values);
+
+            const qint64 sequence = statistics.sent;
+            const int tag = sequence % tagCount;
+
+            for (int point = 0; point < 3; point++)
+            {
+                values[point * 3 + 1] += tag * tagStep;
+            }
+
+            QByteArray datagram;
+
+            for (int i = 0; i < (2 * 3 * 3); i++)
+            {
+                if (i != 0)
+                {
+                    datagram.append(';');
+                }
+
+                datagram.append(QByteArray::number(values[i], 'f', 6));
+            }
+
+            if (appendSequence)
+            {
+                datagram.append(';');
+                datagram.append(QByteArray::number(ticksSent));
+                datagram.append(';');
+                datagram.append(QByteArray::number(vessel));
+            }
+
+            SentSample& sample = samples[tag];
+
+            sample.sequence = sequence;
+            sample.replied = false;
+            sample.sendTime = timer.nsecsElapsed();
+
+            socket.writeDatagram(datagram, host, sendPort);
+            statistics.sent++;
+        }
+
+        ticksSent++;
+    };
+
+    QTimer sendTimer;
+    sendTimer.setTimerType(Qt::PreciseTimer);
+    sendTimer.setInterval(qMax(1, static_cast<int>(500 / rate)));
+
+    QObject::connect(&sendTimer, &QTimer::timeout, [&]()
+    {
+        double elapsed = timer.nsecsElapsed() * 1e-9;
+
+        if (elapsed >= duration)
+        {
+            sendTimer.stop();
+            sending = false;
+
+            QTimer::singleShot(static_cast<int>(drain * 1000), &app, &QCoreApplication::quit);
+            return;
+        }
+
+        // Catch up all ticks due (timer may fire late)
+        while (ticksSent <= static_cast<qint64>(elapsed * rate))
+        {
+            sendTick();
+        }
+    });
+
+    auto handleCommand = [&](const QByteArray& command, const qint64 receiveTime)
+    {
+        QList<QByteArray> fields = command.split(';');
+
+        if (fields.at(0) == "1")
+        {
+            statistics.replies_Transform++;
+
+            if (fields.size() < 17)
+            {
+                statistics.unmatched++;
+                return;
+            }
+
+            // Up-coordinate of the transform (see "1;" in mainwindow.cpp)
+            int tag = static_cast<int>(lround(fields.at(8).toDouble() / tagStep)) % tagCount;
+
+            if (tag < 0)
+            {
+                tag += tagCount;
+            }
+
+            SentSample& sample = samples[tag];
+
+            if ((sample.sequence < 0) || sample.replied)
+            {
+                statistics.unmatched++;
+                return;
+            }
+
+            sample.replied = true;
+            statistics.matched++;
+
+            double roundTripTime = (receiveTime - sample.sendTime) * 1e-6;
+            statistics.roundTripTimes.push_back(roundTripTime);
+            intervalRoundTripTimes.push_back(roundTripTime);
+
+            if (sample.sequence < highestRepliedSequence)
+            {
+                statistics.reordered++;
+            }
+            else
+            {
+                highestRepliedSequence = sample.sequence;
+            }
+        }
+        else if (fields.at(0) == "2")
+        {
+            statistics.replies_Propulsion++;
+
+            if ((motion == MOTION_CLOSEDLOOP) && (fields.size() >= 5))
+            {
+                // Controller handles just one vessel, so all get the same propulsion
+                Autopilot::Outputs outputs;
+
+                outputs.valid = true;
+                outputs.direction_Front = fields.at(1).toDouble();
+                outputs.propulsion_Front = fields.at(2).toDouble();
+                outputs.direction_Back = fields.at(3).toDouble();
+                outputs.propulsion_Back = fields.at(4).toDouble();
+
+                for (FerryModel& model : models)
+                {
+                    model.setOutputs(outputs);
+                }
+            }
+        }
+        else if ((fields.at(0) == "10") || (fields.at(0) == "11"))
+        {
+            statistics.replies_Debug++;
+        }
+        else
+        {
+            statistics.replies_Other++;
+        }
+    };
+
+    QObject::connect(&socket, &QUdpSocket::readyRead, [&]()
+    {
+        while (socket.hasPendingDatagrams())
+        {
+            QNetworkDatagram datagram = socket.receiveDatagram();
+            const qint64 receiveTime = timer.nsecsElapsed();
+            const QByteArray data = datagram.data();
+
+            if (data.startsWith("F;"))
+            {
+                // Framed output: "F;<count>;<length>;<command><length>;<command>..."
+                statistics.frames++;
+
+                int position = data.indexOf(';', 2) + 1;
+
+                while (position > 0)
+                {
+                    int separator = data.indexOf(';', position);
+
+                    if (separator < 0)
+                    {
+                        break;
+                    }
+
+                    int length = data.mid(position, separator - position).toInt();
+
+                    handleCommand(data.mid(separator + 1, length), receiveTime);
+                    position = separator + 1 + length;
+                }
+            }
+            else if (data.startsWith("CAPS;"))
+            {
+                out << "Capabilities in use: " << data << "\n";
+            }
+            else
+            {
+                handleCommand(data, receiveTime);
+            }
+        }
+    });
+
+    QTimer reportTimer;
+    qint64 lastReportSent = 0;
+
+    QObject::connect(&reportTimer, &QTimer::timeout, [&]()
+    {
+        out << QString::number(timer.nsecsElapsed() * 1e-9, 'f', 1) << " s\tsent: " <<
+               (statistics.sent - lastReportSent) << "\treplies: " << intervalRoundTripTimes.size() <<
+               "\tRTT " << roundTripTimeString(intervalRoundTripTimes) << (sending ? "" : " (draining)") << "\n";
+        out.flush();
+
+        lastReportSent = statistics.sent;
+        intervalRoundTripTimes.clear();
+    });
+
+    if (parser.isSet(framedOption))
+    {
+        // Capability handshake, replies are in the legacy format until the controller answers
+        socket.writeDatagram("CAPS;FRAMED", host, sendPort);
+    }
+
+    sendTimer.start();
+    reportTimer.start(1000);
+
+    out << "Sending to " << host.toString() << ":" << sendPort << ", " << vesselCount << " vessel(s) at " <<
+           rate << " Hz, motion: " << parser.value(motionOption) << "\n";
+    out.flush();
+
+    app.exec();
+
+    const qint64 lost = statistics.sent - statistics.matched;
+
+    out << "\nSent: " << statistics.sent << " (" << QString::number(statistics.sent / duration, 'f', 1) << " /s)\n";
+    out << "Replies: \"1;\": " << statistics.replies_Transform << ", \"2;\": " << statistics.replies_Propulsion <<
+           ", \"10;\": " << statistics.replies_Debug << ", other: " << statistics.replies_Other <<
+           ", frames: " << statistics.frames << "\n";
+    out << "Matched: " << statistics.matched << ", lost: " << lost <<
+           " (" << QString::number(statistics.sent ? 100. * lost / statistics.sent : 0, 'f', 2) << " %)" <<
+           ", reordered: " << statistics.reordered << ", unmatched: " << statistics.unmatched << "\n";
+
+    double sum = 0;
+
+    for (double roundTripTime : statistics.roundTripTimes)
+    {
+        sum += roundTripTime;
+    }
+
+    out << "RTT mean: " << QString::number(statistics.roundTripTimes.empty() ? 0 : sum / statistics.roundTripTimes.size(), 'f', 3) <<
+           " ms, " << roundTripTimeString(statistics.roundTripTimes) << "\n";
+
+    return 0;
+}
@@ -0,0 +1,252 @@
+/*
+    main.cpp (pidbench, part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// PID benchmark: Checks that BatchPID gives bit-identical outputs to MiniPID
+// (random configurations covering every option, configuration changes and
+// resets between the updates) and measures the cost per controller update.
+
+#include <random>
+#include <string.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include "batchpid.h"
+#include "MiniPID/MiniPID.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("pidbench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Verifies and benchmarks BatchPID against MiniPID.");
+    parser.addHelpOption();
+
+    QCommandLineOption controllersOption("controllers", "Number of controllers.", "count", "10000");
+    QCommandLineOption stepsOption("steps", "Number of updates to verify.", "count", "1000");
+    QCommandLineOption benchStepsOption("bench-steps", "Number of updates to benchmark.", "count", "1000");
+    QCommandLineOption seedOption("seed", "Seed for the random configurations and values.", "seed", "1");
+
+    parser.addOptions({ controllersOption, stepsOption, benchStepsOption, seedOption });
+    parser.process(app);
+
+    QTextStream out(stdout);
+
+    // mt19937_64's output is defined by the standard, distributions are not
+    std::mt19937_64 random(parser.value(seedOption).toULongLong());
+
+    auto randomDouble = [&random](const double min, const double max)
+    {
+        return min + (random() >> 11) * (1. / 9007199254740992.) * (max - min);
+    };
+
+    // Options are enabled randomly, so that every combination occurs
+    auto enabled = [&random]()
+    {
+        return (random() & 1) != 0;
+    };
+
+    const int count = parser.value(controllersOption).toInt();
+
+    std::vector<MiniPID> miniPIDs(count);
+    BatchPID batchPID(count);
+
+    // Same calls to both
+    auto configure = [&](const int index)
+    {
+        const double p = randomDouble(0, 2);
+        const double i = enabled() ? randomDouble(0.001, 0.5) : 0;
+        const double d = enabled() ? randomDouble(0, 2) : 0;
+        const double f = enabled() ? randomDouble(0, 1) : 0;
+
+        miniPIDs[index].setPID(p, i, d, f);
+        batchPID.setPID(index, p, i, d, f);
+
+        if (enabled())
+        {
+            const double maxIOutput = randomDouble(0.1, 10);
+
+            miniPIDs[index].setMaxIOutput(maxIOutput);
+            batchPID.setMaxIOutput(index, maxIOutput);
+        }
+
+        if (enabled())
+        {
+            const double minimum = randomDouble(-20, 0);
+            const double maximum = randomDouble(0, 20);
+
+            miniPIDs[index].setOutputLimits(minimum, maximum);
+            batchPID.setOutputLimits(index, minimum, maximum);
+        }
+
+        if (enabled())
+        {
+            const double rate = randomDouble(0.1, 5);
+
+            miniPIDs[index].setOutputRampRate(rate);
+            batchPID.setOutputRampRate(index, rate);
+        }
+
+        if (enabled())
+        {
+            const double strength = randomDouble(0, 1);
+
+            miniPIDs[index].setOutputFilter(strength);
+            batchPID.setOutputFilter(index, strength);
+        }
+
+        if (enabled())
+        {
+            const double range = randomDouble(0.5, 10);
+
+            miniPIDs[index].setSetpointRange(range);
+            batchPID.setSetpointRange(index, range);
+        }
+
+        const bool reversed = ((random() % 8) == 0);
+
+        miniPIDs[index].setDirection(reversed);
+        batchPID.setDirection(index, reversed);
+
+        const double setpoint = randomDouble(-10, 10);
+
+        miniPIDs[index].setSetpoint(setpoint);
+        batchPID.setSetpoint(index, setpoint);
+    };
+
+    for (int index = 0; index < count; index++)
+    {
+        configure(index);
+    }
+
+    std::vector<double> actual(count);
+    std::vector<double> setpoints(count);
+    std::vector<double> miniOutputs(count);
+    std::vector<double> batchOutputs(count);
+
+    for (int index = 0; index < count; index++)
+    {
+        actual[index] = randomDouble(-10, 10);
+    }
+
+    const int steps = parser.value(stepsOption).toInt();
+    qint64 mismatches = 0;
+
+    for (int step = 0; step < steps; step++)
+    {
+        // Every 4th update with setpoints (getOutput(actual, setpoint))
+        const bool withSetpoints = ((step % 4) == 3);
+
+        for (int index = 0; index < count; index++)
+        {
+            actual[index] += randomDouble(-1, 1);
+            setpoints[index] = randomDouble(-10, 10);
+
+            // Configuration changes (setI scales errorSum) and resets between the updates
+            const uint64_t event = random() % 1000;
+
+            if (event == 0)
+            {
+                configure(index);
+            }
+            else if (event == 1)
+            {
+                const double i = randomDouble(0.001, 0.5);
+
+                miniPIDs[index].setI(i);
+                batchPID.setI(index, i);
+            }
+            else if (event == 2)
+            {
+                miniPIDs[index].reset();
+                batchPID.reset(index);
+            }
+
+            miniOutputs[index] = withSetpoints ? miniPIDs[index].getOutput(actual[index], setpoints[index]) :
+                                                 miniPIDs[index].getOutput(actual[index]);
+        }
+
+        if (withSetpoints)
+        {
+            batchPID.getOutputs(actual.data(), setpoints.data(), batchOutputs.data());
+        }
+        else
+        {
+            batchPID.getOutputs(actual.data(), batchOutputs.data());
+        }
+
+        for (int index = 0; index < count; index++)
+        {
+            if (memcmp(&miniOutputs[index], &batchOutputs[index], sizeof(double)) != 0)
+            {
+                if (mismatches < 10)
+                {
+                    out << "Mismatch: step " << step << ", controller " << index << ": " <<
+                           QString::number(miniOutputs[index], 'g', 17) << " vs " << QString::number(batchOutputs[index], 'g', 17) << "\n";
+                }
+
+                mismatches++;
+            }
+        }
+    }
+
+    out << "Verified " << static_cast<qint64>(steps) * count << " updates, mismatches: " << mismatches << "\n";
+
+    // Benchmark: Same controllers and inputs for both
+    const int benchSteps = parser.value(benchStepsOption).toInt();
+
+    // Checksum of the results keeps the compiler from optimizing the updates away
+    double checksum = 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int step = 0; step < benchSteps; step++)
+    {
+        for (int index = 0; index < count; index++)
+        {
+            miniOutputs[index] = miniPIDs[index].getOutput(actual[index] + step * 0.001);
+        }
+
+        checksum += miniOutputs[step % count];
+    }
+
+    const double miniPID_ns = timer.nsecsElapsed() / (static_cast<double>(benchSteps) * count);
+
+    timer.restart();
+
+    for (int step = 0; step < benchSteps; step++)
+    {
+        for (int index = 0; index < count; index++)
+        {
+            setpoints[index] = actual[index] + step * 0.001;
+        }
+
+        batchPID.getOutputs(setpoints.data(), batchOutputs.data());
+        checksum += batchOutputs[step % count];
+    }
+
+    const double batchPID_ns = timer.nsecsElapsed() / (static_cast<double>(benchSteps) * count);
+
+    out << "MiniPID:  " << QString::number(miniPID_ns, 'f', 2) << " ns/update\n";
+    out << "BatchPID: " << QString::number(batchPID_ns, 'f', 2) << " ns/update (" <<
+           QString::number(miniPID_ns / batchPID_ns, 'f', 1) << " x, including copying the inputs)\n";
+    out << "(checksum " << QString::number(checksum, 'g', 6) << ")\n";
+
+    return (mismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,6 @@
+include(../common.pri)
+
+TARGET = pidbench
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,530 @@
+/*
+    main.cpp (posesolve, part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Offline pose solver: Runs LOSolver over logged antenna positions (e.g. with
+// changed reference points) and writes the transforms and heading/pitch/roll in
+// the same order.
+//
+// Input (by extension, or --format):
+// - csv: A sample per line, 9 values (antenna points A, B, C as in the datagram)
+//   or 18 (+ reference points A, B, C). Separators: , ; space or tab.
+//   Lines that aren't samples (headers, comments) are skipped.
+// - bin: Raw doubles (native byte order), 9 per sample.
+// - sfcrec: Recording (points and the reference points recorded with them).
+// --reference overrides the reference points of the input (needed for 9 value samples).
+//
+// Output (.csv or binary): valid, transform (EUS, 3 rows x 4 columns, row-major)
+// and heading, pitch, roll (radians, heading in [0, 2 pi), see PoseSolver). Binary output
+// has 16 doubles per sample (valid = 1 or 0, NaNs when not valid).
+//
+// The input is read in blocks that are split into chunks (about 256 kB of text
+// or 4096 samples). Chunks are parsed, solved and formatted on all cores
+// (WorkerPool), and the results are written in order.
+
+#include <algorithm>
+#include <locale.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include "posesolver.h"
+#include "recording.h"
+#include "workerpool.h"
+
+enum Format
+{
+    FORMAT_CSV,
+    FORMAT_BIN,
+    FORMAT_SFCREC
+};
+
+static const int outputValueCount = 16;
+
+struct Settings
+{
+    bool referenceOverride = false;
+    double reference[9];
+    int precision = 17;
+    bool csvOutput = true;
+};
+
+// Result of a chunk
+struct ChunkOutput
+{
+    std::string data;
+    uint64_t samples = 0;
+    uint64_t failed = 0;
+    uint64_t skippedLines = 0;
+};
+
+static void appendOutput(const Settings& settings, const double output[outputValueCount], std::string& data)
+{
+    if (!settings.csvOutput)
+    {
+        data.append(reinterpret_cast<const char*>(output), outputValueCount * sizeof(double));
+        return;
+    }
+
+    char buffer[outputValueCount * 32];
+    int length = snprintf(buffer, sizeof(buffer), "%d", (output[0] != 0) ? 1 : 0);
+
+    for (int i = 1; i < outputValueCount; i++)
+    {
+        length += snprintf(buffer + length, sizeof(buffer) - length, ";%.*g", settings.precision, output[i]);
+    }
+
+    buffer[length++] = '\n';
+    data.append(buffer, length);
+}
+
+static void processSample(PoseSolver& solver, const Settings& settings, const double* points, const double* reference, ChunkOutput& output)
+{
+    double values[outputValueCount];
+    PoseSolver::Pose pose;
+
+    if (solver.solve(points, settings.referenceOverride ? settings.reference : reference, pose))
+    {
+        values[0] = 1;
+
+        for (int row = 0; row < 3; row++)
+        {
+            for (int column = 0; column < 4; column++)
+            {
+                values[1 + row * 4 + column] = pose.transform_EUS(row, column);
+            }
+        }
+
+        values[13] = pose.heading;
+        values[14] = pose.pitch;
+        values[15] = pose.roll;
+    }
+    else
+    {
+        values[0] = 0;
+
+        for (int i = 1; i < outputValueCount; i++)
+        {
+            values[i] = NAN;
+        }
+
+        output.failed++;
+    }
+
+    appendOutput(settings, values, output.data);
+    output.samples++;
+}
+
+static inline bool isSeparator(const char c)
+{
+    return (c == ',') || (c == ';') || (c == ' ') || (c == '\t') || (c == '\r');
+}
+
+// Returns the number of values (0 if the line is not a sample)
+static int parseLine(const char* begin, const char* end, double values[18])
+{
+    int count = 0;
+    const char* position = begin;
+
+    while (true)
+    {
+        while ((position < end) && isSeparator(*position))
+        {
+            position++;
+        }
+
+        if (position >= end)
+        {
+            break;
+        }
+
+        if (count >= 18)
+        {
+            return 0;
+        }
+
+        // Buffer is terminated by a newline or '\0', so strtod stops within it
+        char* valueEnd;
+        values[count] = strtod(position, &valueEnd);
+
+        if ((valueEnd == position) || (valueEnd > end) || ((valueEnd < end) && !isSeparator(*valueEnd)))
+        {
+            return 0;
+        }
+
+        count++;
+        position = valueEnd;
+    }
+
+    return ((count == 9) || (count == 18)) ? count : 0;
+}
+
+static void processCsvChunk(PoseSolver& solver, const Settings& settings, const char* begin, const char* end, ChunkOutput& output)
+{
+    const char* line = begin;
+
+    while (line < end)
+    {
+        const char* lineEnd = static_cast<const char*>(memchr(line, '\n', end - line));
+
+        if (!lineEnd)
+        {
+            lineEnd = end;
+        }
+
+        double values[18];
+        const int count = parseLine(line, lineEnd, values);
+
+        if ((count == 18) || ((count == 9) && settings.referenceOverride))
+        {
+            processSample(solver, settings, values, &values[9], output);
+        }
+        else if (lineEnd > line)
+        {
+            output.skippedLines++;
+        }
+
+        line = lineEnd + 1;
+    }
+}
+
+static void writeOutputs(FILE* file, const std::vector<ChunkOutput>& outputs, const size_t count, ChunkOutput& totals)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        fwrite(outputs[i].data.data(), 1, outputs[i].data.size(), file);
+        totals.samples += outputs[i].samples;
+        totals.failed += outputs[i].failed;
+        totals.skippedLines += outputs[i].skippedLines;
+    }
+}
+
+static bool parseReference(const QString& text, double reference[9])
+{
+    const QStringList parts = text.split(',');
+
+    if (parts.size() != 9)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < 9; i++)
+    {
+        bool ok;
+        reference[i] = parts[i].toDouble(&ok);
+
+        if (!ok)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("posesolve");
+
+    // QCoreApplication sets the locale from the environment, parsing and formatting need '.'
+    setlocale(LC_NUMERIC, "C");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Solves poses from logged antenna positions on all cores.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("input", "Antenna positions (.csv, raw doubles or .sfcrec).");
+    parser.addPositionalArgument("output", "Poses (.csv or binary).");
+
+    QCommandLineOption formatOption("format", "Input format: csv, bin or sfcrec (default: by extension).", "format");
+    QCommandLineOption referenceOption("reference", "Reference points A, B, C (9 comma separated values, EUS).", "values");
+    QCommandLineOption threadsOption("threads", "Number of threads (0 = all cores).", "count", "0");
+    QCommandLineOption precisionOption("precision", "Significant digits in csv output.", "digits", "17");
+    QCommandLineOption blockSizeOption("block-size", "Input block size (MB).", "size", "32");
+
+    parser.addOptions({ formatOption, referenceOption, threadsOption, precisionOption, blockSizeOption });
+    parser.process(app);
+
+    QTextStream out(stdout);
+    const QStringList arguments = parser.positionalArguments();
+
+    if (arguments.size() != 2)
+    {
+        parser.showHelp(1);
+    }
+
+    const QString inFile = arguments[0];
+    const QString outFile = arguments[1];
+    QString formatName = parser.value(formatOption);
+
+    if (formatName.isEmpty())
+    {
+        formatName = inFile.endsWith(".sfcrec", Qt::CaseInsensitive) ? "sfcrec" :
+                     (inFile.endsWith(".csv", Qt::CaseInsensitive) || inFile.endsWith(".txt", Qt::CaseInsensitive)) ? "csv" : "bin";
+    }
+
+    Format format;
+
+    if (formatName == "csv")
+    {
+        format = FORMAT_CSV;
+    }
+    else if (formatName == "bin")
+    {
+        format = FORMAT_BIN;
+    }
+    else if (formatName == "sfcrec")
+    {
+        format = FORMAT_SFCREC;
+    }
+    else
+    {
+        out << "Unknown format " << formatName << "\n";
+        return 1;
+    }
+
+    Settings settings;
+
+    settings.precision = parser.value(precisionOption).toInt();
+    settings.csvOutput = outFile.endsWith(".csv", Qt::CaseInsensitive);
+
+    if (parser.isSet(referenceOption))
+    {
+        if (!parseReference(parser.value(referenceOption), settings.reference))
+        {
+            out << "Reference points need 9 numbers\n";
+            return 1;
+        }
+
+        settings.referenceOverride = true;
+    }
+    else if (format == FORMAT_BIN)
+    {
+        out << "Raw binary input needs --reference\n";
+        return 1;
+    }
+
+    RecordingReader recording;
+    FILE* input = nullptr;
+
+    if (format == FORMAT_SFCREC)
+    {
+        if (!recording.open(inFile.toStdString()))
+        {
+            out << "Can't open recording " << inFile << "\n";
+            return 1;
+        }
+    }
+    else if (!(input = fopen(inFile.toLocal8Bit().constData(), "rb")))
+    {
+        out << "Can't open " << inFile << "\n";
+        return 1;
+    }
+
+    FILE* output = fopen(outFile.toLocal8Bit().constData(), "wb");
+
+    if (!output)
+    {
+        out << "Can't create " << outFile << "\n";
+        return 1;
+    }
+
+    if (settings.csvOutput)
+    {
+        fputs("valid;t00;t01;t02;t03;t10;t11;t12;t13;t20;t21;t22;t23;heading;pitch;roll\n", output);
+    }
+
+    WorkerPool pool(parser.value(threadsOption).toUInt());
+    std::vector<PoseSolver> solvers(pool.getThreadCount());
+    std::vector<ChunkOutput> outputs;
+    ChunkOutput totals;
+
+    const size_t blockSize = std::max(1, parser.value(blockSizeOption).toInt()) * size_t(1024 * 1024);
+    const size_t chunkBytes = 256 * 1024;
+    const size_t chunkSamples = 4096;
+    const size_t sampleBytes = 9 * sizeof(double);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (format == FORMAT_SFCREC)
+    {
+        const uint64_t blockRecords = blockSize / sizeof(RecordingRecord);
+
+        for (uint64_t first = 0; first < recording.getRecordCount(); first += blockRecords)
+        {
+            const uint64_t count = std::min<uint64_t>(blockRecords, recording.getRecordCount() - first);
+            const size_t chunkCount = (count + chunkSamples - 1) / chunkSamples;
+
+            outputs.resize(std::max(outputs.size(), chunkCount));
+
+            pool.run(chunkCount, [&](size_t chunk, unsigned int threadIndex)
+            {
+                ChunkOutput& chunkOutput = outputs[chunk];
+                const uint64_t end = std::min<uint64_t>(count, (chunk + 1) * chunkSamples);
+
+                chunkOutput = ChunkOutput();
+
+                for (uint64_t i = chunk * chunkSamples; i < end; i++)
+                {
+                    const RecordingRecord& record = recording.getRecord(first + i);
+                    processSample(solvers[threadIndex], settings, &record.points[0], &record.points[9], chunkOutput);
+                }
+            });
+
+            writeOutputs(output, outputs, chunkCount, totals);
+            recording.release(first, count);
+        }
+    }
+    else if (format == FORMAT_BIN)
+    {
+        std::vector<double> block(blockSize / sizeof(double) / 9 * 9);
+
+        while (true)
+        {
+            const size_t count = fread(block.data(), sampleBytes, block.size() / 9, input);
+            const size_t chunkCount = (count + chunkSamples - 1) / chunkSamples;
+
+            if (count == 0)
+            {
+                break;
+            }
+
+            outputs.resize(std::max(outputs.size(), chunkCount));
+
+            pool.run(chunkCount, [&](size_t chunk, unsigned int threadIndex)
+            {
+                ChunkOutput& chunkOutput = outputs[chunk];
+                const size_t end = std::min(count, (chunk + 1) * chunkSamples);
+
+                chunkOutput = ChunkOutput();
+
+                for (size_t i = chunk * chunkSamples; i < end; i++)
+                {
+                    processSample(solvers[threadIndex], settings, &block[i * 9], nullptr, chunkOutput);
+                }
+            });
+
+            writeOutputs(output, outputs, chunkCount, totals);
+        }
+    }
+    else
+    {
+        // Block + '\0' (strtod stops there). Partial last line is moved to the next block.
+        std::vector<char> block(blockSize + 1);
+        size_t carried = 0;
+
+        while (true)
+        {
+            const size_t bytesRead = fread(block.data() + carried, 1, blockSize - carried, input);
+            size_t size = carried + bytesRead;
+
+            if (size == 0)
+            {
+                break;
+            }
+
+            size_t end = size;
+
+            if (bytesRead > 0)
+            {
+                while ((end > 0) && (block[end - 1] != '\n'))
+                {
+                    end--;
+                }
+
+                if (end == 0)
+                {
+                    if (size == blockSize)
+                    {
+                        out << "Line longer than the block size\n";
+                        return 1;
+                    }
+
+                    end = size;
+                }
+            }
+
+            // Chunks end at line ends
+            std::vector<size_t> chunkStarts(1, 0);
+
+            while (chunkStarts.back() + chunkBytes < end)
+            {
+                const char* newline = static_cast<const char*>(memchr(block.data() + chunkStarts.back() + chunkBytes, '\n',
+                                                                      end - chunkStarts.back() - chunkBytes));
+                const size_t next = newline ? (newline - block.data()) + 1 : end;
+
+                if (next >= end)
+                {
+                    break;
+                }
+
+                chunkStarts.push_back(next);
+            }
+
+            chunkStarts.push_back(end);
+
+            const size_t chunkCount = chunkStarts.size() - 1;
+            const char savedEnd = block[end];
+
+            block[end] = '\0';
+            outputs.resize(std::max(outputs.size(), chunkCount));
+
+            pool.run(chunkCount, [&](size_t chunk, unsigned int threadIndex)
+            {
+                outputs[chunk] = ChunkOutput();
+                processCsvChunk(solvers[threadIndex], settings, block.data() + chunkStarts[chunk],
+                                block.data() + chunkStarts[chunk + 1], outputs[chunk]);
+            });
+
+            block[end] = savedEnd;
+            writeOutputs(output, outputs, chunkCount, totals);
+
+            carried = size - end;
+            memmove(block.data(), block.data() + end, carried);
+
+            if ((bytesRead == 0) && (carried == 0))
+            {
+                break;
+            }
+        }
+    }
+
+    const double elapsed = timer.nsecsElapsed() * 1e-9;
+    const bool writeOk = (fclose(output) == 0);
+
+    if (input)
+    {
+        fclose(input);
+    }
+
+    out << "Solved " << totals.samples << " samples in " << QString::number(elapsed, 'f', 3) << " s (" <<
+           QString::number(totals.samples / elapsed * 1e-6, 'f', 3) << " M samples/s, " << pool.getThreadCount() << " threads)\n";
+    out << "Failed: " << totals.failed << ", skipped lines: " << totals.skippedLines << "\n";
+
+    if (!writeOk)
+    {
+        out << "Writing " << outFile << " failed\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,6 @@
+include(../common.pri)
+
+TARGET = posesolve
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,633 @@
+/*
+    main.cpp (shmbench, part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Shared memory transport test harness: Forks a "controller" process (solver +
+// autopilot, like MainWindow) and acts as the simulator, sending antenna points
+// one at a time and waiting for the replies. Measures the round trip time of
+// the shared memory transport (futex wakeup / busy-polling) and of loopback UDP
+// with the text protocol. Replies are checked to belong to the sample sent.
+
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <locale.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include "ferrymodel.h"
+#include "losolver.h"
+#include "outputencoder.h"
+#include "shmtransport.h"
+
+enum Transport
+{
+    TRANSPORT_SHM_FUTEX = 0,
+    TRANSPORT_SHM_BUSYPOLL,
+    TRANSPORT_UDP,
+
+    TRANSPORT_COUNT
+};
+
+static const char* const transportNames[TRANSPORT_COUNT] = { "shm-futex", "shm-busypoll", "udp" };
+
+struct BenchSettings
+{
+    int messages;
+    int warmup;
+    bool solve;
+    int port;
+};
+
+struct BenchResult
+{
+    bool ok;
+    double p50;             // us
+    double p99;
+    double max;
+    double messagesPerSecond;
+    int mismatches;         // Replies not matching the sample sent
+};
+
+// Does what MainWindow does for each sample. Returns false if the points can't be solved.
+class Controller
+{
+public:
+    Controller(const bool solve) : solve(solve)
+    {
+        autopilot.init(Autopilot::getDefaultSettings());
+
+        Autopilot::Destination destination = { 100, 100, 0 };
+        autopilot.setDestination(destination);
+    }
+
+    bool process(const double* values, Eigen::Transform<double, 3, Eigen::Affine>& transform_EUS, Autopilot::Outputs& outputs)
+    {
+        if (!solve)
+        {
+            transform_EUS.setIdentity();
+            transform_EUS.translation() = Eigen::Vector3d(values[0], values[1], values[2]);
+            outputs.valid = false;
+            outputs.direction_Front = outputs.propulsion_Front = outputs.direction_Back = outputs.propulsion_Back = 0;
+            return true;
+        }
+
+        loSolver.setReferencePoints(Eigen::Vector3d(values[9], values[10], values[11]),
+                Eigen::Vector3d(values[12], values[13], values[14]),
+                Eigen::Vector3d(values[15], values[16], values[17]));
+
+        loSolver.setPoints(Eigen::Vector3d(values[0], values[1], values[2]),
+                Eigen::Vector3d(values[3], values[4], values[5]),
+                Eigen::Vector3d(values[6], values[7], values[8]));
+
+        if (!loSolver.getTransformMatrix(transform_EUS))
+        {
+            return false;
+        }
+
+        Eigen::Transform<double, 3, Eigen::Affine> transform_NED = LOSolver::changeAxesConvention(transform_EUS, LOSolver::AC_EUS, LOSolver::AC_NED);
+        autopilot.update(transform_NED, outputs, 0.125);
+
+        return true;
+    }
+
+private:
+    bool solve;
+    LOSolver loSolver;
+    Autopilot autopilot;
+};
+
+static void getSampleValues(FerryModel& model, const int index, double values[2 * 3 * 3])
+{
+    const double angle = index * 0.001;
+    FerryModel::State state = { 50 * cos(angle), 50 * sin(angle), angle + M_PI / 2, 2, 0, 0.04 };
+
+    model.setState(state);
+    model.getDatagramValues(values);
+}
+
+static BenchResult calculateResult(std::vector<double>& roundTripTimes, const double totalTime, const int mismatches)
+{
+    BenchResult result;
+
+    std::sort(roundTripTimes.begin(), roundTripTimes.end());
+
+    result.ok = !roundTripTimes.empty();
+    result.mismatches = mismatches;
+
+    if (result.ok)
+    {
+        result.p50 = roundTripTimes[roundTripTimes.size() / 2] / 1000.;
+        result.p99 = roundTripTimes[(roundTripTimes.size() * 99) / 100] / 1000.;
+        result.max = roundTripTimes.back() / 1000.;
+        result.messagesPerSecond = roundTripTimes.size() / (totalTime * 1e-9);
+    }
+
+    return result;
+}
+
+// Controller process (shared memory)
+static int runShmController(const std::string& name, const ShmTransport::WaitMode waitMode, const bool solve, const int readyFd)
+{
+    ShmTransport transport;
+
+    if (!transport.open(name, ShmTransport::ROLE_CONTROLLER))
+    {
+        return 1;
+    }
+
+    char ready = 1;
+
+    if (write(readyFd, &ready, 1) != 1)
+    {
+        return 1;
+    }
+
+    Controller controller(solve);
+    ShmTransport::Record record;
+
+    while (transport.waitReceive(record, waitMode, -1))
+    {
+        if (record.valueCount < (2 * 3 * 3))
+        {
+            // Empty record = stop
+            break;
+        }
+
+        Eigen::Transform<double, 3, Eigen::Affine> transform_EUS;
+        Autopilot::Outputs outputs;
+        ShmTransport::Record reply;
+
+        reply.vessel = record.vessel;
+        reply.sequence = record.sequence;
+        reply.timestamp = record.timestamp;
+        reply.reserved = 0;
+
+        if (!controller.process(record.values, transform_EUS, outputs))
+        {
+            continue;
+        }
+
+        reply.type = ShmTransport::RECORD_TRANSFORM;
+        reply.valueCount = 16;
+        OutputEncoder::getTransformValues(transform_EUS, reply.values);
+        transport.send(reply);
+
+        reply.type = ShmTransport::RECORD_PROPULSION;
+        reply.valueCount = 4;
+        reply.values[0] = outputs.direction_Front;
+        reply.values[1] = outputs.propulsion_Front;
+        reply.values[2] = outputs.direction_Back;
+        reply.values[3] = outputs.propulsion_Back;
+        transport.send(reply);
+    }
+
+    return 0;
+}
+
+static BenchResult runShm(const BenchSettings& settings, const ShmTransport::WaitMode waitMode)
+{
+    BenchResult failed = { false, 0, 0, 0, 0, 0 };
+    const std::string name = std::string(ShmTransport::defaultName) + "-shmbench-" + std::to_string(getpid());
+    int readyPipe[2];
+
+    if (pipe(readyPipe) != 0)
+    {
+        return failed;
+    }
+
+    pid_t child = fork();
+
+    if (child == 0)
+    {
+        ::close(readyPipe[0]);
+        int retVal = runShmController(name, waitMode, settings.solve, readyPipe[1]);
+        fflush(stdout);
+        _exit(retVal);
+    }
+
+    ::close(readyPipe[1]);
+
+    char ready = 0;
+    bool childReady = (child > 0) && (read(readyPipe[0], &ready, 1) == 1);
+
+    ::close(readyPipe[0]);
+
+    ShmTransport transport;
+
+    if (!childReady || !transport.open(name, ShmTransport::ROLE_SIMULATOR))
+    {
+        if (child > 0)
+        {
+            waitpid(child, nullptr, 0);
+        }
+        return failed;
+    }
+
+    FerryModel model(FerryModel::getDefaultParameters());
+    std::vector<double> roundTripTimes;
+    int mismatches = 0;
+    uint64_t startTime = 0;
+
+    roundTripTimes.reserve(settings.messages);
+
+    for (int i = 0; i < (settings.warmup + settings.messages); i++)
+    {
+        if (i == settings.warmup)
+        {
+            startTime = ShmTransport::getTimestamp();
+        }
+
+        ShmTransport::Record record;
+
+        record.type = ShmTransport::RECORD_ANTENNAPOINTS;
+        record.vessel = 0;
+        record.sequence = i;
+        record.valueCount = 2 * 3 * 3;
+        record.reserved = 0;
+        getSampleValues(model, i, record.values);
+        record.timestamp = ShmTransport::getTimestamp();
+
+        transport.send(record);
+
+        // Propulsion is the last reply of a sample
+        ShmTransport::Record reply;
+        bool received;
+
+        while ((received = transport.waitReceive(reply, waitMode, 1000000000)) &&
+               (reply.type != ShmTransport::RECORD_PROPULSION))
+        {
+            if ((reply.type != ShmTransport::RECORD_TRANSFORM) || (reply.sequence != record.sequence))
+            {
+                mismatches++;
+            }
+        }
+
+        if (!received)
+        {
+            // Timeout (controller died?)
+            break;
+        }
+
+        const uint64_t now = ShmTransport::getTimestamp();
+
+        if ((reply.sequence != record.sequence) || (reply.timestamp != record.timestamp))
+        {
+            mismatches++;
+        }
+
+        if (i >= settings.warmup)
+        {
+            roundTripTimes.push_back(now - reply.timestamp);
+        }
+    }
+
+    const uint64_t totalTime = ShmTransport::getTimestamp() - startTime;
+
+    ShmTransport::Record stop;
+    memset(&stop, 0, sizeof(stop));
+    transport.send(stop);
+
+    waitpid(child, nullptr, 0);
+    transport.close();
+
+    return calculateResult(roundTripTimes, totalTime, mismatches);
+}
+
+static int openUdpSocket(const int localPort, const int remotePort)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(localPort);
+
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+
+    address.sin_port = htons(remotePort);
+
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// Controller process (UDP, text protocol like MainWindow)
+static int runUdpController(const int port, const bool solve, const int readyFd)
+{
+    int fd = openUdpSocket(port, port + 1);
+
+    if (fd < 0)
+    {
+        return 1;
+    }
+
+    char ready = 1;
+
+    if (write(readyFd, &ready, 1) != 1)
+    {
+        return 1;
+    }
+
+    Controller controller(solve);
+    char inBuffer[2048];
+    char outBuffer[OutputEncoder::bufferSize];
+
+    for (;;)
+    {
+        ssize_t length = recv(fd, inBuffer, sizeof(inBuffer) - 1, 0);
+
+        if (length <= 0)
+        {
+            continue;
+        }
+
+        inBuffer[length] = 0;
+
+        if (strcmp(inBuffer, "STOP") == 0)
+        {
+            break;
+        }
+
+        double values[2 * 3 * 3];
+        char* source = inBuffer;
+        int valueCount;
+
+        for (valueCount = 0; valueCount < (2 * 3 * 3); valueCount++)
+        {
+            char* end;
+            values[valueCount] = strtod(source, &end);
+
+            if ((end == source) || ((*end != ';') && (*end != 0)))
+            {
+                break;
+            }
+
+            source = (*end == ';') ? (end + 1) : end;
+        }
+
+        Eigen::Transform<double, 3, Eigen::Affine> transform_EUS;
+        Autopilot::Outputs outputs;
+
+        if ((valueCount != (2 * 3 * 3)) || !controller.process(values, transform_EUS, outputs))
+        {
+            continue;
+        }
+
+        int outLength = OutputEncoder::encodeTransform(outBuffer, 1, transform_EUS);
+        send(fd, outBuffer, outLength, 0);
+
+        outLength = OutputEncoder::encodePropulsion(outBuffer, outputs);
+        send(fd, outBuffer, outLength, 0);
+    }
+
+    ::close(fd);
+    return 0;
+}
+
+static BenchResult runUdp(const BenchSettings& settings)
+{
+    BenchResult failed = { false, 0, 0, 0, 0, 0 };
+    int readyPipe[2];
+
+    if (pipe(readyPipe) != 0)
+    {
+        return failed;
+    }
+
+    pid_t child = fork();
+
+    if (child == 0)
+    {
+        ::close(readyPipe[0]);
+        int retVal = runUdpController(settings.port, settings.solve, readyPipe[1]);
+        fflush(stdout);
+        _exit(retVal);
+    }
+
+    ::close(readyPipe[1]);
+
+    char ready = 0;
+    bool childReady = (child > 0) && (read(readyPipe[0], &ready, 1) == 1);
+
+    ::close(readyPipe[0]);
+
+    int fd = childReady ? openUdpSocket(settings.port + 1, settings.port) : -1;
+
+    if (fd < 0)
+    {
+        if (child > 0)
+        {
+            kill(child, SIGTERM);
+            waitpid(child, nullptr, 0);
+        }
+        return failed;
+    }
+
+    timeval timeout = { 1, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    FerryModel model(FerryModel::getDefaultParameters());
+    std::vector<double> roundTripTimes;
+    int mismatches = 0;
+    uint64_t startTime = 0;
+
+    roundTripTimes.reserve(settings.messages);
+
+    for (int i = 0; i < (settings.warmup + settings.messages); i++)
+    {
+        if (i == settings.warmup)
+        {
+            startTime = ShmTransport::getTimestamp();
+        }
+
+        double values[2 * 3 * 3];
+        char outBuffer[1024];
+        int outLength = 0;
+
+        getSampleValues(model, i, values);
+
+        for (int value = 0; value < (2 * 3 * 3); value++)
+        {
+            outLength += snprintf(outBuffer + outLength, sizeof(outBuffer) - outLength, value ? ";%.6f" : "%.6f", values[value]);
+        }
+
+        const uint64_t sendTime = ShmTransport::getTimestamp();
+
+        send(fd, outBuffer, outLength, 0);
+
+        // Replies can't carry the sequence number, but as only one sample is in flight
+        // the transform and propulsion are checked to arrive in this order.
+        char inBuffer[OutputEncoder::bufferSize];
+        ssize_t length = recv(fd, inBuffer, sizeof(inBuffer), 0);
+
+        if ((length < 2) || (strncmp(inBuffer, "1;", 2) != 0))
+        {
+            mismatches++;
+        }
+
+        length = recv(fd, inBuffer, sizeof(inBuffer), 0);
+
+        if (length < 0)
+        {
+            // Timeout (controller died?)
+            break;
+        }
+
+        if ((length < 2) || (strncmp(inBuffer, "2;", 2) != 0))
+        {
+            mismatches++;
+        }
+
+        if (i >= settings.warmup)
+        {
+            roundTripTimes.push_back(ShmTransport::getTimestamp() - sendTime);
+        }
+    }
+
+    const uint64_t totalTime = ShmTransport::getTimestamp() - startTime;
+
+    send(fd, "STOP", 4, 0);
+    waitpid(child, nullptr, 0);
+    ::close(fd);
+
+    return calculateResult(roundTripTimes, totalTime, mismatches);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("shmbench");
+
+    // QCoreApplication sets the locale from the environment, the protocol needs '.' (strtod, snprintf)
+    setlocale(LC_NUMERIC, "C");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures round trip times of the shared memory transport and loopback UDP.");
+    parser.addHelpOption();
+
+    QCommandLineOption transportOption("transport", "Transport to test: shm-futex, shm-busypoll, udp or all.", "transport", "all");
+    QCommandLineOption messagesOption("messages", "Number of samples to measure.", "count", "20000");
+    QCommandLineOption warmupOption("warmup", "Number of samples sent before measuring.", "count", "1000");
+    QCommandLineOption noSolveOption("no-solve", "Don't run solver and autopilot in the controller (transport only).");
+    QCommandLineOption portOption("port", "First of the two UDP ports used.", "port", "65521");
+
+    parser.addOptions({ transportOption, messagesOption, warmupOption, noSolveOption, portOption });
+    parser.process(app);
+
+    QTextStream out(stdout);
+
+    BenchSettings settings;
+    settings.messages = parser.value(messagesOption).toInt();
+    settings.warmup = parser.value(warmupOption).toInt();
+    settings.solve = !parser.isSet(noSolveOption);
+    settings.port = parser.value(portOption).toInt();
+
+    if (settings.messages <= 0)
+    {
+        out << "Invalid number of messages.\n";
+        return 1;
+    }
+
+    const QString transportName = parser.value(transportOption);
+    bool found = false;
+    bool failed = false;
+
+    out << "transport\tp50_us\tp99_us\tmax_us\tmsgs_per_s\tmismatches\n";
+
+    for (int transport = 0; transport < TRANSPORT_COUNT; transport++)
+    {
+        if ((transportName != "all") && (transportName != transportNames[transport]))
+        {
+            continue;
+        }
+
+        found = true;
+
+        // Output must be flushed before forking (child would print it again)
+        out.flush();
+        fflush(stdout);
+
+        BenchResult result;
+
+        switch (transport)
+        {
+        case TRANSPORT_SHM_FUTEX:
+            result = runShm(settings, ShmTransport::WAIT_FUTEX);
+            break;
+        case TRANSPORT_SHM_BUSYPOLL:
+            result = runShm(settings, ShmTransport::WAIT_BUSYPOLL);
+            break;
+        case TRANSPORT_UDP:
+        default:
+            result = runUdp(settings);
+            break;
+        }
+
+        if (!result.ok)
+        {
+            out << transportNames[transport] << "\tfailed\n";
+            failed = true;
+            continue;
+        }
+
+        out << transportNames[transport] << "\t" <<
+               QString::number(result.p50, 'f', 2) << "\t" <<
+               QString::number(result.p99, 'f', 2) << "\t" <<
+               QString::number(result.max, 'f', 2) << "\t" <<
+               QString::number(result.messagesPerSecond, 'f', 0) << "\t" <<
+               result.mismatches << "\n";
+        out.flush();
+
+        if (result.mismatches != 0)
+        {
+            failed = true;
+        }
+    }
+
+    if (!found)
+    {
+        out << "Unknown transport: " << transportName << "\n";
+        return 1;
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,6 @@
+include(../common.pri)
+
+TARGET = shmbench
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,15 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    archive \
+    arrowexport \
+    calibrate \
+    campaign \
+    encoderbench \
+    headless \
+    historybench \
+    loadgen \
+    pidbench \
+    posesolve \
+    shmbench \
+    tuner
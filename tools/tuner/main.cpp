@@ -0,0 +1,122 @@
+/*
+    main.cpp (tuner, part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Autopilot tuner: Searches autopilot settings (PID-gains etc.) minimizing
+// the cost of a set of seeded random missions using differential evolution.
+// Best settings are saved to an ini-file that can be loaded to SimFerryController.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include "autopilottuner.h"
+#include "autopilotsettingsfile.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("tuner");
+
+    AutopilotTuner::Settings tunerSettings = AutopilotTuner::getDefaultSettings();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Tunes autopilot settings using differential evolution on simulated missions.");
+    parser.addHelpOption();
+
+    QCommandLineOption populationOption("population", "Population size.", "count", QString::number(tunerSettings.populationSize));
+    QCommandLineOption generationsOption("generations", "Number of generations.", "count", QString::number(tunerSettings.generations));
+    QCommandLineOption missionsOption("missions", "Number of missions per evaluation.", "count", "20");
+    QCommandLineOption seedOption("seed", "Seed for the missions and the search.", "seed", "1");
+    QCommandLineOption threadsOption("threads", "Number of threads (0 = all cores).", "count", "0");
+    QCommandLineOption initialOption("initial", "Initial settings (ini-file). Default: built-in settings.", "file");
+    QCommandLineOption outputOption("output", "Output file for the best settings.", "file", "autopilot_tuned.ini");
+    QCommandLineOption maxTimeOption("max-time", "Maximum time for one mission (s).", "seconds", "600");
+    QCommandLineOption currentOption("max-current", "Maximum (random) water current (m/s).", "speed", "0");
+    QCommandLineOption windOption("max-wind", "Maximum (random) wind force (N).", "force", "0");
+    QCommandLineOption noiseOption("noise", "GNSS noise (standard deviation, m).", "metres", "0");
+
+    parser.addOptions({ populationOption, generationsOption, missionsOption, seedOption, threadsOption,
+                        initialOption, outputOption, maxTimeOption, currentOption, windOption, noiseOption });
+    parser.process(app);
+
+    QTextStream out(stdout);
+
+    const int missionCount = parser.value(missionsOption).toInt();
+    const uint64_t seed = parser.value(seedOption).toULongLong();
+
+    tunerSettings.populationSize = parser.value(populationOption).toInt();
+    tunerSettings.generations = parser.value(generationsOption).toInt();
+    tunerSettings.seed = seed;
+    tunerSettings.threadCount = parser.value(threadsOption).toUInt();
+
+    Autopilot::Settings initialSettings = Autopilot::getDefaultSettings();
+
+    if (parser.isSet(initialOption) &&
+            !AutopilotSettingsFile::load(parser.value(initialOption).toStdString(), initialSettings))
+    {
+        out << "Can't load initial settings from " << parser.value(initialOption) << "\n";
+        return 1;
+    }
+
+    MissionSimulator::MissionRanges ranges = MissionSimulator::getDefaultMissionRanges();
+    ranges.maxCurrent = parser.value(currentOption).toDouble();
+    ranges.maxWindForce = parser.value(windOption).toDouble();
+    ranges.gnssNoise = parser.value(noiseOption).toDouble();
+
+    MissionSimulator::SimulationSettings simulationSettings = MissionSimulator::getDefaultSimulationSettings();
+    simulationSettings.maxTime = parser.value(maxTimeOption).toDouble();
+
+    std::vector<MissionSimulator::Mission> missions;
+
+    for (int i = 0; i < missionCount; i++)
+    {
+        missions.push_back(MissionSimulator::generateMission(seed, i, ranges));
+    }
+
+    AutopilotTuner tuner(tunerSettings, missions, simulationSettings);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    out << "Initial cost: " << QString::number(tuner.evaluate(initialSettings), 'f', 3) << "\n";
+    out.flush();
+
+    Autopilot::Settings bestSettings = tuner.tune(initialSettings,
+                                                  [&out, &timer](const AutopilotTuner::Progress& progress)
+    {
+        out << "Generation " << progress.generation + 1 <<
+               "\tbest: " << QString::number(progress.bestCost, 'f', 3) <<
+               "\tmean: " << QString::number(progress.meanCost, 'f', 3) <<
+               "\tevaluations: " << progress.evaluations <<
+               " (terminated early: " << progress.terminatedEarly << ")" <<
+               "\telapsed: " << QString::number(timer.nsecsElapsed() * 1e-9, 'f', 1) << " s\n";
+        out.flush();
+    });
+
+    out << "Best cost: " << QString::number(tuner.getBestCost(), 'f', 3) << "\n";
+
+    if (!AutopilotSettingsFile::save(parser.value(outputOption).toStdString(), bestSettings))
+    {
+        out << "Can't save settings to " << parser.value(outputOption) << "\n";
+        return 1;
+    }
+
+    out << "Settings saved to " << parser.value(outputOption) << "\n";
+
+    return 0;
+}
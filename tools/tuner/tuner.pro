@@ -0,0 +1,6 @@
+include(../common.pri)
+
+TARGET = tuner
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,215 @@
+/*
+    trackmapwidget.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <QPainter>
+#include <QPolygonF>
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include "trackmapwidget.h"
+
+static const Qt::GlobalColor vesselColors[] =
+{
+    Qt::darkBlue, Qt::darkGreen, Qt::darkMagenta, Qt::darkCyan, Qt::darkYellow, Qt::darkGray, Qt::blue, Qt::darkRed
+};
+
+TrackMapWidget::TrackMapWidget(const TrackStore* trackStore, QWidget* parent) :
+    QWidget(parent),
+    trackStore(trackStore)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setCursor(Qt::OpenHandCursor);
+}
+
+void TrackMapWidget::setDestination(const double coord_N, const double coord_E, const double heading, const double nearLimit)
+{
+    destinationSet = true;
+    destination.coord_N = coord_N;
+    destination.coord_E = coord_E;
+    destinationHeading = heading;
+    this->nearLimit = nearLimit;
+}
+
+QPointF TrackMapWidget::toScreen(const double coord_N, const double coord_E) const
+{
+    return QPointF(width() / 2. + (coord_E - center_E) * scale,
+                   height() / 2. - (coord_N - center_N) * scale);
+}
+
+void TrackMapWidget::paintEvent(QPaintEvent* event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+
+    painter.fillRect(rect(), palette().base());
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    TrackStore::Point position;
+    double heading;
+
+    if (follow && trackStore->getPose(followedVessel, position, heading))
+    {
+        center_N = position.coord_N;
+        center_E = position.coord_E;
+    }
+
+    // Visible area (m)
+    TrackStore::Bounds view;
+
+    view.min_N = center_N - height() / 2. / scale;
+    view.max_N = center_N + height() / 2. / scale;
+    view.min_E = center_E - width() / 2. / scale;
+    view.max_E = center_E + width() / 2. / scale;
+
+    if (destinationSet)
+    {
+        const QPointF point = toScreen(destination.coord_N, destination.coord_E);
+
+        painter.setPen(QPen(Qt::gray, 1, Qt::DashLine));
+        painter.drawEllipse(point, nearLimit * scale, nearLimit * scale);
+
+        painter.setPen(QPen(Qt::red, 2));
+        painter.drawLine(point + QPointF(-5, -5), point + QPointF(5, 5));
+        painter.drawLine(point + QPointF(-5, 5), point + QPointF(5, -5));
+        painter.drawLine(point, point + QPointF(sin(destinationHeading), -cos(destinationHeading)) * 20);
+    }
+
+    const std::vector<int> vessels = trackStore->getVessels();
+    uint64_t drawnPoints = 0;
+
+    for (int vessel : vessels)
+    {
+        const QColor color = vesselColors[static_cast<unsigned int>(vessel) % (sizeof(vesselColors) / sizeof(vesselColors[0]))];
+
+        trackPoints.clear();
+        trackStarts.clear();
+        trackStore->getTrack(vessel, view, 0.5 / scale, trackPoints, trackStarts);
+
+        painter.setPen(QPen(color, 1));
+
+        for (size_t line = 0; line < trackStarts.size(); line++)
+        {
+            const size_t end = ((line + 1) < trackStarts.size()) ? trackStarts[line + 1] : trackPoints.size();
+            QPolygonF polyline;
+
+            polyline.reserve(static_cast<int>(end - trackStarts[line]));
+
+            for (size_t i = trackStarts[line]; i < end; i++)
+            {
+                polyline.append(toScreen(trackPoints[i].coord_N, trackPoints[i].coord_E));
+            }
+
+            painter.drawPolyline(polyline);
+        }
+
+        drawnPoints += trackPoints.size();
+
+        // Current pose: triangle pointing to the heading
+        if (trackStore->getPose(vessel, position, heading))
+        {
+            const QPointF point = toScreen(position.coord_N, position.coord_E);
+            const QPointF forward(sin(heading), -cos(heading));
+            const QPointF right(cos(heading), sin(heading));
+            QPolygonF shape;
+
+            shape << point + forward * 10 << point - forward * 6 + right * 5 << point - forward * 6 - right * 5;
+
+            painter.setPen(QPen(color, 1));
+            painter.setBrush((vessel == followedVessel) ? QBrush(color) : Qt::NoBrush);
+            painter.drawPolygon(shape);
+            painter.setBrush(Qt::NoBrush);
+        }
+    }
+
+    // Scale bar (1, 2 or 5 * 10^n m, about 100 pixels)
+    const double barMeters = pow(10, floor(log10(100 / scale)));
+    const double barLength = (100 / scale >= 5 * barMeters) ? 5 * barMeters :
+                             (100 / scale >= 2 * barMeters) ? 2 * barMeters : barMeters;
+    const int barY = height() - 8;
+
+    painter.setPen(palette().text().color());
+    painter.drawLine(QPointF(8, barY), QPointF(8 + barLength * scale, barY));
+    painter.drawText(QPointF(8, barY - 4), QString::number(barLength) + " m");
+
+    painter.drawText(QPointF(4, fontMetrics().ascent() + 2),
+                     (follow ? "Following vessel " + QString::number(followedVessel) : QString("Double click to follow")) +
+                     ", points: " + QString::number(drawnPoints) + "/" + QString::number(trackStore->getPointCount()));
+}
+
+void TrackMapWidget::wheelEvent(QWheelEvent* event)
+{
+    const double factor = (event->angleDelta().y() > 0) ? 1.25 : (event->angleDelta().y() < 0) ? 0.8 : 1;
+    const double newScale = std::fmin(std::fmax(scale * factor, 1e-4), 1e3);
+
+    // Point under the cursor stays in place (center in followed mode)
+    if (!follow)
+    {
+        const QPointF cursor = event->posF();
+        const double cursor_N = center_N - (cursor.y() - height() / 2.) / scale;
+        const double cursor_E = center_E + (cursor.x() - width() / 2.) / scale;
+
+        center_N = cursor_N + (cursor.y() - height() / 2.) / newScale;
+        center_E = cursor_E - (cursor.x() - width() / 2.) / newScale;
+    }
+
+    scale = newScale;
+    update();
+    event->accept();
+}
+
+void TrackMapWidget::mousePressEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton)
+    {
+        dragging = true;
+        dragStart = event->pos();
+        setCursor(Qt::ClosedHandCursor);
+    }
+}
+
+void TrackMapWidget::mouseMoveEvent(QMouseEvent* event)
+{
+    if (dragging)
+    {
+        const QPoint delta = event->pos() - dragStart;
+
+        follow = false;
+        center_N += delta.y() / scale;
+        center_E -= delta.x() / scale;
+        dragStart = event->pos();
+        update();
+    }
+}
+
+void TrackMapWidget::mouseReleaseEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton)
+    {
+        dragging = false;
+        setCursor(Qt::OpenHandCursor);
+    }
+}
+
+void TrackMapWidget::mouseDoubleClickEvent(QMouseEvent* event)
+{
+    Q_UNUSED(event);
+
+    follow = true;
+    update();
+}
@@ -0,0 +1,79 @@
+/*
+    trackmapwidget.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRACKMAPWIDGET_H
+#define TRACKMAPWIDGET_H
+
+#include <vector>
+#include <QWidget>
+#include <QPoint>
+#include <QPointF>
+#include "trackstore.h"
+
+// North-up N/E map of the tracks in a TrackStore with the current pose of each
+// vessel, the destination (with heading) and the autopilot's nearLimit circle.
+// Follows the selected vessel until the map is dragged, double click follows again.
+// Mouse wheel zooms around the cursor. Tracks are drawn with the tolerance of
+// half a pixel, so the number of points drawn depends on the view, not on the
+// length of the tracks.
+
+class TrackMapWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TrackMapWidget(const TrackStore* trackStore, QWidget* parent = nullptr);
+
+    // heading in radians
+    void setDestination(const double coord_N, const double coord_E, const double heading, const double nearLimit);
+    void setFollowedVessel(const int vessel) { followedVessel = vessel; }
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    void mouseDoubleClickEvent(QMouseEvent* event) override;
+
+private:
+    const TrackStore* trackStore;
+
+    // View
+    double center_N = 0;
+    double center_E = 0;
+    double scale = 2;               // Pixels / m
+    bool follow = true;
+    int followedVessel = 0;
+
+    bool dragging = false;
+    QPoint dragStart;
+
+    bool destinationSet = false;
+    TrackStore::Point destination;
+    double destinationHeading = 0;
+    double nearLimit = 0;
+
+    // Reused between paints
+    std::vector<TrackStore::Point> trackPoints;
+    std::vector<size_t> trackStarts;
+
+    QPointF toScreen(const double coord_N, const double coord_E) const;
+};
+
+#endif // TRACKMAPWIDGET_H
@@ -0,0 +1,294 @@
+/*
+    trackstore.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <utility>
+#include "trackstore.h"
+
+const double TrackStore::tierTolerances[TrackStore::tierCount] = { 0.1, 0.5, 2, 10, 50, 250 };
+
+void TrackStore::Bounds::set(const Point& point)
+{
+    min_N = max_N = point.coord_N;
+    min_E = max_E = point.coord_E;
+}
+
+void TrackStore::Bounds::add(const Point& point)
+{
+    min_N = std::fmin(min_N, point.coord_N);
+    max_N = std::fmax(max_N, point.coord_N);
+    min_E = std::fmin(min_E, point.coord_E);
+    max_E = std::fmax(max_E, point.coord_E);
+}
+
+bool TrackStore::Bounds::intersects(const Bounds& other) const
+{
+    return (min_N <= other.max_N) && (max_N >= other.min_N) &&
+            (min_E <= other.max_E) && (max_E >= other.min_E);
+}
+
+TrackStore::TrackStore(const int maxChunksPerVessel) :
+    maxChunksPerVessel(maxChunksPerVessel > 1 ? maxChunksPerVessel : 1)
+{
+
+}
+
+void TrackStore::append(const int vessel, const double coord_N, const double coord_E, const double heading)
+{
+    Track& track = tracks[vessel];
+    const Point point = { coord_N, coord_E };
+
+    track.heading = heading;
+
+    if (!track.chunks.empty() &&
+            (track.position.coord_N == coord_N) && (track.position.coord_E == coord_E))
+    {
+        return;
+    }
+
+    track.position = point;
+
+    if (track.chunks.empty() || (static_cast<int>(track.chunks.back().points.size()) >= chunkSize))
+    {
+        if (!track.chunks.empty())
+        {
+            finishChunk(track.chunks.back());
+        }
+
+        if (static_cast<int>(track.chunks.size()) >= maxChunksPerVessel)
+        {
+            pointCount -= track.chunks.front().points.size();
+            track.chunks.pop_front();
+        }
+
+        Chunk chunk;
+
+        chunk.points.reserve(chunkSize);
+
+        if (!track.chunks.empty())
+        {
+            const Point& previous = track.chunks.back().points.back();
+
+            chunk.points.push_back(previous);
+            chunk.bounds.set(previous);
+            pointCount++;
+        }
+        else
+        {
+            chunk.bounds.set(point);
+        }
+
+        track.chunks.push_back(std::move(chunk));
+    }
+
+    Chunk& chunk = track.chunks.back();
+
+    chunk.points.push_back(point);
+    chunk.bounds.add(point);
+    pointCount++;
+}
+
+void TrackStore::clear(void)
+{
+    tracks.clear();
+    pointCount = 0;
+}
+
+std::vector<int> TrackStore::getVessels(void) const
+{
+    std::vector<int> vessels;
+
+    for (const auto& track : tracks)
+    {
+        vessels.push_back(track.first);
+    }
+
+    return vessels;
+}
+
+bool TrackStore::getPose(const int vessel, Point& position, double& heading) const
+{
+    auto track = tracks.find(vessel);
+
+    if (track == tracks.end())
+    {
+        return false;
+    }
+
+    position = track->second.position;
+    heading = track->second.heading;
+
+    return true;
+}
+
+bool TrackStore::getBounds(const int vessel, Bounds& bounds) const
+{
+    auto track = tracks.find(vessel);
+
+    if (track == tracks.end())
+    {
+        return false;
+    }
+
+    bounds = track->second.chunks.front().bounds;
+
+    for (const Chunk& chunk : track->second.chunks)
+    {
+        bounds.add({ chunk.bounds.min_N, chunk.bounds.min_E });
+        bounds.add({ chunk.bounds.max_N, chunk.bounds.max_E });
+    }
+
+    return true;
+}
+
+uint64_t TrackStore::getPointCount(void) const
+{
+    return pointCount;
+}
+
+void TrackStore::finishChunk(Chunk& chunk)
+{
+    std::vector<int> kept;
+
+    for (int tier = 0; tier < tierCount; tier++)
+    {
+        simplify(chunk.points.data(), static_cast<int>(chunk.points.size()), tierTolerances[tier], kept);
+
+        chunk.tiers[tier].clear();
+        chunk.tiers[tier].reserve(kept.size());
+
+        for (int index : kept)
+        {
+            chunk.tiers[tier].push_back(chunk.points[index]);
+        }
+    }
+}
+
+void TrackStore::simplify(const Point* points, const int count, const double tolerance, std::vector<int>& kept)
+{
+    kept.clear();
+
+    if (count <= 2)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            kept.push_back(i);
+        }
+
+        return;
+    }
+
+    std::vector<bool> keep(count, false);
+    std::vector<std::pair<int, int>> stack;
+
+    keep[0] = true;
+    keep[count - 1] = true;
+    stack.push_back(std::make_pair(0, count - 1));
+
+    // Iterative to keep the stack small also with long straight parts
+    while (!stack.empty())
+    {
+        const int first = stack.back().first;
+        const int last = stack.back().second;
+
+        stack.pop_back();
+
+        const double dN = points[last].coord_N - points[first].coord_N;
+        const double dE = points[last].coord_E - points[first].coord_E;
+        const double length = std::sqrt(dN * dN + dE * dE);
+        double maxDistance = -1;
+        int farthest = -1;
+
+        for (int i = first + 1; i < last; i++)
+        {
+            const double pN = points[i].coord_N - points[first].coord_N;
+            const double pE = points[i].coord_E - points[first].coord_E;
+
+            // Distance from the line (or from the first point if the ends are the same)
+            const double distance = (length > 0) ? std::fabs(pN * dE - pE * dN) / length :
+                                                   std::sqrt(pN * pN + pE * pE);
+
+            if (distance > maxDistance)
+            {
+                maxDistance = distance;
+                farthest = i;
+            }
+        }
+
+        if (maxDistance > tolerance)
+        {
+            keep[farthest] = true;
+            stack.push_back(std::make_pair(first, farthest));
+            stack.push_back(std::make_pair(farthest, last));
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if (keep[i])
+        {
+            kept.push_back(i);
+        }
+    }
+}
+
+void TrackStore::getTrack(const int vessel, const Bounds& view, const double tolerance,
+                          std::vector<Point>& points, std::vector<size_t>& starts) const
+{
+    auto track = tracks.find(vessel);
+
+    if (track == tracks.end())
+    {
+        return;
+    }
+
+    // Coarsest tier within the tolerance (-1 = all points)
+    int tier = -1;
+
+    while (((tier + 1) < tierCount) && (tierTolerances[tier + 1] <= tolerance))
+    {
+        tier++;
+    }
+
+    bool joined = false;
+
+    for (const Chunk& chunk : track->second.chunks)
+    {
+        if (!chunk.bounds.intersects(view))
+        {
+            joined = false;
+            continue;
+        }
+
+        // The chunk still being filled has no tiers
+        const std::vector<Point>& chunkPoints = ((tier >= 0) && !chunk.tiers[tier].empty()) ? chunk.tiers[tier] : chunk.points;
+
+        if (joined)
+        {
+            // First point is the same as the previous chunk's last one
+            points.insert(points.end(), chunkPoints.begin() + 1, chunkPoints.end());
+        }
+        else
+        {
+            starts.push_back(points.size());
+            points.insert(points.end(), chunkPoints.begin(), chunkPoints.end());
+        }
+
+        joined = true;
+    }
+}
@@ -0,0 +1,106 @@
+/*
+    trackstore.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRACKSTORE_H
+#define TRACKSTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <map>
+
+// N/E tracks of vessels for drawing.
+// Each track is stored in chunks of chunkSize points. When a chunk gets full
+// it is simplified (Douglas-Peucker) with each tolerance of tierTolerances
+// and its bounding box is stored, so a view only goes through the chunks it
+// intersects, using the coarsest tier that is still accurate enough for its
+// scale. Points are stored only when the position changes.
+
+class TrackStore
+{
+public:
+    struct Point
+    {
+        double coord_N;
+        double coord_E;
+    };
+
+    struct Bounds
+    {
+        double min_N;
+        double max_N;
+        double min_E;
+        double max_E;
+
+        void set(const Point& point);
+        void add(const Point& point);
+        bool intersects(const Bounds& other) const;
+    };
+
+    static const int chunkSize = 1024;
+    static const int tierCount = 6;
+    static const double tierTolerances[tierCount];  // m, smallest first
+
+    // Oldest chunks of a vessel are dropped when there are more
+    explicit TrackStore(const int maxChunksPerVessel = 4096);
+
+    // heading in radians
+    void append(const int vessel, const double coord_N, const double coord_E, const double heading);
+    void clear(void);
+
+    std::vector<int> getVessels(void) const;
+    bool getPose(const int vessel, Point& position, double& heading) const;
+    bool getBounds(const int vessel, Bounds& bounds) const;
+    uint64_t getPointCount(void) const;
+
+    // Appends polylines of the track's parts in the view, max deviation from the recorded
+    // track is tolerance (m). Polyline i is points[starts[i]]...points[starts[i + 1] - 1]
+    // (or until the end).
+    void getTrack(const int vessel, const Bounds& view, const double tolerance,
+                  std::vector<Point>& points, std::vector<size_t>& starts) const;
+
+    // Douglas-Peucker: Indices of the points to keep (first and last are always kept)
+    static void simplify(const Point* points, const int count, const double tolerance, std::vector<int>& kept);
+
+private:
+    struct Chunk
+    {
+        // First point is the last one of the previous chunk (so that the chunks join)
+        std::vector<Point> points;
+        Bounds bounds;
+
+        // Filled when the chunk is full
+        std::vector<Point> tiers[tierCount];
+    };
+
+    struct Track
+    {
+        std::deque<Chunk> chunks;
+        Point position;
+        double heading = 0;
+    };
+
+    const int maxChunksPerVessel;
+    std::map<int, Track> tracks;
+    uint64_t pointCount = 0;
+
+    void finishChunk(Chunk& chunk);
+};
+
+#endif // TRACKSTORE_H
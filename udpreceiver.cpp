@@ -0,0 +1,279 @@
+/*
+    udpreceiver.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "udpreceiver.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+bool SequenceTracker::isNewer(const int64_t sequence, const int64_t reference)
+{
+    return (sequence > reference) || ((reference - sequence) > restartThreshold);
+}
+
+SequenceTracker::Result SequenceTracker::update(const int64_t sequence, int64_t& cycles)
+{
+    Result result = RESULT_FIRST;
+
+    cycles = 1;
+
+    if (lastSet)
+    {
+        if (sequence > last)
+        {
+            cycles = sequence - last;
+            result = RESULT_NEWER;
+        }
+        else if ((last - sequence) > restartThreshold)
+        {
+            result = RESULT_RESTARTED;
+        }
+        else
+        {
+            return RESULT_STALE;
+        }
+    }
+
+    lastSet = true;
+    last = sequence;
+
+    return result;
+}
+
+void DelayStatistics::add(const int64_t delay)
+{
+    // Clocks of different sources may differ a bit
+    const uint64_t value = (delay > 0) ? delay : 0;
+
+    count++;
+    sum += value;
+    last = value;
+
+    if (value > max)
+    {
+        max = value;
+    }
+}
+
+std::string ReceiveStatistics::toString(void) const
+{
+    char buffer[256];
+
+    snprintf(buffer, sizeof(buffer),
+             "datagrams %llu, kernel drops %llu, queueing delay last/mean/max %.1f/%.1f/%.1f us, "
+             "processing last/mean/max %.1f/%.1f/%.1f us",
+             static_cast<unsigned long long>(datagrams), static_cast<unsigned long long>(kernelDrops),
+             queueingDelay.last / 1000., queueingDelay.getMean() / 1000., queueingDelay.max / 1000.,
+             processingTime.last / 1000., processingTime.getMean() / 1000., processingTime.max / 1000.);
+
+    return buffer;
+}
+
+UdpReceiver::~UdpReceiver()
+{
+    close();
+}
+
+int64_t UdpReceiver::getRealTime(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+#ifdef __linux__
+
+static const int controlSpace = CMSG_SPACE(sizeof(timespec)) + CMSG_SPACE(sizeof(uint32_t));
+
+int UdpReceiver::getControlSpace(void)
+{
+    return controlSpace;
+}
+
+void UdpReceiver::parseControlMessages(const msghdr& message, int64_t& kernelTimestamp, uint64_t& kernelDrops)
+{
+    kernelTimestamp = 0;
+
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&message), cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET)
+        {
+            continue;
+        }
+
+        if (cmsg->cmsg_type == SCM_TIMESTAMPNS)
+        {
+            timespec timestamp;
+            memcpy(&timestamp, CMSG_DATA(cmsg), sizeof(timestamp));
+            kernelTimestamp = static_cast<int64_t>(timestamp.tv_sec) * 1000000000 + timestamp.tv_nsec;
+        }
+        else if (cmsg->cmsg_type == SO_RXQ_OVFL)
+        {
+            // Only included when something has been dropped
+            uint32_t drops;
+            memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+            kernelDrops = drops;
+        }
+    }
+}
+
+bool UdpReceiver::open(const std::string& address, const uint16_t port, const int receiveBufferSize)
+{
+    close();
+
+    sockaddr_in bindAddress;
+    memset(&bindAddress, 0, sizeof(bindAddress));
+    bindAddress.sin_family = AF_INET;
+    bindAddress.sin_port = htons(port);
+
+    if (inet_pton(AF_INET, address.c_str(), &bindAddress.sin_addr) != 1)
+    {
+        return false;
+    }
+
+    fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    const int enable = 1;
+
+    setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+    setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable));
+
+    if (receiveBufferSize > 0)
+    {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBufferSize, sizeof(receiveBufferSize));
+    }
+
+    if (bind(fd, reinterpret_cast<sockaddr*>(&bindAddress), sizeof(bindAddress)) != 0)
+    {
+        close();
+        return false;
+    }
+
+    kernelDrops = 0;
+
+    return true;
+}
+
+void UdpReceiver::close(void)
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+int UdpReceiver::getReceiveBufferSize(void) const
+{
+    int size = 0;
+    socklen_t length = sizeof(size);
+
+    if ((fd < 0) || (getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, &length) != 0))
+    {
+        return 0;
+    }
+
+    return size;
+}
+
+int UdpReceiver::receive(char* buffer, const int bufferSize, DatagramInfo& info)
+{
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    sockaddr_in sender;
+    iovec iov = { buffer, static_cast<size_t>(bufferSize) };
+    alignas(cmsghdr) char control[controlSpace];
+
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_name = &sender;
+    message.msg_namelen = sizeof(sender);
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t length = recvmsg(fd, &message, 0);
+
+    if (length < 0)
+    {
+        return -1;
+    }
+
+    info.senderAddress = ntohl(sender.sin_addr.s_addr);
+    info.senderPort = ntohs(sender.sin_port);
+
+    parseControlMessages(message, info.kernelTimestamp, kernelDrops);
+
+    return static_cast<int>(length);
+}
+
+#else
+
+int UdpReceiver::getControlSpace(void)
+{
+    return 0;
+}
+
+void UdpReceiver::parseControlMessages(const msghdr& message, int64_t& kernelTimestamp, uint64_t& kernelDrops)
+{
+    (void)message;
+    (void)kernelDrops;
+    kernelTimestamp = 0;
+}
+
+bool UdpReceiver::open(const std::string& address, const uint16_t port, const int receiveBufferSize)
+{
+    (void)address;
+    (void)port;
+    (void)receiveBufferSize;
+    return false;
+}
+
+void UdpReceiver::close(void)
+{
+}
+
+int UdpReceiver::getReceiveBufferSize(void) const
+{
+    return 0;
+}
+
+int UdpReceiver::receive(char* buffer, const int bufferSize, DatagramInfo& info)
+{
+    (void)buffer;
+    (void)bufferSize;
+    (void)info;
+    return -1;
+}
+
+#endif
@@ -0,0 +1,134 @@
+/*
+    udpreceiver.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef UDPRECEIVER_H
+#define UDPRECEIVER_H
+
+#include <cstdint>
+#include <string>
+
+struct msghdr;
+
+// Delay statistics (ns)
+struct DelayStatistics
+{
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    uint64_t last = 0;
+
+    void add(const int64_t delay);
+    void reset(void) { *this = DelayStatistics(); }
+    double getMean(void) const { return count ? (static_cast<double>(sum) / count) : 0; }
+};
+
+struct ReceiveStatistics
+{
+    uint64_t datagrams = 0;
+    uint64_t kernelDrops = 0;           // Datagrams dropped by the kernel (receive buffer full)
+    DelayStatistics queueingDelay;      // Kernel receive timestamp -> start of processing
+    DelayStatistics processingTime;     // Start of processing -> autopilot outputs ready
+
+    // One line dump (for logs / headless operation)
+    std::string toString(void) const;
+};
+
+// Sequence numbers of one sender (vessel). A sample is newer if its sequence number
+// is higher than the last one. A sequence number more than restartThreshold below
+// the last one means the sender was restarted (counter started again): It's accepted
+// as a new start instead of being discarded as stale.
+
+class SequenceTracker
+{
+public:
+    enum Result
+    {
+        RESULT_FIRST = 0,               // No earlier sequence number (or after reset)
+        RESULT_NEWER,
+        RESULT_STALE,                   // Not newer than the last one, discard
+        RESULT_RESTARTED
+    };
+
+    static const int64_t restartThreshold = 1000;  // Samples (125 s at the nominal 8 Hz)
+
+    // True if sequence is to be handled as newer than reference (also when restarted)
+    static bool isNewer(const int64_t sequence, const int64_t reference);
+
+    // Cycles is set to the number of sender's cycles since the last accepted sample (1 if first or restarted)
+    Result update(const int64_t sequence, int64_t& cycles);
+    void reset(void) { lastSet = false; }
+
+private:
+    bool lastSet = false;
+    int64_t last = 0;
+};
+
+// UDP receive socket (IPv4) that also gives the kernel's receive timestamp
+// (SO_TIMESTAMPNS) of each datagram and the number of datagrams the kernel
+// has dropped because the receive buffer was full (SO_RXQ_OVFL).
+// Only available on Linux (open() fails elsewhere, use QUdpSocket then).
+
+class UdpReceiver
+{
+public:
+    struct DatagramInfo
+    {
+        int64_t kernelTimestamp;    // ns, CLOCK_REALTIME (0 if not available)
+        uint32_t senderAddress;     // Host byte order
+        uint16_t senderPort;
+    };
+
+    UdpReceiver() {}
+    ~UdpReceiver();
+
+    // receiveBufferSize = 0: system default
+    bool open(const std::string& address, const uint16_t port, const int receiveBufferSize = 0);
+    void close(void);
+    bool isOpen(void) const { return fd >= 0; }
+
+    int getSocketDescriptor(void) const { return fd; }
+
+    // Actual size (kernel doubles the requested size for bookkeeping)
+    int getReceiveBufferSize(void) const;
+
+    // Non-blocking. Returns length of the datagram or -1 if nothing to receive.
+    int receive(char* buffer, const int bufferSize, DatagramInfo& info);
+
+    // Total number of datagrams dropped by the kernel (as of the latest datagram received)
+    uint64_t getKernelDrops(void) const { return kernelDrops; }
+
+    // CLOCK_REALTIME, ns (same clock as the kernel timestamps)
+    static int64_t getRealTime(void);
+
+    // Control space needed for the timestamp and the drop counter
+    static int getControlSpace(void);
+
+    // Reads the timestamp and drop counter from a received message (Linux only).
+    // kernelDrops is left untouched if the message doesn't carry the counter.
+    static void parseControlMessages(const msghdr& message, int64_t& kernelTimestamp, uint64_t& kernelDrops);
+
+private:
+    int fd = -1;
+    uint64_t kernelDrops = 0;
+
+    // Not copyable
+    UdpReceiver(const UdpReceiver&);
+    UdpReceiver& operator=(const UdpReceiver&);
+};
+
+#endif // UDPRECEIVER_H
@@ -0,0 +1,121 @@
+/*
+    workerpool.cpp (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "workerpool.h"
+
+WorkerPool::WorkerPool(unsigned int threadCount) :
+    nextTask(0)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::thread::hardware_concurrency();
+
+        if (threadCount == 0)
+        {
+            threadCount = 1;
+        }
+    }
+
+    this->threadCount = threadCount;
+
+    for (unsigned int i = 1; i < threadCount; i++)
+    {
+        threads.emplace_back(&WorkerPool::threadMain, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+
+    startCondition.notify_all();
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void WorkerPool::work(const unsigned int threadIndex)
+{
+    size_t task;
+
+    while ((task = nextTask.fetch_add(1)) < taskCount)
+    {
+        (*function)(task, threadIndex);
+    }
+}
+
+void WorkerPool::threadMain(const unsigned int threadIndex)
+{
+    unsigned int lastBatch = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            startCondition.wait(lock, [&]() { return quit || (batch != lastBatch); });
+
+            if (quit)
+            {
+                return;
+            }
+
+            lastBatch = batch;
+        }
+
+        work(threadIndex);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (--working == 0)
+            {
+                doneCondition.notify_one();
+            }
+        }
+    }
+}
+
+void WorkerPool::run(const size_t taskCount, const std::function<void(size_t, unsigned int)>& function)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        this->function = &function;
+        this->taskCount = taskCount;
+        nextTask = 0;
+        working = static_cast<unsigned int>(threads.size());
+        batch++;
+    }
+
+    startCondition.notify_all();
+
+    work(0);
+
+    // Other threads may still be finishing their last tasks
+    std::unique_lock<std::mutex> lock(mutex);
+
+    doneCondition.wait(lock, [&]() { return working == 0; });
+
+    this->function = nullptr;
+}
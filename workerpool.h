@@ -0,0 +1,66 @@
+/*
+    workerpool.h (part of SimFerryController)
+    Copyright (C) 2020 Pasi Nuutinmaki (gnssstylist<at>sci<dot>fi)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads for running batches of tasks (e.g. the missions of
+// MissionSimulator::runMissions). The threads are kept between the batches, so
+// a batch only costs a wakeup. Tasks of a batch are handed out one at a time in
+// order, so they should be large enough to make that negligible.
+
+class WorkerPool
+{
+public:
+    // 0 = number of cores
+    explicit WorkerPool(unsigned int threadCount = 0);
+    ~WorkerPool();
+
+    unsigned int getThreadCount(void) const { return threadCount; }
+
+    // Calls function(task, threadIndex) for tasks 0..taskCount-1 on all threads
+    // (including the calling thread, index 0) and returns when all are done.
+    void run(const size_t taskCount, const std::function<void(size_t task, unsigned int threadIndex)>& function);
+
+private:
+    unsigned int threadCount;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable startCondition;
+    std::condition_variable doneCondition;
+
+    const std::function<void(size_t, unsigned int)>* function = nullptr;
+    size_t taskCount = 0;
+    std::atomic<size_t> nextTask;
+    unsigned int batch = 0;         // Incremented for every run
+    unsigned int working = 0;       // Threads still working on the batch
+    bool quit = false;
+
+    void threadMain(const unsigned int threadIndex);
+    void work(const unsigned int threadIndex);
+};
+
+#endif // WORKERPOOL_H